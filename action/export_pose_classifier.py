@@ -0,0 +1,49 @@
+import argparse
+import joblib
+import numpy as np
+
+# 将 scikit-learn 训练的标准化器和随机森林导出为文本格式，供 Qt 程序中的 PoseClassifier 加载
+# 格式:
+#   POSE_CLASSIFIER 1
+#   features <n>
+#   classes <k> <类别1> ... <类别k>
+#   mean <n个浮点数>
+#   scale <n个浮点数>
+#   trees <t>
+#   nodes <m>                           (每棵树)
+#   <left> <right> <feature> <threshold> <p1> ... <pk>   (每个节点，叶子节点 left=-1)
+
+def export(model_path, scaler_path, output_path):
+    model = joblib.load(model_path)
+    scaler = joblib.load(scaler_path)
+
+    n_features = scaler.mean_.shape[0]
+    classes = [int(c) for c in model.classes_]
+
+    with open(output_path, "w") as f:
+        f.write("POSE_CLASSIFIER 1\n")
+        f.write(f"features {n_features}\n")
+        f.write(f"classes {len(classes)} {' '.join(str(c) for c in classes)}\n")
+        f.write("mean " + " ".join(f"{v:.9g}" for v in scaler.mean_) + "\n")
+        f.write("scale " + " ".join(f"{v:.9g}" for v in scaler.scale_) + "\n")
+        f.write(f"trees {len(model.estimators_)}\n")
+
+        for est in model.estimators_:
+            tree = est.tree_
+            f.write(f"nodes {tree.node_count}\n")
+            for i in range(tree.node_count):
+                value = tree.value[i][0]
+                total = value.sum()
+                proba = value / total if total > 0 else value  # 叶子节点类别概率
+                f.write(f"{tree.children_left[i]} {tree.children_right[i]} {tree.feature[i]} "
+                        f"{tree.threshold[i]:.9g} " + " ".join(f"{p:.6g}" for p in proba) + "\n")
+
+    print(f"已导出 {len(model.estimators_)} 棵树到 {output_path}")
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="导出动作分类模型")
+    parser.add_argument("--model", default="models/pose_classifier.pkl")
+    parser.add_argument("--scaler", default="models/scaler.pkl")
+    parser.add_argument("--output", default="models/pose_classifier.txt")
+    args = parser.parse_args()
+    export(args.model, args.scaler, args.output)
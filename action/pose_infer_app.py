@@ -9,6 +9,7 @@ import joblib
 from concurrent.futures import ThreadPoolExecutor
 import warnings
 import signal
+import sys
 warnings.filterwarnings("ignore")  # 忽略警告
 
 import logging
@@ -39,6 +40,16 @@ LIB_PATH = "/home/elf/action/rknn_yolov8_pose_demo/lib"
 CLASSIFIER_PATH = "/home/elf/action/rknn_yolov8_pose_demo/model/pose_classifier.pkl"
 SCALER_PATH = "/home/elf/action/rknn_yolov8_pose_demo/model/scaler.pkl"
 
+# 本地消息总线，动作事件同时发布给Qt程序和物联网模块
+sys.path.insert(0, "/home/elf/ipc")
+import camera_ring  # 采集进程 camera_broker 运行时从共享内存取帧，与人脸识别共用摄像头
+try:
+    from msg_bus import MsgBus
+    bus = MsgBus("pose")
+except Exception as e:
+    print(f"消息总线不可用: {str(e)}")
+    bus = None
+
 # 处理间隔配置
 PROCESS_INTERVAL = 1  # 处理间隔
 EXIT_FLAG = False       # 全局退出标志
@@ -75,7 +86,7 @@ max_workers = 2     # 最大并发任务数
 last_trigger_time = 0
 TRIGGER_COOLDOWN = 5  # 触发冷却时间
 
-def send_trigger_signal(): # 发送信号给QT
+def send_trigger_signal(label, confidence): # 发送信号给QT
     global last_trigger_time
     current_time = time.time()
     
@@ -83,6 +94,8 @@ def send_trigger_signal(): # 发送信号给QT
     if current_time - last_trigger_time >= TRIGGER_COOLDOWN:
         # 发送触发信号
         print("ACTION_TRIGGER:1", flush=True)
+        if bus is not None:
+            bus.publish_action(0, int(label), float(confidence))
         #print(f"已发送触发信号给QT程序 (时间: {current_time})")
         last_trigger_time = current_time
     else:
@@ -157,7 +170,7 @@ def process_image(img_path): # 识别动作
                             logging.info(f"检测到动作: {predicted_action}")
                             
                             # 发送信号给QT
-                            send_trigger_signal()
+                            send_trigger_signal(predicted_class, max(proba))
                     
                 except Exception as e:
                     print(f"\n动作预测过程中出错: {str(e)}")
@@ -187,7 +200,7 @@ def process_image(img_path): # 识别动作
 executor = ThreadPoolExecutor(max_workers=max_workers)
 
 # 初始化摄像头
-cap = cv2.VideoCapture('/dev/video11')
+cap = camera_ring.VideoCapture('/dev/video11')
 if not cap.isOpened():
     print("无法打开摄像头")
     exit()
@@ -233,6 +246,9 @@ finally:
     
     #print("清理OpenCV资源...")
     cv2.destroyAllWindows()
+
+    if bus is not None:
+        bus.close()
     
     end_time = time.time()
     duration = end_time - start_time
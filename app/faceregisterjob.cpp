@@ -0,0 +1,139 @@
+/*****************************************************************************/
+/* 头文件                                                                     */
+/*****************************************************************************/
+#include "faceregisterjob.h"
+
+#include <QTimer>
+
+/*****************************************************************************/
+/* 函数定义                                                                   */
+/*****************************************************************************/
+FaceRegisterJob::FaceRegisterJob(const QString &scriptPath, QObject *parent)
+    : QObject(parent), scriptPath(scriptPath), cancelRequested(false), committed(false)
+{
+    process = new QProcess(this);
+    connect(process, &QProcess::readyReadStandardOutput, this, &FaceRegisterJob::readOutput);
+    connect(process, &QProcess::readyReadStandardError, this, &FaceRegisterJob::readError);
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+            this, &FaceRegisterJob::processFinished);
+    connect(process, &QProcess::errorOccurred, this, &FaceRegisterJob::processError);
+}
+
+/* 启动注册脚本，不等待其结束 */
+bool FaceRegisterJob::start(const QString &id, const QString &name)
+{
+    if(isRunning())
+    {
+        return false;
+    }
+
+    cancelRequested = false;
+    committed = false;
+    outputBuffer.clear();
+
+    process->start("python", QStringList() << scriptPath << "--id" << id << "--name" << name);
+    return true;
+}
+
+/* 取消注册：先发送 SIGTERM 让脚本清理已保存的照片，超时后强制结束 */
+void FaceRegisterJob::cancel()
+{
+    if(!isRunning() || cancelRequested)
+    {
+        return;
+    }
+
+    cancelRequested = true;
+    process->terminate();
+
+    QTimer::singleShot(FACE_REGISTER_KILL_MS, this, [=]() {
+        if(cancelRequested && isRunning())
+        {
+            process->kill();
+        }
+    });
+}
+
+/* 按行解析脚本输出 */
+void FaceRegisterJob::readOutput()
+{
+    outputBuffer.append(process->readAllStandardOutput());
+
+    int pos;
+    while((pos = outputBuffer.indexOf('\n')) >= 0)
+    {
+        QString line = QString::fromUtf8(outputBuffer.left(pos)).trimmed();
+        outputBuffer.remove(0, pos + 1);
+        if(!line.isEmpty())
+        {
+            parseLine(line);
+        }
+    }
+}
+
+void FaceRegisterJob::readError()
+{
+    QString text = QString::fromUtf8(process->readAllStandardError()).trimmed();
+    if(!text.isEmpty())
+    {
+        emit message(QString("人脸注册脚本错误: %1").arg(text));
+    }
+}
+
+/* 进度行格式: PROGRESS <阶段> <序号>，其余输出原样转发 */
+void FaceRegisterJob::parseLine(const QString &line)
+{
+    if(!line.startsWith("PROGRESS "))
+    {
+        emit message(line);
+        return;
+    }
+
+    QStringList fields = line.split(' ', QString::SkipEmptyParts);
+    QString stage = fields.value(1);
+    int index = fields.value(2).toInt();
+
+    if(stage == "captured")
+    {
+        emit progress(FrameCaptured, index);
+    }
+    else if(stage == "extracted")
+    {
+        emit progress(FeatureExtracted, index);
+    }
+    else if(stage == "checked")
+    {
+        emit progress(SimilarityChecked, index);
+    }
+    else if(stage == "committed")
+    {
+        committed = true;
+        emit progress(Committed, index);
+    }
+}
+
+void FaceRegisterJob::processFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    QString rest = QString::fromUtf8(outputBuffer).trimmed();
+    outputBuffer.clear();
+    if(!rest.isEmpty())
+    {
+        parseLine(rest);
+    }
+
+    //以是否写入人脸库为准，写入后到达的取消请求不影响结果
+    bool success = committed && exitStatus == QProcess::NormalExit && exitCode == 0;
+    bool cancelled = cancelRequested && !committed;
+    cancelRequested = false;
+
+    emit finished(success, cancelled);
+}
+
+void FaceRegisterJob::processError(QProcess::ProcessError error)
+{
+    if(error == QProcess::FailedToStart)
+    {
+        emit message("无法启动人脸注册脚本");
+        emit finished(false, false);
+    }
+}
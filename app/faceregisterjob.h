@@ -0,0 +1,61 @@
+#ifndef FACEREGISTERJOB_H
+#define FACEREGISTERJOB_H
+
+/*****************************************************************************/
+/* 头文件                                                                     */
+/*****************************************************************************/
+#include <QObject>
+#include <QProcess>
+#include <QString>
+
+/*****************************************************************************/
+/* 宏定义                                                                     */
+/*****************************************************************************/
+#define FACE_REGISTER_KILL_MS   3000    //取消后等待脚本清理的最长时间(ms)
+
+/*****************************************************************************/
+/* 声明                                                                      */
+/*****************************************************************************/
+/* 异步人脸注册任务：在后台运行注册脚本，解析进度输出，支持取消 */
+class FaceRegisterJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Stage
+    {
+        FrameCaptured,      //拍照完成
+        FeatureExtracted,   //特征提取完成
+        SimilarityChecked,  //相似度校验通过
+        Committed           //已写入人脸库
+    };
+
+    FaceRegisterJob(const QString &scriptPath, QObject *parent = nullptr);
+
+    bool start(const QString &id, const QString &name);    //启动注册，已在运行时返回false
+    void cancel();                                          //请求取消，结果仍通过 finished 返回
+    bool isRunning() const { return process->state() != QProcess::NotRunning; }
+    bool waitForFinished(int msecs) { return process->waitForFinished(msecs); }
+
+signals:
+    void progress(FaceRegisterJob::Stage stage, int index);     //注册进度，index 为照片序号(1~3)
+    void message(const QString &text);                          //脚本普通输出
+    void finished(bool success, bool cancelled);                //注册结束
+
+private slots:
+    void readOutput();
+    void readError();
+    void processFinished(int exitCode, QProcess::ExitStatus exitStatus);
+    void processError(QProcess::ProcessError error);
+
+private:
+    void parseLine(const QString &line);
+
+    QString scriptPath;
+    QProcess *process;
+    QByteArray outputBuffer;
+    bool cancelRequested;
+    bool committed;
+};
+
+#endif
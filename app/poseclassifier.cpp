@@ -0,0 +1,134 @@
+/*****************************************************************************/
+/* 头文件                                                                     */
+/*****************************************************************************/
+#include "poseclassifier.h"
+
+#include <QFile>
+#include <QTextStream>
+
+/*****************************************************************************/
+/* 函数定义                                                                   */
+/*****************************************************************************/
+PoseClassifier::PoseClassifier()
+{
+}
+
+/* 加载导出的文本模型 */
+bool PoseClassifier::load(const QString &path)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return false;
+    }
+
+    QTextStream in(&file);
+    QString tag;
+    int version = 0, featureNum = 0, classNum = 0, treeNum = 0;
+
+    classes.clear();
+    mean.clear();
+    scale.clear();
+    trees.clear();
+    probas.clear();
+
+    in >> tag >> version;
+    if(tag != "POSE_CLASSIFIER" || version != 1)
+    {
+        return false;
+    }
+
+    in >> tag >> featureNum;
+    in >> tag >> classNum;
+    for(int i = 0; i < classNum; i++)
+    {
+        int cls;
+        in >> cls;
+        classes.append(cls);
+    }
+
+    in >> tag;
+    mean.resize(featureNum);
+    for(int i = 0; i < featureNum; i++) in >> mean[i];
+
+    in >> tag;
+    scale.resize(featureNum);
+    for(int i = 0; i < featureNum; i++) in >> scale[i];
+
+    in >> tag >> treeNum;
+    trees.resize(treeNum);
+    for(int t = 0; t < treeNum; t++)
+    {
+        int nodeNum = 0;
+        in >> tag >> nodeNum;
+        trees[t].nodes.resize(nodeNum);
+        for(int n = 0; n < nodeNum; n++)
+        {
+            Node &node = trees[t].nodes[n];
+            in >> node.left >> node.right >> node.feature >> node.threshold;
+            node.probaOffset = probas.size();
+            for(int c = 0; c < classNum; c++)
+            {
+                float p;
+                in >> p;
+                probas.append(p);
+            }
+        }
+    }
+
+    if(in.status() != QTextStream::Ok || featureNum <= 0 || classNum <= 0 || treeNum <= 0)
+    {
+        trees.clear();
+        return false;
+    }
+
+    return true;
+}
+
+/* 预测动作类别 */
+int PoseClassifier::predict(const float *features, float *confidence) const
+{
+    const int classNum = classes.size();
+    QVector<float> scaled(mean.size());
+    QVector<float> votes(classNum, 0.0f);
+
+    if(!isLoaded())
+    {
+        return -1;
+    }
+
+    //标准化
+    for(int i = 0; i < mean.size(); i++)
+    {
+        scaled[i] = (features[i] - mean[i]) / scale[i];
+    }
+
+    //各棵树叶子节点的类别概率取平均
+    for(const Tree &tree : trees)
+    {
+        int idx = 0;
+        while(tree.nodes[idx].left >= 0)
+        {
+            const Node &node = tree.nodes[idx];
+            idx = scaled[node.feature] <= node.threshold ? node.left : node.right;
+        }
+
+        const float *p = probas.constData() + tree.nodes[idx].probaOffset;
+        for(int c = 0; c < classNum; c++)
+        {
+            votes[c] += p[c];
+        }
+    }
+
+    int best = 0;
+    for(int c = 1; c < classNum; c++)
+    {
+        if(votes[c] > votes[best]) best = c;
+    }
+
+    if(confidence)
+    {
+        *confidence = votes[best] / trees.size();
+    }
+    return classes[best];
+}
@@ -0,0 +1,48 @@
+#ifndef POSECLASSIFIER_H
+#define POSECLASSIFIER_H
+
+/*****************************************************************************/
+/* 头文件                                                                     */
+/*****************************************************************************/
+#include <QString>
+#include <QVector>
+
+/*****************************************************************************/
+/* 声明                                                                      */
+/*****************************************************************************/
+/* 动作分类器：标准化 + 随机森林，模型由 action/export_pose_classifier.py 导出 */
+class PoseClassifier
+{
+public:
+    PoseClassifier();
+
+    bool load(const QString &path);     //加载导出的文本模型
+    bool isLoaded() const { return !trees.isEmpty(); }
+    int featureCount() const { return mean.size(); }
+
+    //输入17个关键点的 x,y,conf 共51个特征，返回类别编号，confidence 为该类别概率
+    int predict(const float *features, float *confidence) const;
+
+private:
+    struct Node
+    {
+        int left;           //左子节点，-1 表示叶子
+        int right;
+        int feature;
+        float threshold;
+        int probaOffset;    //叶子节点概率在 probas 中的起始位置
+    };
+
+    struct Tree
+    {
+        QVector<Node> nodes;
+    };
+
+    QVector<int> classes;
+    QVector<float> mean;
+    QVector<float> scale;
+    QVector<Tree> trees;
+    QVector<float> probas;
+};
+
+#endif
@@ -0,0 +1,356 @@
+/*****************************************************************************/
+/* 头文件                                                                     */
+/*****************************************************************************/
+#include "poseengine.h"
+
+#include <QElapsedTimer>
+#include <QVector>
+
+#include <chrono>
+#include <cstring>
+#include <opencv2/opencv.hpp>
+
+#include "yolov8-pose.h"
+#include "../ipc/camera_ring.h"
+
+/*****************************************************************************/
+/* 类型定义                                                                   */
+/*****************************************************************************/
+/* 跟踪目标 */
+struct PoseTrack
+{
+    int id;
+    image_rect_t box;
+    int missed;             //连续未匹配的帧数
+    qint64 lastAlarmMs;     //上次报警时刻，-1 表示未报警
+};
+
+/* RKNN 上下文及跟踪状态，只在工作线程中访问 */
+struct PoseEngineContext
+{
+    rknn_app_context_t rknn;
+    object_detect_result_list results;
+    QVector<PoseTrack> tracks;
+    int nextTrackId;
+};
+
+/*****************************************************************************/
+/* 局部函数                                                                   */
+/*****************************************************************************/
+static float boxIoU(const image_rect_t &a, const image_rect_t &b)
+{
+    int left = qMax(a.left, b.left);
+    int top = qMax(a.top, b.top);
+    int right = qMin(a.right, b.right);
+    int bottom = qMin(a.bottom, b.bottom);
+
+    if(right <= left || bottom <= top)
+    {
+        return 0.0f;
+    }
+
+    float inter = static_cast<float>(right - left) * (bottom - top);
+    float areaA = static_cast<float>(a.right - a.left) * (a.bottom - a.top);
+    float areaB = static_cast<float>(b.right - b.left) * (b.bottom - b.top);
+    return inter / (areaA + areaB - inter);
+}
+
+/* 按IoU贪心匹配，返回每个检测结果对应的跟踪下标 */
+static QVector<int> updateTracks(PoseEngineContext *ctx)
+{
+    QVector<int> assigned(ctx->results.count, -1);
+    QVector<bool> matched(ctx->tracks.size(), false);
+
+    for(int i = 0; i < ctx->results.count; i++)
+    {
+        const image_rect_t &box = ctx->results.results[i].box;
+        float bestIoU = POSE_TRACK_IOU_THRESH;
+        int best = -1;
+
+        for(int t = 0; t < ctx->tracks.size(); t++)
+        {
+            float iou = matched[t] ? 0.0f : boxIoU(box, ctx->tracks[t].box);
+            if(iou >= bestIoU)
+            {
+                bestIoU = iou;
+                best = t;
+            }
+        }
+
+        if(best < 0)
+        {
+            PoseTrack track = { ctx->nextTrackId++, box, 0, -1 };
+            ctx->tracks.append(track);
+            matched.append(true);
+            best = ctx->tracks.size() - 1;
+        }
+        else
+        {
+            ctx->tracks[best].box = box;
+            ctx->tracks[best].missed = 0;
+            matched[best] = true;
+        }
+        assigned[i] = best;
+    }
+
+    //删除长时间丢失的目标，同时修正已分配的下标
+    for(int t = ctx->tracks.size() - 1; t >= 0; t--)
+    {
+        if(!matched[t] && ++ctx->tracks[t].missed > POSE_TRACK_MAX_MISSED)
+        {
+            ctx->tracks.remove(t);
+            for(int &idx : assigned)
+            {
+                if(idx > t) idx--;
+            }
+        }
+    }
+
+    return assigned;
+}
+
+/*****************************************************************************/
+/* 函数定义                                                                   */
+/*****************************************************************************/
+PoseEngine::PoseEngine(const QString &modelPath, const QString &classifierPath,
+                       const QString &cameraDevice, QObject *parent)
+    : QObject(parent), modelPath(modelPath), classifierPath(classifierPath),
+      cameraDevice(cameraDevice), alarmActions({"lying", "standing"}),
+      ctx(new PoseEngineContext()), modelsLoaded(false),
+      running(false), stopRequested(false)
+{
+    memset(&ctx->rknn, 0, sizeof(ctx->rknn));
+    ctx->nextTrackId = 1;
+}
+
+PoseEngine::~PoseEngine()
+{
+    stop();
+
+    if(modelsLoaded)
+    {
+        release_yolov8_pose_model(&ctx->rknn);
+        deinit_post_process();
+    }
+    delete ctx;
+}
+
+/* 类别编号转动作名称，与训练脚本中的 ACTION_MAPPING 一致 */
+QString PoseEngine::actionName(int cls)
+{
+    switch(cls)
+    {
+        case 1: return "lying";
+        case 2: return "sitting";
+        case 3: return "squatting";
+        case 4: return "standing";
+        default: return "Unknown";
+    }
+}
+
+int PoseEngine::actionId(const QString &label)
+{
+    for(int cls = 1; cls <= 4; cls++)
+    {
+        if(actionName(cls) == label) return cls;
+    }
+    return 0;
+}
+
+/* 启动工作线程 */
+bool PoseEngine::start()
+{
+    if(running)
+    {
+        return true;
+    }
+
+    if(worker.joinable())
+    {
+        worker.join();  //回收上次自行退出的线程
+    }
+
+    stopRequested = false;
+    running = true;
+    worker = std::thread(&PoseEngine::run, this);
+    return true;
+}
+
+/* 停止工作线程 */
+void PoseEngine::stop()
+{
+    stopRequested = true;
+    if(worker.joinable())
+    {
+        worker.join();
+    }
+    running = false;
+}
+
+/* 设置需要报警的动作，工作线程在下一帧生效 */
+void PoseEngine::setAlarmActions(const QStringList &labels)
+{
+    std::lock_guard<std::mutex> lock(alarmMutex);
+    alarmActions = labels;
+}
+
+/* 加载检测模型和动作分类模型，只执行一次 */
+bool PoseEngine::loadModels()
+{
+    if(modelsLoaded)
+    {
+        return true;
+    }
+
+    if(!classifier.load(classifierPath))
+    {
+        emit errorOccurred(QString("无法加载动作分类模型 %1").arg(classifierPath));
+        return false;
+    }
+
+    init_post_process();
+    if(init_yolov8_pose_model(modelPath.toStdString().c_str(), &ctx->rknn) != 0)
+    {
+        deinit_post_process();
+        emit errorOccurred(QString("无法加载姿态检测模型 %1").arg(modelPath));
+        return false;
+    }
+
+    modelsLoaded = true;
+    return true;
+}
+
+/* 工作线程主循环 */
+void PoseEngine::run()
+{
+    if(!loadModels())
+    {
+        running = false;
+        return;
+    }
+
+    //采集进程 camera_broker 运行时从共享内存零拷贝取帧，与人脸识别共用摄像头，否则直接打开设备
+    struct camera_ring_t ring;
+    bool ringOpened = camera_ring_open(&ring) == 0;
+    cv::VideoCapture cap;
+    if(!ringOpened && !cap.open(cameraDevice.toStdString()))
+    {
+        emit errorOccurred(QString("无法打开摄像头 %1").arg(cameraDevice));
+        running = false;
+        return;
+    }
+
+    cv::Mat frame, rgb;
+    QElapsedTimer clock;
+    qint64 lastProcessMs = -POSE_PROCESS_INTERVAL_MS;
+    uint64_t lastSeq = 0;
+    float features[17 * 3];
+
+    clock.start();
+    ctx->tracks.clear();
+
+    while(!stopRequested)
+    {
+        if(ringOpened)
+        {
+            //推理间隔内不取帧，也就不占用槽位
+            qint64 waitMs = lastProcessMs + POSE_PROCESS_INTERVAL_MS - clock.elapsed();
+            if(waitMs > 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(waitMs));
+                continue;
+            }
+
+            struct camera_frame_t shared;
+            if(camera_ring_acquire(&ring, lastSeq, POSE_CAMERA_TIMEOUT_MS, &shared) != 0)
+            {
+                if(camera_ring_producer_alive(&ring))
+                {
+                    continue;
+                }
+                emit errorOccurred("摄像头采集进程已退出");
+                break;
+            }
+            lastSeq = shared.seq;
+            lastProcessMs = clock.elapsed();
+
+            //直接在共享帧上转换颜色，转换完成即释放
+            cv::Mat view(static_cast<int>(shared.height), static_cast<int>(shared.width), CV_8UC3,
+                         const_cast<uint8_t *>(shared.data), shared.stride);
+            cv::cvtColor(view, rgb, cv::COLOR_BGR2RGB);
+            camera_ring_release(&ring, &shared);
+        }
+        else
+        {
+            if(!cap.read(frame) || frame.empty())
+            {
+                emit errorOccurred("无法获取摄像头图像");
+                break;
+            }
+
+            qint64 readMs = clock.elapsed();
+            if(readMs - lastProcessMs < POSE_PROCESS_INTERVAL_MS)
+            {
+                continue;
+            }
+            lastProcessMs = readMs;
+
+            cv::cvtColor(frame, rgb, cv::COLOR_BGR2RGB);
+        }
+        qint64 nowMs = lastProcessMs;
+
+        image_buffer_t img;
+        memset(&img, 0, sizeof(img));
+        img.width = rgb.cols;
+        img.height = rgb.rows;
+        img.width_stride = rgb.cols;
+        img.height_stride = rgb.rows;
+        img.format = IMAGE_FORMAT_RGB888;
+        img.virt_addr = rgb.data;
+        img.size = static_cast<int>(rgb.total() * rgb.elemSize());
+        img.fd = -1;
+
+        if(inference_yolov8_pose_model(&ctx->rknn, &img, &ctx->results) != 0)
+        {
+            continue;
+        }
+
+        QVector<int> assigned = updateTracks(ctx);
+
+        QStringList actions;
+        {
+            std::lock_guard<std::mutex> lock(alarmMutex);
+            actions = alarmActions;
+        }
+
+        for(int i = 0; i < ctx->results.count; i++)
+        {
+            const object_detect_result &det = ctx->results.results[i];
+            memcpy(features, det.keypoints, sizeof(features));
+
+            float confidence = 0.0f;
+            QString label = actionName(classifier.predict(features, &confidence));
+            if(!actions.contains(label))
+            {
+                continue;
+            }
+
+            //同一目标在冷却时间内只报警一次
+            PoseTrack &track = ctx->tracks[assigned[i]];
+            if(track.lastAlarmMs >= 0 && nowMs - track.lastAlarmMs < POSE_TRIGGER_COOLDOWN_MS)
+            {
+                continue;
+            }
+            track.lastAlarmMs = nowMs;
+
+            emit actionDetected(track.id, label, confidence);
+        }
+    }
+
+    if(ringOpened)
+    {
+        camera_ring_close(&ring);
+    }
+    cap.release();
+    running = false;
+}
@@ -0,0 +1,73 @@
+#ifndef POSEENGINE_H
+#define POSEENGINE_H
+
+/*****************************************************************************/
+/* 头文件                                                                     */
+/*****************************************************************************/
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "poseclassifier.h"
+
+/*****************************************************************************/
+/* 宏定义                                                                     */
+/*****************************************************************************/
+#define POSE_PROCESS_INTERVAL_MS    200     //两次推理的最小间隔(ms)
+#define POSE_TRIGGER_COOLDOWN_MS    5000    //同一目标两次报警的最小间隔(ms)
+#define POSE_TRACK_IOU_THRESH       0.3f    //跟踪匹配的最小IoU
+#define POSE_TRACK_MAX_MISSED       10      //目标连续丢失多少帧后删除
+#define POSE_CAMERA_TIMEOUT_MS      1000    //从共享内存等待新帧的超时(ms)
+
+/*****************************************************************************/
+/* 声明                                                                      */
+/*****************************************************************************/
+struct PoseEngineContext;
+
+/* 进程内动作识别引擎：摄像头采集 + YOLOv8-pose(RKNN) + 随机森林动作分类，运行在工作线程 */
+class PoseEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    PoseEngine(const QString &modelPath, const QString &classifierPath,
+               const QString &cameraDevice, QObject *parent = nullptr);
+    ~PoseEngine();
+
+    bool start();                   //启动工作线程，模型只在首次启动时加载
+    void stop();                    //停止工作线程并释放摄像头
+    bool isRunning() const { return running; }
+
+    void setAlarmActions(const QStringList &labels);    //工作线程运行时也可调用
+
+    static QString actionName(int cls);             //类别编号转动作名称
+    static int actionId(const QString &label);      //动作名称转类别编号，未知返回0
+
+signals:
+    void actionDetected(int trackId, const QString &label, float confidence);  //检测到报警动作
+    void errorOccurred(const QString &message);                                 //工作线程出错并退出
+
+private:
+    void run();
+    bool loadModels();
+
+    QString modelPath;
+    QString classifierPath;
+    QString cameraDevice;
+    QStringList alarmActions;       //由 alarmMutex 保护，工作线程每帧复制一份
+    std::mutex alarmMutex;
+
+    PoseEngineContext *ctx;
+    PoseClassifier classifier;
+    bool modelsLoaded;
+
+    std::thread worker;
+    std::atomic<bool> running;
+    std::atomic<bool> stopRequested;
+};
+
+#endif
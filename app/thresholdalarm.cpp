@@ -0,0 +1,110 @@
+/*****************************************************************************/
+/* 头文件                                                                     */
+/*****************************************************************************/
+#include "thresholdalarm.h"
+
+/*****************************************************************************/
+/* 函数定义                                                                   */
+/*****************************************************************************/
+ThresholdAlarm::ThresholdAlarm(float lower, float upper, float hysteresis,
+                               qint64 debounceMs, qint64 minIntervalMs)
+    : lower(lower), upper(upper), hysteresis(hysteresis),
+      debounceMs(debounceMs), minIntervalMs(minIntervalMs),
+      currentState(Normal), pendingState(Normal),
+      pendingSinceMs(0), lastEventMs(0), hasEvent(false)
+{
+}
+
+void ThresholdAlarm::setThresholds(float lower, float upper)
+{
+    this->lower = lower;
+    this->upper = upper;
+}
+
+void ThresholdAlarm::setHysteresis(float band)
+{
+    hysteresis = band < 0.0f ? 0.0f : band;
+}
+
+void ThresholdAlarm::setDebounce(qint64 ms)
+{
+    debounceMs = ms;
+}
+
+void ThresholdAlarm::setMinInterval(qint64 ms)
+{
+    minIntervalMs = ms;
+}
+
+void ThresholdAlarm::reset()
+{
+    currentState = Normal;
+    pendingState = Normal;
+    pendingSinceMs = 0;
+    hasEvent = false;
+}
+
+/* 根据当前状态判断采样值所属区间，已报警时需越过回差带才算恢复 */
+ThresholdAlarm::State ThresholdAlarm::classify(float value) const
+{
+    if(currentState == High && value > upper - hysteresis)
+    {
+        return High;
+    }
+    if(currentState == Low && value < lower + hysteresis)
+    {
+        return Low;
+    }
+
+    if(value > upper)
+    {
+        return High;
+    }
+    if(value < lower)
+    {
+        return Low;
+    }
+    return Normal;
+}
+
+/* 输入一次采样，仅在状态切换时返回事件 */
+ThresholdAlarm::Event ThresholdAlarm::update(float value, qint64 nowMs)
+{
+    State candidate = classify(value);
+
+    if(candidate == currentState)
+    {
+        pendingState = currentState;    //抖动结束，放弃待切换状态
+        return NoEvent;
+    }
+
+    if(candidate != pendingState)
+    {
+        pendingState = candidate;       //开始计时新的待切换状态
+        pendingSinceMs = nowMs;
+    }
+
+    if(nowMs - pendingSinceMs < debounceMs)
+    {
+        return NoEvent;                 //持续时间不足
+    }
+
+    if(hasEvent && nowMs - lastEventMs < minIntervalMs)
+    {
+        return NoEvent;                 //限频，保留待切换状态等下次采样
+    }
+
+    currentState = candidate;
+    lastEventMs = nowMs;
+    hasEvent = true;
+
+    switch(currentState)
+    {
+        case Low:
+            return EnterLow;
+        case High:
+            return EnterHigh;
+        default:
+            return Recovered;
+    }
+}
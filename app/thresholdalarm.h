@@ -0,0 +1,62 @@
+#ifndef THRESHOLDALARM_H
+#define THRESHOLDALARM_H
+
+/*****************************************************************************/
+/* 头文件                                                                     */
+/*****************************************************************************/
+#include <QtGlobal>
+
+/*****************************************************************************/
+/* 声明                                                                      */
+/*****************************************************************************/
+/* 阈值报警状态机：回差带 + 最短持续时间消抖 + 边沿事件 + 限频 */
+class ThresholdAlarm
+{
+public:
+    enum State
+    {
+        Normal,     //正常
+        Low,        //低于下限
+        High        //高于上限
+    };
+
+    enum Event
+    {
+        NoEvent,    //状态未变化
+        EnterLow,   //进入低限报警（上升沿）
+        EnterHigh,  //进入高限报警（上升沿）
+        Recovered   //报警解除（下降沿）
+    };
+
+    ThresholdAlarm(float lower = 0.0f, float upper = 0.0f, float hysteresis = 0.0f,
+                   qint64 debounceMs = 0, qint64 minIntervalMs = 0);
+
+    void setThresholds(float lower, float upper);   //设置上下限
+    void setHysteresis(float band);                 //设置回差带宽度
+    void setDebounce(qint64 ms);                    //设置最短持续时间
+    void setMinInterval(qint64 ms);                 //设置两次事件的最小间隔
+    void reset();                                   //复位为正常状态
+
+    Event update(float value, qint64 nowMs);        //输入一次采样，返回产生的事件
+
+    State state() const { return currentState; }
+    float lowerLimit() const { return lower; }
+    float upperLimit() const { return upper; }
+
+private:
+    State classify(float value) const;
+
+    float lower;
+    float upper;
+    float hysteresis;
+    qint64 debounceMs;
+    qint64 minIntervalMs;
+
+    State currentState;
+    State pendingState;
+    qint64 pendingSinceMs;
+    qint64 lastEventMs;
+    bool hasEvent;
+};
+
+#endif
@@ -46,12 +46,12 @@ void UIInit::initUI(Widget *widget)
     bh1750Layout->addWidget(widget->lightDisplay, 1);
 
     /* 人脸注册按钮 */
-    QPushButton *faceRegisterButton = new QPushButton("人脸注册", widget);
-    faceRegisterButton->setFont(font);
-    faceRegisterButton->setFixedSize(125, 40);
-    faceRegisterButton->setEnabled(true);
-    QObject::connect(faceRegisterButton, SIGNAL(clicked()), widget, SLOT(registerFace()));
-    bh1750Layout->addWidget(faceRegisterButton, 1);
+    widget->faceRegisterButton = new QPushButton("人脸注册", widget);
+    widget->faceRegisterButton->setFont(font);
+    widget->faceRegisterButton->setFixedSize(125, 40);
+    widget->faceRegisterButton->setEnabled(true);
+    QObject::connect(widget->faceRegisterButton, SIGNAL(clicked()), widget, SLOT(registerFace()));
+    bh1750Layout->addWidget(widget->faceRegisterButton, 1);
 
     /*人脸考勤按钮*/
     widget->faceAttendanceButton = new QPushButton("人脸考勤", widget);
@@ -68,7 +68,7 @@ void UIInit::initUI(Widget *widget)
     widget->actionRecognitionButton->setEnabled(true);
     widget->actionRecognitionButton->setStyleSheet("QPushButton { color: black; }"
                                                   "QPushButton:disabled { color: gray; }");
-    QObject::connect(widget->actionRecognitionButton, SIGNAL(clicked()), widget, SLOT(togglePoseScript()));
+    QObject::connect(widget->actionRecognitionButton, SIGNAL(clicked()), widget, SLOT(togglePoseRecognition()));
     bh1750Layout->addWidget(widget->actionRecognitionButton, 1);
 
     bh1750ButtonLayout->addLayout(bh1750Layout);
@@ -8,13 +8,29 @@
 /*****************************************************************************/
 /* 程序启动时调用 */
 Widget::Widget(QWidget *parent)
-    : QWidget(parent), dht11_fd(-1), bh1750_fd(-1),
-      dht11WarningShown(false), bh1750WarningShown(false),
-      isPoseScriptRunning(false), actionScriptPaused(false),
-      isFaceAttendanceRunning(false)
+    : QWidget(parent),
+      busOpened(false), busNotifier(nullptr), led_fd(-1),
+      isPoseRecognitionRunning(false), isFaceAttendanceRunning(false),
+      luxAlarm(0.0f, 0.0f, LUX_ALARM_HYSTERESIS, BH1750_ALARM_DEBOUNCE, ALARM_MIN_INTERVAL),
+      tempAlarm(0.0f, 0.0f, TEMP_ALARM_HYSTERESIS, DHT11_ALARM_DEBOUNCE, ALARM_MIN_INTERVAL),
+      humidAlarm(0.0f, 0.0f, HUMID_ALARM_HYSTERESIS, DHT11_ALARM_DEBOUNCE, ALARM_MIN_INTERVAL)
 {
-    poseScriptProcess = new QProcess(this);
-    faceAttendanceProcess = new QProcess(this);
+    poseEngine = new PoseEngine(POSE_MODEL_PATH, POSE_CLASSIFIER_PATH, CAMERA_DEVICE_PATH, this);
+    connect(poseEngine, &PoseEngine::actionDetected, this, &Widget::handlePoseAction);
+    connect(poseEngine, &PoseEngine::errorOccurred, this, &Widget::handlePoseError);
+
+    faceServiceProcess = new QProcess(this);
+    connect(faceServiceProcess, &QProcess::errorOccurred, this, &Widget::handleFaceAttendanceError);
+
+    faceRegisterJob = new FaceRegisterJob(FACE_REGI_FILE_PATH, this);
+    connect(faceRegisterJob, &FaceRegisterJob::progress, this, &Widget::handleFaceRegisterProgress);
+    connect(faceRegisterJob, &FaceRegisterJob::message, this, &Widget::handleFaceRegisterMessage);
+    connect(faceRegisterJob, &FaceRegisterJob::finished, this, &Widget::handleFaceRegisterFinished);
+
+    faceSocket = new QLocalSocket(this);
+    connect(faceSocket, SIGNAL(readyRead()), this, SLOT(handleFaceServiceReply()));
+    connect(faceSocket, SIGNAL(error(QLocalSocket::LocalSocketError)), this, SLOT(handleFaceServiceError(QLocalSocket::LocalSocketError)));
+
     UIInit::initUI(this);
     initDevices();
 
@@ -33,18 +49,19 @@ Widget::Widget(QWidget *parent)
     humidMinInput->setText(QString::number(humidMin));
     humidMaxInput->setText(QString::number(humidMax));
 
-    //初始化摄像头状态文件
-    initializeCameraStateFile();
+    //阈值缓存到报警状态机，采样时不再解析输入框
+    applyAlarmThresholds();
+    alarmClock.start();
 
-    //BH1750数据更新定时器 (1秒)
-    QTimer *bh1750Timer = new QTimer(this);
-    connect(bh1750Timer, SIGNAL(timeout()), this, SLOT(updateBH1750Data()));
-    bh1750Timer->start(1000);
+    //打开消息总线并发布摄像头初始状态
+    initMessageBus();
+    publishCameraState(0);
 
-    //DHT11数据更新定时器 (2秒)
-    QTimer *dht11Timer = new QTimer(this);
-    connect(dht11Timer, SIGNAL(timeout()), this, SLOT(updateDHT11Data()));
-    dht11Timer->start(2000);
+    //启动常驻人脸识别服务，避免每次考勤重新加载模型
+    startFaceService();
+
+    //传感器采样由汇集线程推送，阈值就绪后再启动
+    startSensorHub();
 
     //启动定时器更新时间
     QTimer *timeTimer = new QTimer(this);
@@ -80,22 +97,32 @@ Widget::Widget(QWidget *parent)
 /* 程序结束时调用 */
 Widget::~Widget()
 {
-    if (isPoseScriptRunning)
+    sensorHub.stop();   //先停止汇集线程，析构过程中不再发出采样信号
+    poseEngine->stop();
+
+    if (faceRegisterJob->isRunning())
     {
-        poseScriptProcess->terminate();
-        poseScriptProcess->waitForFinished();
+        disconnect(faceRegisterJob, nullptr, this, nullptr);
+        faceRegisterJob->cancel();
+        faceRegisterJob->waitForFinished(FACE_REGISTER_KILL_MS);  //等待脚本清理已保存的照片
     }
 
-    if (isFaceAttendanceRunning)
+    faceSocket->abort();
+    if (faceServiceProcess->state() != QProcess::NotRunning)
     {
-        faceAttendanceProcess->terminate();
-        faceAttendanceProcess->waitForFinished();
+        disconnect(faceServiceProcess, nullptr, this, nullptr);
+        faceServiceProcess->terminate();
+        faceServiceProcess->waitForFinished();
     }
 
-    if (dht11_fd >= 0) ::close(dht11_fd);
-    if (bh1750_fd >= 0) ::close(bh1750_fd);
+    if (led_fd >= 0)
+    {
+        turnOffLED();
+        ::close(led_fd);
+    }
 
-    updateCameraStateFile("0"); //程序结束时更新摄像头状态文件状态为0
+    publishCameraState(0);  //程序结束时发布摄像头状态为0
+    if (busOpened) msg_bus_close(&bus);
 
     setWindowFlags(Qt::Widget);
     setWindowTitle("传感器数据监控");
@@ -111,37 +138,33 @@ Widget::~Widget()
 /* 初始化设备 */
 void Widget::initDevices()
 {
-    dht11_fd = open(DHT11_DEV_NAME, O_RDWR);    //打开DHT11设备
-    if(dht11_fd < 0)
+    led_fd = open(LED_NAME, O_RDWR | O_CLOEXEC);  //打开LED设备，程序运行期间保持打开
+    if(led_fd < 0)
     {
-        QString warningMessage = "DHT11设备未找到！";
-        writeOperationLog(warningMessage);
-
-        //获取当前时间并显示在界面上
-        QDateTime currentTime = QDateTime::currentDateTime();
-        QString timeString = currentTime.toString("yyyy-MM-dd hh:mm:ss");
-        QString warningMessageWithTime = QString(">> %1 %2").arg(timeString).arg(warningMessage);
-        warningTextEdit->append(warningMessageWithTime);
+        writeOperationLog("LED设备未找到！");
+    }
+}
 
+/* 启动传感器汇集：设备只查找一次，采样经排队信号送到界面线程 */
+void Widget::startSensorHub()
+{
+    sensorAddBoardPlugins(sensorHub);
+    connect(this, &Widget::sensorSampleArrived, this, &Widget::handleSensorSample, Qt::QueuedConnection);
+    sensorHub.subscribe([this](const SensorSample &sample)
+    {
+        emit sensorSampleArrived(sample.type, sample.value);
+    });
 
-        if(!dht11WarningShown)      //显示警告弹窗
-        {
-            QMessageBox msgBox(QMessageBox::Warning, "警告", warningMessage, QMessageBox::NoButton, this);
-            QFont font = msgBox.font();
-            font.setPointSize(14);
-            msgBox.setFont(font);
-            msgBox.exec();
-            dht11WarningShown = true;
-        }
+    if(sensorHub.start())
+    {
+        return;
     }
 
-    //查找BH1750和MPU6050设备
-    DIR *dir;
-    struct dirent *entry;
-    dir = opendir("/dev");
-    if(dir == nullptr)
+    //未找到的设备由汇集线程定期重试，接入后自动开始显示
+    std::vector<std::string> missing = sensorHub.missing();
+    for(size_t i = 0; i < missing.size(); i++)
     {
-        QString warningMessage = "无法打开设备目录！";
+        QString warningMessage = QString("%1设备未找到！").arg(QString::fromStdString(missing[i]));
         writeOperationLog(warningMessage);
 
         //获取当前时间并显示在界面上
@@ -149,167 +172,121 @@ void Widget::initDevices()
         QString timeString = currentTime.toString("yyyy-MM-dd hh:mm:ss");
         QString warningMessageWithTime = QString(">> %1 %2").arg(timeString).arg(warningMessage);
         warningTextEdit->append(warningMessageWithTime);
-        return;
+
+        //显示警告弹窗
+        QMessageBox msgBox(QMessageBox::Warning, "警告", warningMessage, QMessageBox::NoButton, this);
+        QFont font = msgBox.font();
+        font.setPointSize(14);
+        msgBox.setFont(font);
+        msgBox.exec();
     }
+}
 
-    while((entry = readdir(dir)) != nullptr)
+/* 处理传感器采样 */
+void Widget::handleSensorSample(int type, float value)
+{
+    switch(type)
     {
-        if(strstr(entry->d_name, "bh1750"))
-        {
-            QString dev_path = QString("/dev/") + QString::fromUtf8(entry->d_name);
-            bh1750_fd = open(dev_path.toStdString().c_str(), O_RDWR);
-            if(bh1750_fd >= 0)
-                break;
-        }
+        case SENSOR_LIGHT:
+            updateLight(value);
+            break;
+        case SENSOR_TEMPERATURE:
+            updateTemperature(value);
+            break;
+        case SENSOR_HUMIDITY:
+            updateHumidity(value);
+            break;
+        default:
+            break;
     }
-    closedir(dir);
+}
+
+/* 更新光强数据 */
+void Widget::updateLight(float lux)
+{
+    lightDisplay->setText(QString::number(static_cast<double>(lux), 'f', 1) + " lx");
 
-    if(bh1750_fd < 0)
+    //仅在报警状态切换时输出信息
+    switch(luxAlarm.update(lux, alarmClock.elapsed()))
     {
-        QString warningMessage = "BH1750设备未找到！";
-        writeOperationLog(warningMessage);
+        case ThresholdAlarm::EnterHigh:
+            reportAlarm(QString("Too Bright! 光照强度:%1 lx 上限:%2 lx").arg(lux, 0, 'f', 2).arg(luxMax, 0, 'f', 2));
+            break;
+        case ThresholdAlarm::EnterLow:
+            reportAlarm(QString("Too Dark! 光照强度:%1 lx 下限:%2 lx").arg(lux, 0, 'f', 2).arg(luxMin, 0, 'f', 2));
+            break;
+        case ThresholdAlarm::Recovered:
+            reportAlarm(QString("光照恢复正常 光照强度:%1 lx").arg(lux, 0, 'f', 2));
+            break;
+        default:
+            break;
+    }
+}
 
-        //获取当前时间并显示在界面上
-        QDateTime currentTime = QDateTime::currentDateTime();
-        QString timeString = currentTime.toString("yyyy-MM-dd hh:mm:ss");
-        QString warningMessageWithTime = QString(">> %1 %2").arg(timeString).arg(warningMessage);
-        warningTextEdit->append(warningMessageWithTime);
+/* 更新温度数据，仅在报警状态切换时输出 */
+void Widget::updateTemperature(float temperature)
+{
+    dhtTempDisplay->setText(QString::number(temperature, 'f', 1) + "°C");
 
-        if(!bh1750WarningShown)     //显示警告弹窗
-        {
-            QMessageBox msgBox(QMessageBox::Warning, "警告", warningMessage, QMessageBox::NoButton, this);
-            QFont font = msgBox.font();
-            font.setPointSize(14);
-            msgBox.setFont(font);
-            msgBox.exec();
-            bh1750WarningShown = true;
-        }
+    switch(tempAlarm.update(temperature, alarmClock.elapsed()))
+    {
+        case ThresholdAlarm::EnterHigh:
+            reportAlarm(QString("Too Hot! 温度:%1℃ 上限:%2℃").arg(temperature, 0, 'f', 1).arg(tempMax, 0, 'f', 1));
+            break;
+        case ThresholdAlarm::EnterLow:
+            reportAlarm(QString("Too Cold! 温度:%1℃ 下限:%2℃").arg(temperature, 0, 'f', 1).arg(tempMin, 0, 'f', 1));
+            break;
+        case ThresholdAlarm::Recovered:
+            reportAlarm(QString("温度恢复正常 温度:%1℃").arg(temperature, 0, 'f', 1));
+            break;
+        default:
+            break;
     }
 }
 
-/* 更新BH1750数据 */
-void Widget::updateBH1750Data()
+/* 更新湿度数据，仅在报警状态切换时输出 */
+void Widget::updateHumidity(float humidity)
 {
-    if (bh1750_fd >= 0)
-    {
-        unsigned short light_data;
-        if (read(bh1750_fd, &light_data, sizeof(unsigned short)) >= 0)
-        {
-            float lux = static_cast<float>(light_data) / 1.2f;
-            lightDisplay->setText(QString::number(static_cast<double>(lux), 'f', 1) + " lx");
+    dhtHumidDisplay->setText(QString::number(humidity, 'f', 1) + "%RH");
 
-            //获取当前时间
-            QDateTime currentTime = QDateTime::currentDateTime();
-            QString timeString = currentTime.toString("yyyy-MM-dd hh:mm:ss");
+    switch(humidAlarm.update(humidity, alarmClock.elapsed()))
+    {
+        case ThresholdAlarm::EnterHigh:
+            reportAlarm(QString("Too Wet! 湿度:%1%RH 上限:%2%RH").arg(humidity, 0, 'f', 1).arg(humidMax, 0, 'f', 1));
+            break;
+        case ThresholdAlarm::EnterLow:
+            reportAlarm(QString("Too Dry! 湿度:%1%RH 下限:%2%RH").arg(humidity, 0, 'f', 1).arg(humidMin, 0, 'f', 1));
+            break;
+        case ThresholdAlarm::Recovered:
+            reportAlarm(QString("湿度恢复正常 湿度:%1%RH").arg(humidity, 0, 'f', 1));
+            break;
+        default:
+            break;
+    }
+}
 
-            //从输入框获取当前阈值
-            float luxMin = luxMinInput->text().toFloat();
-            float luxMax = luxMaxInput->text().toFloat();
+/* 报警信息写入界面和操作日志 */
+void Widget::reportAlarm(const QString &message)
+{
+    QString timeString = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
+    warningTextEdit->append(QString(">> %1 %2").arg(timeString).arg(message));
 
-            //判断当前光照强度是否在阈值范围内
-            bool isTooBright = lux > luxMax;
-            bool isTooDark = lux < luxMin;
+    writeOperationLog(message);  //写入操作日志
 
-            if(isTooBright || isTooDark)
-            {
-                QString warningMessage;
-                if (isTooBright)
-                {
-                    warningMessage = QString("Too Bright! 光照强度:%1 lx 上限:%2 lx").arg(lux, 0, 'f', 2).arg(luxMax, 0, 'f', 2);
-                }
-                else
-                {
-                    warningMessage = QString("Too Dark! 光照强度:%1 lx 下限:%2 lx").arg(lux, 0, 'f', 2).arg(luxMin, 0, 'f', 2);
-                }
-
-                //添加警告信息到QTextEdit控件
-                QString warningMessageWithTime = QString(">> %1 %2").arg(timeString).arg(warningMessage);
-                warningTextEdit->append(warningMessageWithTime);
-
-                writeOperationLog(warningMessage);  //写入操作日志
-
-                QStringList lines = warningTextEdit->toPlainText().split('\n');
-                if(lines.size() > 12)   //限制警告信息的最大行数为12行
-                {
-                    QString newText = lines.mid(1).join('\n');
-                    warningTextEdit->setPlainText(newText);
-                }
-            }
-        }
+    QStringList lines = warningTextEdit->toPlainText().split('\n');
+    if(lines.size() > WARNING_MAX_LINES)   //限制警告信息的最大行数
+    {
+        QString newText = lines.mid(lines.size() - WARNING_MAX_LINES).join('\n');
+        warningTextEdit->setPlainText(newText);
     }
 }
 
-/* 更新DHT11数据 */
-void Widget::updateDHT11Data()
+/* 将缓存的阈值同步到报警状态机 */
+void Widget::applyAlarmThresholds()
 {
-    if (dht11_fd >= 0)
-    {
-        unsigned char DHT11_data[5];
-        if(ioctl(dht11_fd, DHT11_READ_DATA, DHT11_data) >= 0)
-        {
-            if(DHT11_data[4] == 1)
-            {
-                //获取温度和湿度值
-                float temperature = DHT11_data[2] + static_cast<float>(DHT11_data[3]) / 10.0f;
-                float humidity = DHT11_data[0] + static_cast<float>(DHT11_data[1]) / 10.0f;
-
-                dhtTempDisplay->setText(QString::number(temperature, 'f', 1) + "°C");
-                dhtHumidDisplay->setText(QString::number(humidity, 'f', 1) + "%RH");
-
-                //获取当前时间
-                QDateTime currentTime = QDateTime::currentDateTime();
-                QString timeString = currentTime.toString("yyyy-MM-dd hh:mm:ss");
-
-                //从输入框获取当前阈值
-                float tempMin = tempMinInput->text().toFloat();
-                float tempMax = tempMaxInput->text().toFloat();
-                float humidMin = humidMinInput->text().toFloat();
-                float humidMax = humidMaxInput->text().toFloat();
-
-                //判断温湿度是否超出阈值
-                bool isTooHot = temperature > tempMax;
-                bool isTooCold = temperature < tempMin;
-                bool isTooWet = humidity > humidMax;
-                bool isTooDry = humidity < humidMin;
-
-                //若超出阈值，则生成警告信息
-                if(isTooHot || isTooCold || isTooWet || isTooDry)
-                {
-                    QString warningMessage;
-
-                    if(isTooHot)
-                    {
-                        warningMessage = QString("Too Hot! 温度:%1℃ 上限:%2℃").arg(temperature, 0, 'f', 1).arg(tempMax, 0, 'f', 1);
-                    }
-                    else if(isTooCold)
-                    {
-                        warningMessage = QString("Too Cold! 温度:%1℃ 下限:%2℃").arg(temperature, 0, 'f', 1).arg(tempMin, 0, 'f', 1);
-                    }
-                    else if(isTooWet)
-                    {
-                        warningMessage = QString("Too Wet! 湿度:%1%RH 上限:%2%RH").arg(humidity, 0, 'f', 1).arg(humidMax, 0, 'f', 1);
-                    }
-                    else if(isTooDry)
-                    {
-                        warningMessage = QString("Too Dry! 湿度:%1%RH 下限:%2%RH").arg(humidity, 0, 'f', 1).arg(humidMin, 0, 'f', 1);
-                    }
-
-                    //添加警告信息到QTextEdit控件
-                    QString warningMessageWithTime = QString(">> %1 %2").arg(timeString).arg(warningMessage);
-                    warningTextEdit->append(warningMessageWithTime);
-
-                    writeOperationLog(warningMessage);      //写入操作日志
-
-                    QStringList lines = warningTextEdit->toPlainText().split('\n');
-                    if (lines.size() > 12)  //限制警告信息的最大行数为12行
-                    {
-                        QString newText = lines.mid(1).join('\n');
-                        warningTextEdit->setPlainText(newText);
-                    }
-                }
-            }
-        }
-    }
+    luxAlarm.setThresholds(luxMin, luxMax);
+    tempAlarm.setThresholds(tempMin, tempMax);
+    humidAlarm.setThresholds(humidMin, humidMax);
 }
 
 /* 更新时间显示 */
@@ -374,10 +351,11 @@ void Widget::writeDataToFile()
     //构建传感器数据文件路径，例如 /home/elf/sensor/data/202506/20250608.txt
     QString dataFilePath = QString("/home/elf/sensor/data/%1/%2.txt").arg(monthStr).arg(dateStr);
 
-    //获取传感器数据
-    float temperature = dhtTempDisplay->text().replace("°C", "").toFloat();
-    float humidity = dhtHumidDisplay->text().replace("%RH", "").toFloat();
-    float lightIntensity = lightDisplay->text().replace(" lx", "").toFloat();
+    //获取各传感器最近一次采样，尚无采样时记为0
+    SensorSample sample;
+    float temperature = sensorHub.latest(SENSOR_TEMPERATURE, &sample) ? sample.value : 0.0f;
+    float humidity = sensorHub.latest(SENSOR_HUMIDITY, &sample) ? sample.value : 0.0f;
+    float lightIntensity = sensorHub.latest(SENSOR_LIGHT, &sample) ? sample.value : 0.0f;
 
     //构建要写入的数据行
     QString dataLine = QString("%1 %2℃ %3%RH %4lx")
@@ -406,238 +384,251 @@ void Widget::writeDataToFile()
         QMessageBox::warning(this, "错误", QString("无法打开文件 %1").arg(dataFilePath));
     }
 
-    //更新索引文件，内容为当前日期的年月日
-    QString indexFilePath = INDEX_FILE_PATH;
-    QFile indexFile(indexFilePath);
-    if(indexFile.open(QIODevice::WriteOnly | QIODevice::Text))
-    {
-        QTextStream out(&indexFile);
-        out << dateStr;  //写入当前日期，例如 20250608
-        indexFile.close();
-    }
-    else
+    //通过消息总线发布传感器数据及摄像头状态，供物联网模块上报
+    if (busOpened)
     {
-        QMessageBox::warning(this, "错误", QString("无法打开文件 %1").arg(indexFilePath));
+        msg_bus_publish_sensor(&bus, temperature, humidity, lightIntensity);
     }
+    publishCameraState(isPoseRecognitionRunning ? 1 : 0);
 }
 
 /* 动作识别 */
-void Widget::togglePoseScript()
+void Widget::togglePoseRecognition()
 {
-    QString scriptPath = POSE_RECO_FILE_PATH;
-
-    if (!QFile::exists(scriptPath))
-    {
-        QString warningMessage = "找不到/无法打开动作识别脚本";
-        QString formattedWarningMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(warningMessage);
-
-        warningTextEdit->append(formattedWarningMessage);
-        writeOperationLog(warningMessage);
-        return;
-    }
-
-    if (!isPoseScriptRunning)
+    if (!isPoseRecognitionRunning)
     {
-        poseScriptProcess->start("python", QStringList() << scriptPath);
-        if (poseScriptProcess->waitForStarted())
-        {
-            isPoseScriptRunning = true;
-            actionRecognitionButton->setText("停止动作识别");
-
-            //更新摄像头状态文件状态
-            updateCameraStateFile("1");
-            QString message = "动作识别已开启";
-            QString formattedMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(message);
-            warningTextEdit->append(formattedMessage);
-            writeOperationLog(message);
+        poseEngine->start();
+        isPoseRecognitionRunning = true;
+        actionRecognitionButton->setText("停止动作识别");
 
-            //连接输出信号到槽函数
-            connect(poseScriptProcess, &QProcess::readyReadStandardOutput,
-                    this, &Widget::handlePoseScriptOutput);
-
-            //连接错误信号到槽函数
-            connect(poseScriptProcess, &QProcess::readyReadStandardError, this, [=]() {
-                QByteArray errorData = poseScriptProcess->readAllStandardError();
-                QString errorMessage = QString::fromUtf8(errorData);
-                QString formattedErrorMessage = QString(">> %1 动作识别脚本错误:\n%2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(errorMessage);
-                warningTextEdit->append(formattedErrorMessage);
-                writeOperationLog(errorMessage);
-            });
-        }
-        else
-        {
-            QByteArray errorData = poseScriptProcess->readAllStandardError();
-            QString errorMessage = QString("无法启动动作识别脚本:\n%1").arg(QString::fromUtf8(errorData));
-            QString formattedErrorMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(errorMessage);
-            warningTextEdit->append(formattedErrorMessage);
-            writeOperationLog(errorMessage);
-            actionRecognitionButton->setText("动作识别");
-        }
+        //发布摄像头状态
+        publishCameraState(1);
+        QString message = "动作识别已开启";
+        QString formattedMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(message);
+        warningTextEdit->append(formattedMessage);
+        writeOperationLog(message);
     }
     else
     {
-        poseScriptProcess->terminate();
-        if (poseScriptProcess->waitForFinished())
-        {
-            isPoseScriptRunning = false;
-            actionRecognitionButton->setText("动作识别");
+        poseEngine->stop();
+        isPoseRecognitionRunning = false;
+        actionRecognitionButton->setText("动作识别");
+        turnOffLED();
 
-            //更新摄像头状态文件状态
-            updateCameraStateFile("0");
+        //发布摄像头状态
+        publishCameraState(0);
 
-            QString message = "动作识别已关闭";
-            QString formattedMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(message);
-            warningTextEdit->append(formattedMessage);
-            writeOperationLog(message);
-        }
-        else
-        {
-            QString errorMessage = "无法停止动作识别脚本";
-            QString formattedErrorMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(errorMessage);
-            warningTextEdit->append(formattedErrorMessage);
-            writeOperationLog(errorMessage);
-        }
+        QString message = "动作识别已关闭";
+        QString formattedMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(message);
+        warningTextEdit->append(formattedMessage);
+        writeOperationLog(message);
     }
 }
 
-/* 设置LED为亮 */
-void Widget::turnOnLED()
+/* 点亮LED，驱动在保持时间后熄灭，再次报警时重新计时 */
+void Widget::latchLED(unsigned int holdMs)
 {
-    int fd = open(LED_NAME, O_RDWR);
-    if (fd < 0)
+    struct led_pattern_req req = {LED_PATTERN_LATCH, 1, holdMs, 0};
+
+    if (led_fd < 0)
     {
-        perror("Open LED Failed!\n");
         return;
     }
-    ioctl(fd, SET_LED_ON);
-    ::close(fd);
+    if (ioctl(led_fd, SET_LED_PATTERN, &req) < 0)
+    {
+        perror("LED pattern failed");
+    }
 }
 
-/* 设置LED为亮 */
+/* 设置LED为灭 */
 void Widget::turnOffLED()
 {
-    int fd = open(LED_NAME, O_RDWR);
-    if (fd < 0)
+    if (led_fd < 0)
     {
-        perror("Open LED Failed!\n");
         return;
     }
-    ioctl(fd, SET_LED_OFF);
-    ::close(fd);
+    ioctl(led_fd, SET_LED_OFF);
 }
 
-/* 处理动作识别脚本输出 */
-void Widget::handlePoseScriptOutput()
+/* 处理动作识别事件 */
+void Widget::handlePoseAction(int trackId, const QString &label, float confidence)
 {
-    while (poseScriptProcess->canReadLine())
+    QString message = QString("检测到动作: %1 (目标%2 置信度%3)").arg(label).arg(trackId).arg(confidence, 0, 'f', 2);
+    QString formattedMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(message);
+    warningTextEdit->append(formattedMessage);
+    writeOperationLog(message);
+
+    //亮灯并在保持时间后熄灭
+    latchLED(POSE_LED_HOLD_MS);
+
+    if (busOpened)
     {
-        QString output = poseScriptProcess->readLine().trimmed();
-        QString formattedOutputMessage = QString(">> %1 动作识别脚本输出: %2")
-            .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss"))
-            .arg(output);
+        msg_bus_publish_action(&bus, trackId, PoseEngine::actionId(label), confidence);
+    }
+}
 
-        warningTextEdit->append(formattedOutputMessage);
-        writeOperationLog(output);
+/* 处理动作识别引擎错误 */
+void Widget::handlePoseError(const QString &message)
+{
+    QString formattedMessage = QString(">> %1 动作识别错误: %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(message);
+    warningTextEdit->append(formattedMessage);
+    writeOperationLog(message);
 
-        //检查是否是触发信号
-        if(output == "ACTION_TRIGGER:1")
-        {
-            turnOnLED();  //亮灯
-        } 
-        else
-        {
-            turnOffLED();  //灭灯
-        }
+    //工作线程已退出，恢复按钮状态
+    if (isPoseRecognitionRunning && !poseEngine->isRunning())
+    {
+        isPoseRecognitionRunning = false;
+        actionRecognitionButton->setText("动作识别");
+        publishCameraState(0);
     }
 }
 
-/* 人脸考勤 */
-void Widget::toggleFaceAttendance()
+/* 启动常驻人脸识别服务，模型和人脸库在服务启动时加载一次 */
+void Widget::startFaceService()
 {
-    QString scriptPath = FACE_RECO_FILE_PATH;
+    QString scriptPath = FACE_SERVICE_FILE_PATH;
 
     if(!QFile::exists(scriptPath))
     {
-        QString warningMessage = "找不到/无法打开人脸考勤脚本";
+        QString warningMessage = "找不到/无法打开人脸识别服务脚本";
         QString formattedWarningMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(warningMessage);
-
         warningTextEdit->append(formattedWarningMessage);
         writeOperationLog(warningMessage);
         return;
     }
 
-    //断开之前的信号连接（如果存在），避免重复连接
-    disconnect(faceAttendanceProcess, &QProcess::readyReadStandardOutput, this, nullptr);
-    disconnect(faceAttendanceProcess, &QProcess::readyReadStandardError, this, nullptr);
+    if(faceServiceProcess->state() != QProcess::NotRunning)
+    {
+        return;
+    }
+
+    faceServiceProcess->start("python", QStringList() << scriptPath);
+}
 
-    faceAttendanceProcess->start("python", QStringList() << scriptPath);
+/* 人脸考勤：向常驻服务发送一次识别请求，结果异步返回 */
+void Widget::toggleFaceAttendance()
+{
+    if(faceSocket->state() != QLocalSocket::ConnectedState)
+    {
+        faceSocket->abort();
+        faceSocket->connectToServer(FACE_SERVICE_SOCKET);
+        if(!faceSocket->waitForConnected(FACE_SERVICE_CONNECT_MS))
+        {
+            QString warningMessage = "人脸识别服务未就绪，请稍后重试";
+            QString formattedWarningMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(warningMessage);
+            warningTextEdit->append(formattedWarningMessage);
+            writeOperationLog(warningMessage);
+            isFaceAttendanceRunning = false;
+            faceAttendanceButton->setText("人脸考勤");
+            startFaceService();     //服务未运行时重新拉起
+            return;
+        }
+        faceReplyBuffer.clear();
+    }
 
-    if(faceAttendanceProcess->waitForStarted())
+    //连续考勤：开启后服务端持续识别画面中的所有人脸，考勤记录按批次推送
+    if(isFaceAttendanceRunning)
     {
-        QString message = "人脸考勤已开启";
-        QString formattedMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(message);
-        warningTextEdit->append(formattedMessage);
-        writeOperationLog(message);
+        faceSocket->write("{\"cmd\":\"stream_stop\"}\n");
+    }
+    else
+    {
+        faceSocket->write("{\"cmd\":\"stream_start\"}\n");
+    }
+    faceAttendanceButton->setEnabled(false);    //等待服务端确认
+}
+
+/* 处理人脸识别服务返回结果，每行一个JSON对象 */
+void Widget::handleFaceServiceReply()
+{
+    faceReplyBuffer.append(faceSocket->readAll());
+
+    int pos;
+    while((pos = faceReplyBuffer.indexOf('\n')) >= 0)
+    {
+        QByteArray line = faceReplyBuffer.left(pos);
+        faceReplyBuffer.remove(0, pos + 1);
+
+        QJsonObject reply = QJsonDocument::fromJson(line).object();
+        QString message;
 
-        //连接输出信号到槽函数，用于捕获脚本的输出
-        connect(faceAttendanceProcess, &QProcess::readyReadStandardOutput, this, [=]() {
-            QByteArray outputData = faceAttendanceProcess->readAllStandardOutput();
-            if(!outputData.isEmpty())  //检查是否有数据
+        if(reply.value("event").toString() == "attendance")
+        {
+            //一批考勤记录合并为一条提示
+            QStringList names;
+            QJsonArray records = reply.value("records").toArray();
+            for(const QJsonValue &value : records)
             {
-                QString outputMessage = QString::fromUtf8(outputData);
-                QString formattedOutputMessage = QString(">> %1 人脸考勤脚本输出:\n%2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(outputMessage);
-                warningTextEdit->append(formattedOutputMessage);
-                writeOperationLog(outputMessage);
+                QJsonObject record = value.toObject();
+                names.append(QString("%1(%2)").arg(record.value("name").toString())
+                                              .arg(record.value("id").toVariant().toString()));
             }
-        });
-
-        //连接错误信号到槽函数，用于捕获脚本的错误输出
-        connect(faceAttendanceProcess, &QProcess::readyReadStandardError, this, [=]() {
-            QByteArray errorData = faceAttendanceProcess->readAllStandardError();
-            if(!errorData.isEmpty())  //检查是否有数据
+            message = QString("考勤成功 %1人: %2").arg(records.size()).arg(names.join(" "));
+            if(reply.contains("present"))
             {
-                QString errorMessage = QString::fromUtf8(errorData);
-                QString formattedErrorMessage = QString(">> %1 人脸考勤脚本错误:%2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(errorMessage);
-                warningTextEdit->append(formattedErrorMessage);
-                writeOperationLog(errorMessage);
+                message += QString("（今日已到 %1人）").arg(reply.value("present").toInt());
             }
-        });
+        }
+        else if(reply.contains("streaming"))
+        {
+            isFaceAttendanceRunning = reply.value("streaming").toBool();
+            faceAttendanceButton->setText(isFaceAttendanceRunning ? "停止考勤" : "人脸考勤");
+            faceAttendanceButton->setEnabled(true);
+            message = isFaceAttendanceRunning ? "连续人脸考勤已开启" : "连续人脸考勤已关闭";
+        }
+        else
+        {
+            message = QString("人脸识别服务错误: %1").arg(reply.value("message").toString());
+            faceAttendanceButton->setEnabled(true);
+        }
 
-        //脚本启动后立即返回，不再关注其关闭状态
-        return;
+        QString formattedMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(message);
+        warningTextEdit->append(formattedMessage);
+        writeOperationLog(message);
     }
-    else
+}
+
+/* 处理人脸识别服务连接错误 */
+void Widget::handleFaceServiceError(QLocalSocket::LocalSocketError error)
+{
+    Q_UNUSED(error);
+
+    if(!isFaceAttendanceRunning && faceAttendanceButton->isEnabled())
     {
-        QByteArray errorData = faceAttendanceProcess->readAllStandardError();
-        QString errorMessage = QString("无法启动人脸考勤脚本: %1").arg(QString::fromUtf8(errorData));
-        QString formattedErrorMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(errorMessage);
-        warningTextEdit->append(formattedErrorMessage);
-        writeOperationLog(errorMessage);
-        faceAttendanceButton->setText("人脸考勤");
-        isFaceAttendanceRunning = false;  //启动失败，重置状态标志
+        return;     //空闲时服务端断开不影响使用，下次请求时重连
     }
+
+    QString errorMessage = QString("人脸识别服务连接错误: %1").arg(faceSocket->errorString());
+    QString formattedErrorMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(errorMessage);
+    warningTextEdit->append(formattedErrorMessage);
+    writeOperationLog(errorMessage);
+
+    isFaceAttendanceRunning = false;
+    faceAttendanceButton->setText("人脸考勤");
+    faceAttendanceButton->setEnabled(true);
+    startFaceService();
 }
 
-/* 处理人脸考勤脚本错误 */
+/* 处理人脸识别服务进程错误 */
 void Widget::handleFaceAttendanceError(QProcess::ProcessError error)
 {
     QString errorMessage;
     switch (error)
     {
         case QProcess::FailedToStart:
-            errorMessage = "人脸考勤脚本启动失败";
+            errorMessage = "人脸识别服务启动失败";
             break;
         case QProcess::Crashed:
-            errorMessage = "人脸考勤脚本崩溃";
+            errorMessage = "人脸识别服务崩溃";
             break;
         case QProcess::Timedout:
-            errorMessage = "人脸考勤脚本启动超时";
+            errorMessage = "人脸识别服务启动超时";
             break;
         case QProcess::WriteError:
-            errorMessage = "向人脸考勤脚本写入数据时出错";
+            errorMessage = "向人脸识别服务写入数据时出错";
             break;
         case QProcess::ReadError:
-            errorMessage = "从人脸考勤脚本读取数据时出错";
+            errorMessage = "从人脸识别服务读取数据时出错";
             break;
         default:
             errorMessage = "未知错误";
@@ -647,16 +638,25 @@ void Widget::handleFaceAttendanceError(QProcess::ProcessError error)
     warningTextEdit->append(formattedErrorMessage);
     writeOperationLog(errorMessage);
 
-    if (error == QProcess::Crashed)     //如果脚本崩溃，重置按钮状态
+    if (error == QProcess::Crashed)     //如果服务崩溃，重置按钮状态，下次考勤时重新拉起
     {
         isFaceAttendanceRunning = false;
         faceAttendanceButton->setText("人脸考勤");
+        faceAttendanceButton->setEnabled(true);
     }
 }
 
-/* 人脸注册 */
+/* 人脸注册：注册脚本在后台运行，界面和传感器采集不受影响；注册中再次点击则取消 */
 void Widget::registerFace()
 {
+    if (faceRegisterJob->isRunning())
+    {
+        faceRegisterJob->cancel();
+        faceRegisterButton->setText("正在取消...");
+        faceRegisterButton->setEnabled(false);
+        return;
+    }
+
     FaceRegisterDialog dialog(this);
     if (dialog.exec() == QDialog::Accepted)
     {
@@ -673,76 +673,117 @@ void Widget::registerFace()
             return;
         }
 
-        QStringList arguments;
-        arguments << scriptPath << "--id" << id << "--name" << name;
-
-        QProcess *registerProcess = new QProcess(this);
-
-        connect(registerProcess, &QProcess::readyReadStandardError, [=]()
+        if (faceRegisterJob->start(id, name))
         {
-            QByteArray errorData = registerProcess->readAllStandardError();
-            QString errorMessage = QString::fromUtf8(errorData);
-            QString formattedErrorMessage = QString(">> %1 人脸注册脚本错误:\n%2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(errorMessage);
-            warningTextEdit->append(formattedErrorMessage);
-            writeOperationLog(errorMessage);
-        });
-
-        registerProcess->start("python", arguments);
-        if(!registerProcess->waitForStarted())
-        {
-            QByteArray errorData = registerProcess->readAllStandardError();
-            QString errorMessage = QString("无法启动人脸注册脚本: %1").arg(QString::fromUtf8(errorData));
-            QString formattedErrorMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(errorMessage);
-            warningTextEdit->append(formattedErrorMessage);
-            writeOperationLog(errorMessage);
-            registerProcess->deleteLater();
-            return;
-        }
-
-        if(!registerProcess->waitForFinished())
-        {
-            QString errorMessage = "人脸注册脚本执行失败";
-            QString formattedErrorMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(errorMessage);
-            warningTextEdit->append(formattedErrorMessage);
-            writeOperationLog(errorMessage);
-            registerProcess->deleteLater();
-            return;
+            QString message = QString("开始注册员工 %1(%2)，请正对摄像头").arg(name).arg(id);
+            QString formattedMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(message);
+            warningTextEdit->append(formattedMessage);
+            writeOperationLog(message);
+            faceRegisterButton->setText("取消注册");
         }
+    }
+}
 
-        QByteArray outputData = registerProcess->readAllStandardOutput();
-        QString outputMessage = QString::fromUtf8(outputData);
-        QString formattedOutputMessage = QString(">> %1 人脸注册脚本输出:\n%2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(outputMessage);
-        warningTextEdit->append(formattedOutputMessage);
-        writeOperationLog(outputMessage);
-
-        registerProcess->deleteLater();
+/* 处理人脸注册进度 */
+void Widget::handleFaceRegisterProgress(FaceRegisterJob::Stage stage, int index)
+{
+    QString message;
+    switch (stage)
+    {
+        case FaceRegisterJob::FrameCaptured:
+            message = QString("人脸注册: 已拍摄第 %1/3 张照片").arg(index);
+            break;
+        case FaceRegisterJob::FeatureExtracted:
+            message = QString("人脸注册: 已提取第 %1/3 张照片特征").arg(index);
+            break;
+        case FaceRegisterJob::SimilarityChecked:
+            message = "人脸注册: 相似度校验通过";
+            break;
+        case FaceRegisterJob::Committed:
+            message = "人脸注册: 已写入人脸库";
+            faceRegisterButton->setEnabled(false);  //已提交，不能再取消
+            break;
     }
+
+    QString formattedMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(message);
+    warningTextEdit->append(formattedMessage);
 }
 
-/* 更新摄像头状态文件内容 */
-void Widget::updateCameraStateFile(const QString& statusLine)
+/* 处理人脸注册脚本输出，进度行之外的输出只写入日志 */
+void Widget::handleFaceRegisterMessage(const QString &text)
 {
-    QString cameraStateFilePath = CAMERA_STATE_FILE_PATH;
-    QFile cameraStateFile(cameraStateFilePath);
+    writeOperationLog(text);
+}
 
-    //确保目录存在
-    QDir dir(cameraStateFilePath.section('/', 0, -2));  //提取目录部分
-    if(!dir.exists())
+/* 处理人脸注册结束 */
+void Widget::handleFaceRegisterFinished(bool success, bool cancelled)
+{
+    QString message;
+    if (success)
     {
-        dir.mkpath(".");  //创建目录
+        message = "人脸注册成功";
     }
-
-    if(cameraStateFile.open(QIODevice::WriteOnly | QIODevice::Text))
+    else if (cancelled)
     {
-        QTextStream out(&cameraStateFile);
-        out << statusLine;  //写入状态行（0或1）
-        cameraStateFile.close();
+        message = "人脸注册已取消";
     }
     else
     {
-        QString errorMessage = QString("无法打开摄像头状态文件 %1").arg(cameraStateFilePath);
-        QMessageBox::warning(this, "错误", errorMessage);
+        message = "人脸注册失败，详见操作日志";
+    }
+
+    QString formattedMessage = QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(message);
+    warningTextEdit->append(formattedMessage);
+    writeOperationLog(message);
+
+    faceRegisterButton->setText("人脸注册");
+    faceRegisterButton->setEnabled(true);
+}
+
+/* 打开本地消息总线 */
+void Widget::initMessageBus()
+{
+    if (msg_bus_open(&bus, MSG_BUS_EP_APP) != 0)
+    {
+        QString errorMessage = "无法打开本地消息总线";
+        warningTextEdit->append(QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(errorMessage));
         writeOperationLog(errorMessage);
+        return;
+    }
+
+    busOpened = true;
+    busNotifier = new QSocketNotifier(msg_bus_fd(&bus), QSocketNotifier::Read, this);
+    connect(busNotifier, &QSocketNotifier::activated, this, &Widget::handleBusMessage);
+}
+
+/* 发布摄像头状态 */
+void Widget::publishCameraState(int state)
+{
+    if (busOpened)
+    {
+        msg_bus_publish_camera_state(&bus, state);
+    }
+}
+
+/* 处理消息总线消息 */
+void Widget::handleBusMessage()
+{
+    struct msg_bus_msg_t msg;
+
+    while (msg_bus_recv(&bus, &msg, 0) == 1)
+    {
+        //平台远程设置摄像头状态，与当前动作识别状态不一致时切换
+        if (msg.type == MSG_BUS_CAMERA_STATE)
+        {
+            bool requested = msg.data.camera.state != 0;
+            if (requested != isPoseRecognitionRunning)
+            {
+                QString message = QString("平台远程设置动作识别状态: %1").arg(msg.data.camera.state);
+                warningTextEdit->append(QString(">> %1 %2").arg(QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss")).arg(message));
+                writeOperationLog(message);
+                togglePoseRecognition();
+            }
+        }
     }
 }
 
@@ -770,12 +811,6 @@ void Widget::resetThresholds()
     writeThresholdFile();   //写入阈值文件
 }
 
-/* 初始化摄像头状态文件内容为0 */
-void Widget::initializeCameraStateFile()
-{
-    updateCameraStateFile("0");
-}
-
 /* 读取阈值设置文件 */
 bool Widget::readThresholdFile()
 {
@@ -860,5 +895,6 @@ void Widget::updateThresholds()
     humidMax = humidMaxInput->text().toFloat(&ok);
     if(!ok){ qDebug() << "无效的湿度上限值"; return; }
 
+    applyAlarmThresholds();
     writeThresholdFile();   //更新阈值文件
 }
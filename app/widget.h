@@ -25,33 +25,50 @@
 #include <QDir>
 #include <QProcess>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QSocketNotifier>
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QStringList>
 
 #include <unistd.h>
 #include <fcntl.h>
-#include <dirent.h>
 #include <sys/ioctl.h>
 
 #include "ui_init.h"
 #include "facedialog.h"
+#include "faceregisterjob.h"
+#include "thresholdalarm.h"
+#include "poseengine.h"
+#include "../ipc/msg_bus.h"
+#include "../driver/led/myled.h"
+#include "../sensor/sensor_hub.h"
+#include "../sensor/sensor_plugins.h"
 
 /*****************************************************************************/
 /* 宏定义                                                                     */
 /*****************************************************************************/
-#define DHT11_IOC_MAGIC 'k'
-#define DHT11_READ_DATA _IOWR(DHT11_IOC_MAGIC, 1, unsigned char)
-#define DHT11_DEV_NAME "/dev/dht11"
-
-#define LED_NAME "/dev/my_device"   //LED设备路径
-#define LED_IOC_MAGIC 'm'
-#define SET_LED_ON _IO(LED_IOC_MAGIC, 0)
-#define SET_LED_OFF _IO(LED_IOC_MAGIC, 1)
+#define LED_NAME "/dev/my_device"   //LED设备路径，命令定义见 myled.h
 
 #define THRESHOLD_FILE_PATH     "/home/elf/sensor/threshold.txt"            //阈值设置文件路径
-#define INDEX_FILE_PATH         "/home/elf/sensor/data/index.txt"           //索引文件路径
-#define CAMERA_STATE_FILE_PATH  "/home/elf/sensor/data/camera_state.txt"    //摄像头状态文件路径
-#define FACE_RECO_FILE_PATH     "/home/elf/face/face_recognize.py"          //人脸考勤程序路径
+#define FACE_SERVICE_FILE_PATH  "/home/elf/face/face_service.py"            //人脸识别服务程序路径
+#define FACE_SERVICE_SOCKET     "/tmp/elf_face.sock"                        //人脸识别服务套接字
+#define FACE_SERVICE_CONNECT_MS 500     //连接人脸识别服务超时时间(ms)
 #define FACE_REGI_FILE_PATH     "/home/elf/face/face_register.py"           //人脸注册程序路径
-#define POSE_RECO_FILE_PATH     "/home/elf/action/pose_infer_app.py"        //动作识别程序路径
+#define POSE_MODEL_PATH         "/home/elf/action/rknn_yolov8_pose_demo/model/yolov8_pose.rknn"    //姿态检测模型路径
+#define POSE_CLASSIFIER_PATH    "/home/elf/action/rknn_yolov8_pose_demo/model/pose_classifier.txt" //动作分类模型路径
+#define CAMERA_DEVICE_PATH      "/dev/video11"                              //摄像头设备路径
+#define POSE_LED_HOLD_MS        3000    //检测到动作后LED保持点亮时间(ms)，由驱动定时熄灭
+
+#define LUX_ALARM_HYSTERESIS    10.0f   //光照报警回差(lx)
+#define TEMP_ALARM_HYSTERESIS   0.5f    //温度报警回差(℃)
+#define HUMID_ALARM_HYSTERESIS  2.0f    //湿度报警回差(%RH)
+#define BH1750_ALARM_DEBOUNCE   3000    //光照越限持续3秒才报警(ms)
+#define DHT11_ALARM_DEBOUNCE    4000    //温湿度越限持续4秒才报警(ms)
+#define ALARM_MIN_INTERVAL      10000   //同一报警两次事件的最小间隔(ms)
+#define WARNING_MAX_LINES       12      //报警信息框最大行数
 
 /*****************************************************************************/
 /* 声明                                                                      */
@@ -64,32 +81,48 @@ public:
     Widget(QWidget *parent = nullptr);
     ~Widget();
 
+signals:
+    void sensorSampleArrived(int type, float value);   //由传感器汇集线程发出，排队到界面线程处理
+
 private slots:
-    void updateBH1750Data();        //更新光强数据
-    void updateDHT11Data();         //更新温湿度数据
+    void handleSensorSample(int type, float value); //处理传感器采样
     void updateTime();              //更新时间
     void resetThresholds();         //阈值设置初始化
     void writeDataToFile();         //数据记录以及日志写入
-    void togglePoseScript();        //动作识别
+    void togglePoseRecognition();   //动作识别
     void toggleFaceAttendance();    //人脸考勤槽函数
-    void registerFace();            //人脸注册槽函数
-    void handleFaceAttendanceError(QProcess::ProcessError error); //处理人脸考勤错误的槽函数,防止qt程不正常退出
-    void handlePoseScriptOutput();  //处理动作识别脚本输出
+    void registerFace();            //人脸注册槽函数，注册进行中再次点击则取消
+    void handleFaceRegisterProgress(FaceRegisterJob::Stage stage, int index); //处理人脸注册进度
+    void handleFaceRegisterMessage(const QString &text);        //处理人脸注册脚本输出
+    void handleFaceRegisterFinished(bool success, bool cancelled); //处理人脸注册结束
+    void handleFaceAttendanceError(QProcess::ProcessError error); //处理人脸识别服务进程错误的槽函数,防止qt程不正常退出
+    void handleFaceServiceReply();  //处理人脸识别服务返回结果
+    void handleFaceServiceError(QLocalSocket::LocalSocketError error); //处理人脸识别服务连接错误
+    void handlePoseAction(int trackId, const QString &label, float confidence); //处理动作识别事件
+    void handlePoseError(const QString &message);   //处理动作识别引擎错误
+    void turnOffLED();
+    void handleBusMessage();        //处理消息总线消息
 
 private:
     friend class UIInit;
 
     void initUI();
     void initDevices();
+    void startSensorHub();          //启动传感器汇集并订阅采样
+    void updateLight(float lux);    //更新光强显示和报警
+    void updateTemperature(float temperature);  //更新温度显示和报警
+    void updateHumidity(float humidity);        //更新湿度显示和报警
     void alignToScreenCorner();
     void writeOperationLog(const QString &logMessage);
-    void updateCameraStateFile(const QString& statusLine); //更新摄像头状态文件
-    void initializeCameraStateFile(); //初始化摄像头状态文件
+    void initMessageBus();          //打开本地消息总线
+    void publishCameraState(int state); //发布摄像头状态
+    void startFaceService();        //启动常驻人脸识别服务
     bool readThresholdFile(); //读取阈值文件
     void writeThresholdFile(); //写入阈值文件
     void updateThresholds();
-    void turnOnLED();
-    void turnOffLED();
+    void applyAlarmThresholds();    //将缓存的阈值同步到报警状态机
+    void reportAlarm(const QString &message); //报警信息写入界面和日志
+    void latchLED(unsigned int holdMs); //点亮LED，驱动在保持时间后熄灭
 
     QLabel *lightDisplay;
     QLabel *dhtTempDisplay, *dhtHumidDisplay;
@@ -103,20 +136,30 @@ private:
 
     QPushButton *actionRecognitionButton;   //动作识别按钮
     QPushButton *faceAttendanceButton;      //人脸考勤按钮
+    QPushButton *faceRegisterButton;        //人脸注册按钮
 
-    QProcess *poseScriptProcess;            //动作识别脚本进程
-    QProcess *faceAttendanceProcess;        //人脸考勤进程
+    PoseEngine *poseEngine;                 //动作识别引擎
+    QProcess *faceServiceProcess;           //常驻人脸识别服务进程
+    QLocalSocket *faceSocket;               //人脸识别服务连接
+    QByteArray faceReplyBuffer;             //人脸识别服务返回数据缓存
+    FaceRegisterJob *faceRegisterJob;       //异步人脸注册任务
 
     QTimer *timer;
 
-    int dht11_fd;
-    int bh1750_fd;
+    struct msg_bus_t bus;               //本地消息总线端点
+    bool busOpened;                     //消息总线是否已打开
+    QSocketNotifier *busNotifier;       //消息总线可读通知
+
+    SensorHub sensorHub;                //传感器汇集，所有传感器在一个epoll线程中读取
+    int led_fd;                         //LED设备常驻打开，每次报警只需一次ioctl
+
+    bool isPoseRecognitionRunning;        //动作识别运行状态
+    bool isFaceAttendanceRunning;        //连续人脸考勤进行中标志
 
-    bool dht11WarningShown;
-    bool bh1750WarningShown;
-    bool isPoseScriptRunning;             //动作识别脚本运行状态
-    bool actionScriptPaused;              //动作识别脚本是否被暂停的标志
-    bool isFaceAttendanceRunning;        //人脸考勤运行状态标志
+    ThresholdAlarm luxAlarm;        //光照报警状态机
+    ThresholdAlarm tempAlarm;       //温度报警状态机
+    ThresholdAlarm humidAlarm;      //湿度报警状态机
+    QElapsedTimer alarmClock;       //报警状态机单调时钟
 
     //默认阈值
     float luxMinDefault = 200.0f;     //光照强度下限默认值
@@ -0,0 +1,415 @@
+/**
+ * @file camera_broker.cpp
+ * @brief 摄像头采集进程：独占 V4L2 设备，转换为 BGR 后发布到共享内存环形缓冲（camera_ring.h）
+ *
+ * 设备只打开和预热一次，颜色转换只做一次，动作识别、人脸识别、预览等消费者按各自帧率零拷贝读取。
+ * 用法: camera_broker [-d /dev/video11] [-w 640] [-h 480]
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+
+#include <opencv2/imgproc.hpp>
+
+#include "camera_ring.h"
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define CAMERA_DEVICE           "/dev/video11"
+#define CAMERA_WIDTH            640
+#define CAMERA_HEIGHT           480
+#define CAMERA_BUFFER_COUNT     4           //V4L2 驱动缓冲数
+#define CAMERA_POLL_MS          1000
+#define CAMERA_REAP_INTERVAL_MS 1000        //回收已退出消费者引用的间隔
+
+/*****************************************************************************/
+/* 类型定义                                                                  */
+/*****************************************************************************/
+struct v4l2_buffer_map
+{
+    void *addr;
+    size_t length;
+};
+
+/* 已打开的采集设备 */
+struct capture_t
+{
+    int fd;
+    uint32_t type;                  //V4L2_BUF_TYPE_VIDEO_CAPTURE(_MPLANE)
+    uint32_t pixelformat;           //V4L2_PIX_FMT_NV12 / V4L2_PIX_FMT_YUYV
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytesperline;
+    struct v4l2_buffer_map buffers[CAMERA_BUFFER_COUNT];
+    uint32_t buffer_count;
+};
+
+/*****************************************************************************/
+/* 局部变量                                                                  */
+/*****************************************************************************/
+static volatile sig_atomic_t exit_flag = 0;
+
+/*****************************************************************************/
+/* 局部函数                                                                  */
+/*****************************************************************************/
+static void on_signal(int sig)
+{
+    (void)sig;
+    exit_flag = 1;
+}
+
+static int xioctl(int fd, unsigned long req, void *arg)
+{
+    int ret;
+    do
+    {
+        ret = ioctl(fd, req, arg);
+    } while(ret < 0 && errno == EINTR);
+    return ret;
+}
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* 设置采集格式：优先 NV12（RK ISP 主通道），其次 YUYV（USB 摄像头） */
+static int capture_set_format(struct capture_t *cap)
+{
+    const uint32_t formats[] = { V4L2_PIX_FMT_NV12, V4L2_PIX_FMT_YUYV };
+    struct v4l2_format fmt;
+
+    for(uint32_t pixelformat : formats)
+    {
+        memset(&fmt, 0, sizeof(fmt));
+        fmt.type = cap->type;
+        if(cap->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE)
+        {
+            fmt.fmt.pix_mp.width = cap->width;
+            fmt.fmt.pix_mp.height = cap->height;
+            fmt.fmt.pix_mp.pixelformat = pixelformat;
+            fmt.fmt.pix_mp.field = V4L2_FIELD_NONE;
+            fmt.fmt.pix_mp.num_planes = 1;
+        }
+        else
+        {
+            fmt.fmt.pix.width = cap->width;
+            fmt.fmt.pix.height = cap->height;
+            fmt.fmt.pix.pixelformat = pixelformat;
+            fmt.fmt.pix.field = V4L2_FIELD_NONE;
+        }
+
+        if(xioctl(cap->fd, VIDIOC_S_FMT, &fmt) < 0)
+        {
+            continue;
+        }
+
+        //驱动可能调整分辨率，以实际值为准
+        if(cap->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE)
+        {
+            if(fmt.fmt.pix_mp.pixelformat != pixelformat || fmt.fmt.pix_mp.num_planes != 1)
+            {
+                continue;   //只支持 Y/UV 连续存放的单平面格式
+            }
+            cap->width = fmt.fmt.pix_mp.width;
+            cap->height = fmt.fmt.pix_mp.height;
+            cap->bytesperline = fmt.fmt.pix_mp.plane_fmt[0].bytesperline;
+        }
+        else
+        {
+            if(fmt.fmt.pix.pixelformat != pixelformat)
+            {
+                continue;
+            }
+            cap->width = fmt.fmt.pix.width;
+            cap->height = fmt.fmt.pix.height;
+            cap->bytesperline = fmt.fmt.pix.bytesperline;
+        }
+        cap->pixelformat = pixelformat;
+        return 0;
+    }
+    return -1;
+}
+
+static void capture_close(struct capture_t *cap)
+{
+    uint32_t type = cap->type;
+
+    if(cap->fd < 0)
+    {
+        return;
+    }
+
+    xioctl(cap->fd, VIDIOC_STREAMOFF, &type);
+    for(uint32_t i = 0; i < cap->buffer_count; i++)
+    {
+        munmap(cap->buffers[i].addr, cap->buffers[i].length);
+    }
+    close(cap->fd);
+    cap->fd = -1;
+}
+
+static int capture_open(struct capture_t *cap, const char *device, uint32_t width, uint32_t height)
+{
+    struct v4l2_capability caps;
+    struct v4l2_requestbuffers req;
+    uint32_t dev_caps;
+
+    memset(cap, 0, sizeof(*cap));
+    cap->width = width;
+    cap->height = height;
+    cap->fd = open(device, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if(cap->fd < 0)
+    {
+        perror("open");
+        return -1;
+    }
+
+    if(xioctl(cap->fd, VIDIOC_QUERYCAP, &caps) < 0)
+    {
+        perror("VIDIOC_QUERYCAP");
+        goto fail;
+    }
+    dev_caps = (caps.capabilities & V4L2_CAP_DEVICE_CAPS) ? caps.device_caps : caps.capabilities;
+    if(dev_caps & V4L2_CAP_VIDEO_CAPTURE_MPLANE)
+    {
+        cap->type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+    }
+    else if(dev_caps & V4L2_CAP_VIDEO_CAPTURE)
+    {
+        cap->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    }
+    else
+    {
+        fprintf(stderr, "%s 不是视频采集设备\n", device);
+        goto fail;
+    }
+
+    if(capture_set_format(cap) < 0)
+    {
+        fprintf(stderr, "%s 不支持 NV12/YUYV 格式\n", device);
+        goto fail;
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.count = CAMERA_BUFFER_COUNT;
+    req.type = cap->type;
+    req.memory = V4L2_MEMORY_MMAP;
+    if(xioctl(cap->fd, VIDIOC_REQBUFS, &req) < 0 || req.count == 0)
+    {
+        perror("VIDIOC_REQBUFS");
+        goto fail;
+    }
+
+    for(uint32_t i = 0; i < req.count && i < CAMERA_BUFFER_COUNT; i++)
+    {
+        struct v4l2_buffer buf;
+        struct v4l2_plane plane;
+        memset(&buf, 0, sizeof(buf));
+        memset(&plane, 0, sizeof(plane));
+        buf.type = cap->type;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if(cap->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE)
+        {
+            buf.m.planes = &plane;
+            buf.length = 1;
+        }
+
+        if(xioctl(cap->fd, VIDIOC_QUERYBUF, &buf) < 0)
+        {
+            perror("VIDIOC_QUERYBUF");
+            goto fail;
+        }
+
+        size_t length = cap->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE ? plane.length : buf.length;
+        off_t offset = cap->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE ? plane.m.mem_offset : buf.m.offset;
+        void *addr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, cap->fd, offset);
+        if(addr == MAP_FAILED)
+        {
+            perror("mmap");
+            goto fail;
+        }
+        cap->buffers[i].addr = addr;
+        cap->buffers[i].length = length;
+        cap->buffer_count++;
+
+        if(xioctl(cap->fd, VIDIOC_QBUF, &buf) < 0)
+        {
+            perror("VIDIOC_QBUF");
+            goto fail;
+        }
+    }
+
+    if(xioctl(cap->fd, VIDIOC_STREAMON, &cap->type) < 0)
+    {
+        perror("VIDIOC_STREAMON");
+        goto fail;
+    }
+    return 0;
+
+fail:
+    capture_close(cap);
+    return -1;
+}
+
+/* 取出一帧转换为 BGR 写入 dst，再把缓冲还给驱动；dst 为 NULL 时只归还（丢帧） */
+static int capture_read(struct capture_t *cap, uint8_t *dst, uint32_t dst_stride)
+{
+    struct v4l2_buffer buf;
+    struct v4l2_plane plane;
+
+    memset(&buf, 0, sizeof(buf));
+    memset(&plane, 0, sizeof(plane));
+    buf.type = cap->type;
+    buf.memory = V4L2_MEMORY_MMAP;
+    if(cap->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE)
+    {
+        buf.m.planes = &plane;
+        buf.length = 1;
+    }
+
+    if(xioctl(cap->fd, VIDIOC_DQBUF, &buf) < 0)
+    {
+        return errno == EAGAIN ? 0 : -1;
+    }
+
+    if(dst)
+    {
+        uint8_t *src = (uint8_t *)cap->buffers[buf.index].addr;
+        cv::Mat bgr(cap->height, cap->width, CV_8UC3, dst, dst_stride);
+        if(cap->pixelformat == V4L2_PIX_FMT_NV12)
+        {
+            cv::Mat nv12(cap->height * 3 / 2, cap->width, CV_8UC1, src, cap->bytesperline);
+            cv::cvtColor(nv12, bgr, cv::COLOR_YUV2BGR_NV12);
+        }
+        else
+        {
+            cv::Mat yuyv(cap->height, cap->width, CV_8UC2, src, cap->bytesperline);
+            cv::cvtColor(yuyv, bgr, cv::COLOR_YUV2BGR_YUYV);
+        }
+    }
+
+    if(xioctl(cap->fd, VIDIOC_QBUF, &buf) < 0)
+    {
+        return -1;
+    }
+    return 1;
+}
+
+/*****************************************************************************/
+/* 函数定义                                                                  */
+/*****************************************************************************/
+int main(int argc, char **argv)
+{
+    const char *device = CAMERA_DEVICE;
+    uint32_t width = CAMERA_WIDTH, height = CAMERA_HEIGHT;
+    struct capture_t cap;
+    struct camera_ring_t ring;
+    uint64_t last_reap_ns = 0;
+    uint64_t frames = 0, dropped = 0;
+    int opt;
+
+    while((opt = getopt(argc, argv, "d:w:h:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'd': device = optarg; break;
+            case 'w': width = (uint32_t)atoi(optarg); break;
+            case 'h': height = (uint32_t)atoi(optarg); break;
+            default:
+                fprintf(stderr, "用法: %s [-d 设备] [-w 宽] [-h 高]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    if(capture_open(&cap, device, width, height) < 0)
+    {
+        fprintf(stderr, "无法打开摄像头 %s\n", device);
+        return 1;
+    }
+
+    //以驱动实际分辨率创建环形缓冲
+    if(camera_ring_create(&ring, cap.width, cap.height) < 0)
+    {
+        perror("camera_ring_create");
+        capture_close(&cap);
+        return 1;
+    }
+    printf("摄像头采集已启动 %s %ux%u %s\n", device, cap.width, cap.height,
+           cap.pixelformat == V4L2_PIX_FMT_NV12 ? "NV12" : "YUYV");
+    fflush(stdout);
+
+    while(!exit_flag)
+    {
+        struct pollfd pfd = { cap.fd, POLLIN, 0 };
+        int ret = poll(&pfd, 1, CAMERA_POLL_MS);
+        if(ret < 0 && errno != EINTR)
+        {
+            perror("poll");
+            break;
+        }
+        if(ret <= 0)
+        {
+            continue;
+        }
+
+        //所有槽位都被消费者持有时丢弃本帧，不阻塞采集
+        uint32_t slot = 0;
+        uint8_t *dst = camera_ring_begin_write(&ring, &slot);
+        uint64_t timestamp = monotonic_ns();
+        ret = capture_read(&cap, dst, ring.header->stride);
+        if(ret < 0)
+        {
+            perror("VIDIOC_DQBUF");
+            break;
+        }
+
+        if(dst)
+        {
+            if(ret > 0)
+            {
+                camera_ring_commit(&ring, slot, timestamp);
+                frames++;
+            }
+            else
+            {
+                camera_ring_abort(&ring, slot);     //未取到帧，槽位内容未变
+            }
+        }
+        else if(ret > 0)
+        {
+            dropped++;
+        }
+
+        if(timestamp - last_reap_ns >= CAMERA_REAP_INTERVAL_MS * 1000000ULL)
+        {
+            camera_ring_reap(&ring);
+            last_reap_ns = timestamp;
+        }
+    }
+
+    printf("摄像头采集已退出，共发布 %llu 帧，丢弃 %llu 帧\n", (unsigned long long)frames, (unsigned long long)dropped);
+    camera_ring_destroy(&ring);
+    capture_close(&cap);
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+模块名称：bh1750_sim.c
+摘    要：模拟BH1750的I2C适配器，用于在PC上测试bh1750驱动
+说    明：i2c-stub 只支持SMBus传输，而bh1750驱动使用普通I2C消息（单字节命令、两字节读取），因此用本模块代替；
+          加载后执行 echo bh1750 0x23 > /sys/bus/i2c/devices/i2c-N/new_device 实例化驱动
+*/
+#include <linux/module.h>
+#include <linux/i2c.h>
+#include <linux/delay.h>
+#include <linux/spinlock.h>
+#include <linux/version.h>
+
+#define SIM_ADDR			0x23
+
+#define POWERON				0x01
+#define POWERDOWN			0x0
+#define RESET				0x7
+#define CON_H_RESOLUTION_MODE2		0x11
+#define CON_L_RESOLUTION_MODE		0x13
+#define ONE_H_RESOLUTION_MODE2		0x21
+#define ONE_L_RESOLUTION_MODE		0x23
+
+static unsigned int raw = 1200;		//H模式下的计数，默认1000 lx
+module_param(raw, uint, 0644);
+MODULE_PARM_DESC(raw, "H-mode count returned by the sensor");
+
+static unsigned int xfer_us = 60;	//每条消息的总线耗时，400kHz下读2字节约60us
+module_param(xfer_us, uint, 0644);
+MODULE_PARM_DESC(xfer_us, "simulated bus time per message in microseconds");
+
+static unsigned long reads, writes;	//传输统计，供测试核对驱动的访问次数
+module_param(reads, ulong, 0444);
+module_param(writes, ulong, 0444);
+
+static DEFINE_SPINLOCK(sim_lock);
+static u8 sim_mode = POWERDOWN;
+
+/* 按测量模式返回计数：H2 模式分辨率加倍，L 模式低2位为0 */
+static u16 sim_value(u8 mode)
+{
+	unsigned int v = READ_ONCE(raw);
+
+	if (mode == CON_H_RESOLUTION_MODE2 || mode == ONE_H_RESOLUTION_MODE2)
+		v *= 2;
+	else if (mode == CON_L_RESOLUTION_MODE || mode == ONE_L_RESOLUTION_MODE)
+		v &= ~3u;
+	return v > 0xffff ? 0xffff : v;
+}
+
+static int sim_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
+{
+	unsigned long flags;
+	int i;
+
+	for (i = 0; i < num; i++) {
+		struct i2c_msg *m = &msgs[i];
+
+		if (m->addr != SIM_ADDR)
+			return -ENXIO;
+		if (xfer_us)
+			usleep_range(xfer_us, xfer_us + 10);
+
+		spin_lock_irqsave(&sim_lock, flags);
+		if (m->flags & I2C_M_RD) {
+			u16 v = sim_mode == POWERDOWN ? 0 : sim_value(sim_mode);
+
+			memset(m->buf, 0, m->len);
+			if (m->len > 0)
+				m->buf[0] = v >> 8;
+			if (m->len > 1)
+				m->buf[1] = v & 0xff;
+			reads++;
+		} else if (m->len == 1) {
+			if (m->buf[0] != POWERON && m->buf[0] != RESET)
+				sim_mode = m->buf[0];
+			else if (sim_mode == POWERDOWN)
+				sim_mode = POWERON;
+			writes++;
+		} else {
+			spin_unlock_irqrestore(&sim_lock, flags);
+			return -EINVAL;		//BH1750 只接受单字节命令
+		}
+		spin_unlock_irqrestore(&sim_lock, flags);
+	}
+	return num;
+}
+
+static u32 sim_func(struct i2c_adapter *adap)
+{
+	return I2C_FUNC_I2C;
+}
+
+static const struct i2c_algorithm sim_algo = {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 8, 0)
+	.xfer = sim_xfer,
+#else
+	.master_xfer = sim_xfer,
+#endif
+	.functionality = sim_func,
+};
+
+static struct i2c_adapter sim_adapter = {
+	.owner = THIS_MODULE,
+	.algo = &sim_algo,
+	.name = "bh1750-sim",
+};
+
+static int __init bh1750_sim_init(void)
+{
+	return i2c_add_adapter(&sim_adapter);
+}
+
+static void __exit bh1750_sim_exit(void)
+{
+	i2c_del_adapter(&sim_adapter);
+}
+
+module_init(bh1750_sim_init);
+module_exit(bh1750_sim_exit);
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("simulated BH1750 i2c adapter for driver benchmarks");
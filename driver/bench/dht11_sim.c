@@ -0,0 +1,247 @@
+/**
+ * @file dht11_sim.c
+ * @brief 通过 gpio-sim 模拟 DHT11：检测主机的起始信号后，按时序切换模拟引脚的上下拉产生应答和40位数据
+ *
+ * 用法: dht11_sim [-H 湿度] [-T 温度] [-e N] <sim_gpio目录>
+ *       sim_gpio目录形如 /sys/devices/platform/gpio-sim.0/gpiochip5/sim_gpio0
+ *       -e N 每N帧发送一次错误校验和，用于测试驱动的出错处理
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define SIM_RESPONSE_DELAY_US   30      //主机释放总线到传感器拉低
+#define SIM_RESPONSE_LOW_US     80
+#define SIM_RESPONSE_HIGH_US    80
+#define SIM_BIT_LOW_US          50
+#define SIM_BIT_ZERO_US         26
+#define SIM_BIT_ONE_US          70
+#define SIM_START_MIN_US        18000   //主机拉低至少18ms才视为起始信号
+#define SIM_POLL_US             200     //等待起始信号时的查询间隔
+
+/*****************************************************************************/
+/* 局部变量                                                                  */
+/*****************************************************************************/
+static volatile sig_atomic_t sim_stop;
+static int sim_value_fd = -1;
+static int sim_pull_fd = -1;
+static uint64_t sim_late_max_ns;       //实际切换时刻相对计划的最大滞后
+static uint64_t sim_frames;
+
+/*****************************************************************************/
+/* 局部函数                                                                  */
+/*****************************************************************************/
+static uint64_t sim_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* 读取引脚当前电平：主机输出时为输出值，输入时为上下拉 */
+static int sim_read_value(void)
+{
+    char c;
+    if(pread(sim_value_fd, &c, 1, 0) != 1)
+    {
+        return -1;
+    }
+    return c == '1';
+}
+
+static void sim_set_pull(int up)
+{
+    static const char up_str[] = "pull-up";
+    static const char down_str[] = "pull-down";
+    if(up)
+    {
+        (void)!pwrite(sim_pull_fd, up_str, sizeof(up_str) - 1, 0);
+    }
+    else
+    {
+        (void)!pwrite(sim_pull_fd, down_str, sizeof(down_str) - 1, 0);
+    }
+}
+
+/* 忙等到计划时刻再切换，微秒级时序不能依赖睡眠 */
+static void sim_pull_at(uint64_t at_ns, int up)
+{
+    uint64_t now;
+    while((now = sim_now_ns()) < at_ns)
+    {
+    }
+    sim_set_pull(up);
+    if(now - at_ns > sim_late_max_ns)
+    {
+        sim_late_max_ns = now - at_ns;
+    }
+}
+
+/* 等待主机拉低不少于18ms后释放总线，返回释放时刻，被中断时返回0 */
+static uint64_t sim_wait_start(void)
+{
+    uint64_t low_since = 0;
+    struct timespec poll = { 0, SIM_POLL_US * 1000 };
+
+    while(!sim_stop)
+    {
+        int v = sim_read_value();
+        if(v == 0 && low_since == 0)
+        {
+            low_since = sim_now_ns();
+        }
+        else if(v == 1 && low_since != 0)
+        {
+            uint64_t now = sim_now_ns();
+            if(now - low_since >= SIM_START_MIN_US * 1000ULL - SIM_POLL_US * 1000ULL)
+            {
+                return now;
+            }
+            low_since = 0;  //过短的低电平不是起始信号
+        }
+        //低电平期间主机在睡眠，可以降低查询频率；接近释放时忙等以便及时应答
+        if(low_since == 0 || sim_now_ns() - low_since < (SIM_START_MIN_US - 2000) * 1000ULL)
+        {
+            nanosleep(&poll, NULL);
+        }
+    }
+    return 0;
+}
+
+/* 发送应答和5字节数据，每个下降沿之间的间隔决定位值 */
+static void sim_send_frame(uint64_t t, const uint8_t data[5])
+{
+    int i;
+
+    t += SIM_RESPONSE_DELAY_US * 1000ULL;
+    sim_pull_at(t, 0);
+    t += SIM_RESPONSE_LOW_US * 1000ULL;
+    sim_pull_at(t, 1);
+    t += SIM_RESPONSE_HIGH_US * 1000ULL;
+    for(i = 0; i < 40; i++)
+    {
+        int bit = (data[i / 8] >> (7 - i % 8)) & 1;
+        sim_pull_at(t, 0);
+        t += SIM_BIT_LOW_US * 1000ULL;
+        sim_pull_at(t, 1);
+        t += (bit ? SIM_BIT_ONE_US : SIM_BIT_ZERO_US) * 1000ULL;
+    }
+    //结束位：最后一个下降沿之后释放总线
+    sim_pull_at(t, 0);
+    t += SIM_BIT_LOW_US * 1000ULL;
+    sim_pull_at(t, 1);
+}
+
+static void sim_on_signal(int sig)
+{
+    (void)sig;
+    sim_stop = 1;
+}
+
+static int sim_open(const char *dir, const char *name, int flags)
+{
+    char path[512];
+    int fd;
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    fd = open(path, flags | O_CLOEXEC);
+    if(fd < 0)
+    {
+        perror(path);
+    }
+    return fd;
+}
+
+/*****************************************************************************/
+/* 函数定义                                                                  */
+/*****************************************************************************/
+int main(int argc, char *argv[])
+{
+    double humidity = 55.0, temperature = 23.4;
+    int humidity10, temperature10;
+    unsigned long error_every = 0;
+    struct sched_param sp;
+    uint8_t data[5];
+    int opt;
+
+    while((opt = getopt(argc, argv, "H:T:e:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'H': humidity = atof(optarg); break;
+            case 'T': temperature = atof(optarg); break;
+            case 'e': error_every = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-H humidity] [-T temperature] [-e N] <sim_gpio dir>\n", argv[0]);
+                return 2;
+        }
+    }
+    if(optind >= argc || humidity < 0 || humidity > 99.9 || temperature < 0 || temperature > 99.9)
+    {
+        fprintf(stderr, "usage: %s [-H humidity] [-T temperature] [-e N] <sim_gpio dir>\n", argv[0]);
+        return 2;
+    }
+
+    sim_value_fd = sim_open(argv[optind], "value", O_RDONLY);
+    sim_pull_fd = sim_open(argv[optind], "pull", O_WRONLY);
+    if(sim_value_fd < 0 || sim_pull_fd < 0)
+    {
+        return 1;
+    }
+
+    //整数和0.1位由同一个四舍五入后的值得到，23.96 为 24.0 而不是 23.0
+    humidity10 = (int)(humidity * 10 + 0.5);
+    temperature10 = (int)(temperature * 10 + 0.5);
+    data[0] = (uint8_t)(humidity10 / 10);
+    data[1] = (uint8_t)(humidity10 % 10);
+    data[2] = (uint8_t)(temperature10 / 10);
+    data[3] = (uint8_t)(temperature10 % 10);
+    data[4] = (uint8_t)(data[0] + data[1] + data[2] + data[3]);
+
+    //实时优先级和锁定内存减小时序抖动，没有权限时仍可运行但误差更大
+    memset(&sp, 0, sizeof(sp));
+    sp.sched_priority = 90;
+    if(sched_setscheduler(0, SCHED_FIFO, &sp) < 0)
+    {
+        perror("sched_setscheduler");
+    }
+    mlockall(MCL_CURRENT | MCL_FUTURE);
+
+    signal(SIGINT, sim_on_signal);
+    signal(SIGTERM, sim_on_signal);
+    sim_set_pull(1);    //空闲时总线为高
+
+    while(!sim_stop)
+    {
+        uint64_t released = sim_wait_start();
+        uint8_t frame[5];
+        if(released == 0)
+        {
+            break;
+        }
+        memcpy(frame, data, sizeof(frame));
+        sim_frames++;
+        if(error_every && sim_frames % error_every == 0)
+        {
+            frame[4] ^= 0x01;
+        }
+        sim_send_frame(released, frame);
+    }
+
+    printf("frames=%llu late_max_us=%.1f\n", (unsigned long long)sim_frames, sim_late_max_ns / 1000.0);
+    return 0;
+}
@@ -0,0 +1,771 @@
+/**
+ * @file driver_bench.c
+ * @brief 驱动性能测试：统计 bh1750、dht11、led 驱动的系统调用延迟、每次采样消耗的内核CPU时间
+ *        以及对实时线程调度延迟的影响，输出文本报告和JSON
+ *
+ * 用法: driver_bench [-d 秒] [-n 次数] [-o 报告.json] [-b /dev/bh1750] [-t /dev/dht11] [-l /dev/my_device]
+ *                    [-g led的sim_gpio目录] [-r bh1750计数] [-H 湿度] [-T 温度]
+ *       通常由 run_bench.sh 在加载模拟总线和驱动后调用；未指定的设备跳过
+ *
+ * 内核CPU时间 = 内核线程（kworker、irq线程等）运行时间 + 硬/软中断时间，
+ * 先在所有驱动空闲时测量基线，再减去基线按采样次数平均
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#define _GNU_SOURCE
+#include "../bh1750/bh1750.h"
+#include "../led/myled.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/utsname.h>
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define DHT11_IOC_MAGIC         'k'
+#define DHT11_READ_DATA         _IOWR(DHT11_IOC_MAGIC, 1, unsigned char)
+
+#define BH1750_PERIOD_PATH      "/sys/class/bh1750/bh1750/period_ms"
+#define DHT11_REFRESH_PATH      "/sys/class/DHT11/dht11/refresh_ms"
+#define DHT11_ERRORS_PATH       "/sys/class/DHT11/dht11/errors"
+
+#define BENCH_QUIET_MS          "60000"     //空闲阶段的采样周期
+#define BENCH_BH1750_PERIOD     "180"       //H模式最短采样周期
+#define BENCH_DHT11_REFRESH_MS  2000
+#define BENCH_CYCLIC_US         1000        //实时线程周期
+#define BENCH_HIST_US           10000       //调度延迟直方图范围，超出计入最大值
+#define BENCH_LED_BLINKS        10
+#define BENCH_LED_BLINK_MS      50
+#define BENCH_LED_POLL_US       100
+#define BENCH_MAX_EDGES         64
+
+/*****************************************************************************/
+/* 类型定义                                                                  */
+/*****************************************************************************/
+/* 系统调用延迟统计，单位 ns */
+struct bench_lat_t
+{
+    int valid;
+    uint64_t min, p50, p99, max;
+};
+
+/* 实时线程调度延迟统计，单位 us */
+struct bench_jitter_t
+{
+    int rt;                 //是否以 SCHED_FIFO 运行
+    uint64_t cycles;
+    double avg;
+    uint64_t p99, max;
+};
+
+/* 一个测量阶段 */
+struct bench_phase_t
+{
+    int valid;
+    double seconds;
+    uint64_t kernel_ns;     //阶段内内核线程和中断消耗的CPU时间
+    uint64_t samples;
+    double cpu_per_sample_us;
+    struct bench_jitter_t jitter;
+};
+
+struct bench_device_t
+{
+    const char *name;
+    int present;
+    struct bench_lat_t lat;         //主要操作的延迟
+    const char *lat_op;
+    struct bench_phase_t active;
+    uint64_t checked, mismatched;   //读数正确性检查
+    double accuracy_ms;             //led：闪烁边沿相对计划的最大偏差，<0 表示未测
+};
+
+/*****************************************************************************/
+/* 局部变量                                                                  */
+/*****************************************************************************/
+static double bench_seconds = 10.0;
+static int bench_iterations = 10000;
+
+static volatile int cyclic_stop;
+static uint64_t cyclic_hist[BENCH_HIST_US + 1];
+static struct bench_jitter_t cyclic_result;
+
+/*****************************************************************************/
+/* 局部函数                                                                  */
+/*****************************************************************************/
+static uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_sleep_ms(unsigned int ms)
+{
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    while(nanosleep(&ts, &ts) < 0 && errno == EINTR)
+    {
+    }
+}
+
+static int bench_write_file(const char *path, const char *value)
+{
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    ssize_t n;
+    if(fd < 0)
+    {
+        return -1;
+    }
+    n = write(fd, value, strlen(value));
+    close(fd);
+    return n == (ssize_t)strlen(value) ? 0 : -1;
+}
+
+static int bench_read_u64(const char *path, uint64_t *value)
+{
+    char buf[64];
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    ssize_t n;
+    if(fd < 0)
+    {
+        return -1;
+    }
+    n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if(n <= 0)
+    {
+        return -1;
+    }
+    buf[n] = '\0';
+    *value = strtoull(buf, NULL, 0);
+    return 0;
+}
+
+static int bench_cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_lat_finish(struct bench_lat_t *lat, uint64_t *v, size_t n)
+{
+    if(n == 0)
+    {
+        return;
+    }
+    qsort(v, n, sizeof(*v), bench_cmp_u64);
+    lat->valid = 1;
+    lat->min = v[0];
+    lat->p50 = v[n / 2];
+    lat->p99 = v[(n * 99) / 100];
+    lat->max = v[n - 1];
+}
+
+/* 内核线程运行时间：kthreadd（pid 2）及其子线程的 schedstat */
+static uint64_t bench_kthread_ns(void)
+{
+    DIR *dir = opendir("/proc");
+    struct dirent *entry;
+    uint64_t total = 0;
+
+    if(!dir)
+    {
+        return 0;
+    }
+    while((entry = readdir(dir)) != NULL)
+    {
+        char path[64], buf[512];
+        const char *p;
+        int fd, pid = atoi(entry->d_name), ppid;
+        ssize_t n;
+
+        if(pid <= 0)
+        {
+            continue;
+        }
+        snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+        {
+            continue;
+        }
+        n = read(fd, buf, sizeof(buf) - 1);
+        close(fd);
+        if(n <= 0)
+        {
+            continue;
+        }
+        buf[n] = '\0';
+        p = strrchr(buf, ')');     //进程名可能包含空格
+        if(!p || sscanf(p + 1, " %*c %d", &ppid) != 1 || (pid != 2 && ppid != 2))
+        {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "/proc/%d/schedstat", pid);
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+        {
+            continue;
+        }
+        n = read(fd, buf, sizeof(buf) - 1);
+        close(fd);
+        if(n > 0)
+        {
+            buf[n] = '\0';
+            total += strtoull(buf, NULL, 10);
+        }
+    }
+    closedir(dir);
+    return total;
+}
+
+/* 硬中断和软中断时间，精度为一个时钟节拍 */
+static uint64_t bench_irq_ns(void)
+{
+    unsigned long long user, nice, sys, idle, iowait, irq = 0, softirq = 0;
+    FILE *fp = fopen("/proc/stat", "r");
+    long hz = sysconf(_SC_CLK_TCK);
+
+    if(!fp)
+    {
+        return 0;
+    }
+    if(fscanf(fp, "cpu %llu %llu %llu %llu %llu %llu %llu", &user, &nice, &sys, &idle, &iowait, &irq, &softirq) != 7)
+    {
+        irq = softirq = 0;
+    }
+    fclose(fp);
+    return (irq + softirq) * (1000000000ULL / (hz > 0 ? hz : 100));
+}
+
+static uint64_t bench_kernel_ns(void)
+{
+    return bench_kthread_ns() + bench_irq_ns();
+}
+
+/* 周期唤醒的实时线程，统计实际唤醒时刻相对计划的延迟 */
+static void *bench_cyclic_thread(void *arg)
+{
+    struct sched_param sp;
+    struct timespec next;
+    uint64_t sum = 0, cycles = 0, max = 0;
+
+    (void)arg;
+    memset(cyclic_hist, 0, sizeof(cyclic_hist));
+    memset(&sp, 0, sizeof(sp));
+    sp.sched_priority = 80;
+    cyclic_result.rt = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while(!cyclic_stop)
+    {
+        struct timespec now;
+        uint64_t late;
+
+        next.tv_nsec += BENCH_CYCLIC_US * 1000;
+        while(next.tv_nsec >= 1000000000L)
+        {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        late = ((uint64_t)(now.tv_sec - next.tv_sec) * 1000000000ULL + now.tv_nsec - next.tv_nsec) / 1000;
+        cyclic_hist[late < BENCH_HIST_US ? late : BENCH_HIST_US]++;
+        sum += late;
+        cycles++;
+        if(late > max)
+        {
+            max = late;
+        }
+    }
+
+    cyclic_result.cycles = cycles;
+    cyclic_result.avg = cycles ? (double)sum / cycles : 0;
+    cyclic_result.max = max;
+    cyclic_result.p99 = 0;
+    if(cycles)
+    {
+        uint64_t seen = 0, i;
+        for(i = 0; i <= BENCH_HIST_US; i++)
+        {
+            seen += cyclic_hist[i];
+            if(seen * 100 >= cycles * 99)
+            {
+                cyclic_result.p99 = i;
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+测量阶段：运行实时线程并统计内核CPU时间，期间由 poll 回调做设备相关的检查（每500ms一次），
+poll 为空时只等待
+*/
+static void bench_run_phase(struct bench_phase_t *phase, void (*poll)(void *), void *arg)
+{
+    pthread_t thread;
+    uint64_t start, k0, end;
+
+    cyclic_stop = 0;
+    if(pthread_create(&thread, NULL, bench_cyclic_thread, NULL) != 0)
+    {
+        return;
+    }
+    k0 = bench_kernel_ns();
+    start = bench_now_ns();
+    while(bench_now_ns() - start < (uint64_t)(bench_seconds * 1e9))
+    {
+        bench_sleep_ms(500);
+        if(poll)
+        {
+            poll(arg);
+        }
+    }
+    end = bench_now_ns();
+    phase->kernel_ns = bench_kernel_ns() - k0;
+    cyclic_stop = 1;
+    pthread_join(thread, NULL);
+
+    phase->valid = 1;
+    phase->seconds = (end - start) / 1e9;
+    phase->jitter = cyclic_result;
+}
+
+/* 扣除空闲基线后平均到每次采样 */
+static void bench_phase_cost(struct bench_phase_t *phase, const struct bench_phase_t *baseline)
+{
+    double extra_ns = (double)phase->kernel_ns;
+    if(baseline->valid && baseline->seconds > 0)
+    {
+        extra_ns -= baseline->kernel_ns * (phase->seconds / baseline->seconds);
+    }
+    phase->cpu_per_sample_us = phase->samples ? extra_ns / phase->samples / 1000.0 : 0;
+}
+
+/*****************************************************************************/
+/* BH1750                                                                  */
+/*****************************************************************************/
+static void bench_bh1750(struct bench_device_t *dev, const char *path, unsigned int expect_raw,
+                         const struct bench_phase_t *baseline)
+{
+    struct bench_lat_t lat = {0};
+    struct bh1750_sample s0, s1;
+    uint64_t *v = (uint64_t *)calloc(bench_iterations, sizeof(uint64_t));
+    unsigned short raw;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    int i;
+
+    dev->name = "bh1750";
+    dev->lat_op = "read(2)";
+    dev->accuracy_ms = -1;
+    if(fd < 0 || !v)
+    {
+        perror(path);
+        free(v);
+        return;
+    }
+    dev->present = 1;
+
+    //读数正确性：模拟传感器返回固定计数
+    for(i = 0; i < 10; i++)
+    {
+        if(read(fd, &raw, sizeof(raw)) == (ssize_t)sizeof(raw))
+        {
+            dev->checked++;
+            dev->mismatched += raw != expect_raw;
+        }
+    }
+
+    //阻塞读只返回缓存，测的是系统调用本身的开销
+    for(i = 0; i < bench_iterations; i++)
+    {
+        uint64_t t = bench_now_ns();
+        if(read(fd, &raw, sizeof(raw)) != (ssize_t)sizeof(raw))
+        {
+            break;
+        }
+        v[i] = bench_now_ns() - t;
+    }
+    bench_lat_finish(&lat, v, i);
+    dev->lat = lat;
+
+    bench_write_file(BH1750_PERIOD_PATH, BENCH_BH1750_PERIOD);
+    bench_sleep_ms(500);
+    if(read(fd, &s0, sizeof(s0)) == (ssize_t)sizeof(s0))
+    {
+        bench_run_phase(&dev->active, NULL, NULL);
+        if(read(fd, &s1, sizeof(s1)) == (ssize_t)sizeof(s1))
+        {
+            dev->active.samples = s1.seq - s0.seq;
+        }
+        bench_phase_cost(&dev->active, baseline);
+    }
+    bench_write_file(BH1750_PERIOD_PATH, BENCH_QUIET_MS);
+    close(fd);
+    free(v);
+}
+
+/*****************************************************************************/
+/* DHT11                                                                   */
+/*****************************************************************************/
+struct bench_dht11_check_t
+{
+    int fd;
+    unsigned char expect[4];
+    struct bench_device_t *dev;
+};
+
+static void bench_dht11_poll(void *arg)
+{
+    struct bench_dht11_check_t *c = (struct bench_dht11_check_t *)arg;
+    unsigned char data[5];
+
+    if(ioctl(c->fd, DHT11_READ_DATA, data) == 0 && data[4] == 1)
+    {
+        c->dev->checked++;
+        c->dev->mismatched += memcmp(data, c->expect, 4) != 0;
+    }
+}
+
+static void bench_dht11(struct bench_device_t *dev, const char *path, double humidity, double temperature,
+                        const struct bench_phase_t *baseline)
+{
+    struct bench_lat_t lat = {0};
+    struct bench_dht11_check_t check;
+    uint64_t *v = (uint64_t *)calloc(bench_iterations, sizeof(uint64_t));
+    uint64_t err0 = 0, err1 = 0;
+    unsigned char data[5];
+    char refresh[16];
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    int i;
+
+    dev->name = "dht11";
+    dev->lat_op = "ioctl(READ_DATA)";
+    dev->accuracy_ms = -1;
+    if(fd < 0 || !v)
+    {
+        perror(path);
+        free(v);
+        return;
+    }
+    dev->present = 1;
+
+    for(i = 0; i < bench_iterations; i++)
+    {
+        uint64_t t = bench_now_ns();
+        if(ioctl(fd, DHT11_READ_DATA, data) < 0)
+        {
+            break;
+        }
+        v[i] = bench_now_ns() - t;
+    }
+    bench_lat_finish(&lat, v, i);
+    dev->lat = lat;
+
+    check.fd = fd;
+    check.dev = dev;
+    check.expect[0] = (unsigned char)((int)(humidity * 10 + 0.5) / 10);     //与 dht11_sim 的换算一致
+    check.expect[1] = (unsigned char)((int)(humidity * 10 + 0.5) % 10);
+    check.expect[2] = (unsigned char)((int)(temperature * 10 + 0.5) / 10);
+    check.expect[3] = (unsigned char)((int)(temperature * 10 + 0.5) % 10);
+
+    snprintf(refresh, sizeof(refresh), "%d", BENCH_DHT11_REFRESH_MS);
+    bench_read_u64(DHT11_ERRORS_PATH, &err0);
+    bench_write_file(DHT11_REFRESH_PATH, refresh);
+    bench_run_phase(&dev->active, bench_dht11_poll, &check);
+    bench_read_u64(DHT11_ERRORS_PATH, &err1);
+    bench_write_file(DHT11_REFRESH_PATH, BENCH_QUIET_MS);
+
+    //每个周期发起一次读取，失败的计入 errors
+    dev->active.samples = (uint64_t)(dev->active.seconds * 1000 / BENCH_DHT11_REFRESH_MS);
+    dev->mismatched += err1 - err0;
+    dev->checked += err1 - err0;
+    bench_phase_cost(&dev->active, baseline);
+    close(fd);
+    free(v);
+}
+
+/*****************************************************************************/
+/* LED                                                                     */
+/*****************************************************************************/
+/* 读取模拟引脚电平，记录闪烁边沿，返回相对计划的最大偏差（ms） */
+static double bench_led_accuracy(int fd, const char *sim_dir)
+{
+    struct led_pattern_req req = { LED_PATTERN_BLINK, BENCH_LED_BLINKS, BENCH_LED_BLINK_MS, BENCH_LED_BLINK_MS };
+    uint64_t edges[BENCH_MAX_EDGES], start, end;
+    char path[512], c, last = '0';
+    int vfd, n = 0, i;
+    double worst = 0;
+
+    snprintf(path, sizeof(path), "%s/value", sim_dir);
+    vfd = open(path, O_RDONLY | O_CLOEXEC);
+    if(vfd < 0)
+    {
+        perror(path);
+        return -1;
+    }
+
+    ioctl(fd, SET_LED_OFF);
+    start = bench_now_ns();
+    if(ioctl(fd, SET_LED_PATTERN, &req) < 0)
+    {
+        close(vfd);
+        return -1;
+    }
+    end = start + (uint64_t)(BENCH_LED_BLINKS * 2 * BENCH_LED_BLINK_MS + 200) * 1000000ULL;
+    while(bench_now_ns() < end && n < BENCH_MAX_EDGES)
+    {
+        if(pread(vfd, &c, 1, 0) == 1 && c != last)
+        {
+            edges[n++] = bench_now_ns();
+            last = c;
+        }
+        usleep(BENCH_LED_POLL_US);
+    }
+    close(vfd);
+
+    if(n != BENCH_LED_BLINKS * 2)
+    {
+        fprintf(stderr, "led: expected %d edges, saw %d\n", BENCH_LED_BLINKS * 2, n);
+        return -1;
+    }
+    //以第一个上升沿为基准，第 i 个边沿计划在 i * BENCH_LED_BLINK_MS
+    for(i = 1; i < n; i++)
+    {
+        double dev_ms = (double)(edges[i] - edges[0]) / 1e6 - i * BENCH_LED_BLINK_MS;
+        if(dev_ms < 0)
+        {
+            dev_ms = -dev_ms;
+        }
+        if(dev_ms > worst)
+        {
+            worst = dev_ms;
+        }
+    }
+    return worst;
+}
+
+static void bench_led(struct bench_device_t *dev, const char *path, const char *sim_dir,
+                      const struct bench_phase_t *baseline)
+{
+    struct led_pattern_req latch = { LED_PATTERN_LATCH, 1, 1000, 0 };
+    struct led_pattern_req heartbeat = { LED_PATTERN_HEARTBEAT, 0, 0, 0 };
+    struct bench_lat_t lat = {0};
+    uint64_t *v = (uint64_t *)calloc(bench_iterations, sizeof(uint64_t));
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    int i;
+
+    dev->name = "led";
+    dev->lat_op = "ioctl(SET_LED_PATTERN)";
+    dev->accuracy_ms = -1;
+    if(fd < 0 || !v)
+    {
+        perror(path);
+        free(v);
+        return;
+    }
+    dev->present = 1;
+
+    //报警时的单次调用：每次重新计时的点亮
+    for(i = 0; i < bench_iterations; i++)
+    {
+        uint64_t t = bench_now_ns();
+        if(ioctl(fd, SET_LED_PATTERN, &latch) < 0)
+        {
+            break;
+        }
+        v[i] = bench_now_ns() - t;
+    }
+    bench_lat_finish(&lat, v, i);
+    dev->lat = lat;
+
+    if(sim_dir)
+    {
+        dev->accuracy_ms = bench_led_accuracy(fd, sim_dir);
+    }
+
+    //心跳每1.39秒4步
+    ioctl(fd, SET_LED_PATTERN, &heartbeat);
+    bench_run_phase(&dev->active, NULL, NULL);
+    ioctl(fd, SET_LED_OFF);
+    dev->active.samples = (uint64_t)(dev->active.seconds / 1.39 * 4);
+    bench_phase_cost(&dev->active, baseline);
+    close(fd);
+    free(v);
+}
+
+/*****************************************************************************/
+/* 报告                                                                    */
+/*****************************************************************************/
+static void bench_print_jitter(FILE *fp, const struct bench_jitter_t *j)
+{
+    fprintf(fp, "\"jitter_us\": {\"rt\": %s, \"cycles\": %llu, \"avg\": %.1f, \"p99\": %llu, \"max\": %llu}",
+            j->rt ? "true" : "false", (unsigned long long)j->cycles, j->avg,
+            (unsigned long long)j->p99, (unsigned long long)j->max);
+}
+
+static void bench_report(const char *json_path, const struct bench_phase_t *baseline,
+                         const struct bench_device_t *devs, int n)
+{
+    struct utsname un;
+    FILE *fp;
+    int i;
+
+    uname(&un);
+    printf("kernel %s %s, %.0f s per phase, %d iterations\n", un.release, un.machine, bench_seconds, bench_iterations);
+    printf("%-8s %-24s %9s %9s %9s %9s %12s %10s %10s %9s\n", "device", "syscall", "min_us", "p50_us", "p99_us",
+           "max_us", "cpu/sample", "jit_p99", "jit_max", "errors");
+    printf("%-8s %-24s %9s %9s %9s %9s %12s %10llu %10llu %9s\n", "idle", "-", "-", "-", "-", "-", "-",
+           (unsigned long long)baseline->jitter.p99, (unsigned long long)baseline->jitter.max, "-");
+    for(i = 0; i < n; i++)
+    {
+        const struct bench_device_t *d = &devs[i];
+        if(!d->present)
+        {
+            continue;
+        }
+        printf("%-8s %-24s %9.2f %9.2f %9.2f %9.2f %10.1fus %10llu %10llu %4llu/%-4llu\n", d->name, d->lat_op,
+               d->lat.min / 1e3, d->lat.p50 / 1e3, d->lat.p99 / 1e3, d->lat.max / 1e3, d->active.cpu_per_sample_us,
+               (unsigned long long)d->active.jitter.p99, (unsigned long long)d->active.jitter.max,
+               (unsigned long long)d->mismatched, (unsigned long long)d->checked);
+        if(d->accuracy_ms >= 0)
+        {
+            printf("%-8s blink edge error max %.2f ms\n", "", d->accuracy_ms);
+        }
+    }
+    if(!baseline->jitter.rt)
+    {
+        printf("note: cyclic thread not SCHED_FIFO, run as root for meaningful jitter numbers\n");
+    }
+
+    if(!json_path)
+    {
+        return;
+    }
+    fp = fopen(json_path, "w");
+    if(!fp)
+    {
+        perror(json_path);
+        return;
+    }
+    fprintf(fp, "{\"kernel\": \"%s\", \"machine\": \"%s\", \"phase_seconds\": %.1f, \"iterations\": %d,\n",
+            un.release, un.machine, bench_seconds, bench_iterations);
+    fprintf(fp, " \"idle\": {");
+    bench_print_jitter(fp, &baseline->jitter);
+    fprintf(fp, ", \"kernel_ns_per_s\": %.0f}", baseline->seconds > 0 ? baseline->kernel_ns / baseline->seconds : 0);
+    for(i = 0; i < n; i++)
+    {
+        const struct bench_device_t *d = &devs[i];
+        if(!d->present)
+        {
+            continue;
+        }
+        fprintf(fp, ",\n \"%s\": {\"syscall\": \"%s\", \"latency_ns\": {\"min\": %llu, \"p50\": %llu, \"p99\": %llu, \"max\": %llu}, ",
+                d->name, d->lat_op, (unsigned long long)d->lat.min, (unsigned long long)d->lat.p50,
+                (unsigned long long)d->lat.p99, (unsigned long long)d->lat.max);
+        fprintf(fp, "\"samples\": %llu, \"cpu_per_sample_us\": %.2f, ", (unsigned long long)d->active.samples,
+                d->active.cpu_per_sample_us);
+        bench_print_jitter(fp, &d->active.jitter);
+        fprintf(fp, ", \"checked\": %llu, \"errors\": %llu", (unsigned long long)d->checked,
+                (unsigned long long)d->mismatched);
+        if(d->accuracy_ms >= 0)
+        {
+            fprintf(fp, ", \"blink_error_ms\": %.2f", d->accuracy_ms);
+        }
+        fprintf(fp, "}");
+    }
+    fprintf(fp, "\n}\n");
+    fclose(fp);
+}
+
+/*****************************************************************************/
+/* 函数定义                                                                  */
+/*****************************************************************************/
+int main(int argc, char *argv[])
+{
+    const char *bh1750_path = NULL, *dht11_path = NULL, *led_path = NULL, *led_sim = NULL, *json_path = NULL;
+    unsigned int expect_raw = 1200;
+    double humidity = 55.0, temperature = 23.4;
+    struct bench_device_t devs[3];
+    struct bench_phase_t baseline;
+    int opt;
+
+    while((opt = getopt(argc, argv, "d:n:o:b:t:l:g:r:H:T:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'd': bench_seconds = atof(optarg); break;
+            case 'n': bench_iterations = atoi(optarg); break;
+            case 'o': json_path = optarg; break;
+            case 'b': bh1750_path = optarg; break;
+            case 't': dht11_path = optarg; break;
+            case 'l': led_path = optarg; break;
+            case 'g': led_sim = optarg; break;
+            case 'r': expect_raw = (unsigned int)strtoul(optarg, NULL, 0); break;
+            case 'H': humidity = atof(optarg); break;
+            case 'T': temperature = atof(optarg); break;
+            default:
+                fprintf(stderr, "usage: %s [-d seconds] [-n iterations] [-o report.json] [-b bh1750] [-t dht11] "
+                                "[-l led] [-g led sim_gpio dir] [-r raw] [-H humidity] [-T temperature]\n", argv[0]);
+                return 2;
+        }
+    }
+    if(bench_seconds <= 0 || bench_iterations <= 0)
+    {
+        return 2;
+    }
+
+    memset(devs, 0, sizeof(devs));
+    memset(&baseline, 0, sizeof(baseline));
+    mlockall(MCL_CURRENT | MCL_FUTURE);
+
+    //基线：所有驱动以最长周期运行，LED熄灭
+    bench_write_file(BH1750_PERIOD_PATH, BENCH_QUIET_MS);
+    bench_write_file(DHT11_REFRESH_PATH, BENCH_QUIET_MS);
+    if(led_path)
+    {
+        int fd = open(led_path, O_RDWR | O_CLOEXEC);
+        if(fd >= 0)
+        {
+            ioctl(fd, SET_LED_OFF);
+            close(fd);
+        }
+    }
+    bench_sleep_ms(1000);
+    bench_run_phase(&baseline, NULL, NULL);
+
+    if(bh1750_path)
+    {
+        bench_bh1750(&devs[0], bh1750_path, expect_raw, &baseline);
+    }
+    if(dht11_path)
+    {
+        bench_dht11(&devs[1], dht11_path, humidity, temperature, &baseline);
+    }
+    if(led_path)
+    {
+        bench_led(&devs[2], led_path, led_sim, &baseline);
+    }
+
+    bench_report(json_path, &baseline, devs, 3);
+    return (devs[0].mismatched || devs[1].mismatched || devs[2].accuracy_ms > 5.0) ? 1 : 0;
+}
@@ -0,0 +1,16 @@
+/*
+模块名称：dht11.h
+摘    要：在PC上编译dht11驱动时使用的替代头文件，开发板上使用板级的 dht11.h
+说    明：ioctl 命令与设备名与应用程序一致，引脚由模块参数 gpio 指定
+*/
+#ifndef __DHT11_H__
+#define __DHT11_H__
+
+#include <linux/ioctl.h>
+
+#define DEVICE_NAME         "dht11"
+#define DHT11_IOC_MAGIC     'k'
+#define DHT11_READ_DATA     _IOWR(DHT11_IOC_MAGIC, 1, unsigned char)
+#define DHT11_GPIO_PIN_NUM  -1      //必须通过 gpio=<编号> 指定
+
+#endif
@@ -7,7 +7,6 @@
 #include <linux/types.h>
 #include <linux/kernel.h>
 #include <linux/delay.h>
-#include <linux/ide.h>
 #include <linux/errno.h>
 #include <linux/gpio.h>
 #include <linux/of.h>
@@ -16,6 +15,20 @@
 #include <asm/io.h>
 #include <linux/device.h>
 #include <linux/platform_device.h>
+#include <linux/workqueue.h>
+#include <linux/wait.h>
+#include <linux/poll.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/trigger.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
+#include "bh1750.h"
+#include "../kcompat.h"
 
 #define DEV_NAME "bh1750"
 #define DEV_CNT (1)
@@ -30,6 +43,9 @@
 #define ONE_H_RESOLUTION_MODE2		0x21
 #define ONE_L_RESOLUTION_MODE		0x23
 
+#define BH1750_PERIOD_DEFAULT_MS	200	//默认采样周期，不小于H模式最长转换时间
+#define BH1750_PERIOD_MAX_MS		60000
+
 typedef struct {
 	dev_t devid;
 	struct cdev cdev;
@@ -38,10 +54,40 @@ typedef struct {
 	struct device_node *nd;
 	int major;
 	void *private_data;
+
+	struct mutex lock;		//保护I2C访问和模式、周期设置
+	struct delayed_work work;	//按采样周期读取连续模式下的最新转换结果
+	wait_queue_head_t wq;		//新采样到达时唤醒阻塞读和poll
+	spinlock_t sample_lock;		//保护采样缓存
+	struct bh1750_sample sample;	//最近一次采样，seq为0表示尚无采样
+	unsigned int mode;		//BH1750_MODE_*
+	unsigned int period_ms;		//采样周期
+	unsigned int errors;		//连续读取失败次数
+
+	struct iio_dev *indio_dev;	//IIO接口，注册失败时为NULL
+	struct iio_trigger *trig;	//每次采样完成时触发
+	s64 iio_timestamp;		//最近一次采样时刻，IIO时钟
 }bh1750_dev_t;
 
+/* 每次打开的状态，记录已读取的采样序号 */
+typedef struct {
+	bh1750_dev_t *dev;
+	u32 seq;
+}bh1750_file_t;
+
 bh1750_dev_t bh1750dev;
 
+/* 各测量模式的命令、名称和最长转换时间 */
+static const struct {
+	unsigned char cmd;
+	const char *name;
+	unsigned int conv_ms;
+} bh1750_modes[] = {
+	[BH1750_MODE_H]  = {CON_H_RESOLUTION_MODE,  "H",  180},
+	[BH1750_MODE_H2] = {CON_H_RESOLUTION_MODE2, "H2", 180},
+	[BH1750_MODE_L]  = {CON_L_RESOLUTION_MODE,  "L",  24},
+};
+
 
 static int bh1750_read_data(bh1750_dev_t *dev , void *val , int len)
 {
@@ -67,40 +113,167 @@ static int bh1750_write_cmd(bh1750_dev_t *dev , unsigned char cmd)
 	return i2c_transfer(client->adapter, &msg, 1);
 }
 
+/* 进入连续测量模式，之后传感器按转换时间自动更新结果 */
+static int bh1750_start(bh1750_dev_t *dev)
+{
+	int ret;
+
+	ret = bh1750_write_cmd(dev, POWERON);
+	if (ret < 0)
+		return ret;
+	ret = bh1750_write_cmd(dev, bh1750_modes[dev->mode].cmd);
+	if (ret < 0)
+		return ret;
+
+	//第一次转换完成后再读取
+	mod_delayed_work(system_wq, &dev->work, msecs_to_jiffies(bh1750_modes[dev->mode].conv_ms));
+	return 0;
+}
+
+/* 原始计数换算为 0.001 lx：H 模式 计数/1.2，H2 模式分辨率加倍 */
+static u32 bh1750_to_lux_milli(u16 raw, unsigned int mode)
+{
+	u32 lux = (u32)raw * 1000 * 10 / 12;
+	return mode == BH1750_MODE_H2 ? lux / 2 : lux;
+}
+
+static void bh1750_work(struct work_struct *work)
+{
+	bh1750_dev_t *dev = container_of(to_delayed_work(work), bh1750_dev_t, work);
+	unsigned char _data[2];
+	unsigned long flags;
+	int ret;
+
+	mutex_lock(&dev->lock);
+	ret = bh1750_read_data(dev, _data, 2);
+	if (ret == 1) {
+		u16 raw = ((u16)_data[0] << 8) | _data[1];
+
+		spin_lock_irqsave(&dev->sample_lock, flags);
+		dev->sample.raw = raw;
+		dev->sample.mode = dev->mode;
+		dev->sample.lux_milli = bh1750_to_lux_milli(raw, dev->mode);
+		dev->sample.timestamp_ns = ktime_get_ns();
+		dev->sample.seq++;
+		if (dev->sample.seq == 0)
+			dev->sample.seq = 1;	//0 保留表示尚无采样
+		if (dev->indio_dev)
+			dev->iio_timestamp = iio_get_time_ns(dev->indio_dev);
+		spin_unlock_irqrestore(&dev->sample_lock, flags);
+
+		dev->errors = 0;
+		wake_up_interruptible(&dev->wq);
+		if (dev->trig)
+			elf_iio_trigger_poll(dev->trig);	//在当前工作上下文中推送到缓冲区
+	} else if (dev->errors++ == 0) {
+		printk("bh1750: read failed %d\n", ret);
+	} else if (dev->errors % 16 == 0) {
+		bh1750_write_cmd(dev, POWERON);		//连续失败时重新进入测量模式
+		bh1750_write_cmd(dev, bh1750_modes[dev->mode].cmd);
+	}
+	schedule_delayed_work(&dev->work, msecs_to_jiffies(dev->period_ms));
+	mutex_unlock(&dev->lock);
+}
+
+static void bh1750_get_sample(bh1750_dev_t *dev, struct bh1750_sample *sample)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->sample_lock, flags);
+	*sample = dev->sample;
+	spin_unlock_irqrestore(&dev->sample_lock, flags);
+}
+
+static u32 bh1750_sample_seq(bh1750_dev_t *dev)
+{
+	return READ_ONCE(dev->sample.seq);
+}
+
 static int bh1750_open(struct inode *inode, struct file *filp)
 {
-	filp->private_data = &bh1750dev;
+	bh1750_file_t *f = kzalloc(sizeof(*f), GFP_KERNEL);
+
+	if (!f)
+		return -ENOMEM;
+	f->dev = &bh1750dev;
+	filp->private_data = f;
 	return 0;
 }
 
+/*
+阻塞读立即返回最近一次采样，只有加载后尚无采样时才等待；
+O_NONBLOCK 读只返回本次打开后尚未读取过的新采样，否则返回 -EAGAIN，与 poll 一致。
+*/
 static ssize_t bh1750_read(struct file *filp, char __user *buf, size_t cnt, loff_t *off)
 {
+	bh1750_file_t *f = filp->private_data;
+	bh1750_dev_t *dev = f->dev;
+	struct bh1750_sample sample;
 	int ret;
-	unsigned char _data[2];
-	unsigned short sensor_data = 0;
-	bh1750_dev_t *dev = filp->private_data;
-
-	bh1750_write_cmd(dev,POWERON); 
-	bh1750_write_cmd(dev,CON_H_RESOLUTION_MODE);
-	mdelay(180);
-	bh1750_read_data(dev,_data,2);
-	
-	sensor_data = *_data;
-	sensor_data = (sensor_data << 8) + *(_data + 1);
-	ret = copy_to_user(buf,&sensor_data,2);
 
-	return ret;
+	if (cnt < sizeof(u16))
+		return -EINVAL;
+
+	if (filp->f_flags & O_NONBLOCK) {
+		if (bh1750_sample_seq(dev) == f->seq)
+			return -EAGAIN;
+	} else {
+		ret = wait_event_interruptible(dev->wq, bh1750_sample_seq(dev) != 0);
+		if (ret)
+			return ret;
+	}
 
+	bh1750_get_sample(dev, &sample);
+	f->seq = sample.seq;
+
+	if (cnt >= sizeof(sample)) {
+		if (copy_to_user(buf, &sample, sizeof(sample)))
+			return -EFAULT;
+		return sizeof(sample);
+	} else {
+		//兼容旧版：按H模式计数返回，应用程序仍以 计数/1.2 换算
+		u16 raw = sample.mode == BH1750_MODE_H2 ? sample.raw / 2 : sample.raw;
+		if (copy_to_user(buf, &raw, sizeof(raw)))
+			return -EFAULT;
+		return sizeof(raw);
+	}
+}
+
+static __poll_t bh1750_poll(struct file *filp, poll_table *wait)
+{
+	bh1750_file_t *f = filp->private_data;
+	bh1750_dev_t *dev = f->dev;
+
+	poll_wait(filp, &dev->wq, wait);
+	if (bh1750_sample_seq(dev) != f->seq)
+		return EPOLLIN | EPOLLRDNORM;
+	return 0;
 }
 
 static int bh1750_release(struct inode *inode, struct file *filp)
 {
+	kfree(filp->private_data);
 	return 0;
 }
 
 static void bh1750dev_init(bh1750_dev_t *dev)
 {
-	bh1750_write_cmd(dev,POWERON);
+	mutex_init(&dev->lock);
+	spin_lock_init(&dev->sample_lock);
+	init_waitqueue_head(&dev->wq);
+	INIT_DELAYED_WORK(&dev->work, bh1750_work);
+	memset(&dev->sample, 0, sizeof(dev->sample));
+	dev->mode = BH1750_MODE_H;
+	dev->period_ms = BH1750_PERIOD_DEFAULT_MS;
+	dev->errors = 0;
+
+	mutex_lock(&dev->lock);
+	if (bh1750_start(dev) < 0) {
+		//后台读取失败时会周期性重新进入测量模式
+		printk("bh1750: start failed, retrying in background\n");
+		schedule_delayed_work(&dev->work, msecs_to_jiffies(dev->period_ms));
+	}
+	mutex_unlock(&dev->lock);
 }
 
 static struct file_operations bh1750_chr_dev_fops =
@@ -108,10 +281,210 @@ static struct file_operations bh1750_chr_dev_fops =
 	.owner = THIS_MODULE,
 	.open = bh1750_open,
 	.read = bh1750_read,
+	.poll = bh1750_poll,
+	.llseek = no_llseek,
 	.release = bh1750_release,
 };
 
-static int bh1750_probe(struct i2c_client *client,const struct i2c_device_id *id)
+/* sysfs: /sys/class/bh1750/bh1750/{mode,period_ms,lux} */
+static ssize_t mode_show(struct device *d, struct device_attribute *attr, char *buf)
+{
+	bh1750_dev_t *dev = dev_get_drvdata(d);
+	return sysfs_emit(buf, "%s\n", bh1750_modes[READ_ONCE(dev->mode)].name);
+}
+
+static ssize_t mode_store(struct device *d, struct device_attribute *attr, const char *buf, size_t count)
+{
+	bh1750_dev_t *dev = dev_get_drvdata(d);
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < ARRAY_SIZE(bh1750_modes); i++) {
+		if (sysfs_streq(buf, bh1750_modes[i].name))
+			break;
+	}
+	if (i == ARRAY_SIZE(bh1750_modes))
+		return -EINVAL;
+
+	//IIO缓冲区中的原始计数按同一比例换算，采集期间不能切换模式
+	if (dev->indio_dev && iio_device_claim_direct_mode(dev->indio_dev))
+		return -EBUSY;
+
+	mutex_lock(&dev->lock);
+	dev->mode = i;
+	if (dev->period_ms < bh1750_modes[i].conv_ms)
+		dev->period_ms = bh1750_modes[i].conv_ms;
+	ret = bh1750_start(dev);
+	mutex_unlock(&dev->lock);
+	if (dev->indio_dev)
+		iio_device_release_direct_mode(dev->indio_dev);
+	return ret < 0 ? ret : count;
+}
+static DEVICE_ATTR_RW(mode);
+
+static ssize_t period_ms_show(struct device *d, struct device_attribute *attr, char *buf)
+{
+	bh1750_dev_t *dev = dev_get_drvdata(d);
+	return sysfs_emit(buf, "%u\n", READ_ONCE(dev->period_ms));
+}
+
+/* 周期不小于当前模式的转换时间，否则会重复读到同一结果 */
+static ssize_t period_ms_store(struct device *d, struct device_attribute *attr, const char *buf, size_t count)
+{
+	bh1750_dev_t *dev = dev_get_drvdata(d);
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	mutex_lock(&dev->lock);
+	if (val < bh1750_modes[dev->mode].conv_ms || val > BH1750_PERIOD_MAX_MS) {
+		mutex_unlock(&dev->lock);
+		return -EINVAL;
+	}
+	dev->period_ms = val;
+	mod_delayed_work(system_wq, &dev->work, msecs_to_jiffies(val));
+	mutex_unlock(&dev->lock);
+	return count;
+}
+static DEVICE_ATTR_RW(period_ms);
+
+static ssize_t lux_show(struct device *d, struct device_attribute *attr, char *buf)
+{
+	bh1750_dev_t *dev = dev_get_drvdata(d);
+	struct bh1750_sample sample;
+
+	bh1750_get_sample(dev, &sample);
+	if (sample.seq == 0)
+		return -EAGAIN;
+	return sysfs_emit(buf, "%u.%03u\n", sample.lux_milli / 1000, sample.lux_milli % 1000);
+}
+static DEVICE_ATTR_RO(lux);
+
+static struct attribute *bh1750_attrs[] = {
+	&dev_attr_mode.attr,
+	&dev_attr_period_ms.attr,
+	&dev_attr_lux.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(bh1750);
+
+/*
+IIO接口：in_illuminance_raw * in_illuminance_scale = lx，
+缓冲区每个采样为 u16 原始计数加 s64 时间戳
+*/
+static const struct iio_chan_spec bh1750_channels[] = {
+	{
+		.type = IIO_LIGHT,
+		.info_mask_separate = BIT(IIO_CHAN_INFO_RAW) | BIT(IIO_CHAN_INFO_SCALE),
+		.scan_index = 0,
+		.scan_type = {
+			.sign = 'u',
+			.realbits = 16,
+			.storagebits = 16,
+			.endianness = IIO_CPU,
+		},
+	},
+	IIO_CHAN_SOFT_TIMESTAMP(1),
+};
+
+static int bh1750_read_raw(struct iio_dev *indio_dev, struct iio_chan_spec const *chan,
+			   int *val, int *val2, long mask)
+{
+	bh1750_dev_t *dev = *(bh1750_dev_t **)iio_priv(indio_dev);
+	struct bh1750_sample sample;
+
+	switch (mask) {
+	case IIO_CHAN_INFO_RAW:
+		bh1750_get_sample(dev, &sample);
+		if (sample.seq == 0)
+			return -EAGAIN;
+		*val = sample.raw;
+		return IIO_VAL_INT;
+	case IIO_CHAN_INFO_SCALE:
+		//1 / 1.2 lx，H2 模式分辨率加倍
+		*val = 0;
+		*val2 = READ_ONCE(dev->mode) == BH1750_MODE_H2 ? 416667 : 833333;
+		return IIO_VAL_INT_PLUS_MICRO;
+	default:
+		return -EINVAL;
+	}
+}
+
+static const struct iio_info bh1750_iio_info = {
+	.read_raw = bh1750_read_raw,
+};
+
+/* 触发后把缓存的采样推入缓冲区，时间戳为采样时刻 */
+static irqreturn_t bh1750_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	bh1750_dev_t *dev = *(bh1750_dev_t **)iio_priv(indio_dev);
+	struct {
+		u16 raw;
+		s64 timestamp __aligned(8);
+	} scan;
+	unsigned long flags;
+	s64 ts;
+	u32 seq;
+
+	memset(&scan, 0, sizeof(scan));
+	spin_lock_irqsave(&dev->sample_lock, flags);
+	scan.raw = dev->sample.raw;
+	seq = dev->sample.seq;
+	ts = dev->iio_timestamp;
+	spin_unlock_irqrestore(&dev->sample_lock, flags);
+
+	if (seq != 0)
+		iio_push_to_buffers_with_timestamp(indio_dev, &scan, ts);
+	iio_trigger_notify_done(indio_dev->trig);
+	return IRQ_HANDLED;
+}
+
+/* 资源随 I2C 设备释放，remove 中先停止采样工作 */
+static int bh1750_iio_init(bh1750_dev_t *dev, struct i2c_client *client)
+{
+	struct iio_dev *indio_dev;
+	struct iio_trigger *trig;
+	int ret;
+
+	indio_dev = devm_iio_device_alloc(&client->dev, sizeof(dev));
+	if (!indio_dev)
+		return -ENOMEM;
+	*(bh1750_dev_t **)iio_priv(indio_dev) = dev;
+	indio_dev->dev.parent = &client->dev;
+	indio_dev->name = DEV_NAME;
+	indio_dev->info = &bh1750_iio_info;
+	indio_dev->modes = INDIO_DIRECT_MODE;
+	indio_dev->channels = bh1750_channels;
+	indio_dev->num_channels = ARRAY_SIZE(bh1750_channels);
+
+	trig = devm_iio_trigger_alloc(&client->dev, "%s-dev%d", indio_dev->name, indio_dev->id);
+	if (!trig)
+		return -ENOMEM;
+	trig->dev.parent = &client->dev;
+	ret = devm_iio_trigger_register(&client->dev, trig);
+	if (ret)
+		return ret;
+
+	ret = devm_iio_triggered_buffer_setup(&client->dev, indio_dev, NULL, bh1750_trigger_handler, NULL);
+	if (ret)
+		return ret;
+	ret = devm_iio_device_register(&client->dev, indio_dev);
+	if (ret)
+		return ret;
+
+	mutex_lock(&dev->lock);
+	dev->indio_dev = indio_dev;
+	dev->trig = trig;
+	mutex_unlock(&dev->lock);
+	return 0;
+}
+
+static int bh1750_probe(struct i2c_client *client)
 {
 	int ret = -1;
 	ret = alloc_chrdev_region(&bh1750dev.devid, 0, DEV_CNT, DEV_NAME);
@@ -129,10 +502,19 @@ static int bh1750_probe(struct i2c_client *client,const struct i2c_device_id *id
 		goto add_err;
 	}
 
-	bh1750dev.class = class_create(THIS_MODULE, DEV_NAME);
-	bh1750dev.device = device_create(bh1750dev.class, NULL, bh1750dev.devid, NULL, DEV_NAME);
 	bh1750dev.private_data = client;
+	bh1750dev.indio_dev = NULL;
+	bh1750dev.trig = NULL;
 	bh1750dev_init(&bh1750dev);
+
+	//IIO接口可选，内核未启用IIO缓冲区时仍可通过字符设备读取
+	ret = bh1750_iio_init(&bh1750dev, client);
+	if (ret < 0)
+		printk("bh1750: iio register failed %d\n", ret);
+
+	bh1750dev.class = elf_class_create(DEV_NAME);
+	bh1750dev.device = device_create_with_groups(bh1750dev.class, NULL, bh1750dev.devid, &bh1750dev,
+						     bh1750_groups, DEV_NAME);
 	return 0;
 
 add_err:
@@ -142,13 +524,15 @@ alloc_err:
 	return ret;
 }
 
-static int bh1750_remove(struct i2c_client *client)
+static ELF_I2C_REMOVE_RET bh1750_remove(struct i2c_client *client)
 {
-	device_destroy(bh1750dev.class, bh1750dev.devid);
+	device_destroy(bh1750dev.class, bh1750dev.devid);	//先移除sysfs属性，之后不会再有写入重新排队采样工作
+	cancel_delayed_work_sync(&bh1750dev.work);	//IIO设备随后由devm注销，之后不再触发
+	bh1750_write_cmd(&bh1750dev, POWERDOWN);
 	class_destroy(bh1750dev.class);
 	cdev_del(&bh1750dev.cdev);
 	unregister_chrdev_region(bh1750dev.devid, DEV_CNT);
-	return 0;
+	ELF_I2C_REMOVE_RETURN;
 }
 
 static struct of_device_id bh1750_of_match[] = {
@@ -158,11 +542,12 @@ static struct of_device_id bh1750_of_match[] = {
 
 static struct i2c_device_id bh1750_id[] = {
 	{"elfboard,bh1750",0},
+	{"bh1750",0},	//便于通过 new_device 手动实例化
 	{},
 };
 
 static struct i2c_driver bh1750_driver = {
-	.probe = bh1750_probe,
+	.ELF_I2C_PROBE = bh1750_probe,
 	.remove = bh1750_remove,
 	.driver = {
 		.owner = THIS_MODULE,
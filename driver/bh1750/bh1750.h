@@ -0,0 +1,27 @@
+/*
+模块名称：bh1750.h
+摘    要：bh1750光照传感器驱动与应用程序共用的数据格式
+*/
+#ifndef __BH1750_H__
+#define __BH1750_H__
+
+#include <linux/types.h>
+
+/*
+读取长度为2字节时返回 unsigned short 原始计数（按H模式折算），光照强度 = 计数 / 1.2 lx，与旧版驱动兼容；
+读取长度不小于 sizeof(struct bh1750_sample) 时返回带时间戳的完整采样。
+*/
+struct bh1750_sample {
+	__u16 raw;		//传感器原始计数
+	__u16 mode;		//测量模式 BH1750_MODE_*
+	__u32 seq;		//采样序号，从1开始
+	__u32 lux_milli;	//光照强度，单位 0.001 lx
+	__u32 reserved;
+	__u64 timestamp_ns;	//采样时刻（CLOCK_MONOTONIC）
+};
+
+#define BH1750_MODE_H		0	//连续高分辨率 1 lx，转换时间最长180ms
+#define BH1750_MODE_H2		1	//连续高分辨率 0.5 lx，转换时间最长180ms
+#define BH1750_MODE_L		2	//连续低分辨率 4 lx，转换时间最长24ms
+
+#endif
@@ -1,6 +1,10 @@
 /*
 模块名称：dht11.h
 摘    要：dht11模块测温湿度
+说    明：后台每隔 refresh_ms 发起一次读取，起始信号期间睡眠而不忙等；
+          应答和40位数据由GPIO下降沿中断记录时间戳，下半部按相邻下降沿间隔解码，
+          结果缓存后由 ioctl 直接返回，用户调用不再等待单总线时序；
+          同时注册为IIO设备，每次读取成功触发 dht11-devN，缓冲区按批读取带时间戳的采样
 */
 /*包含头文件*/
 #include <linux/module.h>       // 包含模块相关函数的头文件
@@ -10,8 +14,26 @@
 #include <linux/device.h>
 #include <linux/gpio.h>
 #include <linux/delay.h>
+#include <linux/interrupt.h>
+#include <linux/workqueue.h>
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
+#include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/trigger.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
 #include "dht11.h"
+#include "../kcompat.h"
 //宏定义
+#define DHT11_EDGES             42      //应答1个 + 数据起始1个 + 40位各1个下降沿
+#define DHT11_START_MS          20      //主机拉低的起始信号，不小于18ms
+#define DHT11_CAPTURE_MS        10      //释放总线后等待数据的最长时间，完整传输约4ms
+#define DHT11_BIT_MIN_NS        60000   //一位 = 50us低电平 + 26~28us(0)或70us(1)高电平
+#define DHT11_BIT_ONE_NS        100000  //间隔超过该值为1
+#define DHT11_BIT_MAX_NS        160000
+#define DHT11_REFRESH_MIN_MS    2000    //DHT11两次读取至少间隔2秒
+#define DHT11_STALE_REFRESHES   3       //连续多少个周期读取失败后不再返回旧数据
 
 //内部变量
 static dev_t dev_num;       //分配的设备号
@@ -20,125 +42,210 @@ int major;  //主设备号
 int minor;  //次设备号
 static struct class *DHT11_class;
 static struct device *DHT11_device;
+static int DHT11_irq = -1;
+static int DHT11_gpio = DHT11_GPIO_PIN_NUM;   //默认使用开发板引脚，测试时可指定模拟GPIO
+module_param_named(gpio, DHT11_gpio, int, 0444);
+
+static DEFINE_SPINLOCK(DHT11_lock);     //保护边沿记录和缓存
+static u64 DHT11_edges[DHT11_EDGES + 1];    //下降沿时间戳，由中断记录，多留一位防止残留的边沿挤掉最后一个
+static int DHT11_edge_cnt;
+static bool DHT11_capturing;            //起始信号发出后到解码前为真
+static bool DHT11_stopping;             //卸载中，不再开始新的读取
+static u64 DHT11_release_ns;            //开始采集的时刻，此前的边沿是主机自己拉低总线产生的
+
+static u8 DHT11_data[5];                //最近一次成功读取的数据，DHT11_data[4]为校验和
+static u64 DHT11_data_ns;               //最近一次成功读取的时刻，0表示尚无数据
+static unsigned int DHT11_refresh_ms = DHT11_REFRESH_MIN_MS;
+static unsigned int DHT11_errors;       //累计读取失败次数
+static s64 DHT11_iio_ts;                //最近一次成功读取的时刻，IIO时钟
+
+static struct iio_dev *DHT11_indio;     //IIO接口，注册失败时为NULL
+static struct iio_trigger *DHT11_trig;  //每次读取成功时触发
+
 //函数声明
-static u8 DHT11_data[5];
 static void DHT11_Mode(unsigned char mode);
-static void DHT11_Rst(void);
-static u8 DHT11_Check(void);
-static u8 DHT11ReadBit(void);
-static u8 DHT11ReadByte(void);
+static void DHT11_start_work_fn(struct work_struct *work);
+static void DHT11_decode_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(DHT11_start_work, DHT11_start_work_fn);
+static DECLARE_DELAYED_WORK(DHT11_decode_work, DHT11_decode_work_fn);
 //函数实现
-static void DHT11_Rst(void)	//复位DHT11
+/* 下降沿中断：只记录时间戳，收齐后立即调度解码 */
+static irqreturn_t DHT11_irq_handler(int irq, void *dev_id)
 {
-    DHT11_Mode(1);
-    gpio_set_value(DHT11_GPIO_PIN_NUM, 0);
-    mdelay(20);
-    gpio_set_value(DHT11_GPIO_PIN_NUM, 1);
-    udelay(13);
-}
-static u8 DHT11_Check(void)	//等待DHT11的回应
-{
-    unsigned char retry = 0;
-    DHT11_Mode(0);
-    while (gpio_get_value(DHT11_GPIO_PIN_NUM) && retry < 90)	//DHT11会拉低40~80us
-    {
-        retry++;
-        udelay(1);
-    }
-    if (retry >= 90)
+    u64 now = ktime_get_ns();
+    bool done = false;
+
+    spin_lock(&DHT11_lock);
+    if (DHT11_capturing && !DHT11_stopping && now > DHT11_release_ns &&
+        DHT11_edge_cnt < DHT11_EDGES + 1)
     {
-    	printk("DHT11_Check retry >= 90! retry=%d\n\n",retry);
-        return 1;
+        DHT11_edges[DHT11_edge_cnt++] = now;
+        done = DHT11_edge_cnt == DHT11_EDGES;
     }
-    else
-        retry = 0;
-    while (!gpio_get_value(DHT11_GPIO_PIN_NUM) && retry < 92)	//DHT11拉低后会再次拉高40~80us
+    spin_unlock(&DHT11_lock);
+
+    if (done)
     {
-        retry++;
-        udelay(1);
+        mod_delayed_work(system_wq, &DHT11_decode_work, 0);
     }
-    if (retry >= 92)
+    return IRQ_HANDLED;
+}
+
+/* 发送起始信号：拉低20ms（睡眠）后释放总线，开始记录下降沿 */
+static void DHT11_start_work_fn(struct work_struct *work)
+{
+    unsigned long flags;
+
+    DHT11_Mode(1);
+    gpio_set_value_cansleep(DHT11_gpio, 0);
+    msleep(DHT11_START_MS);
+
+    //拉低总线时锁存的下降沿在开中断时重放，此时还未开始采集，由中断丢弃
+    enable_irq(DHT11_irq);
+
+    spin_lock_irqsave(&DHT11_lock, flags);
+    if (DHT11_stopping)
     {
-    	printk("DHT11_Check retry >= 92! retry=%d\n\n",retry);
-    	return 1;
+        spin_unlock_irqrestore(&DHT11_lock, flags);
+        disable_irq(DHT11_irq);
+        return;
     }
-    return 0;
+    DHT11_edge_cnt = 0;
+    DHT11_capturing = true;
+    DHT11_release_ns = ktime_get_ns();
+    spin_unlock_irqrestore(&DHT11_lock, flags);
+
+    gpio_set_value_cansleep(DHT11_gpio, 1);
+    DHT11_Mode(0);
+
+    //收齐边沿时由中断提前调度，否则超时后按已收到的边沿解码
+    mod_delayed_work(system_wq, &DHT11_decode_work, msecs_to_jiffies(DHT11_CAPTURE_MS));
 }
-static u8 DHT11ReadBit(void)		//从DHT11读取一个位
+
+/* 下半部：由最后41个下降沿得到40个位间隔，应答沿可能因中断延迟丢失，不参与解码 */
+static void DHT11_decode_work_fn(struct work_struct *work)
 {
-    unsigned char retry = 0;
-    while (gpio_get_value(DHT11_GPIO_PIN_NUM) && retry < 100)	//等待变为低电平
+    u64 edges[DHT11_EDGES + 1];
+    u8 data[5] = {0};
+    unsigned long flags;
+    int cnt, first, i;
+    bool ok = true;
+
+    spin_lock_irqsave(&DHT11_lock, flags);
+    if (!DHT11_capturing)
     {
-        retry++;
-        udelay(1);
+        //超时和收齐边沿可能各调度一次，本次采集已由先运行的解码处理，中断也已关闭
+        spin_unlock_irqrestore(&DHT11_lock, flags);
+        return;
     }
-    retry = 0;
-    while (!gpio_get_value(DHT11_GPIO_PIN_NUM) && retry < 100)	//等待变高电平
+    DHT11_capturing = false;
+    cnt = DHT11_edge_cnt;
+    memcpy(edges, DHT11_edges, sizeof(edges));
+    spin_unlock_irqrestore(&DHT11_lock, flags);
+    disable_irq(DHT11_irq);     //与采集开始时的enable_irq一一对应
+
+    if (cnt < DHT11_EDGES - 1)
     {
-        retry++;
-        udelay(1);
+        ok = false;
+        if (DHT11_errors++ % 16 == 0)
+        {
+            printk("Can't use dht11! edges=%d\n\n", cnt);
+        }
     }
-    udelay(40);
-    if (gpio_get_value(DHT11_GPIO_PIN_NUM))
+
+    first = cnt - (DHT11_EDGES - 1);
+    for (i = 0; ok && i < 40; i++)
     {
-    	return 1;
+        u64 width = edges[first + i + 1] - edges[first + i];
+        if (width < DHT11_BIT_MIN_NS || width > DHT11_BIT_MAX_NS)
+        {
+            ok = false;     //干扰或丢失边沿
+            DHT11_errors++;
+            break;
+        }
+        data[i / 8] = (data[i / 8] << 1) | (width > DHT11_BIT_ONE_NS);
     }
-    else
-        return 0;
-}
-static u8 DHT11ReadByte(void)
-{
-    unsigned char i, dat;
-    dat = 0;
-    for (i = 0; i < 8; i++)
+
+    if (ok && (u8)(data[0] + data[1] + data[2] + data[3]) != data[4])
     {
-        dat <<= 1;
-        dat |= DHT11ReadBit();
+        ok = false;
+        DHT11_errors++;
+        printk("Data read error!\n\n");
+    }
+
+    if (ok)
+    {
+        spin_lock_irqsave(&DHT11_lock, flags);
+        memcpy(DHT11_data, data, sizeof(DHT11_data));
+        DHT11_data_ns = ktime_get_ns();
+        if (DHT11_indio)
+        {
+            DHT11_iio_ts = iio_get_time_ns(DHT11_indio);
+        }
+        spin_unlock_irqrestore(&DHT11_lock, flags);
+        if (DHT11_trig)
+        {
+            elf_iio_trigger_poll(DHT11_trig);   //在当前工作上下文中推送到缓冲区
+        }
+    }
+
+    if (!READ_ONCE(DHT11_stopping))
+    {
+        schedule_delayed_work(&DHT11_start_work, msecs_to_jiffies(READ_ONCE(DHT11_refresh_ms)));
     }
-    return dat;
 }
 
 void DHT11_Mode(u8 mode)	//mode=0则为输入模式
 {
     if (mode)
-        gpio_direction_output(DHT11_GPIO_PIN_NUM, 1);
+        gpio_direction_output(DHT11_gpio, 1);
     else
-        gpio_direction_input(DHT11_GPIO_PIN_NUM);
+        gpio_direction_input(DHT11_gpio);
 }
 
+/*
+取缓存的数据，返回是否有效；连续多个周期读取失败后视为无数据，不返回过期的温湿度
+*/
+static bool DHT11_get(u8 data[5], s64 *iio_ts)
+{
+    unsigned long flags;
+    bool fresh;
+
+    spin_lock_irqsave(&DHT11_lock, flags);
+    memcpy(data, DHT11_data, 5);
+    fresh = DHT11_data_ns != 0 &&
+            ktime_get_ns() - DHT11_data_ns <= (u64)DHT11_refresh_ms * DHT11_STALE_REFRESHES * NSEC_PER_MSEC;
+    if (iio_ts)
+    {
+        *iio_ts = DHT11_iio_ts;
+    }
+    spin_unlock_irqrestore(&DHT11_lock, flags);
+    return fresh;
+}
+
+/*
+返回缓存的数据，格式与旧版相同：湿度整数、湿度小数、温度整数、温度小数、状态（1有效 0无数据）
+*/
 static long DHT11_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
-    int i = 0;
+    u8 data[5];
+
     switch (cmd)
     {
         case DHT11_READ_DATA:
-            DHT11_Rst();
-            if (DHT11_Check() == 0)
+            if (DHT11_get(data, NULL))
             {
-                for (i = 0; i < 5; i++)
-                {
-                    DHT11_data[i] = DHT11ReadByte();
-                }
-                if ((DHT11_data[0] + DHT11_data[1] + DHT11_data[2] + DHT11_data[3]) == DHT11_data[4])
-                {
-                    DHT11_data[4] = 1;
-                }
-                else
-                {
-                    DHT11_data[4] = -1;
-                    printk("Data read error!\n\n");
-                }
+                data[4] = 1;
             }
             else
             {
-                DHT11_data[0] = 0;
-                printk("Can't use dht11!\n\n");
+                memset(data, 0, sizeof(data));
             }
             break;
         default:
             return -ENOTTY;
     }
-    if (copy_to_user((unsigned char __user *)arg, DHT11_data, sizeof(DHT11_data)))
+    if (copy_to_user((unsigned char __user *)arg, data, sizeof(data)))
     {
         return -EFAULT;
     }
@@ -159,19 +266,244 @@ static struct file_operations fops =
     .release = DHT11_release,
     .unlocked_ioctl = DHT11_ioctl,
 };
+
+/* sysfs: /sys/class/DHT11/<设备名>/refresh_ms（不小于2000）、errors */
+static ssize_t refresh_ms_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%u\n", READ_ONCE(DHT11_refresh_ms));
+}
+static ssize_t refresh_ms_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    unsigned int val;
+    int ret = kstrtouint(buf, 0, &val);
+    if (ret)
+    {
+        return ret;
+    }
+    if (val < DHT11_REFRESH_MIN_MS)
+    {
+        return -EINVAL;
+    }
+    WRITE_ONCE(DHT11_refresh_ms, val);     //下一个周期生效
+    return count;
+}
+static DEVICE_ATTR_RW(refresh_ms);
+
+static ssize_t errors_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+    return sysfs_emit(buf, "%u\n", READ_ONCE(DHT11_errors));
+}
+static DEVICE_ATTR_RO(errors);
+
+static struct attribute *DHT11_attrs[] =
+{
+    &dev_attr_refresh_ms.attr,
+    &dev_attr_errors.attr,
+    NULL,
+};
+ATTRIBUTE_GROUPS(DHT11);
+
+/*
+IIO接口：in_temp_input 单位 0.001 ℃，in_humidityrelative_input 单位 0.001 %RH，
+缓冲区每个采样为 温度、湿度（s32）加 s64 时间戳
+*/
+static const struct iio_chan_spec DHT11_channels[] =
+{
+    {
+        .type = IIO_TEMP,
+        .info_mask_separate = BIT(IIO_CHAN_INFO_PROCESSED),
+        .scan_index = 0,
+        .scan_type = {
+            .sign = 's',
+            .realbits = 32,
+            .storagebits = 32,
+            .endianness = IIO_CPU,
+        },
+    },
+    {
+        .type = IIO_HUMIDITYRELATIVE,
+        .info_mask_separate = BIT(IIO_CHAN_INFO_PROCESSED),
+        .scan_index = 1,
+        .scan_type = {
+            .sign = 's',
+            .realbits = 32,
+            .storagebits = 32,
+            .endianness = IIO_CPU,
+        },
+    },
+    IIO_CHAN_SOFT_TIMESTAMP(2),
+};
+
+//DHT11的小数字节为0.1位
+static s32 DHT11_temp_milli(const u8 data[5])
+{
+    return data[2] * 1000 + data[3] * 100;
+}
+static s32 DHT11_humidity_milli(const u8 data[5])
+{
+    return data[0] * 1000 + data[1] * 100;
+}
+
+static int DHT11_read_raw(struct iio_dev *indio_dev, struct iio_chan_spec const *chan,
+                          int *val, int *val2, long mask)
+{
+    u8 data[5];
+
+    if (mask != IIO_CHAN_INFO_PROCESSED)
+    {
+        return -EINVAL;
+    }
+    if (!DHT11_get(data, NULL))
+    {
+        return -EAGAIN;
+    }
+    *val = chan->type == IIO_TEMP ? DHT11_temp_milli(data) : DHT11_humidity_milli(data);
+    return IIO_VAL_INT;
+}
+
+static const struct iio_info DHT11_iio_info =
+{
+    .read_raw = DHT11_read_raw,
+};
+
+/* 触发后把缓存的采样推入缓冲区，使用其他触发器时只推送有效数据 */
+static irqreturn_t DHT11_trigger_handler(int irq, void *p)
+{
+    struct iio_poll_func *pf = p;
+    struct iio_dev *indio_dev = pf->indio_dev;
+    struct
+    {
+        s32 channels[2];
+        s64 timestamp __aligned(8);
+    } scan;
+    u8 data[5];
+    s64 ts;
+    int i = 0;
+
+    memset(&scan, 0, sizeof(scan));
+    if (DHT11_get(data, &ts))
+    {
+        //只打包已启用的通道
+        if (test_bit(0, indio_dev->active_scan_mask))
+        {
+            scan.channels[i++] = DHT11_temp_milli(data);
+        }
+        if (test_bit(1, indio_dev->active_scan_mask))
+        {
+            scan.channels[i++] = DHT11_humidity_milli(data);
+        }
+        iio_push_to_buffers_with_timestamp(indio_dev, &scan, ts);
+    }
+    iio_trigger_notify_done(indio_dev->trig);
+    return IRQ_HANDLED;
+}
+
+static void DHT11_iio_exit(void)
+{
+    if (!DHT11_indio)
+    {
+        return;
+    }
+    iio_device_unregister(DHT11_indio);
+    iio_triggered_buffer_cleanup(DHT11_indio);
+    iio_trigger_unregister(DHT11_trig);
+    iio_trigger_free(DHT11_trig);
+    iio_device_free(DHT11_indio);
+    DHT11_indio = NULL;
+    DHT11_trig = NULL;
+}
+
+static int DHT11_iio_init(struct device *parent)
+{
+    struct iio_dev *indio_dev;
+    struct iio_trigger *trig;
+    int ret;
+
+    indio_dev = iio_device_alloc(parent, 0);
+    if (!indio_dev)
+    {
+        return -ENOMEM;
+    }
+    indio_dev->dev.parent = parent;
+    indio_dev->name = "dht11";
+    indio_dev->info = &DHT11_iio_info;
+    indio_dev->modes = INDIO_DIRECT_MODE;
+    indio_dev->channels = DHT11_channels;
+    indio_dev->num_channels = ARRAY_SIZE(DHT11_channels);
+
+    trig = elf_iio_trigger_alloc(parent, "%s-dev%d", indio_dev->name, indio_dev->id);
+    if (!trig)
+    {
+        ret = -ENOMEM;
+        goto free_dev;
+    }
+    trig->dev.parent = parent;
+    ret = iio_trigger_register(trig);
+    if (ret)
+    {
+        goto free_trig;
+    }
+
+    ret = iio_triggered_buffer_setup(indio_dev, NULL, DHT11_trigger_handler, NULL);
+    if (ret)
+    {
+        goto unregister_trig;
+    }
+    ret = iio_device_register(indio_dev);
+    if (ret)
+    {
+        goto cleanup_buffer;
+    }
+
+    DHT11_trig = trig;
+    DHT11_indio = indio_dev;
+    return 0;
+
+cleanup_buffer:
+    iio_triggered_buffer_cleanup(indio_dev);
+unregister_trig:
+    iio_trigger_unregister(trig);
+free_trig:
+    iio_trigger_free(trig);
+free_dev:
+    iio_device_free(indio_dev);
+    return ret;
+}
+
 static int __init DHT11_init(void)
 {
     int ret;
-    gpio_free(DHT11_GPIO_PIN_NUM);
-    if (gpio_request(DHT11_GPIO_PIN_NUM, "DHT11"))
+    gpio_free(DHT11_gpio);
+    if (gpio_request(DHT11_gpio, "DHT11"))
     {
         printk("request %s gpio faile \n", "DHT11");
         return -1;
     }
+    DHT11_Mode(1);      //空闲时保持高电平
+
+    //中断只在采集窗口内打开
+    DHT11_irq = gpio_to_irq(DHT11_gpio);
+    if (DHT11_irq < 0)
+    {
+        pr_err("Failed to get DHT11 irq: %d\n", DHT11_irq);
+        gpio_free(DHT11_gpio);
+        return DHT11_irq;
+    }
+    irq_set_status_flags(DHT11_irq, IRQ_NOAUTOEN);
+    ret = request_irq(DHT11_irq, DHT11_irq_handler, IRQF_TRIGGER_FALLING, "DHT11", NULL);
+    if (ret)
+    {
+        pr_err("Failed to request DHT11 irq: %d\n", ret);
+        gpio_free(DHT11_gpio);
+        return ret;
+    }
+
     ret = alloc_chrdev_region(&dev_num, 0, 1, DEVICE_NAME);
     if (ret < 0)
     {
         printk(KERN_ALERT "Failed to allocate device number: %d\n", ret);
+        free_irq(DHT11_irq, NULL);
+        gpio_free(DHT11_gpio);
         return ret;
     }
     major = MAJOR(dev_num);
@@ -181,25 +513,51 @@ static int __init DHT11_init(void)
     DHT11_cdev.owner = THIS_MODULE;
     cdev_init(&DHT11_cdev, &fops);
     cdev_add(&DHT11_cdev, dev_num, 1);
-    DHT11_class = class_create(THIS_MODULE, "DHT11");
+    DHT11_class = elf_class_create("DHT11");
     if (IS_ERR(DHT11_class))
     {
         pr_err("Failed to create class\n");
         return PTR_ERR(DHT11_class);
     }
-    DHT11_device = device_create(DHT11_class, NULL, MKDEV(major, minor), NULL, DEVICE_NAME);
+    DHT11_device = device_create_with_groups(DHT11_class, NULL, MKDEV(major, minor), NULL, DHT11_groups, DEVICE_NAME);
     if (IS_ERR(DHT11_device))
     {
         pr_err("Failed to create device\n");
         class_destroy(DHT11_class);
         return PTR_ERR(DHT11_device);
     }
+
+    //IIO接口可选，内核未启用IIO缓冲区时仍可通过字符设备读取
+    ret = DHT11_iio_init(DHT11_device);
+    if (ret)
+    {
+        pr_warn("DHT11 iio register failed: %d\n", ret);
+    }
+
+    //上电后等待传感器稳定再开始第一次读取
+    schedule_delayed_work(&DHT11_start_work, msecs_to_jiffies(DHT11_REFRESH_MIN_MS / 2));
     printk(KERN_INFO "Device registered successfully.\n");
     return 0;
 }
 static void __exit DHT11_exit(void)
 {
-    gpio_free(DHT11_GPIO_PIN_NUM);
+    unsigned long flags;
+
+    //置位后起始信号不再开始采集，中断不再记录边沿，已在运行的解码不再调度下一次读取
+    spin_lock_irqsave(&DHT11_lock, flags);
+    DHT11_stopping = true;
+    DHT11_capturing = false;
+    spin_unlock_irqrestore(&DHT11_lock, flags);
+
+    //等正在运行的起始信号和解码结束（解码中的disable_irq须在free_irq之前），再释放中断
+    cancel_delayed_work_sync(&DHT11_start_work);
+    cancel_delayed_work_sync(&DHT11_decode_work);
+    free_irq(DHT11_irq, NULL);
+    //释放中断后不会再调度解码，最后取消解码在置位前调度的起始信号
+    cancel_delayed_work_sync(&DHT11_decode_work);
+    cancel_delayed_work_sync(&DHT11_start_work);
+    DHT11_iio_exit();
+    gpio_free(DHT11_gpio);
     device_destroy(DHT11_class, MKDEV(major, minor));
     class_destroy(DHT11_class);
     cdev_del(&DHT11_cdev);
@@ -0,0 +1,46 @@
+/*
+模块名称：kcompat.h
+摘    要：开发板内核（5.10）与新版本内核的接口差异，驱动可同时在PC上编译，用模拟总线测试（见 driver/bench）
+*/
+#ifndef __ELF_KCOMPAT_H__
+#define __ELF_KCOMPAT_H__
+
+#include <linux/version.h>
+
+//6.4 起 class_create 不再需要 owner，iio_trigger_poll_chained 更名
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 4, 0)
+#define elf_class_create(name)          class_create(name)
+#define elf_iio_trigger_poll(trig)      iio_trigger_poll_nested(trig)
+#else
+#define elf_class_create(name)          class_create(THIS_MODULE, name)
+#define elf_iio_trigger_poll(trig)      iio_trigger_poll_chained(trig)
+#endif
+
+//5.13 起 iio_trigger_alloc 需要父设备
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 13, 0)
+#define elf_iio_trigger_alloc(parent, fmt, ...) iio_trigger_alloc(parent, fmt, ##__VA_ARGS__)
+#else
+#define elf_iio_trigger_alloc(parent, fmt, ...) iio_trigger_alloc(fmt, ##__VA_ARGS__)
+#endif
+
+//6.1 起 i2c remove 无返回值；6.3 起 probe 只有 client 参数，之前使用 probe_new
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 1, 0)
+#define ELF_I2C_REMOVE_RET              void
+#define ELF_I2C_REMOVE_RETURN           return
+#else
+#define ELF_I2C_REMOVE_RET              int
+#define ELF_I2C_REMOVE_RETURN           return 0
+#endif
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+#define ELF_I2C_PROBE                   probe
+#else
+#define ELF_I2C_PROBE                   probe_new
+#endif
+
+//6.12 删除了 no_llseek，llseek 为空即不可定位
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 12, 0)
+#define no_llseek                       NULL
+#endif
+
+#endif
@@ -1,54 +1,182 @@
+/*
+模块名称：myled.c
+摘    要：报警LED驱动
+说    明：注册为leds-class设备 /sys/class/leds/elf::alarm，可使用内核timer/heartbeat/pattern等触发器；
+          /dev/my_device 保留开关命令并新增 SET_LED_PATTERN，闪烁、心跳和定时熄灭都在内核中完成，
+          打开和关闭设备不再改变LED状态
+*/
 #include <linux/module.h>       // 包含模块相关函数的头文件
 #include <linux/fs.h>           // 包含文件系统相关函数的头文件
 #include <linux/uaccess.h>      // 包含用户空间数据访问函数的头文件
 #include <linux/cdev.h>         //包含字符设备头文件
 #include <linux/device.h>
 #include <linux/gpio.h>
+#include <linux/leds.h>
+#include <linux/workqueue.h>
+#include <linux/mutex.h>
+#include <linux/jiffies.h>
+#include "myled.h"
+#include "../kcompat.h"
 
 #define DEVICE_NAME "mydevice"  // 设备名称
-#define LED_IOC_MAGIC 'k'
-#define SET_LED_ON _IO(LED_IOC_MAGIC, 0)
-#define SET_LED_OFF _IO(LED_IOC_MAGIC, 1)
 #define GPIO_LED_PIN_NUM 107
+#define LED_PATTERN_MAX_STEPS   4
+#define LED_PATTERN_MIN_MS      10      //每步最短时间，避免占满工作队列
+#define LED_PATTERN_MAX_MS      60000
+
 static dev_t dev_num;   //分配的设备号
 struct  cdev my_cdev;          //字符设备指针
 int major;  //主设备号
 int minor;  //次设备号
 static struct class *my_led;
 static struct device *my_device;
+static int led_gpio = GPIO_LED_PIN_NUM;    //默认使用开发板引脚，测试时可指定模拟GPIO
+module_param_named(gpio, led_gpio, int, 0444);
+
+/* 闪烁模式由若干步组成，每步为亮或灭并保持一段时间，按周期重复 */
+struct led_step {
+    u8 on;
+    unsigned int ms;
+};
+
+static DEFINE_MUTEX(led_mutex);         //保护闪烁状态和GPIO输出，GPIO可能在I2C等扩展芯片上，设置时会睡眠
+static struct led_step led_steps[LED_PATTERN_MAX_STEPS];
+static unsigned int led_nsteps;
+static unsigned int led_pos;            //下一步
+static unsigned int led_repeat;         //重复周期数，0表示一直重复
+static unsigned int led_cycles;         //已完成的周期数
+static unsigned long led_deadline;      //当前步的结束时刻
+static bool led_active;
+
+static void led_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(led_work, led_work_fn);
+
+/* 执行一步并安排下一步，调用时持有 led_mutex */
+static void led_step_locked(void)
+{
+    if (led_pos == led_nsteps)
+    {
+        led_pos = 0;
+        if (led_repeat && ++led_cycles >= led_repeat)
+        {
+            led_active = false;
+            gpio_set_value_cansleep(led_gpio, 0);
+            return;
+        }
+    }
+    gpio_set_value_cansleep(led_gpio, led_steps[led_pos].on);
+    led_deadline = jiffies + msecs_to_jiffies(led_steps[led_pos].ms);
+    mod_delayed_work(system_wq, &led_work, msecs_to_jiffies(led_steps[led_pos].ms));
+    led_pos++;
+}
+
+static void led_work_fn(struct work_struct *work)
+{
+    mutex_lock(&led_mutex);
+    if (led_active)
+    {
+        //重新设置模式时本次执行可能已在等待锁，按新模式的结束时刻重新等待
+        if (time_before(jiffies, led_deadline))
+            mod_delayed_work(system_wq, &led_work, led_deadline - jiffies);
+        else
+            led_step_locked();
+    }
+    mutex_unlock(&led_mutex);
+}
+
+/*
+停止闪烁并设置为常亮或熄灭。在锁内取消工作，不会取消之后新设置的模式；
+不等待工作结束，正在等锁的工作看到 led_active 为假后直接返回
+*/
+static void led_set(int on)
+{
+    mutex_lock(&led_mutex);
+    led_active = false;
+    cancel_delayed_work(&led_work);
+    gpio_set_value_cansleep(led_gpio, on);
+    mutex_unlock(&led_mutex);
+}
+
+static int led_start_pattern(const struct led_pattern_req *req)
+{
+    struct led_step steps[LED_PATTERN_MAX_STEPS];
+    unsigned int nsteps, repeat, i;
+
+    switch (req->mode)
+    {
+        case LED_PATTERN_BLINK:
+            steps[0].on = 1;
+            steps[0].ms = req->on_ms;
+            steps[1].on = 0;
+            steps[1].ms = req->off_ms;
+            nsteps = 2;
+            repeat = req->count;
+            break;
+        case LED_PATTERN_LATCH:
+            steps[0].on = 1;
+            steps[0].ms = req->on_ms;
+            nsteps = 1;
+            repeat = 1;
+            break;
+        case LED_PATTERN_HEARTBEAT:
+            steps[0].on = 1;
+            steps[0].ms = 70;
+            steps[1].on = 0;
+            steps[1].ms = 250;
+            steps[2].on = 1;
+            steps[2].ms = 70;
+            steps[3].on = 0;
+            steps[3].ms = 1000;
+            nsteps = 4;
+            repeat = 0;
+            break;
+        default:
+            return -EINVAL;
+    }
+    for (i = 0; i < nsteps; i++)
+    {
+        if (steps[i].ms < LED_PATTERN_MIN_MS || steps[i].ms > LED_PATTERN_MAX_MS)
+            return -EINVAL;
+    }
+
+    mutex_lock(&led_mutex);
+    memcpy(led_steps, steps, sizeof(steps));
+    led_nsteps = nsteps;
+    led_repeat = repeat;
+    led_cycles = 0;
+    led_pos = 0;
+    led_active = true;
+    led_step_locked();
+    mutex_unlock(&led_mutex);
+    return 0;
+}
 
 static int device_open(struct inode *inode, struct file *file)
 {
-// 在这里处理设备打开的操作
-//设置GPIO引脚为输出模式，并将其初始化为低电平
-gpio_direction_output(GPIO_LED_PIN_NUM, 0);
-printk(KERN_INFO "This is device_open.\n");
     return 0;
 }
 
 static int device_release(struct inode *inode, struct file *file)
 {
-// 在这里处理设备关闭的操作
-gpio_direction_output(GPIO_LED_PIN_NUM, 0);
-printk(KERN_INFO "This is device_release.\n");
-
     return 0;
 }
 
 static long myled_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
+    struct led_pattern_req req;
 
-    switch (cmd) {
-            case SET_LED_ON:
-            // 设置GPIO引脚为高电平
-            gpio_set_value(GPIO_LED_PIN_NUM, 1);
+    switch (cmd)
+    {
+        case SET_LED_ON:
+            led_set(1);
             break;
-
         case SET_LED_OFF:
-          //设置GPIO引脚为低电平
-          gpio_set_value(GPIO_LED_PIN_NUM, 0);
+            led_set(0);
             break;
-
+        case SET_LED_PATTERN:
+            if (copy_from_user(&req, (void __user *)arg, sizeof(req)))
+                return -EFAULT;
+            return led_start_pattern(&req);
         default:
             return -ENOTTY;
     }
@@ -62,23 +190,75 @@ static struct file_operations fops = {
     .unlocked_ioctl = myled_ioctl,
 };
 
+/* leds-class：写 brightness 或切换触发器时停止驱动内的闪烁；设置GPIO可能睡眠，定时器等触发器由LED核心转到工作队列调用 */
+static int myled_brightness_set(struct led_classdev *cdev, enum led_brightness value)
+{
+    led_set(value != LED_OFF);
+    return 0;
+}
+
+/*
+/sys/class/leds/elf::alarm/alarm，一次写入设置报警闪烁：
+  blink <次数> <亮ms> <灭ms>、latch <ms>、heartbeat、off
+*/
+static ssize_t alarm_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t count)
+{
+    struct led_pattern_req req = {0};
+    int ret;
+
+    if (sscanf(buf, "blink %u %u %u", &req.count, &req.on_ms, &req.off_ms) == 3)
+        req.mode = LED_PATTERN_BLINK;
+    else if (sscanf(buf, "latch %u", &req.on_ms) == 1)
+        req.mode = LED_PATTERN_LATCH;
+    else if (sysfs_streq(buf, "heartbeat"))
+        req.mode = LED_PATTERN_HEARTBEAT;
+    else if (sysfs_streq(buf, "off"))
+    {
+        led_set(0);
+        return count;
+    }
+    else
+        return -EINVAL;
+
+    ret = led_start_pattern(&req);
+    return ret < 0 ? ret : count;
+}
+static DEVICE_ATTR_WO(alarm);
+
+static struct attribute *myled_attrs[] = {
+    &dev_attr_alarm.attr,
+    NULL,
+};
+ATTRIBUTE_GROUPS(myled);
+
+static struct led_classdev led_cdev = {
+    .name = "elf::alarm",
+    .max_brightness = 1,
+    .brightness_set_blocking = myled_brightness_set,
+    .groups = myled_groups,
+};
+
 static int __init mydevice_init(void)
 {
     int ret;
 
 // 在这里执行驱动程序的初始化操作
 //释放之前申请的GPIO,避免申请失败
-    gpio_free(GPIO_LED_PIN_NUM);
-        if (gpio_request(GPIO_LED_PIN_NUM, "led_run")) {
-                printk("request %s gpio faile \n", "led_run");
-                 return -1;
-         }
+    gpio_free(led_gpio);
+    if (gpio_request(led_gpio, "led_run")) {
+        printk("request %s gpio faile \n", "led_run");
+        return -1;
+    }
+    //LED状态只由命令改变，打开设备时不再复位
+    gpio_direction_output(led_gpio, 0);
+
     // 注册字符设备驱动程序
     ret = alloc_chrdev_region(&dev_num,0,1,DEVICE_NAME);
     if (ret < 0) {
         printk(KERN_ALERT "Failed to allocate device number: %d\n", ret);
+        gpio_free(led_gpio);
         return ret;
-}
+    }
     major=MAJOR(dev_num);
     minor=MINOR(dev_num);
     printk(KERN_INFO "major number: %d\n",major);
@@ -89,7 +269,7 @@ static int __init mydevice_init(void)
     cdev_add(&my_cdev,dev_num,1);
 
     // 创建设备类
-    my_led = class_create(THIS_MODULE, "my_led");
+    my_led = elf_class_create("my_led");
     if (IS_ERR(my_led)) {
         pr_err("Failed to create class\n");
         return PTR_ERR(my_led);
@@ -103,6 +283,13 @@ static int __init mydevice_init(void)
         return PTR_ERR(my_device);
     }
 
+    // 注册为leds-class设备，失败时字符设备仍可使用
+    ret = led_classdev_register(my_device, &led_cdev);
+    if (ret) {
+        pr_warn("Failed to register led class device: %d\n", ret);
+        led_cdev.dev = NULL;
+    }
+
     printk(KERN_INFO "Device registered successfully.\n");
     return 0;
 }
@@ -110,8 +297,12 @@ static int __init mydevice_init(void)
 static void __exit mydevice_exit(void)
 {
     // 在这里执行驱动程序的清理操作
+    if (led_cdev.dev)
+        led_classdev_unregister(&led_cdev);
+    led_set(0);
+    cancel_delayed_work_sync(&led_work);
     //释放申请的GPIO资源
-    gpio_free(GPIO_LED_PIN_NUM);
+    gpio_free(led_gpio);
     // 销毁设备节点
     device_destroy(my_led, MKDEV(major, minor));
     // 销毁设备类
@@ -119,7 +310,7 @@ static void __exit mydevice_exit(void)
     // 删除字符设备
     cdev_del(&my_cdev);
     // 注销字符设备驱动程序
-    unregister_chrdev(0, DEVICE_NAME);
+    unregister_chrdev_region(dev_num, 1);
 
     printk(KERN_INFO "Device unregistered.\n");
 }
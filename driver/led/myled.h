@@ -0,0 +1,31 @@
+/*
+模块名称：myled.h
+摘    要：LED驱动与应用程序共用的ioctl命令和报警闪烁模式
+*/
+#ifndef __MYLED_H__
+#define __MYLED_H__
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/*
+闪烁由驱动在内核中完成，应用程序保持设备打开，每次报警只需一次 ioctl；
+重新设置模式、SET_LED_ON/OFF 或写 brightness 都会停止正在执行的闪烁
+*/
+struct led_pattern_req {
+    __u32 mode;     //LED_PATTERN_*
+    __u32 count;    //BLINK：闪烁次数，0表示一直闪烁
+    __u32 on_ms;    //BLINK：每次点亮时间；LATCH：保持点亮时间
+    __u32 off_ms;   //BLINK：每次熄灭时间
+};
+
+#define LED_PATTERN_BLINK       0   //闪烁 count 次
+#define LED_PATTERN_LATCH       1   //点亮 on_ms 后熄灭，再次设置时重新计时
+#define LED_PATTERN_HEARTBEAT   2   //心跳闪烁，直到关闭或设置其他模式
+
+#define LED_IOC_MAGIC 'm'
+#define SET_LED_ON _IO(LED_IOC_MAGIC, 0)
+#define SET_LED_OFF _IO(LED_IOC_MAGIC, 1)
+#define SET_LED_PATTERN _IOW(LED_IOC_MAGIC, 2, struct led_pattern_req)
+
+#endif
@@ -0,0 +1,293 @@
+/**
+ * @file attendance_ledger.c
+ * @brief 考勤台账只读访问实现
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include "attendance_ledger.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define ATTENDANCE_HEADER_SIZE  64
+#define ATTENDANCE_READ_BATCH   256     //每次读取的记录数
+#define ATTENDANCE_INDEX_SUFFIX ".idx"
+
+/*****************************************************************************/
+/* 局部函数                                                                  */
+/*****************************************************************************/
+static int attendance_ledger_read_header(int fd, struct attendance_ledger_header_t *header)
+{
+    if(pread(fd, header, sizeof(*header), 0) != (ssize_t)sizeof(*header))
+    {
+        return -1;
+    }
+    if(memcmp(header->magic, ATTENDANCE_LEDGER_MAGIC, sizeof(header->magic)) != 0 ||
+       header->version != ATTENDANCE_LEDGER_VERSION || header->record_size != sizeof(struct attendance_record_t))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/* 与 Python 端 person_key 一致：有工号按工号区分，否则按姓名 */
+static int attendance_same_person(const struct attendance_presence_t *p, const char *id, const char *name)
+{
+    if(id[0] != '\0' || p->id[0] != '\0')
+    {
+        return strcmp(p->id, id) == 0;
+    }
+    return strcmp(p->name, name) == 0;
+}
+
+static int attendance_presence_cmp(const void *a, const void *b)
+{
+    const struct attendance_presence_t *pa = (const struct attendance_presence_t *)a;
+    const struct attendance_presence_t *pb = (const struct attendance_presence_t *)b;
+    return (pa->first > pb->first) - (pa->first < pb->first);
+}
+
+/*****************************************************************************/
+/* 函数定义                                                                  */
+/*****************************************************************************/
+int attendance_ledger_open(struct attendance_ledger_t *ledger, const char *path)
+{
+    struct attendance_ledger_header_t header;
+    size_t len = strlen(path);
+    char *index_path;
+
+    ledger->index_fd = -1;
+    ledger->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(ledger->fd < 0)
+    {
+        return -1;
+    }
+    if(attendance_ledger_read_header(ledger->fd, &header) < 0)
+    {
+        close(ledger->fd);
+        ledger->fd = -1;
+        return -1;
+    }
+
+    index_path = (char *)malloc(len + sizeof(ATTENDANCE_INDEX_SUFFIX));
+    if(index_path)
+    {
+        memcpy(index_path, path, len);
+        memcpy(index_path + len, ATTENDANCE_INDEX_SUFFIX, sizeof(ATTENDANCE_INDEX_SUFFIX));
+        ledger->index_fd = open(index_path, O_RDONLY | O_CLOEXEC);
+        free(index_path);
+    }
+    return 0;
+}
+
+void attendance_ledger_close(struct attendance_ledger_t *ledger)
+{
+    if(ledger->index_fd >= 0)
+    {
+        close(ledger->index_fd);
+    }
+    if(ledger->fd >= 0)
+    {
+        close(ledger->fd);
+    }
+    ledger->fd = -1;
+    ledger->index_fd = -1;
+}
+
+uint32_t attendance_ledger_count(const struct attendance_ledger_t *ledger)
+{
+    struct attendance_ledger_header_t header;
+    if(attendance_ledger_read_header(ledger->fd, &header) < 0)
+    {
+        return 0;
+    }
+    return header.count;
+}
+
+uint32_t attendance_ledger_day_of(int64_t timestamp)
+{
+    time_t t = (time_t)timestamp;
+    struct tm tm;
+    localtime_r(&t, &tm);
+    return (uint32_t)((tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday);
+}
+
+int attendance_ledger_day_range(const struct attendance_ledger_t *ledger, uint32_t day, uint32_t *first, uint32_t *end)
+{
+    uint32_t count = attendance_ledger_count(ledger);
+    struct attendance_day_index_t entry;
+    off_t size;
+    uint32_t lo = 0, hi;
+
+    *first = 0;
+    *end = count;
+    if(ledger->index_fd < 0)
+    {
+        return 0;   //没有索引时由调用方按日期过滤全部记录
+    }
+
+    size = lseek(ledger->index_fd, 0, SEEK_END);
+    if(size < 0)
+    {
+        return -1;
+    }
+
+    //二分查找第一个日期不小于 day 的索引项
+    hi = (uint32_t)(size / sizeof(entry));
+    while(lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if(pread(ledger->index_fd, &entry, sizeof(entry), (off_t)mid * sizeof(entry)) != (ssize_t)sizeof(entry))
+        {
+            return -1;
+        }
+        if(entry.day < day)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    if(lo * sizeof(entry) >= (uint64_t)size ||
+       pread(ledger->index_fd, &entry, sizeof(entry), (off_t)lo * sizeof(entry)) != (ssize_t)sizeof(entry) ||
+       entry.day != day)
+    {
+        *end = 0;
+        return 0;
+    }
+    *first = entry.first < count ? entry.first : count;
+
+    //下一天的第一条即为当天的结束位置，最后一天到 count 为止
+    if((lo + 1) * sizeof(entry) < (uint64_t)size &&
+       pread(ledger->index_fd, &entry, sizeof(entry), (off_t)(lo + 1) * sizeof(entry)) == (ssize_t)sizeof(entry) &&
+       entry.first < count)
+    {
+        *end = entry.first;
+    }
+    if(*end < *first)
+    {
+        *end = *first;
+    }
+    return 0;
+}
+
+int attendance_ledger_read(const struct attendance_ledger_t *ledger, uint32_t first, uint32_t n,
+                           struct attendance_record_t *out)
+{
+    uint32_t count = attendance_ledger_count(ledger);
+    ssize_t ret;
+
+    if(first >= count)
+    {
+        return 0;
+    }
+    if(n > count - first)
+    {
+        n = count - first;
+    }
+
+    ret = pread(ledger->fd, out, (size_t)n * sizeof(*out), ATTENDANCE_HEADER_SIZE + (off_t)first * sizeof(*out));
+    if(ret < 0)
+    {
+        return -1;
+    }
+    return (int)(ret / sizeof(*out));
+}
+
+int attendance_ledger_day_summary(const struct attendance_ledger_t *ledger, uint32_t day,
+                                  struct attendance_presence_t *out, int max)
+{
+    struct attendance_record_t records[ATTENDANCE_READ_BATCH];
+    struct attendance_presence_t *people = NULL;
+    int people_cnt = 0, people_cap = 0;
+    uint32_t first, end, row;
+    int i, j, n;
+
+    if(attendance_ledger_day_range(ledger, day, &first, &end) < 0)
+    {
+        return -1;
+    }
+
+    for(row = first; row < end; row += n)
+    {
+        n = attendance_ledger_read(ledger, row, end - row < ATTENDANCE_READ_BATCH ? end - row : ATTENDANCE_READ_BATCH, records);
+        if(n <= 0)
+        {
+            break;
+        }
+
+        for(i = 0; i < n; i++)
+        {
+            const struct attendance_record_t *r = &records[i];
+            char id[ATTENDANCE_ID_LEN + 1];
+            char name[ATTENDANCE_NAME_LEN + 1];
+
+            if(r->day != day)
+            {
+                continue;   //系统时间回拨写入的其他日期记录
+            }
+            memcpy(id, r->id, ATTENDANCE_ID_LEN);
+            id[ATTENDANCE_ID_LEN] = '\0';
+            memcpy(name, r->name, ATTENDANCE_NAME_LEN);
+            name[ATTENDANCE_NAME_LEN] = '\0';
+
+            for(j = 0; j < people_cnt && !attendance_same_person(&people[j], id, name); j++)
+            {
+            }
+
+            if(j == people_cnt)
+            {
+                if(people_cnt == people_cap)
+                {
+                    int cap = people_cap ? people_cap * 2 : 64;
+                    struct attendance_presence_t *p = (struct attendance_presence_t *)realloc(people, cap * sizeof(*p));
+                    if(!p)
+                    {
+                        free(people);
+                        return -1;
+                    }
+                    people = p;
+                    people_cap = cap;
+                }
+                memcpy(people[j].id, id, sizeof(id));
+                memcpy(people[j].name, name, sizeof(name));
+                people[j].first = r->timestamp;
+                people[j].last = r->timestamp;
+                people[j].count = 0;
+                people_cnt++;
+            }
+
+            if(r->timestamp < people[j].first)
+            {
+                people[j].first = r->timestamp;
+            }
+            if(r->timestamp > people[j].last)
+            {
+                people[j].last = r->timestamp;
+            }
+            people[j].count++;
+        }
+    }
+
+    if(people_cnt > 0)
+    {
+        qsort(people, people_cnt, sizeof(*people), attendance_presence_cmp);
+        if(out && max > 0)
+        {
+            memcpy(out, people, (people_cnt < max ? people_cnt : max) * sizeof(*people));
+        }
+    }
+    free(people);
+    return people_cnt;
+}
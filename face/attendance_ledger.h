@@ -0,0 +1,127 @@
+/**
+ * @file attendance_ledger.h
+ * @brief 考勤台账只读访问：定长记录 + 按天索引，供物联网上报等 C 程序查询当天出勤
+ *
+ * 文件由 attendance_ledger.py 写入。台账文件头64字节，之后为每条64字节的考勤记录，按写入顺序排列；
+ * 索引文件（台账路径加 .idx）在日期变化时追加一项，记录当天第一条记录的行号，
+ * 因此查询某天只需读取该天的记录。写端先写记录再更新文件头中的 count，读端只访问前 count 条记录。
+ */
+
+#ifndef __ATTENDANCE_LEDGER_H__
+#define __ATTENDANCE_LEDGER_H__
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define ATTENDANCE_LEDGER_PATH      "/home/elf/face/data/attendance.ledger"     //台账路径
+#define ATTENDANCE_LEDGER_MAGIC     "ATTLEDG"                                   //文件标识，末尾含 \0 共8字节
+#define ATTENDANCE_LEDGER_VERSION   1
+
+#define ATTENDANCE_ID_LEN           16      //工号最大字节数（UTF-8，不足以 \0 填充）
+#define ATTENDANCE_NAME_LEN         32      //姓名最大字节数
+
+/*****************************************************************************/
+/* 类型定义                                                                  */
+/*****************************************************************************/
+/* 文件头，64字节，Python端以 "<8sIII44x" 解析 */
+struct attendance_ledger_header_t
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;       //sizeof(struct attendance_record_t)
+    uint32_t count;             //已提交的记录数
+    uint8_t reserved[44];
+};
+
+/* 考勤记录，64字节，Python端以 "<qIf16s32s" 解析 */
+struct attendance_record_t
+{
+    int64_t timestamp;                  //考勤时刻（Unix 时间，秒）
+    uint32_t day;                       //本地日期 YYYYMMDD
+    float distance;                     //特征距离，由旧版日志导入的记录为0
+    char id[ATTENDANCE_ID_LEN];         //工号，旧版日志中无法确定时为空
+    char name[ATTENDANCE_NAME_LEN];     //姓名
+} __attribute__((packed));
+
+/* 按天索引项，8字节 */
+struct attendance_day_index_t
+{
+    uint32_t day;               //本地日期 YYYYMMDD
+    uint32_t first;             //当天第一条记录的行号
+};
+
+/* 某人某天的出勤汇总 */
+struct attendance_presence_t
+{
+    char id[ATTENDANCE_ID_LEN + 1];
+    char name[ATTENDANCE_NAME_LEN + 1];
+    int64_t first;              //首次考勤时刻
+    int64_t last;               //最近一次考勤时刻
+    uint32_t count;             //考勤次数
+};
+
+/* 已打开的台账 */
+struct attendance_ledger_t
+{
+    int fd;
+    int index_fd;               //索引文件不存在时为 -1，按天查询退化为全表扫描
+};
+
+/*****************************************************************************/
+/* 函数声明                                                                  */
+/*****************************************************************************/
+/**
+ * 打开台账
+ * @retval  0 - 成功
+ * @retval -1 - 文件不存在或格式错误
+ */
+int attendance_ledger_open(struct attendance_ledger_t *ledger, const char *path);
+
+/* 关闭台账 */
+void attendance_ledger_close(struct attendance_ledger_t *ledger);
+
+/* 当前已提交的记录数，每次调用重新读取文件头 */
+uint32_t attendance_ledger_count(const struct attendance_ledger_t *ledger);
+
+/* 本地日期 YYYYMMDD */
+uint32_t attendance_ledger_day_of(int64_t timestamp);
+
+/**
+ * 查询某天记录的行号范围 [first, end)
+ * @retval  0 - 成功，当天无记录时 first == end
+ * @retval -1 - 读取失败
+ */
+int attendance_ledger_day_range(const struct attendance_ledger_t *ledger, uint32_t day, uint32_t *first, uint32_t *end);
+
+/**
+ * 读取从 first 开始的 n 条记录
+ * @retval >=0 - 实际读取的条数
+ * @retval  -1 - 读取失败
+ */
+int attendance_ledger_read(const struct attendance_ledger_t *ledger, uint32_t first, uint32_t n,
+                           struct attendance_record_t *out);
+
+/**
+ * 汇总某天的出勤人员，按首次考勤时间排序
+ * @param out 输出数组，人数超过 max 时只保留前 max 人
+ * @retval >=0 - 当天出勤人数
+ * @retval  -1 - 读取失败
+ */
+int attendance_ledger_day_summary(const struct attendance_ledger_t *ledger, uint32_t day,
+                                  struct attendance_presence_t *out, int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,332 @@
+import bisect
+import contextlib
+import csv
+import fcntl
+import os
+import struct
+import threading
+import time
+from collections import namedtuple
+from datetime import datetime
+
+# 考勤台账，与 attendance_ledger.h 中的格式一致，替代逐行追加的 attendance.log
+#
+#   attendance.ledger       文件头64字节 "<8sIII44x"，之后为定长64字节记录 "<qIf16s32s":
+#                           时间戳(秒), 日期(YYYYMMDD, 本地时间), 距离, 工号, 姓名（UTF-8，\0 填充）
+#   attendance.ledger.idx   按天索引，每项8字节 "<II": 日期, 当天第一条记录的行号，只在日期变化时追加
+#
+# 追加时先写记录和索引，fsync 后再更新文件头中的 count，读端只访问前 count 条。
+# 写端（追加、导入、重建索引）互斥，锁在 attendance.ledger.lock 上，导入 rename 替换台账时不会丢失并发追加的记录。
+# 读端启动时扫描一次全部记录，在内存中维护每人最近一次考勤和记录行号，此后只读取新增记录。
+
+LEDGER_PATH = "/home/elf/face/data/attendance.ledger"
+ATTENDANCE_CSV_PATH = "/home/elf/face/data/attendance.log"
+GALLERY_PATH = "/home/elf/face/data/gallery.bin"
+
+MAGIC = b"ATTLEDG\0"
+VERSION = 1
+HEADER_FMT = "<8sIII44x"
+HEADER_SIZE = 64
+RECORD_FMT = "<qIf16s32s"
+RECORD_SIZE = 64
+INDEX_FMT = "<II"
+INDEX_SIZE = 8
+ID_LEN = 16
+NAME_LEN = 32
+
+TIME_FORMAT = "%Y-%m-%d %H:%M:%S"
+
+Record = namedtuple("Record", ["row", "timestamp", "day", "distance", "id", "name"])
+
+def index_path(path):
+    return path + ".idx"
+
+def day_of(timestamp): # 本地日期 YYYYMMDD
+    t = time.localtime(timestamp)
+    return t.tm_year * 10000 + t.tm_mon * 100 + t.tm_mday
+
+def parse_day(text): # "YYYY-MM-DD" -> YYYYMMDD
+    d = datetime.strptime(text, "%Y-%m-%d")
+    return d.year * 10000 + d.month * 100 + d.day
+
+def format_day(day):
+    return f"{day // 10000:04d}-{day // 100 % 100:02d}-{day % 100:02d}"
+
+def format_time(timestamp):
+    return datetime.fromtimestamp(timestamp).strftime(TIME_FORMAT)
+
+def _encode(text, size): # UTF-8 截断到 size 字节，不截断多字节字符
+    data = text.encode("utf-8")[:size]
+    return data.decode("utf-8", errors="ignore").encode("utf-8")
+
+def _decode(data):
+    return data.rstrip(b"\0").decode("utf-8", errors="ignore")
+
+def _pack(timestamp, emp_id, name, distance):
+    return struct.pack(RECORD_FMT, int(timestamp), day_of(timestamp), float(distance),
+                       _encode(emp_id, ID_LEN), _encode(name, NAME_LEN))
+
+def _unpack(data, first): # 解析连续的记录块，first 为第一条的行号
+    return [Record(first + i, ts, day, dist, _decode(emp_id), _decode(name))
+            for i, (ts, day, dist, emp_id, name) in enumerate(struct.iter_unpack(RECORD_FMT, data))]
+
+def _read_count(f):
+    f.seek(0)
+    magic, version, record_size, count = struct.unpack(HEADER_FMT, f.read(HEADER_SIZE))
+    if magic != MAGIC or version != VERSION or record_size != RECORD_SIZE:
+        raise ValueError("考勤台账文件格式错误")
+    return count
+
+@contextlib.contextmanager
+def _write_lock(path): # 写端互斥，锁在不会被 rename 替换的 .lock 文件上，读端无需加锁
+    with open(path + ".lock", "a") as lock:
+        fcntl.flock(lock, fcntl.LOCK_EX)
+        yield
+
+def create(path=LEDGER_PATH, records=()): # records 为按时间排序的 (时间戳, 工号, 姓名, 距离)
+    with _write_lock(path):
+        _write_new(path, records)
+
+def _write_new(path, records): # 写临时文件后 rename，整体替换
+    data = bytearray(struct.pack(HEADER_FMT, MAGIC, VERSION, RECORD_SIZE, len(records)))
+    index = bytearray()
+    last_day = 0
+    for row, record in enumerate(records):
+        day = day_of(record[0])
+        if day > last_day:
+            index += struct.pack(INDEX_FMT, day, row)
+            last_day = day
+        data += _pack(*record)
+
+    for target, content in ((index_path(path), index), (path, data)):   # 台账最后替换
+        tmp_path = target + ".tmp"
+        with open(tmp_path, "wb") as f:
+            f.write(content)
+            f.flush()
+            os.fsync(f.fileno())
+        os.rename(tmp_path, target)
+
+def ensure(path=LEDGER_PATH, csv_path=ATTENDANCE_CSV_PATH): # 台账不存在时创建，有旧版 attendance.log 则导入
+    if os.path.exists(path):
+        return
+    with _write_lock(path):
+        if not os.path.exists(path):    # 其他写端可能已先创建
+            _write_new(path, _read_csv(csv_path) if os.path.exists(csv_path) else ())
+
+def append(records, path=LEDGER_PATH): # 追加考勤记录，records 为 [(时间戳, 工号, 姓名, 距离), ...]
+    if not records:
+        return
+    ensure(path)
+    with _write_lock(path), open(path, "r+b") as f:
+        count = _read_count(f)
+
+        with open(index_path(path), "ab+") as idx:
+            # 索引只在日期变化时追加，最后一项可能指向上次未提交的行号，与本次写入位置一致
+            last_day = 0
+            if idx.seek(0, os.SEEK_END) >= INDEX_SIZE:
+                idx.seek(-INDEX_SIZE, os.SEEK_END)
+                last_day, _ = struct.unpack(INDEX_FMT, idx.read(INDEX_SIZE))
+
+            data = bytearray()
+            index = bytearray()
+            for i, record in enumerate(records):
+                day = day_of(record[0])
+                if day > last_day:
+                    index += struct.pack(INDEX_FMT, day, count + i)
+                    last_day = day
+                data += _pack(*record)
+
+            # 1. 记录和索引
+            f.seek(HEADER_SIZE + count * RECORD_SIZE)
+            f.write(data)
+            f.flush()
+            if index:
+                idx.write(index)
+                idx.flush()
+                os.fsync(idx.fileno())
+            os.fsync(f.fileno())
+
+        # 2. 最后更新文件头中的 count 提交
+        f.seek(0)
+        f.write(struct.pack(HEADER_FMT, MAGIC, VERSION, RECORD_SIZE, count + len(records)))
+        f.flush()
+        os.fsync(f.fileno())
+
+def import_csv(csv_path=ATTENDANCE_CSV_PATH, path=LEDGER_PATH, gallery_path=GALLERY_PATH): # 由旧版 attendance.log 生成台账
+    records = _read_csv(csv_path, gallery_path)
+    with _write_lock(path):
+        _write_new(path, records)
+    return len(records)
+
+def _read_csv(csv_path, gallery_path=GALLERY_PATH): # 旧版 attendance.log 中的记录，按时间排序
+    # 旧日志只有时间和姓名，姓名在人脸库中唯一时补全工号
+    ids = {}
+    if os.path.exists(gallery_path):
+        import face_gallery
+        g = face_gallery.FaceGallery(gallery_path)
+        for emp_id, name, deleted in zip(g.ids, g.names, g.deleted):
+            if not deleted:
+                ids.setdefault(name, set()).add(emp_id)
+        g.close()
+
+    records = []
+    with open(csv_path, "r", encoding="utf-8-sig") as f:
+        for line in csv.reader(f):
+            if len(line) < 2:
+                continue
+            try:
+                timestamp = datetime.strptime(line[0], TIME_FORMAT).timestamp()
+            except ValueError:
+                continue    # 表头或损坏的行
+            name = line[1]
+            candidates = ids.get(name, ())
+            emp_id = next(iter(candidates)) if len(candidates) == 1 else ""
+            records.append((timestamp, emp_id, name, 0.0))
+
+    records.sort(key=lambda r: r[0])
+    return records
+
+def reindex(path=LEDGER_PATH): # 由台账重建按天索引
+    with _write_lock(path), open(path, "rb") as f:
+        count = _read_count(f)
+        index = bytearray()
+        last_day = 0
+        for record in _unpack(f.read(count * RECORD_SIZE), 0):
+            if record.day > last_day:
+                index += struct.pack(INDEX_FMT, record.day, record.row)
+                last_day = record.day
+        tmp_path = index_path(path) + ".tmp"
+        with open(tmp_path, "wb") as idx:
+            idx.write(index)
+            idx.flush()
+            os.fsync(idx.fileno())
+        os.rename(tmp_path, index_path(path))
+    return len(index) // INDEX_SIZE
+
+def person_key(emp_id, name): # 导入的旧记录可能没有工号，按姓名区分
+    return emp_id or name
+
+class AttendanceLedger: # 台账读端，查询前调用 refresh 读取新增记录
+    def __init__(self, path=LEDGER_PATH):
+        self.path = path
+        self.lock = threading.Lock()
+        self.f = None
+        self._reset()
+
+    def _reset(self):
+        if self.f is not None:
+            self.f.close()
+        self.f = None
+        self.inode = None
+        self.count = 0
+        self.days = []          # 按天索引 [(日期, 第一条行号)]
+        self.last_seen = {}     # 每人最近一次考勤 {key: Record}
+        self.rows = {}          # 每人的记录行号 {key: [行号]}
+
+    def refresh(self):
+        with self.lock:
+            self._refresh()
+
+    def _refresh(self):
+        try:
+            st = os.stat(self.path)
+        except FileNotFoundError:
+            self._reset()
+            return
+        if self.f is None or st.st_ino != self.inode:
+            self._reset()       # 重新导入后文件被替换
+            self.f = open(self.path, "rb")
+            self.inode = os.fstat(self.f.fileno()).st_ino
+
+        count = _read_count(self.f)
+        if count <= self.count:
+            return
+        self.f.seek(HEADER_SIZE + self.count * RECORD_SIZE)
+        for record in _unpack(self.f.read((count - self.count) * RECORD_SIZE), self.count):
+            key = person_key(record.id, record.name)
+            self.last_seen[key] = record
+            self.rows.setdefault(key, []).append(record.row)
+            if not self.days or record.day > self.days[-1][0]:
+                self.days.append((record.day, record.row))
+        self.count = count
+
+    def _read(self, first, end):
+        self.f.seek(HEADER_SIZE + first * RECORD_SIZE)
+        return _unpack(self.f.read((end - first) * RECORD_SIZE), first)
+
+    def _day_range(self, day):
+        i = bisect.bisect_left(self.days, (day, -1))
+        if i >= len(self.days) or self.days[i][0] != day:
+            return 0, 0
+        end = self.days[i + 1][1] if i + 1 < len(self.days) else self.count
+        return self.days[i][1], end
+
+    def present(self, within_s=None): # 今天已考勤的人员（可限定最近 within_s 秒内），按最近考勤时间倒序
+        with self.lock:
+            self._refresh()
+            now = time.time()
+            today = day_of(now)
+            people = [r for r in self.last_seen.values()
+                      if r.day == today and (within_s is None or now - r.timestamp <= within_s)]
+        return sorted(people, key=lambda r: r.timestamp, reverse=True)
+
+    def history(self, key, limit=50): # 某人最近 limit 条考勤记录，时间倒序
+        if limit <= 0:
+            return []   # rows[-0:] 是全部记录
+        with self.lock:
+            self._refresh()
+            rows = self.rows.get(key, [])[-limit:]
+            records = [self._read(row, row + 1)[0] for row in reversed(rows)]
+        return records
+
+    def summary(self, day=None): # 某天每人的首次、末次考勤时间和次数，按首次考勤排序
+        day = day or day_of(time.time())
+        with self.lock:
+            self._refresh()
+            first, end = self._day_range(day)
+            records = self._read(first, end) if end > first else []
+
+        people = {}
+        for r in records:
+            if r.day != day:
+                continue    # 系统时间回拨写入的其他日期记录
+            key = person_key(r.id, r.name)
+            p = people.get(key)
+            if p is None:
+                people[key] = {"id": r.id, "name": r.name, "first": r.timestamp, "last": r.timestamp, "count": 1}
+            else:
+                p["first"] = min(p["first"], r.timestamp)
+                p["last"] = max(p["last"], r.timestamp)
+                p["count"] += 1
+        return sorted(people.values(), key=lambda p: p["first"])
+
+    def close(self):
+        with self.lock:
+            self._reset()
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser(description="考勤台账维护工具")
+    parser.add_argument("command", choices=["import", "reindex", "present", "history", "summary"])
+    parser.add_argument("--id", type=str, help="员工ID或姓名（history）")
+    parser.add_argument("--date", type=str, help="日期 YYYY-MM-DD（summary，默认今天）")
+    args = parser.parse_args()
+    day = parse_day(args.date) if args.date else None
+
+    if args.command == "import":
+        print(f"已导入 {import_csv()} 条考勤记录")
+    elif args.command == "reindex":
+        print(f"索引共 {reindex()} 天")
+    else:
+        ledger = AttendanceLedger()
+        if args.command == "present":
+            for r in ledger.present():
+                print(f"{r.id}\t{r.name}\t{format_time(r.timestamp)}")
+        elif args.command == "history":
+            for r in ledger.history(args.id):
+                print(f"{format_time(r.timestamp)}\t{r.name}\t{r.distance:.3f}")
+        else:
+            for p in ledger.summary(day):
+                print(f"{p['id']}\t{p['name']}\t{format_time(p['first'])}\t{format_time(p['last'])}\t{p['count']}")
+        ledger.close()
@@ -0,0 +1,77 @@
+import sys
+from rknn.api import RKNN
+
+# 人脸模型 ONNX -> RKNN，归一化写入模型，板端输入 uint8（与 face_backend_rknn.cpp 一致）
+#   retinaface: RetinaFace(mobilenet0.25) 320x320，输入 BGR、减均值 (104, 117, 123)，int8 量化
+#               （校准图片按 RGB 读入，quant_img_RGB2BGR 转为 BGR）
+#   dlib_resnet: dlib_face_recognition_resnet_model_v1 导出的 ONNX，150x150，输入 RGB，
+#                (RGB - (122.782, 117.001, 104.298)) / 256；默认 fp16，int8 会明显拉大与 dlib 特征的距离
+# 转换后用 face_backend_parity.py 在板端检查与 dlib 的一致性
+
+DATASET_PATH = './dataset.txt'     # 量化校准图片列表，每行一张人脸照片
+
+MODELS = {
+    'retinaface': dict(mean_values=[[104, 117, 123]], std_values=[[1, 1, 1]], quant_img_RGB2BGR=True,
+                       output='/home/elf/face/weights/retinaface_320.rknn', quant=True),
+    'dlib_resnet': dict(mean_values=[[122.782, 117.001, 104.298]], std_values=[[256, 256, 256]], quant_img_RGB2BGR=False,
+                        output='/home/elf/face/weights/dlib_resnet_v1.rknn', quant=False),
+}
+
+def parse_arg():
+    if len(sys.argv) < 4:
+        print("Usage: python3 {} [retinaface|dlib_resnet] onnx_model_path platform [fp|i8] [output_rknn_path]".format(sys.argv[0]))
+        print("       platform choose from [rk3562,rk3566,rk3568,rk3576,rk3588]")
+        exit(1)
+
+    kind = sys.argv[1]
+    if kind not in MODELS:
+        print("ERROR: Invalid model: {}".format(kind))
+        exit(1)
+    cfg = MODELS[kind]
+
+    model_path = sys.argv[2]
+    platform = sys.argv[3]
+
+    do_quant = cfg['quant']
+    if len(sys.argv) > 4:
+        if sys.argv[4] not in ['fp', 'i8']:
+            print("ERROR: Invalid model type: {}".format(sys.argv[4]))
+            exit(1)
+        do_quant = sys.argv[4] == 'i8'
+
+    output_path = sys.argv[5] if len(sys.argv) > 5 else cfg['output']
+    return cfg, model_path, platform, do_quant, output_path
+
+if __name__ == '__main__':
+    cfg, model_path, platform, do_quant, output_path = parse_arg()
+
+    rknn = RKNN(verbose=False)
+
+    print('--> Config model')
+    rknn.config(mean_values=cfg['mean_values'], std_values=cfg['std_values'],
+                quant_img_RGB2BGR=cfg['quant_img_RGB2BGR'], target_platform=platform)
+    print('done')
+
+    print('--> Loading model')
+    ret = rknn.load_onnx(model=model_path)
+    if ret != 0:
+        print('Load model failed!')
+        exit(ret)
+    print('done')
+
+    print('--> Building model')
+    ret = rknn.build(do_quantization=do_quant, dataset=DATASET_PATH)
+    if ret != 0:
+        print('Build model failed!')
+        exit(ret)
+    print('done')
+
+    print('--> Export rknn model')
+    ret = rknn.export_rknn(output_path)
+    if ret != 0:
+        print('Export rknn model failed!')
+        exit(ret)
+    print("output_path:", output_path)
+    print('done')
+
+    rknn.release()
@@ -0,0 +1,274 @@
+/**
+ * @file face_backend.cpp
+ * @brief 人脸后端公共部分：RetinaFace 先验框解码、NMS、人脸对齐和 C 接口
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include "face_backend.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+#include <opencv2/imgproc.hpp>
+
+/*****************************************************************************/
+/* 局部变量                                                                  */
+/*****************************************************************************/
+/* RetinaFace(mobilenet0.25) 先验框配置 */
+static const int kPriorSteps[3] = { 8, 16, 32 };
+static const int kPriorMinSizes[3][2] = { { 16, 32 }, { 64, 128 }, { 256, 512 } };
+static const float kVariance[2] = { 0.1f, 0.2f };
+
+/* 5个关键点在 dlib 150x150 图像块中的位置：由 dlib 平均脸形（双眼取6点均值，鼻尖30，嘴角48/54）
+ * 按 get_face_chip_details(shape, 150, 0.25) 的映射 (p + 0.25) / 1.5 * 150 换算 */
+static const float kChipTemplate[10] = {
+    47.549f, 46.599f,
+    100.476f, 46.599f,
+    74.013f, 76.563f,
+    50.415f, 103.023f,
+    97.610f, 103.023f,
+};
+
+/*****************************************************************************/
+/* 局部函数                                                                  */
+/*****************************************************************************/
+static void generatePriors(std::vector<float> &priors, int size)
+{
+    priors.clear();
+    for(int k = 0; k < 3; k++)
+    {
+        int step = kPriorSteps[k];
+        int fm = (size + step - 1) / step;
+        for(int i = 0; i < fm; i++)
+        {
+            for(int j = 0; j < fm; j++)
+            {
+                for(int m = 0; m < 2; m++)
+                {
+                    priors.push_back((j + 0.5f) * step / size);
+                    priors.push_back((i + 0.5f) * step / size);
+                    priors.push_back(static_cast<float>(kPriorMinSizes[k][m]) / size);
+                    priors.push_back(static_cast<float>(kPriorMinSizes[k][m]) / size);
+                }
+            }
+        }
+    }
+}
+
+static float boxIoU(const face_box_t &a, const face_box_t &b)
+{
+    int left = std::max(a.left, b.left);
+    int top = std::max(a.top, b.top);
+    int right = std::min(a.right, b.right);
+    int bottom = std::min(a.bottom, b.bottom);
+
+    if(right <= left || bottom <= top)
+    {
+        return 0.0f;
+    }
+
+    float inter = static_cast<float>(right - left) * (bottom - top);
+    float areaA = static_cast<float>(a.right - a.left) * (a.bottom - a.top);
+    float areaB = static_cast<float>(b.right - b.left) * (b.bottom - b.top);
+    return inter / (areaA + areaB - inter);
+}
+
+/* 模型坐标还原到原图 */
+static float unletterbox(float v, int pad, float scale)
+{
+    return (v - pad) / scale;
+}
+
+/*****************************************************************************/
+/* 函数定义                                                                  */
+/*****************************************************************************/
+bool FaceBackend::detect(const cv::Mat &bgr, std::vector<face_box_t> &faces)
+{
+    std::vector<float> loc, conf, landm;
+    FaceLetterbox lb;
+    const float size = FACE_DET_INPUT_SIZE;
+
+    faces.clear();
+    if(priors.empty())
+    {
+        generatePriors(priors, FACE_DET_INPUT_SIZE);
+    }
+
+    size_t n = priors.size() / 4;
+    if(!runDetector(bgr, &lb, loc, conf, landm) || loc.size() < n * 4 || conf.size() < n * 2 || landm.size() < n * 10)
+    {
+        return false;
+    }
+
+    std::vector<face_box_t> candidates;
+    for(size_t i = 0; i < n; i++)
+    {
+        float score = conf[i * 2 + 1];
+        if(score < FACE_DET_CONF_THRESH)
+        {
+            continue;
+        }
+
+        const float *p = &priors[i * 4];
+        const float *l = &loc[i * 4];
+        float cx = p[0] + l[0] * kVariance[0] * p[2];
+        float cy = p[1] + l[1] * kVariance[0] * p[3];
+        float w = p[2] * std::exp(l[2] * kVariance[1]);
+        float h = p[3] * std::exp(l[3] * kVariance[1]);
+
+        face_box_t box;
+        box.left = static_cast<int32_t>(std::max(0.0f, unletterbox((cx - w / 2) * size, lb.padX, lb.scale)));
+        box.top = static_cast<int32_t>(std::max(0.0f, unletterbox((cy - h / 2) * size, lb.padY, lb.scale)));
+        box.right = static_cast<int32_t>(std::min(static_cast<float>(bgr.cols - 1), unletterbox((cx + w / 2) * size, lb.padX, lb.scale)));
+        box.bottom = static_cast<int32_t>(std::min(static_cast<float>(bgr.rows - 1), unletterbox((cy + h / 2) * size, lb.padY, lb.scale)));
+        box.score = score;
+        for(int k = 0; k < 5; k++)
+        {
+            box.landmarks[k * 2] = unletterbox((p[0] + landm[i * 10 + k * 2] * kVariance[0] * p[2]) * size, lb.padX, lb.scale);
+            box.landmarks[k * 2 + 1] = unletterbox((p[1] + landm[i * 10 + k * 2 + 1] * kVariance[0] * p[3]) * size, lb.padY, lb.scale);
+        }
+        if(box.right > box.left && box.bottom > box.top)
+        {
+            candidates.push_back(box);
+        }
+    }
+
+    //NMS
+    std::sort(candidates.begin(), candidates.end(),
+              [](const face_box_t &a, const face_box_t &b) { return a.score > b.score; });
+    for(const face_box_t &box : candidates)
+    {
+        bool keep = true;
+        for(const face_box_t &kept : faces)
+        {
+            if(boxIoU(box, kept) > FACE_DET_NMS_THRESH)
+            {
+                keep = false;
+                break;
+            }
+        }
+        if(keep)
+        {
+            faces.push_back(box);
+        }
+    }
+    return true;
+}
+
+bool FaceBackend::embed(const cv::Mat &bgr, const face_box_t &face, float *feature)
+{
+    return runEmbedder(alignFace(bgr, face), feature);
+}
+
+/* 5点最小二乘相似变换（旋转、等比缩放、平移），与 dlib 的 find_similarity_transform 一致 */
+cv::Mat FaceBackend::alignFace(const cv::Mat &bgr, const face_box_t &face)
+{
+    float smx = 0, smy = 0, dmx = 0, dmy = 0;
+    for(int k = 0; k < 5; k++)
+    {
+        smx += face.landmarks[k * 2] / 5;
+        smy += face.landmarks[k * 2 + 1] / 5;
+        dmx += kChipTemplate[k * 2] / 5;
+        dmy += kChipTemplate[k * 2 + 1] / 5;
+    }
+
+    float numA = 0, numB = 0, den = 0;
+    for(int k = 0; k < 5; k++)
+    {
+        float sx = face.landmarks[k * 2] - smx, sy = face.landmarks[k * 2 + 1] - smy;
+        float dx = kChipTemplate[k * 2] - dmx, dy = kChipTemplate[k * 2 + 1] - dmy;
+        numA += sx * dx + sy * dy;
+        numB += sx * dy - sy * dx;
+        den += sx * sx + sy * sy;
+    }
+
+    float a = den > 0 ? numA / den : 1.0f;
+    float b = den > 0 ? numB / den : 0.0f;
+    cv::Mat m = (cv::Mat_<double>(2, 3) << a, -b, dmx - (a * smx - b * smy),
+                                           b, a, dmy - (b * smx + a * smy));
+
+    cv::Mat chip;
+    cv::warpAffine(bgr, chip, m, cv::Size(FACE_CHIP_SIZE, FACE_CHIP_SIZE), cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+    return chip;
+}
+
+FaceBackend *FaceBackend::create(int kind)
+{
+    switch(kind)
+    {
+        case FACE_BACKEND_CPU:
+            return createCpuFaceBackend();
+        case FACE_BACKEND_RKNN:
+#ifdef FACE_BACKEND_WITH_RKNN
+            return createRknnFaceBackend();
+#else
+            return nullptr;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+/*****************************************************************************/
+/* C 接口                                                                  */
+/*****************************************************************************/
+struct face_backend_s
+{
+    FaceBackend *backend;
+    std::vector<face_box_t> faces;
+    std::mutex lock;        //服务中单次识别与连续考勤线程可能同时调用
+};
+
+face_backend_t *face_backend_create(int kind, const char *det_model, const char *emb_model)
+{
+    FaceBackend *backend = FaceBackend::create(kind);
+    if(backend == nullptr)
+    {
+        return nullptr;
+    }
+
+    if(!backend->load(det_model ? det_model : FACE_DET_MODEL_PATH, emb_model ? emb_model : FACE_EMB_MODEL_PATH))
+    {
+        delete backend;
+        return nullptr;
+    }
+
+    face_backend_t *b = new face_backend_s();
+    b->backend = backend;
+    return b;
+}
+
+void face_backend_destroy(face_backend_t *backend)
+{
+    if(backend)
+    {
+        delete backend->backend;
+        delete backend;
+    }
+}
+
+int face_backend_detect(face_backend_t *backend, const uint8_t *bgr, int width, int height, int stride,
+                        struct face_box_t *out, int max)
+{
+    cv::Mat image(height, width, CV_8UC3, const_cast<uint8_t *>(bgr), stride);
+    std::lock_guard<std::mutex> guard(backend->lock);
+    if(!backend->backend->detect(image, backend->faces))
+    {
+        return -1;
+    }
+
+    int n = std::min(max, static_cast<int>(backend->faces.size()));
+    std::copy(backend->faces.begin(), backend->faces.begin() + n, out);
+    return n;
+}
+
+int face_backend_embed(face_backend_t *backend, const uint8_t *bgr, int width, int height, int stride,
+                       const struct face_box_t *face, float *feature)
+{
+    cv::Mat image(height, width, CV_8UC3, const_cast<uint8_t *>(bgr), stride);
+    std::lock_guard<std::mutex> guard(backend->lock);
+    return backend->backend->embed(image, *face, feature) ? 0 : -1;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file face_backend.h
+ * @brief 人脸检测与特征提取后端：RKNN（NPU）与 OpenCV DNN（CPU 参考实现）
+ *
+ * 检测模型为 RetinaFace（输出人脸框和5个关键点），特征模型为由 dlib ResNet 转换的 ONNX/RKNN，
+ * 人脸按关键点对齐到与 dlib 相同的 150x150 图像块，特征与现有人脸库兼容。
+ * 两个后端共用先验框解码、NMS 和对齐，只在推理上不同；一致性由 face_backend_parity.py 校验。
+ */
+
+#ifndef __FACE_BACKEND_H__
+#define __FACE_BACKEND_H__
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include <stdint.h>
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define FACE_BACKEND_CPU            0       //OpenCV DNN 参考实现
+#define FACE_BACKEND_RKNN           1       //RKNN NPU
+
+#define FACE_DET_INPUT_SIZE         320     //检测模型输入边长
+#define FACE_DET_CONF_THRESH        0.5f    //人脸置信度阈值
+#define FACE_DET_NMS_THRESH         0.4f    //NMS IoU 阈值
+#define FACE_DET_LETTERBOX_COLOR    114     //letterbox 填充色，与姿态检测一致
+#define FACE_CHIP_SIZE              150     //对齐后人脸图像边长，与 dlib 一致
+#define FACE_FEATURE_DIM            128     //特征维度
+
+#define FACE_DET_MODEL_PATH         "/home/elf/face/weights/retinaface_320"         //不含扩展名，按后端加 .onnx/.rknn
+#define FACE_EMB_MODEL_PATH         "/home/elf/face/weights/dlib_resnet_v1"
+
+/*****************************************************************************/
+/* 类型定义                                                                  */
+/*****************************************************************************/
+/* 检测结果，坐标为原图像素；关键点依次为左眼、右眼、鼻尖、左嘴角、右嘴角（图像左右） */
+struct face_box_t
+{
+    int32_t left;
+    int32_t top;
+    int32_t right;
+    int32_t bottom;
+    float score;
+    float landmarks[10];
+};
+
+#ifdef __cplusplus
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+/* letterbox 参数：模型坐标 = 原图坐标 * scale + pad */
+struct FaceLetterbox
+{
+    float scale;
+    int padX;
+    int padY;
+};
+
+/* 人脸后端基类，子类只实现模型加载和推理 */
+class FaceBackend
+{
+public:
+    virtual ~FaceBackend() {}
+
+    static FaceBackend *create(int kind);   //未编译对应后端时返回 nullptr
+
+    //modelPath 不含扩展名，子类按自身格式补全
+    virtual bool load(const std::string &detModelPath, const std::string &embModelPath) = 0;
+
+    //检测 BGR 图像中的人脸，按置信度降序；推理失败返回 false
+    bool detect(const cv::Mat &bgr, std::vector<face_box_t> &faces);
+
+    //提取一张人脸的特征，feature 至少 FACE_FEATURE_DIM 个元素
+    bool embed(const cv::Mat &bgr, const face_box_t &face, float *feature);
+
+    //按关键点将人脸对齐到 FACE_CHIP_SIZE 的 BGR 图像块
+    static cv::Mat alignFace(const cv::Mat &bgr, const face_box_t &face);
+
+protected:
+    //检测推理：输出 loc[N*4]、conf[N*2]（softmax 后）、landm[N*10]，N 为先验框个数
+    virtual bool runDetector(const cv::Mat &bgr, FaceLetterbox *letterbox, std::vector<float> &loc,
+                             std::vector<float> &conf, std::vector<float> &landm) = 0;
+
+    //特征推理：输入对齐后的 BGR 图像块
+    virtual bool runEmbedder(const cv::Mat &chip, float *feature) = 0;
+
+private:
+    std::vector<float> priors;          //cx, cy, w, h（归一化），只生成一次
+};
+
+/* 各后端实现 */
+FaceBackend *createCpuFaceBackend();
+FaceBackend *createRknnFaceBackend();
+
+extern "C"
+{
+#endif
+
+/*****************************************************************************/
+/* C 接口                                                                  */
+/*****************************************************************************/
+typedef struct face_backend_s face_backend_t;
+
+/**
+ * 创建后端并加载模型
+ * @param kind      FACE_BACKEND_CPU / FACE_BACKEND_RKNN
+ * @param det_model 检测模型路径（不含扩展名），NULL 使用 FACE_DET_MODEL_PATH
+ * @param emb_model 特征模型路径（不含扩展名），NULL 使用 FACE_EMB_MODEL_PATH
+ * @retval NULL - 后端未编译或模型加载失败
+ */
+face_backend_t *face_backend_create(int kind, const char *det_model, const char *emb_model);
+
+void face_backend_destroy(face_backend_t *backend);
+
+/**
+ * 检测人脸
+ * @param bgr    BGR888 图像，stride 为每行字节数
+ * @param out    至少 max 个元素
+ * @retval 检测到的人脸数（不超过 max），-1 - 推理失败
+ */
+int face_backend_detect(face_backend_t *backend, const uint8_t *bgr, int width, int height, int stride,
+                        struct face_box_t *out, int max);
+
+/**
+ * 提取一张人脸的特征
+ * @param feature 至少 FACE_FEATURE_DIM 个元素
+ * @retval 0 - 成功，-1 - 推理失败
+ */
+int face_backend_embed(face_backend_t *backend, const uint8_t *bgr, int width, int height, int stride,
+                       const struct face_box_t *face, float *feature);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
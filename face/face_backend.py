@@ -0,0 +1,117 @@
+import ctypes
+import os
+
+import numpy as np
+
+# libface_backend.so 的 ctypes 封装，接口见 face_backend.h
+# 编译: cmake -S /home/elf/face -B build -DFACE_BACKEND_RKNN=ON && cmake --build build
+# 未开启 FACE_BACKEND_RKNN 时只有 CPU 参考后端
+
+LIB_PATHS = [
+    "/home/elf/face/build/libface_backend.so",
+    os.path.join(os.path.dirname(os.path.abspath(__file__)), "build", "libface_backend.so"),
+]
+
+FACE_BACKEND_CPU = 0
+FACE_BACKEND_RKNN = 1
+BACKENDS = {"cpu": FACE_BACKEND_CPU, "rknn": FACE_BACKEND_RKNN}
+
+FACE_FEATURE_DIM = 128
+MAX_FACES = 32
+
+class _Box(ctypes.Structure):
+    _fields_ = [("left", ctypes.c_int32),
+                ("top", ctypes.c_int32),
+                ("right", ctypes.c_int32),
+                ("bottom", ctypes.c_int32),
+                ("score", ctypes.c_float),
+                ("landmarks", ctypes.c_float * 10)]
+
+class FaceBox: # 检测结果，接口与 dlib.rectangle 一致，便于与 dlib 检测结果混用
+    def __init__(self, box):
+        self.box = box
+
+    def left(self):
+        return self.box.left
+
+    def top(self):
+        return self.box.top
+
+    def right(self):
+        return self.box.right
+
+    def bottom(self):
+        return self.box.bottom
+
+    def width(self):
+        return self.box.right - self.box.left
+
+    def height(self):
+        return self.box.bottom - self.box.top
+
+    def area(self):
+        return self.width() * self.height()
+
+    def score(self):
+        return self.box.score
+
+_lib = None
+
+def _load_library(): # 加载后端库，不存在返回None
+    global _lib
+    if _lib is not None:
+        return _lib
+    for path in LIB_PATHS:
+        if os.path.exists(path):
+            lib = ctypes.CDLL(path)
+            lib.face_backend_create.restype = ctypes.c_void_p
+            lib.face_backend_create.argtypes = [ctypes.c_int, ctypes.c_char_p, ctypes.c_char_p]
+            lib.face_backend_destroy.argtypes = [ctypes.c_void_p]
+            lib.face_backend_detect.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int, ctypes.c_int,
+                                                ctypes.c_int, ctypes.POINTER(_Box), ctypes.c_int]
+            lib.face_backend_embed.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int, ctypes.c_int,
+                                               ctypes.c_int, ctypes.POINTER(_Box), ctypes.POINTER(ctypes.c_float)]
+            _lib = lib
+            break
+    return _lib
+
+def available():
+    return _load_library() is not None
+
+class NativeBackend: # RKNN 或 CPU 参考后端，detect/embed 与 dlib 检测器、特征模型对应
+    def __init__(self, kind=FACE_BACKEND_RKNN, det_model=None, emb_model=None):
+        self.lib = _load_library()
+        if self.lib is None:
+            raise OSError("找不到 libface_backend.so")
+        self.handle = self.lib.face_backend_create(kind,
+                                                   det_model.encode("utf-8") if det_model else None,
+                                                   emb_model.encode("utf-8") if emb_model else None)
+        if not self.handle:
+            raise ValueError(f"人脸后端 {kind} 未编译或模型加载失败")
+
+    def detect(self, frame): # 返回 [FaceBox, ...]，按置信度降序
+        frame = np.ascontiguousarray(frame)
+        out = (_Box * MAX_FACES)()
+        n = self.lib.face_backend_detect(self.handle, frame.ctypes.data, frame.shape[1], frame.shape[0],
+                                         frame.strides[0], out, MAX_FACES)
+        if n < 0:
+            raise RuntimeError("人脸检测推理失败")
+        return [FaceBox(_Box.from_buffer_copy(out[i])) for i in range(n)]
+
+    def embed(self, frame, face): # 返回 1x128 float32 特征
+        frame = np.ascontiguousarray(frame)
+        feature = np.zeros((1, FACE_FEATURE_DIM), dtype=np.float32)
+        ret = self.lib.face_backend_embed(self.handle, frame.ctypes.data, frame.shape[1], frame.shape[0],
+                                          frame.strides[0], ctypes.byref(face.box),
+                                          feature.ctypes.data_as(ctypes.POINTER(ctypes.c_float)))
+        if ret < 0:
+            raise RuntimeError("人脸特征推理失败")
+        return feature
+
+    def close(self):
+        if self.handle:
+            self.lib.face_backend_destroy(self.handle)
+            self.handle = None
+
+    def __del__(self):
+        self.close()
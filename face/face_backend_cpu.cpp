@@ -0,0 +1,124 @@
+/**
+ * @file face_backend_cpu.cpp
+ * @brief 人脸后端 CPU 参考实现：OpenCV DNN 运行与 RKNN 相同来源的 ONNX 模型，无 NPU 时可用于测试和比对
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include "face_backend.h"
+
+#include <algorithm>
+
+#include <opencv2/dnn.hpp>
+#include <opencv2/imgproc.hpp>
+
+/*****************************************************************************/
+/* 类型定义                                                                  */
+/*****************************************************************************/
+class CpuFaceBackend : public FaceBackend
+{
+public:
+    bool load(const std::string &detModelPath, const std::string &embModelPath) override;
+
+protected:
+    bool runDetector(const cv::Mat &bgr, FaceLetterbox *letterbox, std::vector<float> &loc,
+                     std::vector<float> &conf, std::vector<float> &landm) override;
+    bool runEmbedder(const cv::Mat &chip, float *feature) override;
+
+private:
+    cv::dnn::Net detector;
+    cv::dnn::Net embedder;
+};
+
+/*****************************************************************************/
+/* 函数定义                                                                  */
+/*****************************************************************************/
+bool CpuFaceBackend::load(const std::string &detModelPath, const std::string &embModelPath)
+{
+    try
+    {
+        detector = cv::dnn::readNetFromONNX(detModelPath + ".onnx");
+        embedder = cv::dnn::readNetFromONNX(embModelPath + ".onnx");
+    }
+    catch(const cv::Exception &)
+    {
+        return false;
+    }
+    return !detector.empty() && !embedder.empty();
+}
+
+/* letterbox 到 FACE_DET_INPUT_SIZE，与 RKNN 端 convert_image_with_letterbox 等效 */
+bool CpuFaceBackend::runDetector(const cv::Mat &bgr, FaceLetterbox *letterbox, std::vector<float> &loc,
+                                 std::vector<float> &conf, std::vector<float> &landm)
+{
+    const int size = FACE_DET_INPUT_SIZE;
+    float scale = std::min(static_cast<float>(size) / bgr.cols, static_cast<float>(size) / bgr.rows);
+    int w = static_cast<int>(bgr.cols * scale);
+    int h = static_cast<int>(bgr.rows * scale);
+
+    letterbox->scale = scale;
+    letterbox->padX = (size - w) / 2;
+    letterbox->padY = (size - h) / 2;
+
+    cv::Mat resized, input;
+    cv::resize(bgr, resized, cv::Size(w, h));
+    cv::copyMakeBorder(resized, input, letterbox->padY, size - h - letterbox->padY,
+                       letterbox->padX, size - w - letterbox->padX, cv::BORDER_CONSTANT,
+                       cv::Scalar::all(FACE_DET_LETTERBOX_COLOR));
+
+    //RetinaFace 以 BGR 训练，减均值(104, 117, 123)
+    cv::Mat blob = cv::dnn::blobFromImage(input, 1.0, cv::Size(), cv::Scalar(104, 117, 123), false, false);
+    std::vector<cv::Mat> outs;
+    try
+    {
+        detector.setInput(blob);
+        detector.forward(outs, detector.getUnconnectedOutLayersNames());
+    }
+    catch(const cv::Exception &)
+    {
+        return false;
+    }
+
+    //输出为 [1, N, 4/2/10]，按最后一维区分，不依赖输出顺序
+    for(const cv::Mat &out : outs)
+    {
+        const float *data = out.ptr<float>();
+        switch(out.size[out.dims - 1])
+        {
+            case 4:  loc.assign(data, data + out.total()); break;
+            case 2:  conf.assign(data, data + out.total()); break;
+            case 10: landm.assign(data, data + out.total()); break;
+            default: break;
+        }
+    }
+    return true;
+}
+
+bool CpuFaceBackend::runEmbedder(const cv::Mat &chip, float *feature)
+{
+    //与 dlib input_rgb_image_sized<150> 相同的归一化：(RGB - 均值) / 256
+    cv::Mat blob = cv::dnn::blobFromImage(chip, 1.0 / 256, cv::Size(), cv::Scalar(122.782, 117.001, 104.298), true, false);
+    cv::Mat out;
+    try
+    {
+        embedder.setInput(blob);
+        out = embedder.forward();
+    }
+    catch(const cv::Exception &)
+    {
+        return false;
+    }
+
+    if(out.total() < FACE_FEATURE_DIM)
+    {
+        return false;
+    }
+    std::copy(out.ptr<float>(), out.ptr<float>() + FACE_FEATURE_DIM, feature);
+    return true;
+}
+
+FaceBackend *createCpuFaceBackend()
+{
+    return new CpuFaceBackend();
+}
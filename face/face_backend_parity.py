@@ -0,0 +1,112 @@
+import argparse
+import glob
+import os
+import sys
+import time
+
+import cv2
+import numpy as np
+
+import face_backend
+import face_recognize as fr
+from face_stream import rect_iou
+
+# 人脸后端一致性测试：以 dlib 为参考，在同一批照片上比较检测、特征和识别结果
+#   检测召回    后端检测框与 dlib 检测框 IoU >= 0.5 的比例
+#   特征距离    同一张人脸两种特征之间的欧氏距离（远小于识别阈值才能共用 dlib 人脸库）
+#   识别一致率  两种特征在人脸库上的识别结果（员工或未识别）相同的比例
+# 照片文件名为 "<工号>_<序号>.jpg" 时同时统计识别正确率。
+# 用法: python face_backend_parity.py --backend rknn [--photos DIR] [--min-agreement 0.98]
+
+REGISTER_PHOTO_DIR = "/home/elf/face/data/register_photos/"
+DIST_THRESHOLD = 0.5
+DET_IOU_THRESH = 0.5
+
+def decide(feature, employees, features): # 识别结果：员工ID 或 None
+    employee, dist = fr.match_face_feature(feature, employees, features)
+    return employee.id if employee is not None and dist < DIST_THRESHOLD else None
+
+def median_ms(values):
+    return float(np.median(values)) * 1000 if values else 0.0
+
+def main():
+    parser = argparse.ArgumentParser(description='人脸后端一致性测试')
+    parser.add_argument('--backend', choices=['cpu', 'rknn'], default='rknn')
+    parser.add_argument('--photos', default=REGISTER_PHOTO_DIR, help='测试照片目录，最好不与注册照片重合')
+    parser.add_argument('--min-agreement', type=float, default=0.98, help='识别一致率低于该值时返回失败')
+    args = parser.parse_args()
+
+    backend = face_backend.NativeBackend(face_backend.BACKENDS[args.backend])
+    employees, features = fr.load_employee_face_feature()
+
+    photos = sorted(glob.glob(os.path.join(args.photos, "*.jpg")))
+    if not photos:
+        print(f"{args.photos} 中没有照片")
+        return 1
+
+    ref_det_s, ref_emb_s, det_s, emb_s = [], [], [], []
+    feature_dists = []
+    total = detected = agreed = 0
+    ref_correct = correct = labelled = 0
+
+    for path in photos:
+        frame = cv2.imread(path)
+        if frame is None:
+            continue
+
+        start = time.monotonic()
+        ref_faces = fr.face_detector(frame, 1)
+        ref_det_s.append(time.monotonic() - start)
+        if len(ref_faces) == 0:
+            continue    # 参考实现未检测到人脸的照片不参与比较
+        ref_face = max(ref_faces, key=lambda r: r.area())
+
+        start = time.monotonic()
+        ref_feature = fr.compute_face_feature(frame, ref_face)     # backend 未设置，走 dlib
+        ref_emb_s.append(time.monotonic() - start)
+
+        start = time.monotonic()
+        faces = backend.detect(frame)
+        det_s.append(time.monotonic() - start)
+
+        total += 1
+        best = max(faces, key=lambda f: rect_iou(f, ref_face), default=None)
+        ref_id = decide(ref_feature, employees, features)
+        cur_id = None
+        if best is not None and rect_iou(best, ref_face) >= DET_IOU_THRESH:
+            detected += 1
+            start = time.monotonic()
+            feature = backend.embed(frame, best)
+            emb_s.append(time.monotonic() - start)
+            feature_dists.append(float(np.linalg.norm(feature - ref_feature)))
+            cur_id = decide(feature, employees, features)
+
+        agreed += ref_id == cur_id
+
+        name = os.path.basename(path)
+        if "_" in name:
+            label = name.rsplit("_", 1)[0]
+            labelled += 1
+            ref_correct += ref_id == label
+            correct += cur_id == label
+
+    if total == 0:
+        print("参考实现在所有照片上均未检测到人脸")
+        return 1
+
+    dists = np.asarray(feature_dists) if feature_dists else np.zeros(1)
+    agreement = agreed / total
+    print(f"照片: {total}  后端: {args.backend}")
+    print(f"检测召回: {detected / total:.3f}")
+    print(f"特征距离: 均值 {dists.mean():.4f}  P95 {np.percentile(dists, 95):.4f}  最大 {dists.max():.4f}  (识别阈值 {DIST_THRESHOLD})")
+    print(f"识别一致率: {agreement:.3f}")
+    if labelled:
+        print(f"识别正确率: dlib {ref_correct / labelled:.3f}  {args.backend} {correct / labelled:.3f}")
+    print(f"耗时(中位数): 检测 dlib {median_ms(ref_det_s):.1f} ms / {args.backend} {median_ms(det_s):.1f} ms  "
+          f"特征 dlib {median_ms(ref_emb_s):.1f} ms / {args.backend} {median_ms(emb_s):.1f} ms")
+
+    backend.close()
+    return 0 if agreement >= args.min_agreement else 1
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,236 @@
+/**
+ * @file face_backend_rknn.cpp
+ * @brief 人脸后端 RKNN 实现：预处理沿用姿态检测的 convert_image_with_letterbox（有 RGA 时由 RGA 完成），
+ *        归一化在模型转换时写入（见 convert_rknn.py），检测输入 uint8 BGR，特征输入 uint8 RGB
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include "face_backend.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <opencv2/imgproc.hpp>
+
+#include "rknn_api.h"
+#include "common.h"
+#include "image_utils.h"
+
+/*****************************************************************************/
+/* 类型定义                                                                  */
+/*****************************************************************************/
+/* 单个 RKNN 模型 */
+struct RknnModel
+{
+    rknn_context ctx;
+    rknn_input_output_num ioNum;
+    std::vector<rknn_tensor_attr> outputAttrs;
+    int width;
+    int height;
+};
+
+class RknnFaceBackend : public FaceBackend
+{
+public:
+    RknnFaceBackend();
+    ~RknnFaceBackend();
+
+    bool load(const std::string &detModelPath, const std::string &embModelPath) override;
+
+protected:
+    bool runDetector(const cv::Mat &bgr, FaceLetterbox *letterbox, std::vector<float> &loc,
+                     std::vector<float> &conf, std::vector<float> &landm) override;
+    bool runEmbedder(const cv::Mat &chip, float *feature) override;
+
+private:
+    RknnModel detector;
+    RknnModel embedder;
+    std::vector<unsigned char> detInput;        //letterbox 输出缓冲，复用
+};
+
+/*****************************************************************************/
+/* 局部函数                                                                  */
+/*****************************************************************************/
+static bool loadModel(RknnModel *model, const std::string &path)
+{
+    if(rknn_init(&model->ctx, const_cast<char *>(path.c_str()), 0, 0, NULL) < 0)
+    {
+        model->ctx = 0;
+        return false;
+    }
+
+    rknn_tensor_attr input;
+    memset(&input, 0, sizeof(input));
+    if(rknn_query(model->ctx, RKNN_QUERY_IN_OUT_NUM, &model->ioNum, sizeof(model->ioNum)) != RKNN_SUCC ||
+       rknn_query(model->ctx, RKNN_QUERY_INPUT_ATTR, &input, sizeof(input)) != RKNN_SUCC)
+    {
+        return false;
+    }
+
+    if(input.fmt == RKNN_TENSOR_NCHW)
+    {
+        model->height = input.dims[2];
+        model->width = input.dims[3];
+    }
+    else
+    {
+        model->height = input.dims[1];
+        model->width = input.dims[2];
+    }
+
+    model->outputAttrs.resize(model->ioNum.n_output);
+    for(uint32_t i = 0; i < model->ioNum.n_output; i++)
+    {
+        memset(&model->outputAttrs[i], 0, sizeof(rknn_tensor_attr));
+        model->outputAttrs[i].index = i;
+        if(rknn_query(model->ctx, RKNN_QUERY_OUTPUT_ATTR, &model->outputAttrs[i], sizeof(rknn_tensor_attr)) != RKNN_SUCC)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void releaseModel(RknnModel *model)
+{
+    if(model->ctx != 0)
+    {
+        rknn_destroy(model->ctx);
+        model->ctx = 0;
+    }
+}
+
+/* 输入 uint8 NHWC，运行并取回 float 输出，调用方负责 rknn_outputs_release */
+static bool runModel(const RknnModel *model, void *data, uint32_t size, std::vector<rknn_output> &outputs)
+{
+    rknn_input input;
+    memset(&input, 0, sizeof(input));
+    input.index = 0;
+    input.type = RKNN_TENSOR_UINT8;
+    input.fmt = RKNN_TENSOR_NHWC;
+    input.size = size;
+    input.buf = data;
+
+    outputs.assign(model->ioNum.n_output, rknn_output());
+    for(uint32_t i = 0; i < model->ioNum.n_output; i++)
+    {
+        memset(&outputs[i], 0, sizeof(rknn_output));
+        outputs[i].index = i;
+        outputs[i].want_float = 1;
+    }
+
+    if(rknn_inputs_set(model->ctx, 1, &input) < 0 || rknn_run(model->ctx, NULL) < 0)
+    {
+        return false;
+    }
+    return rknn_outputs_get(model->ctx, model->ioNum.n_output, outputs.data(), NULL) >= 0;
+}
+
+/*****************************************************************************/
+/* 函数定义                                                                  */
+/*****************************************************************************/
+RknnFaceBackend::RknnFaceBackend()
+{
+    detector.ctx = 0;
+    embedder.ctx = 0;
+}
+
+RknnFaceBackend::~RknnFaceBackend()
+{
+    releaseModel(&detector);
+    releaseModel(&embedder);
+}
+
+bool RknnFaceBackend::load(const std::string &detModelPath, const std::string &embModelPath)
+{
+    if(!loadModel(&detector, detModelPath + ".rknn") || !loadModel(&embedder, embModelPath + ".rknn"))
+    {
+        return false;
+    }
+    return detector.width == FACE_DET_INPUT_SIZE && detector.height == FACE_DET_INPUT_SIZE &&
+           embedder.width == FACE_CHIP_SIZE && embedder.height == FACE_CHIP_SIZE;
+}
+
+bool RknnFaceBackend::runDetector(const cv::Mat &bgr, FaceLetterbox *letterbox, std::vector<float> &loc,
+                                  std::vector<float> &conf, std::vector<float> &landm)
+{
+    //RetinaFace 以 BGR 训练，letterbox 只做缩放和填充，直接输入 BGR 省去一次颜色转换
+    cv::Mat input = bgr.isContinuous() ? bgr : bgr.clone();
+
+    image_buffer_t src, dst;
+    letterbox_t lb;
+    memset(&src, 0, sizeof(src));
+    memset(&dst, 0, sizeof(dst));
+    memset(&lb, 0, sizeof(lb));
+
+    src.width = input.cols;
+    src.height = input.rows;
+    src.format = IMAGE_FORMAT_RGB888;
+    src.virt_addr = input.data;
+    src.size = static_cast<int>(input.total() * input.elemSize());
+
+    detInput.resize(static_cast<size_t>(detector.width) * detector.height * 3);
+    dst.width = detector.width;
+    dst.height = detector.height;
+    dst.format = IMAGE_FORMAT_RGB888;
+    dst.virt_addr = detInput.data();
+    dst.size = static_cast<int>(detInput.size());
+
+    if(convert_image_with_letterbox(&src, &dst, &lb, FACE_DET_LETTERBOX_COLOR) < 0)
+    {
+        return false;
+    }
+    letterbox->scale = lb.scale;
+    letterbox->padX = lb.x_pad;
+    letterbox->padY = lb.y_pad;
+
+    std::vector<rknn_output> outputs;
+    if(!runModel(&detector, detInput.data(), static_cast<uint32_t>(detInput.size()), outputs))
+    {
+        return false;
+    }
+
+    //按最后一维区分 loc/conf/landm
+    for(uint32_t i = 0; i < detector.ioNum.n_output; i++)
+    {
+        const rknn_tensor_attr &attr = detector.outputAttrs[i];
+        const float *data = static_cast<const float *>(outputs[i].buf);
+        switch(attr.dims[attr.n_dims - 1])
+        {
+            case 4:  loc.assign(data, data + attr.n_elems); break;
+            case 2:  conf.assign(data, data + attr.n_elems); break;
+            case 10: landm.assign(data, data + attr.n_elems); break;
+            default: break;
+        }
+    }
+    rknn_outputs_release(detector.ctx, detector.ioNum.n_output, outputs.data());
+    return true;
+}
+
+bool RknnFaceBackend::runEmbedder(const cv::Mat &chip, float *feature)
+{
+    cv::Mat rgb;
+    cv::cvtColor(chip, rgb, cv::COLOR_BGR2RGB);
+
+    std::vector<rknn_output> outputs;
+    if(!runModel(&embedder, rgb.data, static_cast<uint32_t>(rgb.total() * rgb.elemSize()), outputs))
+    {
+        return false;
+    }
+
+    bool ok = embedder.outputAttrs[0].n_elems >= FACE_FEATURE_DIM;
+    if(ok)
+    {
+        const float *data = static_cast<const float *>(outputs[0].buf);
+        std::copy(data, data + FACE_FEATURE_DIM, feature);
+    }
+    rknn_outputs_release(embedder.ctx, embedder.ioNum.n_output, outputs.data());
+    return ok;
+}
+
+FaceBackend *createRknnFaceBackend()
+{
+    return new RknnFaceBackend();
+}
@@ -0,0 +1,146 @@
+import atexit
+import collections
+import logging
+import os
+import threading
+
+import cv2
+import numpy as np
+from PIL import Image, ImageDraw, ImageFont
+
+# 考勤留证：中文标注直接绘制在BGR图像上，字形按字号缓存，JPEG编码和写盘在后台线程完成，
+# 识别结果不必等待磁盘I/O
+
+FONT_PATH = "/home/elf/face/fonts/songti.ttc"
+LINE_SPACING = 4                # 行间距，与 PIL multiline_text 默认一致
+GLYPH_CACHE_MAX = 4096          # 每个字号最多缓存的字形数
+JPEG_QUALITY = 95
+EVIDENCE_MAX_PENDING = 32       # 待编码图像上限，超过后丢弃最旧的一张，避免写盘过慢时内存增长
+EVIDENCE_BATCH = 8              # 后台线程每次最多取出的任务数
+EXIT_FLUSH_TIMEOUT_S = 5        # 进程退出时等待未写完照片的最长时间
+
+class GlyphAtlas: # 单一字号的字形缓存，每个字只调用一次 PIL 栅格化
+    def __init__(self, size, font_path=FONT_PATH):
+        self.font = ImageFont.truetype(font_path, size, encoding="utf-8")
+        ascent, descent = self.font.getmetrics()
+        self.line_height = ascent + descent + LINE_SPACING
+        self.glyphs = {}
+
+    def glyph(self, ch): # 返回 (alpha, 左偏移, 上偏移, 步进)，alpha 为 uint16 的 HxWx1 数组，空白字符为 None
+        g = self.glyphs.get(ch)
+        if g is not None:
+            return g
+        left, top, right, bottom = self.font.getbbox(ch)
+        alpha = None
+        if right > left and bottom > top:
+            mask = Image.new("L", (right - left, bottom - top), 0)
+            ImageDraw.Draw(mask).text((-left, -top), ch, fill=255, font=self.font)
+            alpha = np.asarray(mask, dtype=np.uint16)[:, :, None]
+        g = (alpha, left, top, int(round(self.font.getlength(ch))))
+        if len(self.glyphs) >= GLYPH_CACHE_MAX:
+            self.glyphs.clear()
+        self.glyphs[ch] = g
+        return g
+
+    def draw(self, img, text, position, color): # 在BGR图像上原地绘制，支持换行
+        x0, y = position
+        color = np.array(color, dtype=np.uint16)
+        height, width = img.shape[:2]
+        for line in text.split("\n"):
+            x = x0
+            for ch in line:
+                alpha, left, top, advance = self.glyph(ch)
+                if alpha is not None:
+                    self._blend(img, alpha, x + left, y + top, color, width, height)
+                x += advance
+            y += self.line_height
+
+    @staticmethod
+    def _blend(img, alpha, x, y, color, width, height): # 按 alpha 混合到图像，超出边界的部分裁掉
+        h, w = alpha.shape[:2]
+        l, t = max(x, 0), max(y, 0)
+        r, b = min(x + w, width), min(y + h, height)
+        if r <= l or b <= t:
+            return
+        a = alpha[t - y:b - y, l - x:r - x]
+        roi = img[t:b, l:r]
+        roi[:] = (roi * (255 - a) + color * a + 127) // 255
+
+_atlases = {}
+
+def put_text(img, text, position, color=(0, 255, 0), size=30): # 中文标注，color 为BGR，直接修改 img
+    atlas = _atlases.get(size)
+    if atlas is None:
+        atlas = _atlases.setdefault(size, GlyphAtlas(size))
+    atlas.draw(img, text, position, color)
+    return img
+
+class EvidenceWriter: # 后台编码写盘，submit 后调用方不能再修改图像
+    def __init__(self, max_pending=EVIDENCE_MAX_PENDING, batch=EVIDENCE_BATCH):
+        self.max_pending = max_pending
+        self.batch = batch
+        self.tasks = collections.deque()
+        self.cond = threading.Condition()
+        self.busy = 0
+        self.thread = None
+
+    def submit(self, image, path): # 保存为JPEG，先写临时文件再改名，读到的照片总是完整的
+        self._post(("jpeg", image, path))
+
+    def post(self, func, *args): # 其他需要写盘的操作，与照片按提交顺序执行
+        self._post(("call", func, args))
+
+    def flush(self, timeout=None): # 等待已提交的任务全部完成
+        with self.cond:
+            return self.cond.wait_for(lambda: not self.tasks and not self.busy, timeout)
+
+    def _post(self, task):
+        with self.cond:
+            images = [t for t in self.tasks if t[0] == "jpeg"]
+            if len(images) >= self.max_pending:
+                self.tasks.remove(images[0])
+                logging.error(f"考勤照片写入过慢，丢弃 {images[0][2]}")
+            self.tasks.append(task)
+            if self.thread is None:
+                self.thread = threading.Thread(target=self._run, name="evidence", daemon=True)
+                self.thread.start()
+            self.cond.notify_all()
+
+    def _run(self):
+        while True:
+            with self.cond:
+                self.cond.wait_for(lambda: self.tasks)
+                batch = [self.tasks.popleft() for _ in range(min(self.batch, len(self.tasks)))]
+                self.busy = len(batch)
+
+            dirs = set()
+            for task in batch:
+                try:
+                    if task[0] == "jpeg":
+                        self._write_jpeg(task[1], task[2], dirs)
+                    else:
+                        task[1](*task[2])
+                except Exception as e:
+                    logging.error(f"考勤留证写入失败: {str(e)}")
+
+            with self.cond:
+                self.busy = 0
+                self.cond.notify_all()
+
+    @staticmethod
+    def _write_jpeg(image, path, dirs):
+        # imencode 期间释放GIL，与识别线程并行
+        ok, buf = cv2.imencode(".jpg", image, [cv2.IMWRITE_JPEG_QUALITY, JPEG_QUALITY])
+        if not ok:
+            raise RuntimeError(f"JPEG编码失败 {path}")
+        directory = os.path.dirname(path)
+        if directory not in dirs:
+            os.makedirs(directory, exist_ok=True)
+            dirs.add(directory)
+        tmp_path = path + ".tmp"
+        with open(tmp_path, "wb") as f:
+            f.write(buf.tobytes())
+        os.replace(tmp_path, path)
+
+writer = EvidenceWriter()
+atexit.register(writer.flush, EXIT_FLUSH_TIMEOUT_S)
@@ -0,0 +1,255 @@
+/**
+ * @file face_gallery.c
+ * @brief 二进制人脸库只读访问实现
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include "face_gallery.h"
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define FACE_GALLERY_OPEN_TRIES     3   //打开时遇到并发追加，文件头引用的数据超出映射长度时重新映射的次数
+
+/*****************************************************************************/
+/* 局部函数                                                                  */
+/*****************************************************************************/
+/* IEEE 754 半精度转单精度 */
+static float face_gallery_half_to_float(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t bits;
+    float f;
+
+    if(exp == 0)
+    {
+        if(mant == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            //非规格化数
+            exp = 127 - 15 + 1;
+            while(!(mant & 0x400))
+            {
+                mant <<= 1;
+                exp--;
+            }
+            mant &= 0x3ff;
+            bits = sign | (exp << 23) | (mant << 13);
+        }
+    }
+    else if(exp == 0x1f)
+    {
+        bits = sign | 0x7f800000 | (mant << 13);
+    }
+    else
+    {
+        bits = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+    }
+
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static size_t face_gallery_elem_size(const struct face_gallery_header_t *header)
+{
+    return header->dtype == FACE_GALLERY_F16 ? 2 : 4;
+}
+
+/* 校验文件头及各区域是否在文件范围内 */
+static int face_gallery_check(const struct face_gallery_header_t *header, size_t size)
+{
+    if(size < sizeof(*header) || memcmp(header->magic, FACE_GALLERY_MAGIC, sizeof(header->magic)) != 0)
+    {
+        return -1;
+    }
+    if(header->version != FACE_GALLERY_VERSION || header->dim == 0 ||
+       (header->dtype != FACE_GALLERY_F32 && header->dtype != FACE_GALLERY_F16) ||
+       header->count > header->capacity || header->matrix_offset % FACE_GALLERY_ALIGN != 0)
+    {
+        return -1;
+    }
+    if(header->matrix_offset + (uint64_t)header->capacity * header->dim * face_gallery_elem_size(header) > header->records_offset ||
+       header->records_offset + (uint64_t)header->capacity * sizeof(struct face_gallery_record_t) > header->strings_offset ||
+       header->strings_offset + header->strings_size > size)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/* 校验前 count 条记录的工号、姓名偏移都在字符串区内；字符串区以 \0 结尾，因此每个字符串都在区内结束 */
+static int face_gallery_check_strings(const struct face_gallery_t *gallery, const struct face_gallery_header_t *header)
+{
+    uint32_t i;
+
+    if(header->count == 0)
+    {
+        return 0;
+    }
+    if(header->strings_size == 0 || gallery->strings[header->strings_size - 1] != '\0')
+    {
+        return -1;
+    }
+    for(i = 0; i < header->count; i++)
+    {
+        if(gallery->records[i].id_offset >= header->strings_size || gallery->records[i].name_offset >= header->strings_size)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+/* 函数定义                                                                  */
+/*****************************************************************************/
+int face_gallery_open(struct face_gallery_t *gallery, const char *path)
+{
+    struct face_gallery_header_t header;
+    struct stat st;
+    int fd, tries;
+
+    memset(gallery, 0, sizeof(*gallery));
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        return -1;
+    }
+
+    //追加先写数据（文件变长）再更新文件头，fstat 之后提交的追加会使文件头引用映射之外的数据，重新映射即可
+    for(tries = 0; tries < FACE_GALLERY_OPEN_TRIES; tries++)
+    {
+        if(fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(header))
+        {
+            break;
+        }
+
+        gallery->base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if(gallery->base == MAP_FAILED)
+        {
+            gallery->base = NULL;
+            break;
+        }
+        gallery->size = st.st_size;
+
+        //校验和之后的访问都按文件头快照，之后的追加不影响本次打开
+        memcpy(&header, gallery->base, sizeof(header));
+        if(face_gallery_check(&header, gallery->size) == 0)
+        {
+            gallery->header = (const struct face_gallery_header_t *)gallery->base;
+            gallery->records = (const struct face_gallery_record_t *)((const char *)gallery->base + header.records_offset);
+            gallery->strings = (const char *)gallery->base + header.strings_offset;
+            if(face_gallery_check_strings(gallery, &header) < 0)
+            {
+                break;      //记录损坏，重试无意义
+            }
+            gallery->count = header.count;
+            close(fd);
+            return 0;
+        }
+
+        munmap(gallery->base, gallery->size);
+        gallery->base = NULL;
+    }
+
+    close(fd);
+    face_gallery_close(gallery);
+    return -1;
+}
+
+void face_gallery_close(struct face_gallery_t *gallery)
+{
+    if(gallery->base)
+    {
+        munmap(gallery->base, gallery->size);
+    }
+    memset(gallery, 0, sizeof(*gallery));
+}
+
+uint32_t face_gallery_count(const struct face_gallery_t *gallery)
+{
+    return gallery->count;
+}
+
+uint32_t face_gallery_dim(const struct face_gallery_t *gallery)
+{
+    return gallery->header ? gallery->header->dim : 0;
+}
+
+uint32_t face_gallery_generation(const struct face_gallery_t *gallery)
+{
+    return gallery->header ? gallery->header->generation : 0;
+}
+
+const char *face_gallery_id(const struct face_gallery_t *gallery, uint32_t index)
+{
+    if(index >= gallery->count)
+    {
+        return NULL;
+    }
+    return gallery->strings + gallery->records[index].id_offset;
+}
+
+const char *face_gallery_name(const struct face_gallery_t *gallery, uint32_t index)
+{
+    if(index >= gallery->count)
+    {
+        return NULL;
+    }
+    return gallery->strings + gallery->records[index].name_offset;
+}
+
+int face_gallery_is_deleted(const struct face_gallery_t *gallery, uint32_t index)
+{
+    return index < gallery->count && (gallery->records[index].flags & FACE_GALLERY_DELETED);
+}
+
+const float *face_gallery_matrix_f32(const struct face_gallery_t *gallery)
+{
+    if(!gallery->header || gallery->header->dtype != FACE_GALLERY_F32)
+    {
+        return NULL;
+    }
+    return (const float *)((const char *)gallery->base + gallery->header->matrix_offset);
+}
+
+int face_gallery_feature(const struct face_gallery_t *gallery, uint32_t index, float *out)
+{
+    const struct face_gallery_header_t *header = gallery->header;
+    const char *row;
+    uint32_t i;
+
+    if(index >= gallery->count)
+    {
+        return -1;
+    }
+
+    row = (const char *)gallery->base + header->matrix_offset + (uint64_t)index * header->dim * face_gallery_elem_size(header);
+    if(header->dtype == FACE_GALLERY_F32)
+    {
+        memcpy(out, row, header->dim * sizeof(float));
+        return 0;
+    }
+
+    for(i = 0; i < header->dim; i++)
+    {
+        uint16_t h;
+        memcpy(&h, row + i * 2, sizeof(h));
+        out[i] = face_gallery_half_to_float(h);
+    }
+    return 0;
+}
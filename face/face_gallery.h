@@ -0,0 +1,121 @@
+/**
+ * @file face_gallery.h
+ * @brief 二进制人脸库：文件头 + 特征矩阵 + 记录表 + 字符串区，只读 mmap 访问
+ *
+ * 文件由 face_gallery.py 写入。特征矩阵为 capacity x dim 的 float32 或 float16，
+ * 起始地址64字节对齐；记录表每条16字节，保存工号、姓名在字符串区的偏移和标志。
+ * 写端先写数据再更新文件头中的 count，读端只访问前 count 条记录。
+ */
+
+#ifndef __FACE_GALLERY_H__
+#define __FACE_GALLERY_H__
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define FACE_GALLERY_PATH       "/home/elf/face/data/gallery.bin"   //人脸库路径
+#define FACE_GALLERY_MAGIC      "FACEGAL"                           //文件标识，末尾含 \0 共8字节
+#define FACE_GALLERY_VERSION    1
+#define FACE_GALLERY_ALIGN      64                                  //特征矩阵对齐字节数
+
+#define FACE_GALLERY_F32        0       //特征以 float32 存储
+#define FACE_GALLERY_F16        1       //特征以 float16 存储
+
+#define FACE_GALLERY_DELETED    0x1     //记录已删除（待压缩）
+
+/*****************************************************************************/
+/* 类型定义                                                                  */
+/*****************************************************************************/
+/* 文件头，64字节，Python端以 "<8sIIIIII4Q" 解析 */
+struct face_gallery_header_t
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t dim;               //特征维度
+    uint32_t dtype;             //FACE_GALLERY_F32 / FACE_GALLERY_F16
+    uint32_t count;             //已提交的记录数
+    uint32_t capacity;          //特征矩阵和记录表可容纳的记录数
+    uint32_t generation;        //压缩或重新导入导致行号变化时加1，新建时为随机值
+    uint64_t matrix_offset;     //特征矩阵偏移
+    uint64_t records_offset;    //记录表偏移
+    uint64_t strings_offset;    //字符串区偏移
+    uint64_t strings_size;      //字符串区已使用字节数
+};
+
+/* 记录，16字节 */
+struct face_gallery_record_t
+{
+    uint32_t id_offset;         //工号在字符串区的偏移
+    uint32_t name_offset;       //姓名在字符串区的偏移
+    uint32_t flags;             //FACE_GALLERY_DELETED
+    uint32_t reserved;
+};
+
+/* 已映射的人脸库 */
+struct face_gallery_t
+{
+    void *base;
+    size_t size;
+    const struct face_gallery_header_t *header;
+    const struct face_gallery_record_t *records;
+    const char *strings;
+    uint32_t count;             //打开时的记录数快照
+};
+
+/*****************************************************************************/
+/* 函数声明                                                                  */
+/*****************************************************************************/
+/**
+ * 只读映射人脸库
+ * @retval  0 - 成功
+ * @retval -1 - 文件不存在或格式错误
+ */
+int face_gallery_open(struct face_gallery_t *gallery, const char *path);
+
+/* 解除映射 */
+void face_gallery_close(struct face_gallery_t *gallery);
+
+/* 记录数（含已删除记录）与特征维度 */
+uint32_t face_gallery_count(const struct face_gallery_t *gallery);
+uint32_t face_gallery_dim(const struct face_gallery_t *gallery);
+
+/* 人脸库版本，追加、删除和扩容不变，压缩或重新导入后行号重排时改变 */
+uint32_t face_gallery_generation(const struct face_gallery_t *gallery);
+
+/* 第 index 条记录的工号、姓名，越界返回 NULL */
+const char *face_gallery_id(const struct face_gallery_t *gallery, uint32_t index);
+const char *face_gallery_name(const struct face_gallery_t *gallery, uint32_t index);
+
+/* 第 index 条记录是否已删除 */
+int face_gallery_is_deleted(const struct face_gallery_t *gallery, uint32_t index);
+
+/**
+ * 直接访问 float32 特征矩阵（行优先，count x dim）
+ * @retval NULL - 特征以 float16 存储，需使用 face_gallery_feature 逐条转换
+ */
+const float *face_gallery_matrix_f32(const struct face_gallery_t *gallery);
+
+/**
+ * 读取第 index 条特征并转换为 float32
+ * @param out 长度不小于 dim
+ * @retval  0 - 成功
+ * @retval -1 - 越界
+ */
+int face_gallery_feature(const struct face_gallery_t *gallery, uint32_t index, float *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,270 @@
+import contextlib
+import csv
+import fcntl
+import mmap
+import os
+import struct
+
+import numpy as np
+
+# 二进制人脸库，与 face_gallery.h 中的格式一致，C/C++ 与 Python 均可直接 mmap 读取
+#
+#   [0, 64)                 文件头 "<8sIIIIII4Q"，其中 generation 在压缩、重新导入导致行号变化时加1，
+#                           新建时取随机值，删除后重建的人脸库不会与旧索引记录的 generation 相同
+#   [matrix_offset, ...)    特征矩阵 capacity x dim，float32 或 float16，64字节对齐
+#   [records_offset, ...)   记录表 capacity x 16字节 "<IIII": 工号偏移, 姓名偏移, 标志, 保留
+#   [strings_offset, EOF)   字符串区，UTF-8，以 \0 结尾，偏移相对 strings_offset
+#
+# 追加时先写特征、记录和字符串，fsync 后再更新文件头中的 count，读端只访问前 count 条，
+# 因此追加对读端是原子的。容量不足或压缩时写入临时文件后 rename 替换。
+
+GALLERY_PATH = "/home/elf/face/data/gallery.bin"
+FEATURE_CSV_PATH = "/home/elf/face/data/feature.csv"
+
+MAGIC = b"FACEGAL\0"
+VERSION = 1
+HEADER_FMT = "<8sIIIIII4Q"
+HEADER_SIZE = 64
+RECORD_FMT = "<IIII"
+RECORD_SIZE = 16
+ALIGN = 64
+
+DTYPE_F32 = 0
+DTYPE_F16 = 1
+DTYPES = {DTYPE_F32: np.float32, DTYPE_F16: np.float16}
+
+FLAG_DELETED = 1
+
+DEFAULT_DIM = 128
+DEFAULT_CAPACITY = 256
+
+def _align(n):
+    return (n + ALIGN - 1) // ALIGN * ALIGN
+
+def _layout(dim, dtype, capacity): # 返回 (matrix_offset, records_offset, strings_offset)
+    elem = np.dtype(DTYPES[dtype]).itemsize
+    matrix_offset = HEADER_SIZE
+    records_offset = _align(matrix_offset + capacity * dim * elem)
+    strings_offset = _align(records_offset + capacity * RECORD_SIZE)
+    return matrix_offset, records_offset, strings_offset
+
+class _Header:
+    def __init__(self, data):
+        (magic, self.version, self.dim, self.dtype, self.count, self.capacity, self.generation,
+         self.matrix_offset, self.records_offset, self.strings_offset,
+         self.strings_size) = struct.unpack_from(HEADER_FMT, data, 0)
+        if magic != MAGIC or self.version != VERSION or self.dtype not in DTYPES:
+            raise ValueError("人脸库文件格式错误")
+
+    def pack(self):
+        return struct.pack(HEADER_FMT, MAGIC, self.version, self.dim, self.dtype,
+                           self.count, self.capacity, self.generation, self.matrix_offset,
+                           self.records_offset, self.strings_offset, self.strings_size)
+
+class FaceGallery: # 只读映射人脸库
+    def __init__(self, path=GALLERY_PATH):
+        with open(path, "rb") as f:
+            self.mm = mmap.mmap(f.fileno(), 0, prot=mmap.PROT_READ)
+        header = _Header(self.mm)
+        self.dim = header.dim
+        self.count = header.count
+
+        dtype = DTYPES[header.dtype]
+        self.features = np.frombuffer(self.mm, dtype=dtype, count=header.count * header.dim,
+                                      offset=header.matrix_offset).reshape((header.count, header.dim))
+
+        self.ids = []
+        self.names = []
+        self.deleted = np.zeros(header.count, dtype=bool)
+        for i in range(header.count):
+            id_off, name_off, flags, _ = struct.unpack_from(RECORD_FMT, self.mm, header.records_offset + i * RECORD_SIZE)
+            self.ids.append(self._string(header.strings_offset + id_off))
+            self.names.append(self._string(header.strings_offset + name_off))
+            self.deleted[i] = bool(flags & FLAG_DELETED)
+
+    def _string(self, offset):
+        end = self.mm.find(b"\0", offset)
+        return self.mm[offset:end].decode("utf-8")
+
+    def active(self): # 返回未删除记录的下标、工号、姓名和 float32 特征矩阵
+        index = np.flatnonzero(~self.deleted)
+        features = np.ascontiguousarray(self.features[index], dtype=np.float32)
+        return index, [self.ids[i] for i in index], [self.names[i] for i in index], features
+
+    def close(self):
+        self.features = None
+        self.mm.close()
+
+def _new_generation(): # 新建人脸库的 generation
+    return struct.unpack("<I", os.urandom(4))[0]
+
+def _next_generation(generation): # 行号变化后的 generation，32位回绕
+    return (generation + 1) & 0xffffffff
+
+@contextlib.contextmanager
+def _write_lock(path): # 写端互斥，锁在不会被 rename 替换的 .lock 文件上，读端无需加锁
+    with open(path + ".lock", "a") as lock:
+        fcntl.flock(lock, fcntl.LOCK_EX)
+        yield
+
+def create(path=GALLERY_PATH, dim=DEFAULT_DIM, dtype=DTYPE_F32, capacity=DEFAULT_CAPACITY):
+    with _write_lock(path):
+        _write_new(path, dim, dtype, capacity, [], [], np.zeros((0, dim)), [], _new_generation())
+
+def _write_new(path, dim, dtype, capacity, ids, names, features, flags, generation): # 写临时文件后 rename，整体替换
+    matrix_offset, records_offset, strings_offset = _layout(dim, dtype, capacity)
+
+    strings = bytearray()
+    records = bytearray()
+    for emp_id, name, flag in zip(ids, names, flags):
+        id_off = len(strings)
+        strings += emp_id.encode("utf-8") + b"\0"
+        name_off = len(strings)
+        strings += name.encode("utf-8") + b"\0"
+        records += struct.pack(RECORD_FMT, id_off, name_off, flag, 0)
+
+    header = struct.pack(HEADER_FMT, MAGIC, VERSION, dim, dtype, len(ids), capacity, generation,
+                         matrix_offset, records_offset, strings_offset, len(strings))
+
+    tmp_path = path + ".tmp"
+    with open(tmp_path, "wb") as f:
+        f.write(header)
+        f.seek(matrix_offset)
+        f.write(np.asarray(features, dtype=DTYPES[dtype]).tobytes())
+        f.seek(records_offset)
+        f.write(records)
+        f.seek(strings_offset)
+        f.write(strings)
+        f.flush()
+        os.fsync(f.fileno())
+    os.rename(tmp_path, path)
+
+def _read_all(f): # 读出全部记录，用于扩容和压缩
+    data = f.read()
+    header = _Header(data)
+    dtype = DTYPES[header.dtype]
+    features = np.frombuffer(data, dtype=dtype, count=header.count * header.dim,
+                             offset=header.matrix_offset).reshape((header.count, header.dim))
+    ids, names, flags = [], [], []
+    for i in range(header.count):
+        id_off, name_off, flag, _ = struct.unpack_from(RECORD_FMT, data, header.records_offset + i * RECORD_SIZE)
+        ids.append(data[header.strings_offset + id_off:data.index(b"\0", header.strings_offset + id_off)].decode("utf-8"))
+        names.append(data[header.strings_offset + name_off:data.index(b"\0", header.strings_offset + name_off)].decode("utf-8"))
+        flags.append(flag)
+    return header, ids, names, features, flags
+
+def append(emp_id, name, features, path=GALLERY_PATH): # 追加一名员工的多条特征
+    features = np.asarray(features, dtype=np.float32).reshape((-1, DEFAULT_DIM))
+    with _write_lock(path):
+        if not os.path.exists(path):
+            _write_new(path, DEFAULT_DIM, DTYPE_F32, DEFAULT_CAPACITY, [], [], np.zeros((0, DEFAULT_DIM)), [],
+                       _new_generation())
+        with open(path, "r+b") as f:
+            header = _Header(f.read(HEADER_SIZE))
+            if features.shape[1] != header.dim:
+                raise ValueError(f"特征维度不匹配: {features.shape[1]}")
+
+            n = features.shape[0]
+            if header.count + n > header.capacity:
+                # 容量不足，按两倍扩容整体重写
+                f.seek(0)
+                _, ids, names, old, flags = _read_all(f)
+                capacity = max(header.capacity * 2, header.count + n)
+                _write_new(path, header.dim, header.dtype, capacity,
+                           ids + [emp_id] * n, names + [name] * n,
+                           np.vstack([old, features]), flags + [0] * n, header.generation)  # 扩容不改变行号
+                return
+
+            elem = np.dtype(DTYPES[header.dtype]).itemsize
+
+            # 1. 特征写入矩阵空闲行
+            f.seek(header.matrix_offset + header.count * header.dim * elem)
+            f.write(features.astype(DTYPES[header.dtype]).tobytes())
+
+            # 2. 字符串追加到文件末尾
+            id_off = header.strings_size
+            id_bytes = emp_id.encode("utf-8") + b"\0"
+            name_off = id_off + len(id_bytes)
+            name_bytes = name.encode("utf-8") + b"\0"
+            f.seek(header.strings_offset + header.strings_size)
+            f.write(id_bytes + name_bytes)
+
+            # 3. 记录表
+            f.seek(header.records_offset + header.count * RECORD_SIZE)
+            f.write(struct.pack(RECORD_FMT, id_off, name_off, 0, 0) * n)
+            f.flush()
+            os.fsync(f.fileno())
+
+            # 4. 最后更新文件头提交
+            header.count += n
+            header.strings_size += len(id_bytes) + len(name_bytes)
+            f.seek(0)
+            f.write(header.pack())
+            f.flush()
+            os.fsync(f.fileno())
+
+def delete(emp_id, path=GALLERY_PATH): # 标记删除某员工的全部特征，返回删除条数
+    removed = 0
+    with _write_lock(path), open(path, "r+b") as f:
+        header, ids, _, _, flags = _read_all(f)
+        for i, (cur_id, flag) in enumerate(zip(ids, flags)):
+            if cur_id == emp_id and not flag & FLAG_DELETED:
+                f.seek(header.records_offset + i * RECORD_SIZE + 8)
+                f.write(struct.pack("<I", flag | FLAG_DELETED))
+                removed += 1
+        f.flush()
+        os.fsync(f.fileno())
+    return removed
+
+def compact(path=GALLERY_PATH): # 去除已删除记录并收缩容量
+    with _write_lock(path), open(path, "rb") as f:
+        header, ids, names, features, flags = _read_all(f)
+        keep = [i for i, flag in enumerate(flags) if not flag & FLAG_DELETED]
+        capacity = max(DEFAULT_CAPACITY, len(keep) * 2)
+        _write_new(path, header.dim, header.dtype, capacity,
+                   [ids[i] for i in keep], [names[i] for i in keep],
+                   features[keep], [0] * len(keep), _next_generation(header.generation))
+    return len(ids) - len(keep)
+
+def import_csv(csv_path=FEATURE_CSV_PATH, path=GALLERY_PATH, dtype=DTYPE_F32): # 由旧版 feature.csv 生成人脸库
+    ids, names, features = [], [], []
+    with open(csv_path, "r", encoding="utf-8-sig") as f:
+        for line in csv.reader(f):
+            feature_str = line[2].strip("[]")
+            feature = [float(x) for x in feature_str.split(",")]
+            if len(feature) != DEFAULT_DIM:
+                continue
+            ids.append(line[0])
+            names.append(line[1])
+            features.append(feature)
+
+    with _write_lock(path):
+        generation = _new_generation()
+        if os.path.exists(path):
+            with open(path, "rb") as f:
+                generation = _next_generation(_Header(f.read(HEADER_SIZE)).generation)
+
+        capacity = max(DEFAULT_CAPACITY, len(ids) * 2)
+        _write_new(path, DEFAULT_DIM, dtype, capacity, ids, names,
+                   np.asarray(features).reshape((-1, DEFAULT_DIM)), [0] * len(ids), generation)
+    return len(ids)
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser(description="人脸库维护工具")
+    parser.add_argument("command", choices=["import", "compact", "delete", "info"])
+    parser.add_argument("--id", type=str, help="员工ID（delete）")
+    parser.add_argument("--fp16", action="store_true", help="import 时以 float16 存储特征")
+    args = parser.parse_args()
+
+    if args.command == "import":
+        print(f"已导入 {import_csv(dtype=DTYPE_F16 if args.fp16 else DTYPE_F32)} 条特征")
+    elif args.command == "compact":
+        print(f"已清理 {compact()} 条已删除特征")
+    elif args.command == "delete":
+        print(f"已删除 {delete(args.id)} 条特征")
+    else:
+        g = FaceGallery()
+        print(f"维度: {g.dim} 特征数: {g.count} 已删除: {int(g.deleted.sum())}")
+        g.close()
@@ -0,0 +1,639 @@
+/**
+ * @file face_index.cpp
+ * @brief 人脸库近似最近邻索引（HNSW）实现
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include "face_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+
+#include "face_kernels.h"
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define FACE_INDEX_MAGIC        "FACEHNSW"
+#define FACE_INDEX_VERSION      1
+
+/*****************************************************************************/
+/* 局部函数                                                                  */
+/*****************************************************************************/
+template<typename T>
+static bool writeValue(FILE *fp, const T &value)
+{
+    return fwrite(&value, sizeof(value), 1, fp) == 1;
+}
+
+template<typename T>
+static bool readValue(FILE *fp, T &value)
+{
+    return fread(&value, sizeof(value), 1, fp) == 1;
+}
+
+static bool writeString(FILE *fp, const std::string &s)
+{
+    uint32_t len = static_cast<uint32_t>(s.size());
+    return writeValue(fp, len) && fwrite(s.data(), 1, len, fp) == len;
+}
+
+static bool readString(FILE *fp, std::string &s)
+{
+    uint32_t len;
+    if(!readValue(fp, len) || len > 4096)
+    {
+        return false;
+    }
+    s.resize(len);
+    return fread(&s[0], 1, len, fp) == len;
+}
+
+/*****************************************************************************/
+/* 函数定义                                                                  */
+/*****************************************************************************/
+FaceIndex::FaceIndex(int metric, int m, int efConstruction)
+    : metric(metric), m(m), efConstruction(efConstruction),
+      levelMult(1.0 / std::log(static_cast<double>(m))), rng(100)
+{
+    clear();
+}
+
+void FaceIndex::clear()
+{
+    dim = 0;
+    stride = 0;
+    entryPoint = -1;
+    maxLevel = -1;
+    generation = 0;
+    galleryRows = 0;
+    data.clear();
+    graph.clear();
+    nodeRow.clear();
+    nodeIdentity.clear();
+    deleted.clear();
+    rowNode.clear();
+    ids.clear();
+    names.clear();
+    identityIndex.clear();
+}
+
+/* 索引文件来自磁盘，检索时不再检查下标，加载时一次校验 */
+bool FaceIndex::checkLoaded() const
+{
+    int count = size();
+
+    if(count == 0)
+    {
+        return entryPoint == -1 && maxLevel == -1;
+    }
+    if(entryPoint < 0 || entryPoint >= count || maxLevel != static_cast<int>(graph[entryPoint].size()) - 1)
+    {
+        return false;
+    }
+
+    for(int n = 0; n < count; n++)
+    {
+        if(nodeIdentity[n] < 0 || nodeIdentity[n] >= identityCount() ||
+           static_cast<int>(graph[n].size()) - 1 > maxLevel)
+        {
+            return false;
+        }
+        //第 l 层的邻居自身也必须有第 l 层
+        for(size_t l = 0; l < graph[n].size(); l++)
+        {
+            for(int link : graph[n][l])
+            {
+                if(link < 0 || link >= count || graph[link].size() <= l)
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/* 余弦距离下预先归一化，图中统一使用平方欧氏距离 */
+void FaceIndex::prepare(const float *src, float *dst) const
+{
+    std::fill(dst, dst + stride, 0.0f);
+    std::memcpy(dst, src, sizeof(float) * dim);
+
+    if(metric == FACE_MATCH_COSINE)
+    {
+        float norm2 = kernel_dot_f32(dst, dst, stride);
+        if(norm2 > 0.0f)
+        {
+            float inv = 1.0f / std::sqrt(norm2);
+            for(int i = 0; i < dim; i++)
+            {
+                dst[i] *= inv;
+            }
+        }
+    }
+}
+
+float FaceIndex::distance(const float *a, int node) const
+{
+    return kernel_l2_f32(a, vector(node), stride);
+}
+
+int FaceIndex::identityOf(const std::string &id, const std::string &name)
+{
+    auto it = identityIndex.find(id);
+    if(it != identityIndex.end())
+    {
+        return it->second;
+    }
+
+    int identity = static_cast<int>(ids.size());
+    identityIndex.emplace(id, identity);
+    ids.push_back(id);
+    names.push_back(name);
+    return identity;
+}
+
+/* 在某一层上贪心移动到距离查询最近的节点 */
+int FaceIndex::greedyClosest(const float *query, int entry, int level) const
+{
+    int cur = entry;
+    float curDist = distance(query, cur);
+    bool changed = true;
+
+    while(changed)
+    {
+        changed = false;
+        for(int next : links(cur, level))
+        {
+            float d = distance(query, next);
+            if(d < curDist)
+            {
+                curDist = d;
+                cur = next;
+                changed = true;
+            }
+        }
+    }
+    return cur;
+}
+
+/* 在某一层上做候选集大小为 ef 的最佳优先搜索，结果按距离升序 */
+std::vector<FaceIndex::Candidate> FaceIndex::searchLayer(const float *query, int entry, int ef, int level) const
+{
+    auto closer = [](const Candidate &a, const Candidate &b) { return a.distance > b.distance; };
+    auto farther = [](const Candidate &a, const Candidate &b) { return a.distance < b.distance; };
+    std::priority_queue<Candidate, std::vector<Candidate>, decltype(closer)> candidates(closer);
+    std::priority_queue<Candidate, std::vector<Candidate>, decltype(farther)> results(farther);
+    std::vector<uint8_t> visited(size(), 0);
+
+    Candidate start = { distance(query, entry), entry };
+    candidates.push(start);
+    results.push(start);
+    visited[entry] = 1;
+
+    while(!candidates.empty())
+    {
+        Candidate c = candidates.top();
+        if(c.distance > results.top().distance && static_cast<int>(results.size()) >= ef)
+        {
+            break;
+        }
+        candidates.pop();
+
+        for(int next : links(c.node, level))
+        {
+            if(visited[next])
+            {
+                continue;
+            }
+            visited[next] = 1;
+
+            float d = distance(query, next);
+            if(static_cast<int>(results.size()) < ef || d < results.top().distance)
+            {
+                candidates.push(Candidate{ d, next });
+                results.push(Candidate{ d, next });
+                if(static_cast<int>(results.size()) > ef)
+                {
+                    results.pop();
+                }
+            }
+        }
+    }
+
+    std::vector<Candidate> out(results.size());
+    for(int i = static_cast<int>(out.size()) - 1; i >= 0; i--)
+    {
+        out[i] = results.top();
+        results.pop();
+    }
+    return out;
+}
+
+/* 启发式选邻：候选点比已选邻居更接近新节点时才保留，使邻居分布在不同方向上 */
+std::vector<int> FaceIndex::selectNeighbors(std::vector<Candidate> candidates, int maxLinks) const
+{
+    std::vector<int> selected;
+
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate &a, const Candidate &b) { return a.distance < b.distance; });
+
+    for(const Candidate &c : candidates)
+    {
+        if(static_cast<int>(selected.size()) >= maxLinks)
+        {
+            break;
+        }
+
+        bool keep = true;
+        for(int s : selected)
+        {
+            if(distance(vector(c.node), s) < c.distance)
+            {
+                keep = false;
+                break;
+            }
+        }
+        if(keep)
+        {
+            selected.push_back(c.node);
+        }
+    }
+    return selected;
+}
+
+int FaceIndex::insert(const std::string &id, const std::string &name, const float *feature, int featureDim, int row)
+{
+    if(dim == 0)
+    {
+        dim = featureDim;
+        stride = (featureDim + FACE_MATCH_LANES - 1) / FACE_MATCH_LANES * FACE_MATCH_LANES;
+    }
+
+    int node = size();
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    int level = static_cast<int>(-std::log(1.0 - uniform(rng)) * levelMult);
+
+    data.resize(data.size() + stride);
+    prepare(feature, &data[static_cast<size_t>(node) * stride]);
+    graph.emplace_back(level + 1);
+    nodeRow.push_back(row);
+    nodeIdentity.push_back(identityOf(id, name));
+    deleted.push_back(0);
+    rowNode[row] = node;
+    galleryRows = std::max(galleryRows, static_cast<uint32_t>(row) + 1);     //直接插入的行之后 sync 不再重复插入
+
+    if(entryPoint < 0)
+    {
+        entryPoint = node;
+        maxLevel = level;
+        return node;
+    }
+
+    const float *v = vector(node);
+    int cur = entryPoint;
+    for(int l = maxLevel; l > level; l--)
+    {
+        cur = greedyClosest(v, cur, l);
+    }
+
+    for(int l = std::min(level, maxLevel); l >= 0; l--)
+    {
+        int maxLinks = l == 0 ? m * 2 : m;
+        std::vector<Candidate> candidates = searchLayer(v, cur, efConstruction, l);
+        links(node, l) = selectNeighbors(candidates, m);
+
+        //反向连接，邻居超出上限时重新选邻
+        for(int n : links(node, l))
+        {
+            std::vector<int> &nl = links(n, l);
+            nl.push_back(node);
+            if(static_cast<int>(nl.size()) > maxLinks)
+            {
+                std::vector<Candidate> cands;
+                for(int x : nl)
+                {
+                    cands.push_back(Candidate{ distance(vector(n), x), x });
+                }
+                nl = selectNeighbors(cands, maxLinks);
+            }
+        }
+        cur = candidates.front().node;
+    }
+
+    if(level > maxLevel)
+    {
+        entryPoint = node;
+        maxLevel = level;
+    }
+    return node;
+}
+
+bool FaceIndex::remove(int row)
+{
+    auto it = rowNode.find(row);
+    if(it == rowNode.end() || deleted[it->second])
+    {
+        return false;
+    }
+    deleted[it->second] = 1;
+    return true;
+}
+
+bool FaceIndex::sync(const struct face_gallery_t *gallery)
+{
+    uint32_t count = face_gallery_count(gallery);
+    int galleryDim = static_cast<int>(face_gallery_dim(gallery));
+    std::vector<float> buf(galleryDim);
+    bool changed = false;
+
+    //人脸库被压缩或重新导入后行号失效，重建索引
+    if(face_gallery_generation(gallery) != generation || count < galleryRows || (dim != 0 && dim != galleryDim))
+    {
+        clear();
+        generation = face_gallery_generation(gallery);
+        changed = true;
+    }
+
+    for(auto &entry : rowNode)
+    {
+        if(!deleted[entry.second] && face_gallery_is_deleted(gallery, entry.first))
+        {
+            deleted[entry.second] = 1;
+            changed = true;
+        }
+    }
+
+    for(uint32_t i = galleryRows; i < count; i++)
+    {
+        if(face_gallery_is_deleted(gallery, i) || face_gallery_feature(gallery, i, buf.data()) < 0)
+        {
+            continue;
+        }
+        insert(face_gallery_id(gallery, i), face_gallery_name(gallery, i), buf.data(), galleryDim, static_cast<int>(i));
+        changed = true;
+    }
+    galleryRows = count;
+
+    return changed;
+}
+
+std::vector<FaceMatch> FaceIndex::search(const float *query, int k, int ef) const
+{
+    std::vector<FaceMatch> result;
+    std::vector<float> q(stride);
+
+    if(entryPoint < 0 || k <= 0)
+    {
+        return result;
+    }
+
+    prepare(query, q.data());
+    ef = std::max(ef, k * 4);   //每名员工有多条特征，且已删除节点会被过滤
+
+    int cur = entryPoint;
+    for(int l = maxLevel; l > 0; l--)
+    {
+        cur = greedyClosest(q.data(), cur, l);
+    }
+
+    //同一员工只保留距离最近的一条
+    std::unordered_map<int, size_t> seen;
+    for(const Candidate &c : searchLayer(q.data(), cur, ef, 0))
+    {
+        if(deleted[c.node])
+        {
+            continue;
+        }
+
+        int identity = nodeIdentity[c.node];
+        if(seen.count(identity))
+        {
+            continue;
+        }
+        seen[identity] = result.size();
+
+        float d = metric == FACE_MATCH_COSINE ? c.distance * 0.5f : std::sqrt(c.distance);
+        result.push_back(FaceMatch{ identity, nodeRow[c.node], d });
+        if(static_cast<int>(result.size()) >= k)
+        {
+            break;
+        }
+    }
+    return result;
+}
+
+bool FaceIndex::save(const std::string &path) const
+{
+    std::string tmpPath = path + ".tmp";
+    FILE *fp = fopen(tmpPath.c_str(), "wb");
+    bool ok;
+
+    if(!fp)
+    {
+        return false;
+    }
+
+    uint32_t count = static_cast<uint32_t>(size());
+    ok = fwrite(FACE_INDEX_MAGIC, 1, 8, fp) == 8 &&
+         writeValue(fp, static_cast<uint32_t>(FACE_INDEX_VERSION)) &&
+         writeValue(fp, metric) && writeValue(fp, m) && writeValue(fp, efConstruction) &&
+         writeValue(fp, dim) && writeValue(fp, stride) && writeValue(fp, count) &&
+         writeValue(fp, entryPoint) && writeValue(fp, maxLevel) &&
+         writeValue(fp, generation) && writeValue(fp, galleryRows);
+
+    for(uint32_t n = 0; ok && n < count; n++)
+    {
+        int32_t levels = static_cast<int32_t>(graph[n].size());
+        ok = writeValue(fp, nodeRow[n]) && writeValue(fp, nodeIdentity[n]) &&
+             writeValue(fp, deleted[n]) && writeValue(fp, levels);
+        for(int l = 0; ok && l < levels; l++)
+        {
+            uint32_t linkCount = static_cast<uint32_t>(graph[n][l].size());
+            ok = writeValue(fp, linkCount) &&
+                 fwrite(graph[n][l].data(), sizeof(int), linkCount, fp) == linkCount;
+        }
+    }
+
+    uint32_t identityNum = static_cast<uint32_t>(ids.size());
+    ok = ok && writeValue(fp, identityNum);
+    for(uint32_t i = 0; ok && i < identityNum; i++)
+    {
+        ok = writeString(fp, ids[i]) && writeString(fp, names[i]);
+    }
+
+    ok = ok && fwrite(data.data(), sizeof(float), data.size(), fp) == data.size();
+    ok = fclose(fp) == 0 && ok;
+
+    if(!ok || rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        ::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool FaceIndex::load(const std::string &path)
+{
+    FILE *fp = fopen(path.c_str(), "rb");
+    char magic[8];
+    uint32_t version, count, identityNum;
+    int fileMetric, fileM, fileEf;
+    long fileSize;
+    bool ok;
+
+    if(!fp)
+    {
+        return false;
+    }
+    fileSize = fseek(fp, 0, SEEK_END) == 0 ? ftell(fp) : -1;
+    rewind(fp);
+
+    clear();
+    ok = fileSize > 0 && fread(magic, 1, 8, fp) == 8 && memcmp(magic, FACE_INDEX_MAGIC, 8) == 0 &&
+         readValue(fp, version) && version == FACE_INDEX_VERSION &&
+         readValue(fp, fileMetric) && fileMetric == metric &&
+         readValue(fp, fileM) && readValue(fp, fileEf) &&
+         readValue(fp, dim) && readValue(fp, stride) && readValue(fp, count) &&
+         readValue(fp, entryPoint) && readValue(fp, maxLevel) &&
+         readValue(fp, generation) && readValue(fp, galleryRows);
+
+    //m 决定层数分布，m <= 1 时 levelMult 无意义；特征矩阵在文件末尾，节点数不能超出文件大小
+    ok = ok && fileM > 1 && fileEf > 0 && count <= galleryRows &&
+         (count == 0 || (dim > 0 && stride == (dim + FACE_MATCH_LANES - 1) / FACE_MATCH_LANES * FACE_MATCH_LANES &&
+                         static_cast<uint64_t>(count) * stride * sizeof(float) <= static_cast<uint64_t>(fileSize)));
+
+    if(ok)
+    {
+        m = fileM;
+        efConstruction = fileEf;
+        levelMult = 1.0 / std::log(static_cast<double>(m));
+        graph.resize(count);
+        nodeRow.resize(count);
+        nodeIdentity.resize(count);
+        deleted.resize(count);
+    }
+
+    for(uint32_t n = 0; ok && n < count; n++)
+    {
+        int32_t levels;
+        ok = readValue(fp, nodeRow[n]) && readValue(fp, nodeIdentity[n]) &&
+             readValue(fp, deleted[n]) && readValue(fp, levels) && levels > 0 && levels <= 64 &&
+             nodeRow[n] >= 0 && static_cast<uint32_t>(nodeRow[n]) < galleryRows && !rowNode.count(nodeRow[n]);
+        if(ok)
+        {
+            graph[n].resize(levels);
+            rowNode[nodeRow[n]] = static_cast<int>(n);
+        }
+        for(int l = 0; ok && l < levels; l++)
+        {
+            uint32_t linkCount;
+            ok = readValue(fp, linkCount) && linkCount <= count;
+            if(ok)
+            {
+                graph[n][l].resize(linkCount);
+                ok = fread(graph[n][l].data(), sizeof(int), linkCount, fp) == linkCount;
+            }
+        }
+    }
+
+    ok = ok && readValue(fp, identityNum);
+    for(uint32_t i = 0; ok && i < identityNum; i++)
+    {
+        std::string id, name;
+        ok = readString(fp, id) && readString(fp, name);
+        if(ok)
+        {
+            identityOf(id, name);
+        }
+    }
+
+    if(ok)
+    {
+        data.resize(static_cast<size_t>(count) * stride);
+        ok = fread(data.data(), sizeof(float), data.size(), fp) == data.size();
+    }
+    fclose(fp);
+
+    ok = ok && checkLoaded();
+
+    if(!ok)
+    {
+        clear();
+    }
+    return ok;
+}
+
+/*****************************************************************************/
+/* C 接口                                                                  */
+/*****************************************************************************/
+struct face_index_s
+{
+    FaceIndex index;
+    std::string galleryPath;
+    std::string indexPath;
+
+    explicit face_index_s(int metric) : index(metric) {}
+};
+
+face_index_t *face_index_open(const char *gallery_path, const char *index_path, int metric)
+{
+    face_index_t *idx = new face_index_s(metric);
+    idx->galleryPath = gallery_path;
+    idx->indexPath = index_path;
+    idx->index.load(idx->indexPath);   //失败时从空索引开始
+
+    if(face_index_sync(idx) < 0)
+    {
+        delete idx;
+        return nullptr;
+    }
+    return idx;
+}
+
+void face_index_close(face_index_t *index)
+{
+    delete index;
+}
+
+int face_index_sync(face_index_t *index)
+{
+    struct face_gallery_t gallery;
+    if(face_gallery_open(&gallery, index->galleryPath.c_str()) < 0)
+    {
+        return -1;
+    }
+
+    bool changed = index->index.sync(&gallery);
+    face_gallery_close(&gallery);
+
+    if(changed)
+    {
+        index->index.save(index->indexPath);
+    }
+    return changed ? 1 : 0;
+}
+
+int face_index_size(const face_index_t *index)
+{
+    return index->index.size();
+}
+
+int face_index_search(const face_index_t *index, const float *query, int k, int ef, struct face_match_result_t *out)
+{
+    std::vector<FaceMatch> result = index->index.search(query, k, ef > 0 ? ef : FACE_INDEX_EF_SEARCH);
+    for(size_t i = 0; i < result.size(); i++)
+    {
+        out[i].id = index->index.identityId(result[i].identity).c_str();
+        out[i].name = index->index.identityName(result[i].identity).c_str();
+        out[i].distance = result[i].distance;
+        out[i].row = result[i].row;
+    }
+    return static_cast<int>(result.size());
+}
@@ -0,0 +1,134 @@
+/**
+ * @file face_index.h
+ * @brief 人脸库近似最近邻索引（HNSW），支持增量插入、标记删除和持久化
+ *
+ * 索引记录所对应人脸库的 generation 和已索引行数，sync() 只插入新追加的行并同步删除标志，
+ * generation 变化（人脸库被压缩）时重建。员工数较少时应直接使用 FaceMatcher 精确检索。
+ */
+
+#ifndef __FACE_INDEX_H__
+#define __FACE_INDEX_H__
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include <stdint.h>
+
+#include "face_gallery.h"
+#include "face_matcher.h"
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define FACE_INDEX_PATH             "/home/elf/face/data/gallery.hnsw"  //索引文件路径
+#define FACE_INDEX_M                16      //每层最大邻居数，第0层为其2倍
+#define FACE_INDEX_EF_CONSTRUCTION  100     //建图时的候选集大小
+#define FACE_INDEX_EF_SEARCH        128     //检索时的默认候选集大小
+
+#ifdef __cplusplus
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*****************************************************************************/
+/* 类型定义                                                                  */
+/*****************************************************************************/
+class FaceIndex
+{
+public:
+    explicit FaceIndex(int metric = FACE_MATCH_L2, int m = FACE_INDEX_M, int efConstruction = FACE_INDEX_EF_CONSTRUCTION);
+
+    void clear();
+    int insert(const std::string &id, const std::string &name, const float *feature, int dim, int row);  //返回节点编号
+    bool remove(int row);                   //按人脸库行号标记删除，节点仍参与图遍历
+
+    //与人脸库同步：generation 变化时重建，否则插入新行并同步删除标志；返回是否有修改
+    bool sync(const struct face_gallery_t *gallery);
+
+    //检索最相似的 k 名员工，ef 为候选集大小，越大召回率越高、耗时越长
+    std::vector<FaceMatch> search(const float *query, int k, int ef = FACE_INDEX_EF_SEARCH) const;
+
+    bool save(const std::string &path) const;
+    bool load(const std::string &path);
+
+    int size() const { return static_cast<int>(nodeRow.size()); }
+    int identityCount() const { return static_cast<int>(ids.size()); }
+    const std::string &identityId(int identity) const { return ids[identity]; }
+    const std::string &identityName(int identity) const { return names[identity]; }
+
+private:
+    struct Candidate
+    {
+        float distance;
+        int node;
+    };
+
+    float distance(const float *a, int node) const;
+    const float *vector(int node) const { return &data[static_cast<size_t>(node) * stride]; }
+    std::vector<int> &links(int node, int level) { return graph[node][level]; }
+    const std::vector<int> &links(int node, int level) const { return graph[node][level]; }
+
+    int greedyClosest(const float *query, int entry, int level) const;
+    std::vector<Candidate> searchLayer(const float *query, int entry, int ef, int level) const;
+    std::vector<int> selectNeighbors(std::vector<Candidate> candidates, int maxLinks) const;
+    void prepare(const float *src, float *dst) const;
+    int identityOf(const std::string &id, const std::string &name);
+    bool checkLoaded() const;               //加载后校验入口点、邻居和员工下标都在范围内
+
+    int metric;
+    int m;
+    int efConstruction;
+    double levelMult;
+    std::mt19937 rng;
+
+    int dim;
+    int stride;
+    int entryPoint;
+    int maxLevel;
+    uint32_t generation;                    //对应的人脸库版本
+    uint32_t galleryRows;                   //已同步的人脸库行数，不小于已插入的最大行号+1
+
+    std::vector<float> data;                //节点特征，size x stride
+    std::vector<std::vector<std::vector<int>>> graph;   //节点 -> 各层邻居
+    std::vector<int> nodeRow;               //节点 -> 人脸库行号
+    std::vector<int> nodeIdentity;          //节点 -> 员工下标
+    std::vector<uint8_t> deleted;           //节点删除标志
+    std::unordered_map<int, int> rowNode;   //人脸库行号 -> 节点
+
+    std::vector<std::string> ids;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, int> identityIndex;
+};
+
+extern "C"
+{
+#endif
+
+/*****************************************************************************/
+/* C 接口                                                                  */
+/*****************************************************************************/
+typedef struct face_index_s face_index_t;
+
+/**
+ * 打开索引：加载 index_path（不存在或格式错误时新建），再与人脸库同步，有修改时写回
+ * @retval NULL - 人脸库打开失败
+ */
+face_index_t *face_index_open(const char *gallery_path, const char *index_path, int metric);
+
+void face_index_close(face_index_t *index);
+
+/* 重新与人脸库同步（注册、删除之后调用），有修改时写回索引文件 */
+int face_index_sync(face_index_t *index);
+
+int face_index_size(const face_index_t *index);
+
+/* 检索，结果格式同 face_matcher_search，ef<=0 时使用默认值 */
+int face_index_search(const face_index_t *index, const float *query, int k, int ef, struct face_match_result_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,140 @@
+/**
+ * @file face_index_bench.cpp
+ * @brief HNSW 索引召回率/耗时测试：与 FaceMatcher 精确检索的 top-1 结果对比，
+ *        统计不同 ef 下的召回率和单次检索耗时，并验证索引保存、加载和标记删除
+ *
+ * 用法: face_index_bench [员工数 ...]
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include "face_index.h"
+#include "face_matcher.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define BENCH_DIM           128
+#define BENCH_SAMPLES       3
+#define BENCH_QUERIES       200
+#define BENCH_NOISE         0.03f
+#define BENCH_INDEX_PATH    "/tmp/face_index_bench.hnsw"
+
+/*****************************************************************************/
+/* 函数定义                                                                  */
+/*****************************************************************************/
+static double elapsed_us(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void run(int identities)
+{
+    static const int efs[] = { 16, 32, 64, 128, 256 };
+    std::mt19937 rng(identities);
+    std::normal_distribution<float> center(0.0f, 0.09f);
+    std::normal_distribution<float> noise(0.0f, BENCH_NOISE);
+    std::vector<float> centers(static_cast<size_t>(identities) * BENCH_DIM);
+    std::vector<float> queries(BENCH_QUERIES * BENCH_DIM);
+    std::vector<float> sample(BENCH_DIM);
+    FaceMatcher exact;
+    FaceIndex index;
+
+    for(size_t i = 0; i < centers.size(); i++)
+    {
+        centers[i] = center(rng);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for(int p = 0; p < identities; p++)
+    {
+        for(int s = 0; s < BENCH_SAMPLES; s++)
+        {
+            for(int d = 0; d < BENCH_DIM; d++)
+            {
+                sample[d] = centers[static_cast<size_t>(p) * BENCH_DIM + d] + noise(rng);
+            }
+            int row = p * BENCH_SAMPLES + s;
+            exact.add(std::to_string(p), "", sample.data(), BENCH_DIM, row);
+            index.insert(std::to_string(p), "", sample.data(), BENCH_DIM, row);
+        }
+    }
+    printf("%7d ids  build %.2f s\n", identities, elapsed_us(start) / 1e6);
+
+    for(int q = 0; q < BENCH_QUERIES; q++)
+    {
+        int p = static_cast<int>(rng() % identities);
+        for(int d = 0; d < BENCH_DIM; d++)
+        {
+            queries[q * BENCH_DIM + d] = centers[static_cast<size_t>(p) * BENCH_DIM + d] + noise(rng);
+        }
+    }
+
+    std::vector<std::string> truth(BENCH_QUERIES);
+    start = std::chrono::steady_clock::now();
+    for(int q = 0; q < BENCH_QUERIES; q++)
+    {
+        truth[q] = exact.identityId(exact.search(&queries[q * BENCH_DIM], 1)[0].identity);
+    }
+    printf("%7d ids  exact         %10.1f us/query\n", identities, elapsed_us(start) / BENCH_QUERIES);
+
+    for(int ef : efs)
+    {
+        int hit = 0;
+        start = std::chrono::steady_clock::now();
+        for(int q = 0; q < BENCH_QUERIES; q++)
+        {
+            std::vector<FaceMatch> top = index.search(&queries[q * BENCH_DIM], 1, ef);
+            if(!top.empty() && index.identityId(top[0].identity) == truth[q]) hit++;
+        }
+        printf("%7d ids  hnsw ef=%-4d  %10.1f us/query  recall@1 %5.1f%%\n",
+               identities, ef, elapsed_us(start) / BENCH_QUERIES, 100.0 * hit / BENCH_QUERIES);
+    }
+
+    //保存、加载后结果应一致；删除某员工的全部特征后不应再被检出
+    FaceIndex loaded;
+    if(!index.save(BENCH_INDEX_PATH) || !loaded.load(BENCH_INDEX_PATH))
+    {
+        printf("%7d ids  save/load failed\n", identities);
+        return;
+    }
+    std::vector<FaceMatch> before = index.search(&queries[0], 1);
+    std::vector<FaceMatch> after = loaded.search(&queries[0], 1);
+    int victim = before[0].row / BENCH_SAMPLES;
+    for(int s = 0; s < BENCH_SAMPLES; s++)
+    {
+        loaded.remove(victim * BENCH_SAMPLES + s);
+    }
+    std::vector<FaceMatch> removed = loaded.search(&queries[0], 1);
+    printf("%7d ids  reload %s  tombstone %s\n", identities,
+           before[0].row == after[0].row ? "ok" : "MISMATCH",
+           removed.empty() || removed[0].row / BENCH_SAMPLES != victim ? "ok" : "FAILED");
+    std::remove(BENCH_INDEX_PATH);
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<int> sizes;
+    for(int i = 1; i < argc; i++)
+    {
+        sizes.push_back(atoi(argv[i]));
+    }
+    if(sizes.empty())
+    {
+        sizes = { 1000, 10000 };
+    }
+
+    for(int n : sizes)
+    {
+        run(n);
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+/**
+ * @file face_kernels.h
+ * @brief 人脸特征距离计算内核（NEON/AVX2/标量），供匹配器和近似最近邻索引共用
+ */
+
+#ifndef __FACE_KERNELS_H__
+#define __FACE_KERNELS_H__
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FACE_MATCH_NEON 1
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define FACE_MATCH_AVX2 1
+#endif
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define FACE_MATCH_LANES    16      //特征维度补齐到16的倍数，内核无需处理尾部
+
+/*****************************************************************************/
+/* 计算内核，n 为16的倍数                                                    */
+/*****************************************************************************/
+/* 平方欧氏距离 */
+static inline float kernel_l2_f32(const float *a, const float *b, int n)
+{
+#if defined(FACE_MATCH_NEON) && defined(__aarch64__)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for(int i = 0; i < n; i += 8)
+    {
+        float32x4_t d0 = vsubq_f32(vld1q_f32(a + i), vld1q_f32(b + i));
+        float32x4_t d1 = vsubq_f32(vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        acc0 = vfmaq_f32(acc0, d0, d0);
+        acc1 = vfmaq_f32(acc1, d1, d1);
+    }
+    return vaddvq_f32(vaddq_f32(acc0, acc1));
+#elif defined(FACE_MATCH_AVX2)
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for(int i = 0; i < n; i += 16)
+    {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+    }
+    acc0 = _mm256_add_ps(acc0, acc1);
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+#else
+    float sum = 0.0f;
+    for(int i = 0; i < n; i++)
+    {
+        float d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+#endif
+}
+
+/* 内积 */
+static inline float kernel_dot_f32(const float *a, const float *b, int n)
+{
+#if defined(FACE_MATCH_NEON) && defined(__aarch64__)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for(int i = 0; i < n; i += 8)
+    {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    return vaddvq_f32(vaddq_f32(acc0, acc1));
+#elif defined(FACE_MATCH_AVX2)
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for(int i = 0; i < n; i += 16)
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    acc0 = _mm256_add_ps(acc0, acc1);
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+#else
+    float sum = 0.0f;
+    for(int i = 0; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+#endif
+}
+
+/* int8 内积，结果为 int32 */
+static inline int32_t kernel_dot_i8(const int8_t *a, const int8_t *b, int n)
+{
+#if defined(FACE_MATCH_NEON) && defined(__aarch64__) && defined(__ARM_FEATURE_DOTPROD)
+    int32x4_t acc = vdupq_n_s32(0);
+    for(int i = 0; i < n; i += 16)
+    {
+        acc = vdotq_s32(acc, vld1q_s8(a + i), vld1q_s8(b + i));
+    }
+    return vaddvq_s32(acc);
+#elif defined(FACE_MATCH_NEON) && defined(__aarch64__)
+    int32x4_t acc = vdupq_n_s32(0);
+    for(int i = 0; i < n; i += 16)
+    {
+        int8x16_t x = vld1q_s8(a + i);
+        int8x16_t y = vld1q_s8(b + i);
+        acc = vpadalq_s16(acc, vmull_s8(vget_low_s8(x), vget_low_s8(y)));
+        acc = vpadalq_s16(acc, vmull_high_s8(x, y));
+    }
+    return vaddvq_s32(acc);
+#elif defined(FACE_MATCH_AVX2)
+    __m256i acc = _mm256_setzero_si256();
+    for(int i = 0; i < n; i += 16)
+    {
+        __m256i x = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)));
+        __m256i y = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(x, y));
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+#else
+    int32_t sum = 0;
+    for(int i = 0; i < n; i++)
+    {
+        sum += static_cast<int32_t>(a[i]) * b[i];
+    }
+    return sum;
+#endif
+}
+
+/* 对称量化到 [-127, 127]，返回量化系数 */
+static inline float quantize_i8(const float *src, int8_t *dst, int n)
+{
+    float maxAbs = 0.0f;
+    for(int i = 0; i < n; i++)
+    {
+        maxAbs = std::max(maxAbs, std::fabs(src[i]));
+    }
+
+    float scale = maxAbs > 0.0f ? maxAbs / 127.0f : 1.0f;
+    for(int i = 0; i < n; i++)
+    {
+        dst[i] = static_cast<int8_t>(std::lround(src[i] / scale));
+    }
+    return scale;
+}
+
+#endif
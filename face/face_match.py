@@ -0,0 +1,121 @@
+import ctypes
+import os
+
+import numpy as np
+
+# libface_match.so 的 ctypes 封装，接口见 face_matcher.h 和 face_index.h
+# 编译: cmake -S /home/elf/face -B build && cmake --build build
+
+INDEX_PATH = "/home/elf/face/data/gallery.hnsw"
+
+LIB_PATHS = [
+    "/home/elf/face/build/libface_match.so",
+    os.path.join(os.path.dirname(os.path.abspath(__file__)), "build", "libface_match.so"),
+]
+
+FACE_MATCH_L2 = 0
+FACE_MATCH_COSINE = 1
+FACE_MATCH_F32 = 0
+FACE_MATCH_INT8 = 1
+
+class _Result(ctypes.Structure):
+    _fields_ = [("id", ctypes.c_char_p),
+                ("name", ctypes.c_char_p),
+                ("distance", ctypes.c_float),
+                ("row", ctypes.c_int32)]
+
+_lib = None
+
+def _load_library(): # 加载匹配库，不存在返回None
+    global _lib
+    if _lib is not None:
+        return _lib
+    for path in LIB_PATHS:
+        if os.path.exists(path):
+            lib = ctypes.CDLL(path)
+            lib.face_matcher_create.restype = ctypes.c_void_p
+            lib.face_matcher_create.argtypes = [ctypes.c_char_p, ctypes.c_int, ctypes.c_int]
+            lib.face_matcher_destroy.argtypes = [ctypes.c_void_p]
+            lib.face_matcher_size.argtypes = [ctypes.c_void_p]
+            lib.face_matcher_identity_count.argtypes = [ctypes.c_void_p]
+            lib.face_matcher_search.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_float),
+                                                ctypes.c_int, ctypes.POINTER(_Result)]
+            lib.face_matcher_calibrate.restype = ctypes.c_float
+            lib.face_matcher_calibrate.argtypes = [ctypes.c_void_p, ctypes.c_float, ctypes.POINTER(ctypes.c_float)]
+            lib.face_index_open.restype = ctypes.c_void_p
+            lib.face_index_open.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_int]
+            lib.face_index_close.argtypes = [ctypes.c_void_p]
+            lib.face_index_sync.argtypes = [ctypes.c_void_p]
+            lib.face_index_size.argtypes = [ctypes.c_void_p]
+            lib.face_index_search.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_float), ctypes.c_int,
+                                              ctypes.c_int, ctypes.POINTER(_Result)]
+            _lib = lib
+            break
+    return _lib
+
+def available():
+    return _load_library() is not None
+
+class NativeMatcher: # 由人脸库文件构建的匹配器
+    def __init__(self, gallery_path, metric=FACE_MATCH_L2, precision=FACE_MATCH_F32):
+        self.lib = _load_library()
+        if self.lib is None:
+            raise OSError("找不到 libface_match.so")
+        self.handle = self.lib.face_matcher_create(gallery_path.encode("utf-8"), metric, precision)
+        if not self.handle:
+            raise ValueError(f"无法加载人脸库: {gallery_path}")
+
+    def __len__(self):
+        return self.lib.face_matcher_size(self.handle)
+
+    def identity_count(self):
+        return self.lib.face_matcher_identity_count(self.handle)
+
+    def search(self, feature, k=1): # 返回 [(工号, 姓名, 距离), ...]，按距离升序
+        query = np.ascontiguousarray(feature, dtype=np.float32).reshape(-1)
+        out = (_Result * k)()
+        n = self.lib.face_matcher_search(self.handle, query.ctypes.data_as(ctypes.POINTER(ctypes.c_float)), k, out)
+        return [(out[i].id.decode("utf-8"), out[i].name.decode("utf-8"), float(out[i].distance)) for i in range(n)]
+
+    def calibrate(self, target_far=0.001): # 返回 (阈值, 拒识率)
+        frr = ctypes.c_float()
+        threshold = self.lib.face_matcher_calibrate(self.handle, target_far, ctypes.byref(frr))
+        return float(threshold), float(frr.value)
+
+    def close(self):
+        if self.handle:
+            self.lib.face_matcher_destroy(self.handle)
+            self.handle = None
+
+    def __del__(self):
+        self.close()
+
+class NativeIndex: # HNSW 近似最近邻索引，注册、删除后调用 sync() 增量更新
+    def __init__(self, gallery_path, index_path=INDEX_PATH, metric=FACE_MATCH_L2, ef=0):
+        self.lib = _load_library()
+        if self.lib is None:
+            raise OSError("找不到 libface_match.so")
+        self.ef = ef
+        self.handle = self.lib.face_index_open(gallery_path.encode("utf-8"), index_path.encode("utf-8"), metric)
+        if not self.handle:
+            raise ValueError(f"无法加载人脸库: {gallery_path}")
+
+    def __len__(self):
+        return self.lib.face_index_size(self.handle)
+
+    def sync(self): # 返回索引是否有修改
+        return self.lib.face_index_sync(self.handle) > 0
+
+    def search(self, feature, k=1): # 返回格式同 NativeMatcher.search
+        query = np.ascontiguousarray(feature, dtype=np.float32).reshape(-1)
+        out = (_Result * k)()
+        n = self.lib.face_index_search(self.handle, query.ctypes.data_as(ctypes.POINTER(ctypes.c_float)), k, self.ef, out)
+        return [(out[i].id.decode("utf-8"), out[i].name.decode("utf-8"), float(out[i].distance)) for i in range(n)]
+
+    def close(self):
+        if self.handle:
+            self.lib.face_index_close(self.handle)
+            self.handle = None
+
+    def __del__(self):
+        self.close()
@@ -0,0 +1,300 @@
+/**
+ * @file face_matcher.cpp
+ * @brief 人脸特征最近邻匹配实现
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include "face_matcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "face_kernels.h"
+
+/*****************************************************************************/
+/* 函数定义                                                                  */
+/*****************************************************************************/
+FaceMatcher::FaceMatcher(int metric, int precision)
+    : metric(metric), precision(precision), dim(0), stride(0)
+{
+}
+
+void FaceMatcher::clear()
+{
+    features.clear();
+    norms2.clear();
+    quantized.clear();
+    scales.clear();
+    rowIdentity.clear();
+    rowSource.clear();
+    ids.clear();
+    names.clear();
+    identityIndex.clear();
+    dim = 0;
+    stride = 0;
+}
+
+bool FaceMatcher::load(const struct face_gallery_t *gallery)
+{
+    uint32_t count = face_gallery_count(gallery);
+    int galleryDim = static_cast<int>(face_gallery_dim(gallery));
+    std::vector<float> buf(galleryDim);
+
+    clear();
+    if(galleryDim <= 0)
+    {
+        return false;
+    }
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(face_gallery_is_deleted(gallery, i) || face_gallery_feature(gallery, i, buf.data()) < 0)
+        {
+            continue;
+        }
+        add(face_gallery_id(gallery, i), face_gallery_name(gallery, i), buf.data(), galleryDim, static_cast<int>(i));
+    }
+    return true;
+}
+
+/* 追加一条特征，余弦距离下预先归一化 */
+void FaceMatcher::add(const std::string &id, const std::string &name, const float *feature, int featureDim, int row)
+{
+    if(dim == 0)
+    {
+        dim = featureDim;
+        stride = (featureDim + FACE_MATCH_LANES - 1) / FACE_MATCH_LANES * FACE_MATCH_LANES;
+    }
+
+    size_t offset = features.size();
+    features.resize(offset + stride, 0.0f);
+    std::memcpy(&features[offset], feature, sizeof(float) * std::min(dim, featureDim));
+
+    float norm2 = kernel_dot_f32(&features[offset], &features[offset], stride);
+    if(metric == FACE_MATCH_COSINE && norm2 > 0.0f)
+    {
+        float inv = 1.0f / std::sqrt(norm2);
+        for(int i = 0; i < dim; i++)
+        {
+            features[offset + i] *= inv;
+        }
+        norm2 = 1.0f;
+    }
+    norms2.push_back(norm2);
+
+    quantized.resize(offset + stride, 0);
+    scales.push_back(quantize_i8(&features[offset], &quantized[offset], stride));
+
+    auto it = identityIndex.find(id);
+    int identity;
+    if(it == identityIndex.end())
+    {
+        identity = static_cast<int>(ids.size());
+        identityIndex.emplace(id, identity);
+        ids.push_back(id);
+        names.push_back(name);
+    }
+    else
+    {
+        identity = it->second;
+    }
+
+    rowIdentity.push_back(identity);
+    rowSource.push_back(row);
+}
+
+/* 查询特征补齐、归一化和量化 */
+void FaceMatcher::prepareQuery(const float *query, std::vector<float> &buf, std::vector<int8_t> &qbuf,
+                               float *scale, float *norm2) const
+{
+    buf.assign(stride, 0.0f);
+    std::memcpy(buf.data(), query, sizeof(float) * dim);
+
+    *norm2 = kernel_dot_f32(buf.data(), buf.data(), stride);
+    if(metric == FACE_MATCH_COSINE && *norm2 > 0.0f)
+    {
+        float inv = 1.0f / std::sqrt(*norm2);
+        for(int i = 0; i < dim; i++)
+        {
+            buf[i] *= inv;
+        }
+        *norm2 = 1.0f;
+    }
+
+    qbuf.assign(stride, 0);
+    *scale = precision == FACE_MATCH_INT8 ? quantize_i8(buf.data(), qbuf.data(), stride) : 1.0f;
+}
+
+/* 查询与第 row 行的距离：L2 返回欧氏距离，余弦返回 1 - cos */
+float FaceMatcher::rowDistance(int row, const float *query, const int8_t *qquery, float qscale, float qnorm2) const
+{
+    size_t offset = static_cast<size_t>(row) * stride;
+    float dot;
+
+    if(precision == FACE_MATCH_INT8)
+    {
+        dot = kernel_dot_i8(&quantized[offset], qquery, stride) * scales[row] * qscale;
+    }
+    else if(metric == FACE_MATCH_L2)
+    {
+        return std::sqrt(kernel_l2_f32(&features[offset], query, stride));
+    }
+    else
+    {
+        dot = kernel_dot_f32(&features[offset], query, stride);
+    }
+
+    if(metric == FACE_MATCH_COSINE)
+    {
+        return 1.0f - dot;
+    }
+    return std::sqrt(std::max(0.0f, norms2[row] + qnorm2 - 2.0f * dot));
+}
+
+std::vector<FaceMatch> FaceMatcher::search(const float *query, int k) const
+{
+    std::vector<FaceMatch> best(ids.size(), FaceMatch{ -1, -1, 0.0f });
+    std::vector<float> buf;
+    std::vector<int8_t> qbuf;
+    float qscale, qnorm2;
+
+    if(rowIdentity.empty() || k <= 0)
+    {
+        return std::vector<FaceMatch>();
+    }
+
+    prepareQuery(query, buf, qbuf, &qscale, &qnorm2);
+
+    //同一员工的多条注册特征取最小距离
+    for(int row = 0; row < size(); row++)
+    {
+        float d = rowDistance(row, buf.data(), qbuf.data(), qscale, qnorm2);
+        FaceMatch &m = best[rowIdentity[row]];
+        if(m.row < 0 || d < m.distance)
+        {
+            m.identity = rowIdentity[row];
+            m.row = rowSource[row];
+            m.distance = d;
+        }
+    }
+
+    k = std::min(k, static_cast<int>(best.size()));
+    std::partial_sort(best.begin(), best.begin() + k, best.end(),
+                      [](const FaceMatch &a, const FaceMatch &b) { return a.distance < b.distance; });
+    best.resize(k);
+    return best;
+}
+
+/* 留一法：每条特征与同一员工其他特征的最小距离为真匹配，与其他员工的最小距离为冒认 */
+float FaceMatcher::calibrate(float targetFar, float *frr) const
+{
+    std::vector<float> genuine, impostor;
+    std::vector<float> buf;
+    std::vector<int8_t> qbuf;
+    float qscale, qnorm2;
+
+    for(int i = 0; i < size(); i++)
+    {
+        float sameMin = -1.0f, otherMin = -1.0f;
+        prepareQuery(&features[static_cast<size_t>(i) * stride], buf, qbuf, &qscale, &qnorm2);
+
+        for(int j = 0; j < size(); j++)
+        {
+            if(j == i)
+            {
+                continue;
+            }
+            float d = rowDistance(j, buf.data(), qbuf.data(), qscale, qnorm2);
+            float &slot = rowIdentity[j] == rowIdentity[i] ? sameMin : otherMin;
+            if(slot < 0.0f || d < slot)
+            {
+                slot = d;
+            }
+        }
+
+        if(sameMin >= 0.0f) genuine.push_back(sameMin);
+        if(otherMin >= 0.0f) impostor.push_back(otherMin);
+    }
+
+    if(impostor.empty())
+    {
+        if(frr) *frr = 0.0f;
+        return 0.0f;
+    }
+
+    //距离小于阈值判为同一人，允许至多 targetFar 比例的冒认通过
+    std::sort(impostor.begin(), impostor.end());
+    size_t allowed = static_cast<size_t>(std::floor(targetFar * impostor.size()));
+    float threshold = impostor[std::min(allowed, impostor.size() - 1)];
+
+    if(frr)
+    {
+        size_t rejected = 0;
+        for(float d : genuine)
+        {
+            if(d >= threshold) rejected++;
+        }
+        *frr = genuine.empty() ? 0.0f : static_cast<float>(rejected) / genuine.size();
+    }
+    return threshold;
+}
+
+/*****************************************************************************/
+/* C 接口                                                                  */
+/*****************************************************************************/
+struct face_matcher_s
+{
+    FaceMatcher matcher;
+
+    face_matcher_s(int metric, int precision) : matcher(metric, precision) {}
+};
+
+face_matcher_t *face_matcher_create(const char *gallery_path, int metric, int precision)
+{
+    struct face_gallery_t gallery;
+    if(face_gallery_open(&gallery, gallery_path) < 0)
+    {
+        return nullptr;
+    }
+
+    face_matcher_t *m = new face_matcher_s(metric, precision);
+    m->matcher.load(&gallery);
+    face_gallery_close(&gallery);
+    return m;
+}
+
+void face_matcher_destroy(face_matcher_t *matcher)
+{
+    delete matcher;
+}
+
+int face_matcher_size(const face_matcher_t *matcher)
+{
+    return matcher->matcher.size();
+}
+
+int face_matcher_identity_count(const face_matcher_t *matcher)
+{
+    return matcher->matcher.identityCount();
+}
+
+int face_matcher_search(const face_matcher_t *matcher, const float *query, int k, struct face_match_result_t *out)
+{
+    std::vector<FaceMatch> result = matcher->matcher.search(query, k);
+    for(size_t i = 0; i < result.size(); i++)
+    {
+        out[i].id = matcher->matcher.identityId(result[i].identity).c_str();
+        out[i].name = matcher->matcher.identityName(result[i].identity).c_str();
+        out[i].distance = result[i].distance;
+        out[i].row = result[i].row;
+    }
+    return static_cast<int>(result.size());
+}
+
+float face_matcher_calibrate(const face_matcher_t *matcher, float target_far, float *frr)
+{
+    return matcher->matcher.calibrate(target_far, frr);
+}
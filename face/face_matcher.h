@@ -0,0 +1,134 @@
+/**
+ * @file face_matcher.h
+ * @brief 人脸特征最近邻匹配：float32 / int8 量化的 L2、余弦距离内核（NEON/AVX2），
+ *        按员工聚合多条注册特征的 top-k 检索，以及阈值标定
+ *
+ * C++ 程序直接使用 FaceMatcher，Python 人脸识别服务通过 face_match.py 调用下方的 C 接口。
+ */
+
+#ifndef __FACE_MATCHER_H__
+#define __FACE_MATCHER_H__
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include <stdint.h>
+
+#include "face_gallery.h"
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define FACE_MATCH_L2           0       //欧氏距离
+#define FACE_MATCH_COSINE       1       //余弦距离 1 - cos
+#define FACE_MATCH_F32          0       //float32 计算
+#define FACE_MATCH_INT8         1       //int8 对称量化计算
+
+#ifdef __cplusplus
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*****************************************************************************/
+/* 类型定义                                                                  */
+/*****************************************************************************/
+/* 检索结果，distance 越小越相似 */
+struct FaceMatch
+{
+    int identity;       //员工下标
+    int row;            //距离最近的那条特征在人脸库中的行号
+    float distance;
+};
+
+/* 人脸特征匹配器，特征按16维补齐后连续存放 */
+class FaceMatcher
+{
+public:
+    explicit FaceMatcher(int metric = FACE_MATCH_L2, int precision = FACE_MATCH_F32);
+
+    bool load(const struct face_gallery_t *gallery);    //载入人脸库中未删除的特征
+    void clear();
+    void add(const std::string &id, const std::string &name, const float *feature, int dim, int row);
+
+    int size() const { return static_cast<int>(rowIdentity.size()); }
+    int identityCount() const { return static_cast<int>(ids.size()); }
+    const std::string &identityId(int identity) const { return ids[identity]; }
+    const std::string &identityName(int identity) const { return names[identity]; }
+
+    //检索最相似的 k 名员工，每名员工取其所有注册特征中的最小距离
+    std::vector<FaceMatch> search(const float *query, int k) const;
+
+    //在当前人脸库上留一法标定阈值：误识率不超过 targetFar 时的最大阈值，frr 返回对应拒识率
+    float calibrate(float targetFar, float *frr) const;
+
+private:
+    void prepareQuery(const float *query, std::vector<float> &buf, std::vector<int8_t> &qbuf,
+                      float *scale, float *norm2) const;
+    float rowDistance(int row, const float *query, const int8_t *qquery, float qscale, float qnorm2) const;
+
+    int metric;
+    int precision;
+    int dim;
+    int stride;                         //补齐后的维度，16的倍数
+
+    std::vector<float> features;        //size x stride
+    std::vector<float> norms2;          //每行平方范数
+    std::vector<int8_t> quantized;      //size x stride
+    std::vector<float> scales;          //每行量化系数
+
+    std::vector<int> rowIdentity;       //行 -> 员工下标
+    std::vector<int> rowSource;         //行 -> 人脸库行号
+    std::vector<std::string> ids;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, int> identityIndex;
+};
+
+extern "C"
+{
+#endif
+
+/*****************************************************************************/
+/* C 接口                                                                  */
+/*****************************************************************************/
+typedef struct face_matcher_s face_matcher_t;
+
+/* C 接口检索结果，字符串在匹配器销毁前有效 */
+struct face_match_result_t
+{
+    const char *id;
+    const char *name;
+    float distance;
+    int32_t row;
+};
+
+/**
+ * 由人脸库文件创建匹配器
+ * @param metric    FACE_MATCH_L2 / FACE_MATCH_COSINE
+ * @param precision FACE_MATCH_F32 / FACE_MATCH_INT8
+ * @retval NULL - 人脸库打开失败
+ */
+face_matcher_t *face_matcher_create(const char *gallery_path, int metric, int precision);
+
+void face_matcher_destroy(face_matcher_t *matcher);
+
+/* 有效特征条数与员工数 */
+int face_matcher_size(const face_matcher_t *matcher);
+int face_matcher_identity_count(const face_matcher_t *matcher);
+
+/**
+ * 检索最相似的 k 名员工
+ * @param query 长度为人脸库维度的 float32 特征
+ * @param out   至少 k 个元素
+ * @retval 实际返回的结果数
+ */
+int face_matcher_search(const face_matcher_t *matcher, const float *query, int k, struct face_match_result_t *out);
+
+/* 阈值标定，frr 可为 NULL */
+float face_matcher_calibrate(const face_matcher_t *matcher, float target_far, float *frr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,12 +1,20 @@
-import csv
 import logging
 import os
+import sys
 import time
 from datetime import datetime
 import cv2
 import dlib
 import numpy as np
-from PIL import Image, ImageDraw, ImageFont
+
+import attendance_ledger
+import face_backend
+import face_evidence
+import face_gallery
+
+# 采集进程 camera_broker 运行时从共享内存取帧，与动作识别共用摄像头
+sys.path.insert(0, "/home/elf/ipc")
+import camera_ring
 
 class Employee: # 员工信息
     def __init__(self, emp_id, name):
@@ -49,78 +57,37 @@ face_sp = dlib.shape_predictor('/home/elf/face/weights/shape_predictor_68_face_l
 face_feature_model = dlib.face_recognition_model_v1('/home/elf/face/weights/dlib_face_recognition_resnet_model_v1.dat')
 
 # 中文
-def cv2_put_cn_text(img, text, position, text_color=(0, 255, 0), text_size=30):
-    text_color_rgb = (text_color[2], text_color[1], text_color[0])
-    img = Image.fromarray(cv2.cvtColor(img, cv2.COLOR_BGR2RGB))
-    draw = ImageDraw.Draw(img)
-
-    font_style = ImageFont.truetype("/home/elf/face/fonts/songti.ttc", text_size, encoding="utf-8")
-    draw.text(position, text, text_color_rgb, font=font_style)
-
-    return cv2.cvtColor(np.asarray(img), cv2.COLOR_RGB2BGR)
+def cv2_put_cn_text(img, text, position, text_color=(0, 255, 0), text_size=30): # 原地绘制，text_color 为BGR
+    return face_evidence.put_text(img, text, position, text_color, text_size)
 
 def load_employee_face_feature(): # 加载人脸数据
-    all_employee = []
-    all_face_feature = []
-
-    with open('/home/elf/face/data/feature.csv', 'r', encoding='utf-8-sig') as f:
-        csv_f = csv.reader(f)
-        for line in csv_f:
-            try:
-                # 解析数据
-                feature_str = line[2].strip('[]') if '[' in line[2] else line[2]
-                feature = [float(x) for x in feature_str.split(',')]
-                if len(feature) != 128:  # 验证特征维度
-                    logging.warning(f"数据维度异常(工号:{line[0]}): {len(feature)}")
-                    continue
-                
-                employee = Employee(line[0], line[1])
-                face_feature = np.asarray(feature, dtype=np.float64).reshape((1, -1))
-                
-                all_employee.append(employee)
-                all_face_feature.append(face_feature)
-            except Exception as e:
-                logging.warning(f"数据解析失败(工号:{line[0]}): {str(e)}")
-                continue
-                
-        if not all_employee:
-            logging.error("没有有效的数据")
-            raise ValueError("没有有效的数据")
-            
-        logging.info(f"成功加载 {len(all_employee)} 条数据")
-
-    return all_employee, np.vstack(all_face_feature)
-
-def face_recognize(dist_threshold=0.5): # 人脸识别考勤功能
-    if not check_required_files():
-        print("人脸识别运行失败，缺少必要文件！")
-        logging.info(f"打卡失败")
-        return
+    # 首次运行时由旧版 feature.csv 生成二进制人脸库
+    if not os.path.exists(face_gallery.GALLERY_PATH) and os.path.exists(face_gallery.FEATURE_CSV_PATH):
+        count = face_gallery.import_csv()
+        logging.info(f"已由 feature.csv 导入 {count} 条数据")
 
-    # 加载数据
+    gallery = face_gallery.FaceGallery()
     try:
-        all_employee, all_employee_face_feature = load_employee_face_feature()
-        if not all_employee:
-            print("没有员工数据，请先进行人脸注册！")
-            logging.info(f"打卡失败")
-            return
-    except Exception as e:
-        logging.error(f"加载员工数据失败: {str(e)}")
-        print("加载员工数据失败！")
-        logging.info(f"打卡失败")
-        return
+        _, ids, names, all_face_feature = gallery.active()
+    finally:
+        gallery.close()
 
-    # 创建考勤照片目录
-    attendance_photo_dir = '/home/elf/face/data/attendance_photos/'
-    os.makedirs(attendance_photo_dir, exist_ok=True)
+    all_employee = [Employee(emp_id, name) for emp_id, name in zip(ids, names)]
+    if not all_employee:
+        logging.error("没有有效的数据")
+        raise ValueError("没有有效的数据")
+
+    logging.info(f"成功加载 {len(all_employee)} 条数据")
+    return all_employee, all_face_feature
 
+def capture_frame(): # 打开摄像头并拍摄1张照片，失败返回None
+    cap = None
     try:
-        cap = cv2.VideoCapture('/dev/video11')
+        cap = camera_ring.VideoCapture('/dev/video11')
         if not cap.isOpened():
             logging.error("无法打开摄像头")
             print("无法打开摄像头！")
-            logging.info(f"打卡失败")
-            return
+            return None
 
         # 设置适合开发板的分辨率
         cap.set(cv2.CAP_PROP_FRAME_WIDTH, 640)
@@ -132,83 +99,156 @@ def face_recognize(dist_threshold=0.5): # 人脸识别考勤功能
         ret, frame = cap.read()
         if not ret:
             print("拍照失败，请重试！")
-            logging.info(f"打卡失败")
-            return
+            return None
+        return frame
     except Exception as e:
         logging.error(f"摄像头异常: {str(e)}")
         print(f"摄像头异常: {str(e)}")
-        logging.info(f"打卡失败")
+        return None
+    finally:
+        # 确保资源释放
+        if cap is not None and cap.isOpened():
+            cap.release()
+
+# 人脸检测与特征提取后端：None 使用 dlib（CPU），否则为 face_backend.NativeBackend
+backend = None
+
+def set_backend(name): # "dlib" / "cpu" / "rknn"，加载失败时抛出异常并保持原后端
+    global backend
+    if name == "dlib":
+        backend = None
         return
+    backend = face_backend.NativeBackend(face_backend.BACKENDS[name])
+
+def detect_faces(frame): # 检测所有人脸，返回 dlib.rectangle 或 face_backend.FaceBox 列表
+    if backend is not None:
+        return backend.detect(frame)
+    return face_detector(frame, 1)
+
+def compute_face_feature(frame, face): # 提取一张人脸的128维特征
+    if backend is not None:
+        return backend.embed(frame, face)
+    face_shape = face_sp(frame, face)
+    face_descriptor = face_feature_model.compute_face_descriptor(frame, face_shape)
+    return np.asarray([x for x in face_descriptor], dtype=np.float32).reshape((1, -1))
+
+def match_face_feature(cur_face_feature, all_employee, all_employee_face_feature, matcher=None): # 返回 (最相似员工, 距离)
+    # matcher 为 face_match.NativeMatcher/NativeIndex 时使用 C++ 匹配库，否则用 numpy 线性扫描
+    if matcher is not None:
+        result = matcher.search(cur_face_feature, 1)
+        if not result:
+            return None, None
+        emp_id, emp_name, min_dist = result[0]
+        return Employee(emp_id, emp_name), min_dist
+
+    distances = np.linalg.norm((cur_face_feature - all_employee_face_feature), axis=1)
+    min_dist_index = np.argmin(distances)
+    return all_employee[min_dist_index], float(distances[min_dist_index])
+
+def save_attendance_photo(frame, face, employee, suffix=""): # 原地标注员工信息并提交后台保存，返回照片路径，之后不能再修改 frame
+    face_rect_color = (0, 255, 0)  # 边框颜色
+
+    # 人脸画框，标注员工信息
+    l, t, r, b = face.left(), face.top(), face.right(), face.bottom()
+    cv2.rectangle(frame, (l, t), (r, b), face_rect_color, 3)
+
+    # 标注员工信息
+    info_text = f"打卡成功\n姓名: {employee.name}\n工号: {employee.id}"
+    text_x = r + 20
+    text_y = t
+
+    # 添加标注背景
+    cv2.rectangle(frame,
+                 (text_x - 10, text_y - 10),
+                 (text_x + 250, text_y + 100),
+                 (245, 245, 245), -1)
+
+    # 文字标注颜色
+    cv2_put_cn_text(frame, info_text, (text_x, text_y), (255, 0, 0), 30)
+
+    # 保存识别照片，编码和写盘在后台完成
+    attendance_photo_dir = '/home/elf/face/data/attendance_photos/'
+    timestamp = datetime.now().strftime("%Y%m%d_%H%M%S")
+    photo_path = f"{attendance_photo_dir}{timestamp}{suffix}.jpg"
+    face_evidence.writer.submit(frame, photo_path)
+    return photo_path
 
+def recognize_frame(frame, all_employee, all_employee_face_feature, dist_threshold=0.5, matcher=None): # 识别一帧图像，返回结果字典
     # 检测人脸
-    dets = face_detector(frame, 1)
+    dets = detect_faces(frame)
     if len(dets) == 0:
-        print("未检测到人脸！")
-        logging.info(f"打卡失败")
-        cap.release()
-        return
+        return {"status": "no_face"}
 
     # 提取特征
     face = dets[0]
-    face_shape = face_sp(frame, face)
-    face_descriptor = face_feature_model.compute_face_descriptor(frame, face_shape)
-    cur_face_feature = np.asarray([x for x in face_descriptor], dtype=np.float64)
-    cur_face_feature = cur_face_feature.reshape((1, -1))
+    cur_face_feature = compute_face_feature(frame, face)
 
     # 计算距离
-    distances = np.linalg.norm((cur_face_feature - all_employee_face_feature), axis=1)
-    min_dist_index = np.argmin(distances)
-    min_dist = distances[min_dist_index]
+    employee, min_dist = match_face_feature(cur_face_feature, all_employee, all_employee_face_feature, matcher)
+    if employee is None:
+        return {"status": "unknown"}
 
-    # 识别结果
-    if min_dist < dist_threshold:
-        employee = all_employee[min_dist_index]
-        face_rect_color = (0, 255, 0)  # 边框颜色
-        
-        # 人脸画框，标注员工信息
-        l, t, r, b = face.left(), face.top(), face.right(), face.bottom()
-        cv2.rectangle(frame, (l, t), (r, b), face_rect_color, 3)
-        
-        # 标注员工信息
-        info_text = f"打卡成功\n姓名: {employee.name}\n工号: {employee.id}"
-        text_x = r + 20
-        text_y = t
-        
-        # 添加标注背景
-        cv2.rectangle(frame, 
-                     (text_x - 10, text_y - 10),
-                     (text_x + 250, text_y + 100),
-                     (245, 245, 245), -1)
-        
-        # 文字标注颜色
-        frame = cv2_put_cn_text(frame, info_text, (text_x, text_y), (255, 0, 0), 30)
+    if min_dist >= dist_threshold:
+        return {"status": "unknown", "distance": min_dist}
 
-        # 保存识别照片
-        timestamp = datetime.now().strftime("%Y%m%d_%H%M%S")
-        photo_path = f"{attendance_photo_dir}{timestamp}.jpg"
-        cv2.imwrite(photo_path, frame, [cv2.IMWRITE_JPEG_QUALITY, 95])
-        
-        # 记录日志
-        log_attendance(employee.name)
-        logging.info(f"{employee.name} 打卡成功")
-        
+    photo_path = save_attendance_photo(frame, face, employee)
+
+    # 记录考勤，与照片一起在后台写入
+    now = datetime.now().strftime("%Y-%m-%d %H:%M:%S")
+    face_evidence.writer.post(log_attendance_batch, [{"id": employee.id, "name": employee.name,
+                                                      "distance": min_dist, "time": now}])
+    logging.info(f"{employee.name} 打卡成功")
+
+    return {"status": "ok", "id": employee.id, "name": employee.name,
+            "distance": min_dist, "photo": photo_path}
+
+def face_recognize(dist_threshold=0.5): # 人脸识别考勤功能
+    if not check_required_files():
+        print("人脸识别运行失败，缺少必要文件！")
+        logging.info(f"打卡失败")
+        return
+
+    # 加载数据
+    try:
+        all_employee, all_employee_face_feature = load_employee_face_feature()
+        if not all_employee:
+            print("没有员工数据，请先进行人脸注册！")
+            logging.info(f"打卡失败")
+            return
+    except Exception as e:
+        logging.error(f"加载员工数据失败: {str(e)}")
+        print("加载员工数据失败！")
+        logging.info(f"打卡失败")
+        return
+
+    frame = capture_frame()
+    if frame is None:
+        logging.info(f"打卡失败")
+        return
+
+    result = recognize_frame(frame, all_employee, all_employee_face_feature, dist_threshold)
+
+    # 识别结果
+    if result["status"] == "no_face":
+        print("未检测到人脸！")
+        logging.info(f"打卡失败")
+    elif result["status"] == "ok":
         print(f"\n=== 识别成功 ===")
-        print(f"姓名: {employee.name}")
-        print(f"工号: {employee.id}")
+        print(f"姓名: {result['name']}")
+        print(f"工号: {result['id']}")
     else:
         print("\n=== 识别失败 ===")
 
-    # 确保资源释放
-    if 'cap' in locals() and cap.isOpened():
-        cap.release()
-
-def log_attendance(name): # 记录考勤日志
+def log_attendance(employee, distance=0.0): # 记录一次考勤
     now = datetime.now().strftime("%Y-%m-%d %H:%M:%S")
+    log_attendance_batch([{"id": employee.id, "name": employee.name, "distance": distance, "time": now}])
+
+def log_attendance_batch(records): # 批量写入考勤台账，records 为 [{"id", "name", "distance", "time"}, ...]
     try:
-        with open('/home/elf/face/data/attendance.log', 'a', newline="", encoding='utf-8') as f:
-            writer = csv.writer(f)
-            writer.writerow([now, name])
-            logging.info(f"考勤记录: {name} 于 {now}")
+        attendance_ledger.append([(datetime.strptime(r["time"], attendance_ledger.TIME_FORMAT).timestamp(),
+                                   str(r["id"]), r["name"], r["distance"]) for r in records])
+        for r in records:
+            logging.info(f"考勤记录: {r['name']} 于 {r['time']}")
     except Exception as e:
         logging.error(f"记录考勤失败: {str(e)}")
 
@@ -218,13 +258,6 @@ if __name__ == "__main__":
         if not os.path.exists('/home/elf/face/data'):
             os.makedirs('/home/elf/face/data')
         
-        # 保证日志存在
-        attendance_file = '/home/elf/face/data/attendance.log'
-        if not os.path.exists(attendance_file):
-            with open(attendance_file, 'w', newline='', encoding='utf-8') as f:
-                writer = csv.writer(f)
-                writer.writerow(['时间', '姓名'])
-        
         logging.info("程序启动，开始人脸识别")
         print("=== 人脸识别考勤 ===")
         
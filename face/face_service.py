@@ -0,0 +1,215 @@
+import argparse
+import json
+import logging
+import os
+import signal
+import socketserver
+import threading
+import time
+
+# 导入时即加载 dlib 检测器、关键点和 ResNet 模型，服务运行期间常驻内存
+import face_recognize as fr
+import attendance_ledger
+import face_match
+import face_stream
+
+# 常驻人脸识别服务
+# 监听 Unix 域套接字，每个请求为一行 JSON，返回一行 JSON:
+#   {"cmd": "recognize"}  -> {"status": "ok", "id": ..., "name": ..., "distance": ..., "photo": ..., "elapsed_ms": ...}
+#                            status 取值 ok / unknown / no_face / error
+#   {"cmd": "reload"}     -> 重新加载人脸库
+#   {"cmd": "ping"}       -> {"status": "ok"}
+#   {"cmd": "stream_start"} / {"cmd": "stream_stop"} -> {"status": "ok", "streaming": true/false}
+#                            开启连续考勤后，考勤记录按批次主动推送给发起连接:
+#                            {"event": "attendance", "records": [{"id", "name", "distance", "time", "photo"}, ...], "present": 今天已考勤人数}
+#   {"cmd": "present"}    -> {"status": "ok", "people": [{"id", "name", "time"}, ...]}  今天已考勤人员，最近的在前
+#   {"cmd": "history", "id": 工号或姓名, "limit": 50} -> {"status": "ok", "records": [{"id", "name", "distance", "time"}, ...]}
+#   {"cmd": "summary", "date": "YYYY-MM-DD"} -> {"status": "ok", "date": ..., "people": [{"id", "name", "first", "last", "count"}, ...]}
+
+SOCKET_PATH = "/tmp/elf_face.sock"
+GALLERY_PATH = fr.face_gallery.GALLERY_PATH
+DIST_THRESHOLD = 0.5
+
+class Gallery: # 人脸库缓存，gallery.bin 修改后自动重新加载
+    def __init__(self):
+        self.mtime = None
+        self.employees = []
+        self.features = None
+        self.matcher = None     # C++ 匹配库可用时使用
+        self.use_index = False  # 使用 HNSW 近似检索，默认精确检索
+        self.lock = threading.RLock()   # 请求处理与连续考勤线程共用
+
+    def get(self, force=False):
+        with self.lock:
+            return self._get(force)
+
+    def match(self, feature): # 返回 (最相似员工, 距离)，匹配期间人脸库不会被替换
+        with self.lock:
+            employees, features = self._get()
+            return fr.match_face_feature(feature, employees, features, self.matcher)
+
+    def _get(self, force=False):
+        mtime = os.stat(GALLERY_PATH).st_mtime_ns if os.path.exists(GALLERY_PATH) else None
+        if force or mtime is None or mtime != self.mtime:
+            self.employees, self.features = fr.load_employee_face_feature()
+            self.mtime = os.stat(GALLERY_PATH).st_mtime_ns
+            if self.use_index and isinstance(self.matcher, face_match.NativeIndex):
+                self.matcher.sync()    # 只插入新注册的特征
+            elif face_match.available():
+                if self.matcher is not None:
+                    self.matcher.close()
+                if self.use_index:
+                    self.matcher = face_match.NativeIndex(GALLERY_PATH)
+                else:
+                    self.matcher = face_match.NativeMatcher(GALLERY_PATH)
+        return self.employees, self.features
+
+gallery = Gallery()
+ledger = attendance_ledger.AttendanceLedger()   # 考勤查询，只读取新增记录
+
+subscribers = []                # 接收连续考勤推送的连接
+write_lock = threading.Lock()   # 回复与推送共用同一连接，写入需互斥
+
+def send_line(wfile, obj):
+    with write_lock:
+        wfile.write((json.dumps(obj, ensure_ascii=False) + "\n").encode("utf-8"))
+        wfile.flush()
+
+def publish_attendance(records): # 连续考勤批量推送，记录已写入台账
+    event = {"event": "attendance", "records": records, "present": len(ledger.present())}
+    for wfile in list(subscribers):
+        try:
+            send_line(wfile, event)
+        except OSError:
+            subscribers.remove(wfile)
+
+stream = face_stream.AttendanceStream(gallery, publish_attendance, DIST_THRESHOLD)
+
+def handle_request(req, wfile):
+    cmd = req.get("cmd")
+    if cmd == "ping":
+        return {"status": "ok"}
+
+    if cmd == "reload":
+        employees, _ = gallery.get(force=True)
+        return {"status": "ok", "count": len(employees)}
+
+    if cmd == "recognize":
+        start = time.monotonic()
+        # 连续考勤期间摄像头已被占用，直接使用最近一帧
+        frame = stream.latest_frame() if stream.running() else fr.capture_frame()
+        if frame is None:
+            return {"status": "error", "message": "拍照失败"}
+        with gallery.lock:
+            employees, features = gallery.get()
+            result = fr.recognize_frame(frame, employees, features, DIST_THRESHOLD, gallery.matcher)
+        result["elapsed_ms"] = int((time.monotonic() - start) * 1000)
+        return result
+
+    if cmd == "present":
+        people = ledger.present()
+        return {"status": "ok", "people": [{"id": r.id, "name": r.name,
+                                            "time": attendance_ledger.format_time(r.timestamp)} for r in people]}
+
+    if cmd == "history":
+        records = ledger.history(str(req.get("id", "")), int(req.get("limit", 50)))
+        return {"status": "ok", "records": [{"id": r.id, "name": r.name, "distance": r.distance,
+                                             "time": attendance_ledger.format_time(r.timestamp)} for r in records]}
+
+    if cmd == "summary":
+        day = attendance_ledger.parse_day(req["date"]) if req.get("date") else attendance_ledger.day_of(time.time())
+        people = ledger.summary(day)
+        for p in people:
+            p["first"] = attendance_ledger.format_time(p["first"])
+            p["last"] = attendance_ledger.format_time(p["last"])
+        return {"status": "ok", "date": attendance_ledger.format_day(day), "people": people}
+
+    if cmd == "stream_start":
+        gallery.get()   # 人脸库加载失败时直接返回错误
+        if not stream.start():
+            return {"status": "error", "message": "连续考勤无法打开摄像头"}
+        if wfile not in subscribers:
+            subscribers.append(wfile)
+        return {"status": "ok", "streaming": True}
+
+    if cmd == "stream_stop":
+        stream.stop()
+        return {"status": "ok", "streaming": False}
+
+    return {"status": "error", "message": f"未知命令: {cmd}"}
+
+class RequestHandler(socketserver.StreamRequestHandler):
+    def handle(self):
+        try:
+            for line in self.rfile:
+                try:
+                    reply = handle_request(json.loads(line), self.wfile)
+                except Exception as e:
+                    logging.error(f"请求处理失败: {str(e)}")
+                    reply = {"status": "error", "message": str(e)}
+                send_line(self.wfile, reply)
+        finally:
+            # 发起连续考勤的连接断开后停止推送，没有订阅者时停止采集
+            if self.wfile in subscribers:
+                subscribers.remove(self.wfile)
+                if not subscribers:
+                    stream.stop()
+
+def main():
+    parser = argparse.ArgumentParser(description='人脸识别服务')
+    parser.add_argument('--ann', action='store_true', help='使用HNSW近似最近邻索引（员工较多时）')
+    parser.add_argument('--backend', choices=['dlib', 'cpu', 'rknn'], default='dlib',
+                        help='人脸检测与特征提取后端，rknn 使用NPU，cpu 为参考实现')
+    args = parser.parse_args()
+    gallery.use_index = args.ann and face_match.available()
+
+    try:
+        fr.set_backend(args.backend)
+        logging.info(f"人脸后端: {args.backend}")
+    except Exception as e:
+        logging.error(f"人脸后端 {args.backend} 加载失败，使用 dlib: {str(e)}")
+
+    if not fr.check_required_files():
+        print("人脸识别服务启动失败，缺少必要文件！")
+        return
+
+    # 启动时预加载人脸库
+    try:
+        gallery.get()
+    except Exception as e:
+        logging.error(f"加载员工数据失败: {str(e)}")
+        print("加载员工数据失败，将在首次识别时重试")
+
+    # 首次运行时由旧版 attendance.log 生成考勤台账，并预先扫描建立每人最近考勤
+    try:
+        attendance_ledger.ensure()
+        ledger.refresh()
+    except Exception as e:
+        logging.error(f"加载考勤台账失败: {str(e)}")
+
+    if os.path.exists(SOCKET_PATH):
+        os.unlink(SOCKET_PATH)  # 清理残留的套接字文件
+
+    # 请求串行处理，摄像头同一时刻只被一个请求使用
+    server = socketserver.UnixStreamServer(SOCKET_PATH, RequestHandler)
+    os.chmod(SOCKET_PATH, 0o666)
+
+    def on_signal(sig, frame):
+        raise KeyboardInterrupt
+    signal.signal(signal.SIGTERM, on_signal)
+
+    logging.info("人脸识别服务已启动")
+    print("人脸识别服务已启动", flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        stream.stop()
+        server.server_close()
+        if os.path.exists(SOCKET_PATH):
+            os.unlink(SOCKET_PATH)
+        logging.info("人脸识别服务已退出")
+
+if __name__ == "__main__":
+    main()
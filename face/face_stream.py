@@ -0,0 +1,203 @@
+import logging
+import threading
+import time
+from datetime import datetime
+
+import cv2
+
+import face_evidence
+import face_recognize as fr
+
+# 连续考勤：持续采集，检测每帧中的所有人脸并按IoU跟踪，
+# 只对新出现或位置明显变化的目标提取特征，同一员工在冷却时间内只记录一次，
+# 考勤记录按批次交给后台写入台账并回调通知
+
+CAMERA_DEVICE = '/dev/video11'
+PROCESS_INTERVAL_S = 0.2        # 两次检测的最小间隔
+TRACK_IOU_THRESH = 0.3          # 跟踪匹配的最小IoU
+TRACK_MAX_MISSED = 10           # 目标连续丢失多少帧后删除
+TRACK_CHANGED_IOU = 0.5         # 与上次提取特征时的人脸框IoU低于该值视为变化，重新提取
+TRACK_RETRY_S = 1.0             # 未识别目标重新提取特征的间隔
+ATTENDANCE_COOLDOWN_S = 300     # 同一员工两次考勤记录的最小间隔
+BATCH_INTERVAL_S = 2.0          # 考勤记录批量提交间隔
+BATCH_MAX = 16                  # 单批最多记录数，达到后立即提交
+
+def rect_iou(a, b):
+    left = max(a.left(), b.left())
+    top = max(a.top(), b.top())
+    right = min(a.right(), b.right())
+    bottom = min(a.bottom(), b.bottom())
+    if right <= left or bottom <= top:
+        return 0.0
+    inter = (right - left) * (bottom - top)
+    return inter / float(a.area() + b.area() - inter)
+
+class Track: # 跟踪目标
+    def __init__(self, track_id, rect):
+        self.id = track_id
+        self.rect = rect
+        self.missed = 0
+        self.embed_rect = None      # 上次提取特征时的人脸框
+        self.embed_time = 0.0
+        self.employee = None        # 识别出的员工，None 表示未识别
+
+    def needs_embedding(self, now):
+        if self.embed_rect is None:
+            return True     # 新目标
+        if rect_iou(self.rect, self.embed_rect) < TRACK_CHANGED_IOU:
+            return True     # 位置或大小明显变化，可能换人
+        return self.employee is None and now - self.embed_time >= TRACK_RETRY_S
+
+class AttendanceStream:
+    def __init__(self, gallery, on_batch, dist_threshold=0.5):
+        self.gallery = gallery          # face_service.Gallery
+        self.on_batch = on_batch        # 回调 on_batch(records)，写入台账后在后台写入线程中调用
+        self.dist_threshold = dist_threshold
+        self.thread = None
+        self.stop_event = threading.Event()
+        self.opened_event = threading.Event()  # 摄像头打开成功或失败后置位
+        self.opened = False
+        self.frame_lock = threading.Lock()
+        self.latest = None
+        self.tracks = []
+        self.next_track_id = 1
+        self.last_record = {}           # 员工ID -> 上次记录时刻（单调时钟）
+        self.pending = []
+        self.last_flush = 0.0
+
+    def running(self):
+        return self.thread is not None and self.thread.is_alive()
+
+    def start(self): # 等到摄像头打开后返回，打开失败返回False
+        if self.running():
+            return True
+        self.stop_event.clear()
+        self.opened_event.clear()
+        self.opened = False
+        self.thread = threading.Thread(target=self._run, daemon=True)
+        self.thread.start()
+        self.opened_event.wait()
+        if not self.opened:
+            self.stop()
+        return self.opened
+
+    def stop(self):
+        if self.thread is not None:
+            self.stop_event.set()
+            self.thread.join()
+            self.thread = None
+
+    def latest_frame(self): # 最近一帧的副本，连续考勤期间单次识别直接使用，不再打开摄像头
+        with self.frame_lock:
+            return None if self.latest is None else self.latest.copy()
+
+    def _run(self):
+        try:
+            cap = fr.camera_ring.VideoCapture(CAMERA_DEVICE)  # 与动作识别共用摄像头
+            self.opened = cap.isOpened()
+        finally:
+            self.opened_event.set()
+        if not self.opened:
+            logging.error("连续考勤无法打开摄像头")
+            return
+        cap.set(cv2.CAP_PROP_FRAME_WIDTH, 640)
+        cap.set(cv2.CAP_PROP_FRAME_HEIGHT, 480)
+
+        logging.info("连续考勤已开启")
+        self.tracks = []
+        last_process = 0.0
+        try:
+            while not self.stop_event.is_set():
+                ret, frame = cap.read()
+                if not ret:
+                    logging.error("连续考勤获取图像失败")
+                    break
+                with self.frame_lock:
+                    self.latest = frame
+
+                now = time.monotonic()
+                if now - last_process < PROCESS_INTERVAL_S:
+                    continue
+                last_process = now
+
+                try:
+                    self._process(frame, now)
+                except Exception as e:
+                    logging.error(f"连续考勤处理失败: {str(e)}")
+
+                if self.pending and (len(self.pending) >= BATCH_MAX or now - self.last_flush >= BATCH_INTERVAL_S):
+                    self._flush(now)
+        finally:
+            if self.pending:
+                self._flush(time.monotonic())
+            cap.release()
+            with self.frame_lock:
+                self.latest = None
+            logging.info("连续考勤已关闭")
+
+    def _update_tracks(self, dets): # 按IoU贪心匹配，返回与 dets 一一对应的跟踪目标
+        assigned = []
+        matched = set()
+        for rect in dets:
+            best, best_iou = None, TRACK_IOU_THRESH
+            for track in self.tracks:
+                if track.id in matched:
+                    continue
+                iou = rect_iou(rect, track.rect)
+                if iou >= best_iou:
+                    best, best_iou = track, iou
+            if best is None:
+                best = Track(self.next_track_id, rect)
+                self.next_track_id += 1
+                self.tracks.append(best)
+            else:
+                best.rect = rect
+                best.missed = 0
+            matched.add(best.id)
+            assigned.append(best)
+
+        for track in self.tracks:
+            if track.id not in matched:
+                track.missed += 1
+        self.tracks = [t for t in self.tracks if t.missed <= TRACK_MAX_MISSED]
+        return assigned
+
+    def _process(self, frame, now):
+        dets = fr.detect_faces(frame)
+        tracks = self._update_tracks(dets)
+
+        for face, track in zip(dets, tracks):
+            if not track.needs_embedding(now):
+                continue
+
+            track.embed_rect = face
+            track.embed_time = now
+            feature = fr.compute_face_feature(frame, face)
+            employee, dist = self.gallery.match(feature)
+            track.employee = employee if employee is not None and dist < self.dist_threshold else None
+            if track.employee is None:
+                continue
+
+            # 同一员工冷却时间内只记录一次
+            last = self.last_record.get(employee.id)
+            if last is not None and now - last < ATTENDANCE_COOLDOWN_S:
+                continue
+            self.last_record[employee.id] = now
+
+            photo = fr.save_attendance_photo(frame.copy(), face, employee, f"_{employee.id}")
+            self.pending.append({"id": employee.id, "name": employee.name, "distance": dist,
+                                 "time": datetime.now().strftime("%Y-%m-%d %H:%M:%S"),
+                                 "photo": photo})
+
+    def _flush(self, now):
+        records, self.pending = self.pending, []
+        self.last_flush = now
+        # 台账写入和通知在后台按提交顺序完成，不阻塞采集，通知时台账已包含本批记录
+        face_evidence.writer.post(self._commit, records)
+
+    def _commit(self, records):
+        fr.log_attendance_batch(records)
+        try:
+            self.on_batch(records)
+        except Exception as e:
+            logging.error(f"考勤记录通知失败: {str(e)}")
@@ -0,0 +1,364 @@
+/**
+ * @file camera_ring.c
+ * @brief 摄像头共享内存环形缓冲实现
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include "camera_ring.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define CAMERA_RING_PAGE    4096
+
+/*****************************************************************************/
+/* 局部函数                                                                  */
+/*****************************************************************************/
+static size_t camera_ring_align(size_t n)
+{
+    return (n + CAMERA_RING_PAGE - 1) / CAMERA_RING_PAGE * CAMERA_RING_PAGE;
+}
+
+static uint64_t camera_ring_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* 进程间 futex，不能使用 FUTEX_PRIVATE_FLAG */
+static void camera_ring_futex_wait(uint32_t *addr, uint32_t val, int timeout_ms)
+{
+    struct timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, timeout_ms < 0 ? NULL : &ts, NULL, 0);
+}
+
+static void camera_ring_futex_wake(uint32_t *addr)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static int camera_ring_map(struct camera_ring_t *ring, size_t size, int prot)
+{
+    void *addr = mmap(NULL, size, prot, MAP_SHARED, ring->fd, 0);
+    if(addr == MAP_FAILED)
+    {
+        return -1;
+    }
+    ring->size = size;
+    ring->header = (struct camera_ring_header_t *)addr;
+    ring->base = (uint8_t *)addr;
+    return 0;
+}
+
+/* 本进程持有次数加减，与生产者的写入标记之间需要顺序一致 */
+static void camera_ring_hold(struct camera_ring_t *ring, uint32_t slot, int delta)
+{
+    struct camera_consumer_t *c = &ring->header->consumers[ring->consumer];
+    __atomic_add_fetch(&c->held[slot], (uint8_t)delta, __ATOMIC_SEQ_CST);
+}
+
+/* 槽位是否无人持有，空闲登记项的持有次数均为0 */
+static int camera_ring_unheld(struct camera_ring_header_t *h, uint32_t slot)
+{
+    int i;
+
+    for(i = 0; i < CAMERA_RING_MAX_CONSUMERS; i++)
+    {
+        if(__atomic_load_n(&h->consumers[i].held[slot], __ATOMIC_SEQ_CST) != 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* 清空登记项并注销，由消费者自己关闭或生产者回收时调用 */
+static void camera_ring_unregister(struct camera_consumer_t *c)
+{
+    uint32_t s;
+
+    for(s = 0; s < CAMERA_RING_SLOTS; s++)
+    {
+        __atomic_store_n(&c->held[s], 0, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&c->pid, 0, __ATOMIC_RELEASE);
+}
+
+/*****************************************************************************/
+/* 函数定义                                                                  */
+/*****************************************************************************/
+int camera_ring_create(struct camera_ring_t *ring, uint32_t width, uint32_t height)
+{
+    struct camera_ring_header_t *h;
+    uint32_t stride = width * 3;
+    uint32_t frame_size = stride * height;
+    size_t header_size = camera_ring_align(sizeof(struct camera_ring_header_t));
+    size_t size = header_size + camera_ring_align(frame_size) * CAMERA_RING_SLOTS;
+    uint32_t i;
+
+    memset(ring, 0, sizeof(*ring));
+    ring->consumer = -1;
+
+    shm_unlink(CAMERA_RING_SHM_NAME);   //旧消费者仍映射旧对象，检测到生产者退出后重新打开
+    ring->fd = shm_open(CAMERA_RING_SHM_NAME, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+    if(ring->fd < 0)
+    {
+        return -1;
+    }
+    fchmod(ring->fd, 0666);     //不受 umask 影响，其他用户的消费者也可打开
+
+    if(ftruncate(ring->fd, size) < 0 || camera_ring_map(ring, size, PROT_READ | PROT_WRITE) < 0)
+    {
+        close(ring->fd);
+        shm_unlink(CAMERA_RING_SHM_NAME);
+        return -1;
+    }
+
+    h = ring->header;
+    memset(h, 0, sizeof(*h));
+    h->version = CAMERA_RING_VERSION;
+    h->width = width;
+    h->height = height;
+    h->stride = stride;
+    h->format = CAMERA_FORMAT_BGR24;
+    h->slot_count = CAMERA_RING_SLOTS;
+    h->frame_size = frame_size;
+    h->producer_pid = getpid();
+    for(i = 0; i < CAMERA_RING_SLOTS; i++)
+    {
+        h->slots[i].offset = header_size + camera_ring_align(frame_size) * i;
+    }
+    __atomic_store_n(&h->magic, CAMERA_RING_MAGIC, __ATOMIC_RELEASE);  //最后写入，消费者据此判断初始化完成
+    return 0;
+}
+
+void camera_ring_destroy(struct camera_ring_t *ring)
+{
+    if(!ring->header)
+    {
+        return;
+    }
+
+    ring->header->producer_pid = 0;
+    camera_ring_futex_wake(&ring->header->futex);   //唤醒等待中的消费者，使其发现生产者已退出
+    munmap(ring->base, ring->size);
+    close(ring->fd);
+    shm_unlink(CAMERA_RING_SHM_NAME);
+    ring->header = NULL;
+}
+
+uint8_t *camera_ring_begin_write(struct camera_ring_t *ring, uint32_t *slot)
+{
+    struct camera_ring_header_t *h = ring->header;
+    uint64_t latest = __atomic_load_n(&h->latest, __ATOMIC_ACQUIRE);
+    uint32_t i;
+
+    for(i = 0; i < CAMERA_RING_SLOTS; i++)
+    {
+        uint32_t s = (ring->next_slot + i) % CAMERA_RING_SLOTS;
+
+        if(latest != 0 && s == (latest & 0xFF))
+        {
+            continue;   //最新帧保留给随后到来的消费者
+        }
+
+        //只有无人持有时才能写入：先标记写入再确认，之后登记的消费者会看到标记而放弃
+        if(!camera_ring_unheld(h, s))
+        {
+            continue;
+        }
+        __atomic_store_n(&h->slots[s].writing, 1, __ATOMIC_SEQ_CST);
+        if(camera_ring_unheld(h, s))
+        {
+            ring->next_slot = (s + 1) % CAMERA_RING_SLOTS;
+            *slot = s;
+            return ring->base + h->slots[s].offset;
+        }
+        __atomic_store_n(&h->slots[s].writing, 0, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+void camera_ring_commit(struct camera_ring_t *ring, uint32_t slot, uint64_t timestamp_ns)
+{
+    struct camera_ring_header_t *h = ring->header;
+    struct camera_slot_t *s = &h->slots[slot];
+
+    ring->seq++;
+    s->timestamp_ns = timestamp_ns;
+    __atomic_store_n(&s->seq, ring->seq, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&s->writing, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&h->latest, (ring->seq << 8) | slot, __ATOMIC_RELEASE);
+
+    __atomic_add_fetch(&h->futex, 1, __ATOMIC_RELEASE);
+    camera_ring_futex_wake(&h->futex);
+}
+
+void camera_ring_abort(struct camera_ring_t *ring, uint32_t slot)
+{
+    __atomic_store_n(&ring->header->slots[slot].writing, 0, __ATOMIC_RELEASE);
+}
+
+void camera_ring_reap(struct camera_ring_t *ring)
+{
+    struct camera_ring_header_t *h = ring->header;
+    int i;
+
+    for(i = 0; i < CAMERA_RING_MAX_CONSUMERS; i++)
+    {
+        struct camera_consumer_t *c = &h->consumers[i];
+        int32_t pid = __atomic_load_n(&c->pid, __ATOMIC_ACQUIRE);
+
+        if(pid == 0 || kill(pid, 0) == 0 || errno != ESRCH)
+        {
+            continue;
+        }
+        camera_ring_unregister(c);
+    }
+}
+
+int camera_ring_open(struct camera_ring_t *ring)
+{
+    struct camera_ring_header_t *h;
+    struct stat st;
+    int32_t pid = getpid();
+    int i;
+
+    memset(ring, 0, sizeof(*ring));
+    ring->consumer = -1;
+
+    ring->fd = shm_open(CAMERA_RING_SHM_NAME, O_RDWR | O_CLOEXEC, 0);
+    if(ring->fd < 0)
+    {
+        return -1;
+    }
+
+    //消费者需要修改引用计数，因此以读写方式映射
+    if(fstat(ring->fd, &st) < 0 || (size_t)st.st_size < sizeof(struct camera_ring_header_t) ||
+       camera_ring_map(ring, st.st_size, PROT_READ | PROT_WRITE) < 0)
+    {
+        close(ring->fd);
+        return -1;
+    }
+
+    h = ring->header;
+    if(__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != CAMERA_RING_MAGIC || h->version != CAMERA_RING_VERSION ||
+       !camera_ring_producer_alive(ring))
+    {
+        munmap(ring->base, ring->size);
+        close(ring->fd);
+        ring->header = NULL;
+        return -1;
+    }
+
+    for(i = 0; i < CAMERA_RING_MAX_CONSUMERS; i++)
+    {
+        int32_t expected = 0;
+        if(__atomic_compare_exchange_n(&h->consumers[i].pid, &expected, pid, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        {
+            memset(h->consumers[i].held, 0, sizeof(h->consumers[i].held));
+            ring->consumer = i;
+            return 0;
+        }
+    }
+
+    munmap(ring->base, ring->size);
+    close(ring->fd);
+    ring->header = NULL;
+    return -1;
+}
+
+void camera_ring_close(struct camera_ring_t *ring)
+{
+    struct camera_ring_header_t *h = ring->header;
+
+    if(!h)
+    {
+        return;
+    }
+
+    if(ring->consumer >= 0)
+    {
+        camera_ring_unregister(&h->consumers[ring->consumer]);
+    }
+
+    munmap(ring->base, ring->size);
+    close(ring->fd);
+    ring->header = NULL;
+}
+
+int camera_ring_acquire(struct camera_ring_t *ring, uint64_t after_seq, int timeout_ms, struct camera_frame_t *frame)
+{
+    struct camera_ring_header_t *h = ring->header;
+    uint64_t deadline = camera_ring_now_ms() + (timeout_ms < 0 ? 0 : timeout_ms);
+
+    while(1)
+    {
+        uint32_t futex = __atomic_load_n(&h->futex, __ATOMIC_ACQUIRE);
+        uint64_t latest = __atomic_load_n(&h->latest, __ATOMIC_ACQUIRE);
+        uint64_t seq = latest >> 8;
+        uint32_t slot = latest & 0xFF;
+
+        if(latest != 0 && seq > after_seq)
+        {
+            struct camera_slot_t *s = &h->slots[slot];
+
+            //先登记持有再确认槽位未在写入且仍是这一帧，此后生产者不会再覆盖
+            camera_ring_hold(ring, slot, 1);
+            if(!__atomic_load_n(&s->writing, __ATOMIC_SEQ_CST) && __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) == seq)
+            {
+                frame->data = ring->base + s->offset;
+                frame->width = h->width;
+                frame->height = h->height;
+                frame->stride = h->stride;
+                frame->slot = slot;
+                frame->seq = seq;
+                frame->timestamp_ns = s->timestamp_ns;
+                return 0;
+            }
+            camera_ring_hold(ring, slot, -1);
+            continue;   //槽位正在或已被改写，重新读取最新帧
+        }
+
+        if(!camera_ring_producer_alive(ring))
+        {
+            return -1;
+        }
+
+        int remain = (int)(deadline - camera_ring_now_ms());
+        if(timeout_ms >= 0 && remain <= 0)
+        {
+            return -1;
+        }
+        camera_ring_futex_wait(&h->futex, futex, timeout_ms < 0 ? -1 : remain);
+    }
+}
+
+void camera_ring_release(struct camera_ring_t *ring, const struct camera_frame_t *frame)
+{
+    camera_ring_hold(ring, frame->slot, -1);
+}
+
+int camera_ring_producer_alive(const struct camera_ring_t *ring)
+{
+    int32_t pid = __atomic_load_n(&ring->header->producer_pid, __ATOMIC_ACQUIRE);
+    return pid != 0 && (kill(pid, 0) == 0 || errno != ESRCH);
+}
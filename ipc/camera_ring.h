@@ -0,0 +1,157 @@
+/**
+ * @file camera_ring.h
+ * @brief 摄像头共享内存环形缓冲：采集进程 camera_broker 独占 V4L2 设备，将 BGR 帧发布到环形缓冲，
+ *        动作识别、人脸识别、预览等多个消费者按各自帧率零拷贝读取同一帧
+ *
+ * 消费者在头部登记进程号和各槽位的持有次数，所有消费者的持有次数之和即槽位的引用计数：
+ * 消费者先登记持有再确认槽位未在写入，生产者先标记写入再确认无人持有，双方至少一方能看到对方，
+ * 生产者只覆盖无人持有且不是最新帧的槽位，因此消费者持有期间帧内容不会被改写。
+ * 持有只记在登记项中，消费者异常退出后生产者清除其登记项即可回收，不存在已加引用但未登记的窗口。
+ * 新帧到达时生产者通过 futex 唤醒等待的消费者。
+ */
+
+#ifndef __CAMERA_RING_H__
+#define __CAMERA_RING_H__
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define CAMERA_RING_SHM_NAME        "/elf_camera"   //共享内存名称，对应 /dev/shm/elf_camera
+#define CAMERA_RING_MAGIC           0x4D414345      //"ECAM"
+#define CAMERA_RING_VERSION         2
+#define CAMERA_RING_SLOTS           8               //槽位数，最多同时被持有 SLOTS-2 帧
+#define CAMERA_RING_MAX_CONSUMERS   16              //最多同时打开的消费者
+
+#define CAMERA_FORMAT_BGR24         0               //帧格式，与 OpenCV 默认一致
+
+/*****************************************************************************/
+/* 类型定义                                                                  */
+/*****************************************************************************/
+/* 槽位，32字节 */
+struct camera_slot_t
+{
+    uint64_t seq;               //帧序号，从1开始，0 表示空
+    uint64_t timestamp_ns;      //采集时刻（CLOCK_MONOTONIC）
+    int32_t writing;            //生产者写入期间为1
+    uint32_t reserved;
+    uint64_t offset;            //帧数据相对共享内存起始的偏移
+};
+
+/* 消费者登记项 */
+struct camera_consumer_t
+{
+    int32_t pid;                        //0 表示空闲
+    uint8_t held[CAMERA_RING_SLOTS];    //各槽位的持有次数
+    uint32_t reserved;
+};
+
+/* 共享内存头部，帧数据按页对齐紧随其后 */
+struct camera_ring_header_t
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;                    //每行字节数
+    uint32_t format;                    //CAMERA_FORMAT_*
+    uint32_t slot_count;
+    uint32_t frame_size;
+    uint64_t latest;                    //最新帧 (seq << 8) | slot，0 表示尚无帧
+    uint32_t futex;                     //每发布一帧加1，消费者在此等待
+    int32_t producer_pid;
+    struct camera_slot_t slots[CAMERA_RING_SLOTS];
+    struct camera_consumer_t consumers[CAMERA_RING_MAX_CONSUMERS];
+};
+
+/* 已映射的环形缓冲 */
+struct camera_ring_t
+{
+    int fd;
+    size_t size;
+    struct camera_ring_header_t *header;
+    uint8_t *base;
+    int consumer;                       //消费者登记项下标，生产者为 -1
+    uint32_t next_slot;                 //生产者下次尝试写入的槽位
+    uint64_t seq;                       //生产者已发布的帧序号
+};
+
+/* 消费者取得的帧，release 之前 data 有效 */
+struct camera_frame_t
+{
+    const uint8_t *data;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    uint32_t slot;
+    uint64_t seq;
+    uint64_t timestamp_ns;
+};
+
+/*****************************************************************************/
+/* 函数声明                                                                  */
+/*****************************************************************************/
+/**
+ * 生产者创建环形缓冲，已存在时先删除（旧消费者检测到生产者退出后重新打开）
+ * @retval  0 - 成功
+ * @retval -1 - 失败
+ */
+int camera_ring_create(struct camera_ring_t *ring, uint32_t width, uint32_t height);
+
+/* 生产者删除环形缓冲 */
+void camera_ring_destroy(struct camera_ring_t *ring);
+
+/**
+ * 生产者取得一个可写槽位
+ * @retval 帧缓冲地址，所有槽位都被持有时返回 NULL（丢弃本帧）
+ */
+uint8_t *camera_ring_begin_write(struct camera_ring_t *ring, uint32_t *slot);
+
+/* 生产者写完后发布该帧并唤醒消费者 */
+void camera_ring_commit(struct camera_ring_t *ring, uint32_t slot, uint64_t timestamp_ns);
+
+/* 生产者放弃写入，槽位保持原内容 */
+void camera_ring_abort(struct camera_ring_t *ring, uint32_t slot);
+
+/* 回收已退出消费者持有的引用，生产者定期调用 */
+void camera_ring_reap(struct camera_ring_t *ring);
+
+/**
+ * 消费者打开环形缓冲并登记
+ * @retval  0 - 成功
+ * @retval -1 - 采集进程未运行或登记项已满
+ */
+int camera_ring_open(struct camera_ring_t *ring);
+
+/* 消费者释放所有持有的帧并注销 */
+void camera_ring_close(struct camera_ring_t *ring);
+
+/**
+ * 消费者取得序号大于 after_seq 的最新帧，没有时等待
+ * @param timeout_ms 等待时间，<0 一直等待
+ * @retval  0 - 成功，frame 在 camera_ring_release 之前有效
+ * @retval -1 - 超时
+ */
+int camera_ring_acquire(struct camera_ring_t *ring, uint64_t after_seq, int timeout_ms, struct camera_frame_t *frame);
+
+/* 消费者释放帧 */
+void camera_ring_release(struct camera_ring_t *ring, const struct camera_frame_t *frame);
+
+/* 采集进程是否仍在运行，否则应关闭后重新打开 */
+int camera_ring_producer_alive(const struct camera_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
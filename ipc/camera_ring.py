@@ -0,0 +1,156 @@
+# 摄像头共享内存环形缓冲 Python 端，通过 ctypes 调用 libcamera_ring.so，接口见 camera_ring.h
+# 编译: cmake -S /home/elf/camera -B /home/elf/camera/build && cmake --build /home/elf/camera/build
+import ctypes
+import os
+
+import numpy as np
+
+LIB_PATHS = [
+    "/home/elf/camera/build/libcamera_ring.so",
+    os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "camera", "build", "libcamera_ring.so"),
+]
+
+ACQUIRE_TIMEOUT_MS = 1000
+CAMERA_RING_SLOTS = 8
+CAMERA_RING_MAX_CONSUMERS = 16
+
+
+class _Ring(ctypes.Structure):
+    _fields_ = [("fd", ctypes.c_int),
+                ("size", ctypes.c_size_t),
+                ("header", ctypes.c_void_p),
+                ("base", ctypes.c_void_p),
+                ("consumer", ctypes.c_int),
+                ("next_slot", ctypes.c_uint32),
+                ("seq", ctypes.c_uint64)]
+
+
+class _Frame(ctypes.Structure):
+    _fields_ = [("data", ctypes.POINTER(ctypes.c_uint8)),
+                ("width", ctypes.c_uint32),
+                ("height", ctypes.c_uint32),
+                ("stride", ctypes.c_uint32),
+                ("slot", ctypes.c_uint32),
+                ("seq", ctypes.c_uint64),
+                ("timestamp_ns", ctypes.c_uint64)]
+
+
+_lib = None
+
+
+def _load_library():  # 加载共享库，不存在返回None
+    global _lib
+    if _lib is not None:
+        return _lib
+    for path in LIB_PATHS:
+        if os.path.exists(path):
+            lib = ctypes.CDLL(path)
+            lib.camera_ring_open.argtypes = [ctypes.POINTER(_Ring)]
+            lib.camera_ring_close.argtypes = [ctypes.POINTER(_Ring)]
+            lib.camera_ring_acquire.argtypes = [ctypes.POINTER(_Ring), ctypes.c_uint64, ctypes.c_int,
+                                                ctypes.POINTER(_Frame)]
+            lib.camera_ring_release.argtypes = [ctypes.POINTER(_Ring), ctypes.POINTER(_Frame)]
+            lib.camera_ring_producer_alive.argtypes = [ctypes.POINTER(_Ring)]
+            _lib = lib
+            break
+    return _lib
+
+
+class Frame:
+    """共享内存中的一帧，image 为只读视图，release 之后不可再访问"""
+
+    def __init__(self, ring, frame):
+        self.ring = ring
+        self.frame = frame
+        self.seq = frame.seq
+        self.timestamp_ns = frame.timestamp_ns
+        rows = np.ctypeslib.as_array(frame.data, shape=(frame.height, frame.stride))
+        self.image = rows[:, :frame.width * 3].reshape((frame.height, frame.width, 3))
+        self.image.flags.writeable = False  # 其他消费者共享同一块内存，需要修改时先 copy()
+
+    def release(self):
+        if self.ring is not None:
+            self.image = None
+            self.ring._release(self.frame)
+            self.ring = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.release()
+
+
+class CameraRing:
+    """零拷贝消费者：with ring.acquire() as frame: 处理 frame.image"""
+
+    def __init__(self):
+        self.lib = _load_library()
+        self.ring = _Ring()
+        self.opened = False
+        self.last_seq = 0
+
+    def open(self):
+        if self.lib is None:
+            return False
+        if not self.opened:
+            self.opened = self.lib.camera_ring_open(ctypes.byref(self.ring)) == 0
+            if self.opened:
+                self.last_seq = 0  # 重启后的采集进程从头编号，沿用旧序号会一直等不到新帧
+        return self.opened
+
+    def close(self):
+        if self.opened:
+            self.lib.camera_ring_close(ctypes.byref(self.ring))
+            self.opened = False
+
+    def acquire(self, timeout_ms=ACQUIRE_TIMEOUT_MS):  # 取得比上次更新的一帧，失败返回None
+        if not self.open():
+            return None
+        frame = _Frame()
+        if self.lib.camera_ring_acquire(ctypes.byref(self.ring), self.last_seq, timeout_ms, ctypes.byref(frame)) < 0:
+            if not self.lib.camera_ring_producer_alive(ctypes.byref(self.ring)):
+                self.close()  # 采集进程已重启或退出，下次重新打开
+            return None
+        self.last_seq = frame.seq
+        return Frame(self, frame)
+
+    def _release(self, frame):
+        if self.opened:
+            self.lib.camera_ring_release(ctypes.byref(self.ring), ctypes.byref(frame))
+
+    def __del__(self):
+        self.close()
+
+
+class VideoCapture:
+    """与 cv2.VideoCapture 接口兼容：采集进程运行时从共享内存读取，否则直接打开设备"""
+
+    def __init__(self, device):
+        self.ring = CameraRing()
+        self.cap = None
+        if not self.ring.open():
+            import cv2
+            self.ring = None
+            self.cap = cv2.VideoCapture(device)
+
+    def isOpened(self):
+        return self.ring is not None or self.cap.isOpened()
+
+    def set(self, prop, value):  # 分辨率由采集进程决定
+        return self.cap.set(prop, value) if self.cap is not None else False
+
+    def read(self):  # 返回独立的副本，语义与 cv2 相同
+        if self.cap is not None:
+            return self.cap.read()
+        frame = self.ring.acquire()
+        if frame is None:
+            return False, None
+        with frame:
+            return True, frame.image.copy()
+
+    def release(self):
+        if self.cap is not None:
+            self.cap.release()
+        elif self.ring is not None:
+            self.ring.close()
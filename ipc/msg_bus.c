@@ -0,0 +1,285 @@
+/**
+ * @file msg_bus.c
+ * @brief 本地消息总线实现
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include "msg_bus.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/*****************************************************************************/
+/* 局部函数                                                                  */
+/*****************************************************************************/
+/* 总线目录修改时间，端点加入或退出时变化 */
+static uint64_t msg_bus_dir_mtime_ns(void)
+{
+    struct stat st;
+    if(stat(MSG_BUS_DIR, &st) < 0)
+    {
+        return 0;
+    }
+    return (uint64_t)st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec;
+}
+
+/* 墙上时钟，写入消息时间戳 */
+static uint64_t msg_bus_real_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* 单调时钟，计算等待截止时间 */
+static uint64_t msg_bus_mono_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void msg_bus_make_addr(struct sockaddr_un *addr, const char *name)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    snprintf(addr->sun_path, sizeof(addr->sun_path), "%s/%s", MSG_BUS_DIR, name);
+}
+
+/* 重新扫描总线目录，得到所有端点名称 */
+static void msg_bus_refresh_peers(struct msg_bus_t *bus)
+{
+    DIR *dir = opendir(MSG_BUS_DIR);
+    struct dirent *entry;
+
+    bus->peer_cnt = 0;
+    bus->dir_mtime_ns = msg_bus_dir_mtime_ns();
+    if(!dir)
+    {
+        return;
+    }
+
+    while((entry = readdir(dir)) != NULL && bus->peer_cnt < MSG_BUS_MAX_PEERS)
+    {
+        if(entry->d_name[0] == '.' || strlen(entry->d_name) >= MSG_BUS_NAME_LEN ||
+           0 == strcmp(entry->d_name, bus->name))
+        {
+            continue;
+        }
+        strcpy(bus->peers[bus->peer_cnt++], entry->d_name);
+    }
+    closedir(dir);
+}
+
+/*****************************************************************************/
+/* 函数实现                                                                  */
+/*****************************************************************************/
+int msg_bus_open(struct msg_bus_t *bus, const char *name)
+{
+    struct sockaddr_un addr;
+
+    if(!bus || !name || strlen(name) == 0 || strlen(name) >= MSG_BUS_NAME_LEN)
+    {
+        return -1;
+    }
+
+    memset(bus, 0, sizeof(*bus));
+    strcpy(bus->name, name);
+
+    mkdir(MSG_BUS_DIR, 0777);   //目录已存在时忽略错误
+
+    bus->fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(bus->fd < 0)
+    {
+        return -1;
+    }
+
+    msg_bus_make_addr(&addr, name);
+    unlink(addr.sun_path);      //清理上次异常退出残留的套接字文件
+    if(bind(bus->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        close(bus->fd);
+        bus->fd = -1;
+        return -1;
+    }
+    chmod(addr.sun_path, 0666);
+
+    msg_bus_refresh_peers(bus);
+    return 0;
+}
+
+void msg_bus_close(struct msg_bus_t *bus)
+{
+    struct sockaddr_un addr;
+
+    if(!bus || bus->fd < 0)
+    {
+        return;
+    }
+
+    close(bus->fd);
+    bus->fd = -1;
+    msg_bus_make_addr(&addr, bus->name);
+    unlink(addr.sun_path);
+}
+
+int msg_bus_fd(const struct msg_bus_t *bus)
+{
+    return bus ? bus->fd : -1;
+}
+
+int msg_bus_publish(struct msg_bus_t *bus, uint32_t type, struct msg_bus_msg_t *msg)
+{
+    struct sockaddr_un addr;
+    int delivered = 0;
+    int stale = 0;
+    int i;
+
+    if(!bus || bus->fd < 0 || !msg)
+    {
+        return -1;
+    }
+
+    msg->type = type;
+    msg->seq = ++bus->seq;
+    msg->timestamp_ms = msg_bus_real_ms();
+    msg->reserved = 0;
+
+    if(msg_bus_dir_mtime_ns() != bus->dir_mtime_ns)
+    {
+        msg_bus_refresh_peers(bus);
+    }
+
+    for(i = 0; i < bus->peer_cnt; i++)
+    {
+        msg_bus_make_addr(&addr, bus->peers[i]);
+        if(sendto(bus->fd, msg, sizeof(*msg), MSG_DONTWAIT, (struct sockaddr *)&addr, sizeof(addr)) == sizeof(*msg))
+        {
+            delivered++;
+        }
+        else if(errno == ECONNREFUSED)
+        {
+            unlink(addr.sun_path);  //端点进程已退出，删除残留文件
+            stale = 1;
+        }
+        else if(errno == ENOENT)
+        {
+            stale = 1;
+        }
+        //EAGAIN：订阅方接收队列已满，丢弃本条消息
+    }
+
+    if(stale)
+    {
+        msg_bus_refresh_peers(bus);
+    }
+
+    return delivered;
+}
+
+int msg_bus_recv(struct msg_bus_t *bus, struct msg_bus_msg_t *msg, int timeout_ms)
+{
+    struct pollfd pfd;
+    uint64_t deadline = 0;
+    uint64_t now;
+    ssize_t len;
+    int wait = timeout_ms;
+    int ret;
+
+    if(!bus || bus->fd < 0 || !msg)
+    {
+        return -1;
+    }
+    if(timeout_ms > 0)
+    {
+        deadline = msg_bus_mono_ms() + timeout_ms;
+    }
+
+    while(1)
+    {
+        len = recv(bus->fd, msg, sizeof(*msg), MSG_DONTWAIT);
+        if(len == sizeof(*msg))
+        {
+            return 1;
+        }
+        if(len >= 0)
+        {
+            continue;   //长度不符的消息直接丢弃
+        }
+        if(errno == EINTR)
+        {
+            continue;
+        }
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            return -1;
+        }
+        if(timeout_ms == 0)
+        {
+            return 0;
+        }
+        if(timeout_ms > 0)  //被信号打断或丢弃消息后只等待剩余时间
+        {
+            now = msg_bus_mono_ms();
+            if(now >= deadline)
+            {
+                return 0;
+            }
+            wait = (int)(deadline - now);
+        }
+
+        pfd.fd = bus->fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        ret = poll(&pfd, 1, wait);
+        if(ret == 0)
+        {
+            return 0;
+        }
+        if(ret < 0 && errno != EINTR)
+        {
+            return -1;
+        }
+    }
+}
+
+int msg_bus_publish_sensor(struct msg_bus_t *bus, float temp, float humi, float lx)
+{
+    struct msg_bus_msg_t msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.data.sensor.temp = temp;
+    msg.data.sensor.humi = humi;
+    msg.data.sensor.lx = lx;
+    return msg_bus_publish(bus, MSG_BUS_SENSOR, &msg);
+}
+
+int msg_bus_publish_camera_state(struct msg_bus_t *bus, int32_t state)
+{
+    struct msg_bus_msg_t msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.data.camera.state = state;
+    return msg_bus_publish(bus, MSG_BUS_CAMERA_STATE, &msg);
+}
+
+int msg_bus_publish_action(struct msg_bus_t *bus, int32_t track_id, int32_t label, float confidence)
+{
+    struct msg_bus_msg_t msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.data.action.track_id = track_id;
+    msg.data.action.label = label;
+    msg.data.action.confidence = confidence;
+    return msg_bus_publish(bus, MSG_BUS_ACTION, &msg);
+}
@@ -0,0 +1,126 @@
+/**
+ * @file msg_bus.h
+ * @brief 本地消息总线：Qt程序、动作识别与物联网上报之间基于Unix域数据报套接字的进程间通信
+ *
+ * 每个进程以唯一名称在 MSG_BUS_DIR 下绑定一个数据报套接字，发布时向目录下
+ * 其他所有端点各发送一份定长消息，订阅方在 fd 可读时取出消息并按类型过滤。
+ */
+
+#ifndef __MSG_BUS_H__
+#define __MSG_BUS_H__
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define MSG_BUS_DIR             "/tmp/elf_bus"  //总线端点目录
+#define MSG_BUS_NAME_LEN        32              //端点名称最大长度
+#define MSG_BUS_MAX_PEERS       16              //最多缓存的对端数量
+
+#define MSG_BUS_EP_APP          "app"           //Qt程序端点
+#define MSG_BUS_EP_UPLINK       "uplink"        //物联网上报端点
+#define MSG_BUS_EP_POSE         "pose"          //动作识别端点
+
+/*****************************************************************************/
+/* 类型定义                                                                  */
+/*****************************************************************************/
+/* 消息类型 */
+enum msg_bus_type_e
+{
+    MSG_BUS_SENSOR = 1,     //传感器采样
+    MSG_BUS_CAMERA_STATE,   //摄像头（动作识别）状态
+    MSG_BUS_ACTION          //动作识别事件
+};
+
+/* 定长消息，32字节，Python端以 "<IIQ12sI" 解析 */
+struct msg_bus_msg_t
+{
+    uint32_t type;          //消息类型 msg_bus_type_e
+    uint32_t seq;           //发送方序号
+    uint64_t timestamp_ms;  //发送时刻（CLOCK_REALTIME，毫秒）
+    union
+    {
+        struct
+        {
+            float temp;     //温度 ℃
+            float humi;     //湿度 %RH
+            float lx;       //光照 lx
+        } sensor;
+        struct
+        {
+            int32_t state;  //0 关闭 1 开启
+        } camera;
+        struct
+        {
+            int32_t track_id;   //目标编号
+            int32_t label;      //动作类别
+            float confidence;   //置信度
+        } action;
+    } data;
+    uint32_t reserved;
+};
+
+/* 总线端点 */
+struct msg_bus_t
+{
+    int fd;
+    uint32_t seq;
+    char name[MSG_BUS_NAME_LEN];
+    char peers[MSG_BUS_MAX_PEERS][MSG_BUS_NAME_LEN];
+    int peer_cnt;
+    uint64_t dir_mtime_ns;  //对端列表对应的目录修改时间
+};
+
+/*****************************************************************************/
+/* 函数声明                                                                  */
+/*****************************************************************************/
+/**
+ * 打开总线端点
+ * @param bus  端点
+ * @param name 端点名称，同一时刻唯一
+ * @retval  0 - 成功
+ * @retval -1 - 失败
+ */
+int msg_bus_open(struct msg_bus_t *bus, const char *name);
+
+/* 关闭总线端点并删除套接字文件 */
+void msg_bus_close(struct msg_bus_t *bus);
+
+/* 返回可用于 select/poll/QSocketNotifier 的描述符 */
+int msg_bus_fd(const struct msg_bus_t *bus);
+
+/**
+ * 向所有端点发布消息，type/seq/timestamp_ms 由总线填写
+ * @retval >=0 - 成功送达的端点数
+ * @retval  -1 - 失败
+ */
+int msg_bus_publish(struct msg_bus_t *bus, uint32_t type, struct msg_bus_msg_t *msg);
+
+/**
+ * 接收一条消息
+ * @param timeout_ms 0 立即返回，<0 一直等待
+ * @retval  1 - 收到消息
+ * @retval  0 - 超时
+ * @retval -1 - 失败
+ */
+int msg_bus_recv(struct msg_bus_t *bus, struct msg_bus_msg_t *msg, int timeout_ms);
+
+/* 便捷发布接口 */
+int msg_bus_publish_sensor(struct msg_bus_t *bus, float temp, float humi, float lx);
+int msg_bus_publish_camera_state(struct msg_bus_t *bus, int32_t state);
+int msg_bus_publish_action(struct msg_bus_t *bus, int32_t track_id, int32_t label, float confidence);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,81 @@
+# 本地消息总线 Python 端，与 msg_bus.h 中的定长消息格式保持一致
+import os
+import socket
+import struct
+import time
+
+MSG_BUS_DIR = "/tmp/elf_bus"
+
+MSG_BUS_SENSOR = 1
+MSG_BUS_CAMERA_STATE = 2
+MSG_BUS_ACTION = 3
+
+_MSG = struct.Struct("<IIQ12sI")
+_SENSOR = struct.Struct("<fff")
+_CAMERA = struct.Struct("<i8x")
+_ACTION = struct.Struct("<iif")
+
+
+class MsgBus:
+    def __init__(self, name):
+        os.makedirs(MSG_BUS_DIR, exist_ok=True)
+        self.name = name
+        self.path = os.path.join(MSG_BUS_DIR, name)
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_DGRAM)
+        self.sock.setblocking(False)
+        if os.path.exists(self.path):
+            os.unlink(self.path)  # 清理残留的套接字文件
+        self.sock.bind(self.path)
+        os.chmod(self.path, 0o666)
+        self.seq = 0
+        self.peers = []
+        self.dir_mtime = 0
+
+    def close(self):
+        self.sock.close()
+        try:
+            os.unlink(self.path)
+        except OSError:
+            pass
+
+    def _refresh_peers(self):
+        self.dir_mtime = os.stat(MSG_BUS_DIR).st_mtime_ns
+        self.peers = [os.path.join(MSG_BUS_DIR, n) for n in os.listdir(MSG_BUS_DIR)
+                      if not n.startswith('.') and n != self.name]
+
+    def publish(self, msg_type, body):
+        # 总线目录修改时间变化说明有端点加入或退出
+        if os.stat(MSG_BUS_DIR).st_mtime_ns != self.dir_mtime:
+            self._refresh_peers()
+
+        self.seq = (self.seq + 1) & 0xFFFFFFFF
+        data = _MSG.pack(msg_type, self.seq, int(time.time() * 1000), body, 0)
+
+        delivered = 0
+        stale = False
+        for peer in self.peers:
+            try:
+                self.sock.sendto(data, peer)
+                delivered += 1
+            except ConnectionRefusedError:
+                try:
+                    os.unlink(peer)  # 端点进程已退出
+                except OSError:
+                    pass
+                stale = True
+            except FileNotFoundError:
+                stale = True
+            except BlockingIOError:
+                pass  # 订阅方接收队列已满，丢弃
+        if stale:
+            self._refresh_peers()
+        return delivered
+
+    def publish_sensor(self, temp, humi, lx):
+        return self.publish(MSG_BUS_SENSOR, _SENSOR.pack(temp, humi, lx))
+
+    def publish_camera_state(self, state):
+        return self.publish(MSG_BUS_CAMERA_STATE, _CAMERA.pack(state))
+
+    def publish_action(self, track_id, label, confidence):
+        return self.publish(MSG_BUS_ACTION, _ACTION.pack(track_id, label, confidence))
@@ -13,6 +13,7 @@
 #include "log.h"
 #include "tm_api.h"
 #include "tm_user.h"
+#include "msg_bus.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -37,17 +38,20 @@
 /** token 有效时间，默认为 2035.12.31 23:59:59 */
 #define TM_EXPIRE_TIME 2082729599
 
-/*****************************************************************************/
-/* 函数声明                                                                  */
-/*****************************************************************************/
-int read_index_file(const char *index_file, char *date_str);
-int read_data_by_date(const char *base_dir, const char *date_str, float *temp, float *humi, float *lx);
-int read_camera_state(const char *camera_state_file, int *camera_state);
+/** 等待总线消息的最长时间，超时后处理一次平台下行数据 */
+#define BUS_WAIT_MS 100
 
-/*****************************************************************************/
-/* 全局变量                                                                  */
-/*****************************************************************************/
-static int prev_pose_recog = -1; //-1 表示初始状态未知
+/** 有上报请求等待应答时缩短总线等待，应答尽快被处理 */
+#define BUS_WAIT_INFLIGHT_MS 5
+
+/** 上报请求的应答超时时间 */
+#define POST_TIMEOUT_MS 3000
+
+/** 属性合并窗口，窗口内的属性更新合并为一次上报 */
+#define BATCH_WINDOW_MS 500
+
+/** 读取考勤台账的间隔，今天的考勤人数变化时上报（由合并上报过滤） */
+#define ATTENDANCE_CHECK_S 10
 
 /*****************************************************************************/
 /* 函数实现                                                                  */
@@ -55,19 +59,14 @@ static int prev_pose_recog = -1; //-1 表示初始状态未知
 /* 主函数 */
 int main(int argc, char *argv[])
 {
-    const char *base_dir = "/home/elf/sensor/data";               //环境数据文件所在目录
-    const char *index_file = "/home/elf/sensor/data/index.txt";   //索引文件
-    char date_str[16];  //存储日期字符串如 "20250706"
-    int camera_state = -1; //摄像头状态
-
     AIOT_ASSERT(PRODUCT_ID != NULL && strlen(PRODUCT_ID) > 0);
     AIOT_ASSERT(DEVICE_NAME != NULL && strlen(DEVICE_NAME) > 0);
     AIOT_ASSERT(ACCESS_KEY != NULL && strlen(ACCESS_KEY) > 0);
 
     struct tm_downlink_tbl_t dl_tbl;
+    struct msg_bus_t bus;
+    struct msg_bus_msg_t msg;
     int ret = 0;
-    handle_t timer_handle = 0;
-    uint32_t timer_period = 120;
 
     dl_tbl.prop_tbl = tm_prop_list;
     dl_tbl.prop_tbl_size = tm_prop_list_size;
@@ -80,178 +79,89 @@ int main(int argc, char *argv[])
 
     int timeout_ms = 60 * 1000;
 
-    char log_entry[256];
+    /* 打开本地消息总线 */
+    ret = msg_bus_open(&bus, MSG_BUS_EP_UPLINK);
+    CHECK_EXPR_GOTO(0 != ret, _END, "Message bus open failed!");
+    tm_user_bind_bus(&bus);
 
     /* 设备初始化 */
     ret = tm_init(&dl_tbl);
-    CHECK_EXPR_GOTO(ERR_OK != ret, _END, "ThingModel init failed!\n");
+    CHECK_EXPR_GOTO(ERR_OK != ret, _CLOSE_BUS, "ThingModel init failed!\n");
     logi("ThingModel init ok");
 
     /* 设备登录 */
     ret = tm_login(product_id, device_sn, auth_code, TM_EXPIRE_TIME, timeout_ms);
-    CHECK_EXPR_GOTO(ERR_OK != ret, _END, "ThingModel login failed!");
+    CHECK_EXPR_GOTO(ERR_OK != ret, _CLOSE_BUS, "ThingModel login failed!");
     logi("ThingModel login ok");
 
-    int32_t pose_recog = 0;
-    float temp = 0, humi = 0, lx = 0;
+    /* 属性合并上报，未变化的属性由死区过滤 */
+    ret = tm_batch_init(tm_batch_list, tm_batch_list_size, BATCH_WINDOW_MS, POST_TIMEOUT_MS);
+    CHECK_EXPR_GOTO(ERR_OK != ret, _LOGOUT, "Property batch init failed!");
+
+    time_t attendance_checked = 0;
 
     while (1)
     {
-        //读取索引文件获取日期
-        if(read_index_file(index_file, date_str) != 0)
+        //等待Qt程序发布的消息，收到后立即上报
+        ret = msg_bus_recv(&bus, &msg, tm_requests_in_flight() > 0 ? BUS_WAIT_INFLIGHT_MS : BUS_WAIT_MS);
+        if(ret < 0)
         {
-            loge("Failed to read index file");
+            loge("Message bus receive failed");
             break;
         }
 
-        //读取温湿度和光强数据
-        if(0 == read_data_by_date(base_dir, date_str, &temp, &humi, &lx))
+        while(ret == 1)
         {
-            //上报属性值
-            tm_prop_temp_notify(NULL, temp, 0, 3000);
-            tm_prop_humi_notify(NULL, humi, 0, 3000);
-            tm_prop_lx_notify(NULL, lx, 0, 3000);
+            switch(msg.type)
+            {
+                case MSG_BUS_SENSOR:
+                    //同一时刻的采样合并为一次上报
+                    tm_batch_set_float((const uint8_t *)"temp", msg.data.sensor.temp, msg.timestamp_ms);
+                    tm_batch_set_float((const uint8_t *)"humi", msg.data.sensor.humi, msg.timestamp_ms);
+                    tm_batch_set_float((const uint8_t *)"lx", msg.data.sensor.lx, msg.timestamp_ms);
+                    break;
+
+                case MSG_BUS_CAMERA_STATE:
+                    //摄像头状态变化时上报
+                    tm_batch_set_int32((const uint8_t *)"pose_recog", msg.data.camera.state, msg.timestamp_ms);
+                    break;
+
+                default:
+                    break;
+            }
+
+            ret = msg_bus_recv(&bus, &msg, 0);
         }
-        else
+
+        //定期查询考勤台账，今天的考勤人数变化时上报
+        if(time(NULL) - attendance_checked >= ATTENDANCE_CHECK_S)
         {
-            loge("Failed to read sensor data, using last values");
+            int32_t count = tm_user_attendance_count();
+            attendance_checked = time(NULL);
+            if(count >= 0)
+            {
+                tm_batch_set_int32((const uint8_t *)"attendance", count, (uint64_t)attendance_checked * 1000);
+            }
         }
 
-        //非阻塞延时250ms
-        struct timeval tv_status;
-        tv_status.tv_sec = 0;
-        tv_status.tv_usec = 250000;
-        select(0, NULL, NULL, NULL, &tv_status);
+        //合并窗口到期后上报
+        tm_batch_step();
 
-        //每0.5秒读取并上传摄像头状态
-        if(read_camera_state(CAMERA_STATE_FILE, &camera_state) == 0)
-        {
-            //printf("camera state: %d\n", camera_state);
-            tm_prop_pose_recog_notify(NULL, camera_state, 0, 3000);
-        }
-        else
+        //处理平台下行数据及心跳
+        if(tm_step(1) < 0)
         {
-            loge("Failed to read camera state");
+            loge("ThingModel step failed");
         }
-
-        //非阻塞延时750ms
-        struct timeval tv_sensor;
-        tv_sensor.tv_sec = 0;
-        tv_sensor.tv_usec = 750000;
-        select(0, NULL, NULL, NULL, &tv_sensor);
     }
 
-    /* 设备注销 */
+    /* 上报剩余的属性，等待已发出的上报完成后注销 */
+    tm_batch_flush();
+    tm_wait_requests(POST_TIMEOUT_MS);
+    tm_batch_deinit();
+_LOGOUT:
     tm_logout(3000);
+_CLOSE_BUS:
+    msg_bus_close(&bus);
 _END:
     return 0;
 }
-
-/* 读取索引文件获取动作识别状态 */
-int read_index_file(const char *index_file, char *date_str)
-{
-    FILE *fp = fopen(index_file, "r");
-    if(!fp)
-    {
-        //只记录一次错误日志
-        static int error_logged = 0;
-        if(!error_logged)
-        {
-            loge("Failed to open index file: %s", index_file);
-            error_logged = 1;
-        }
-        return -1;
-    }
-
-    //读取日期
-    if(fscanf(fp, "%s", date_str) != 1)
-    {
-        loge("Failed to read date from index file");
-        fclose(fp);
-        return -1;
-    }
-
-    fclose(fp);
-    return 0;
-}
-
-/* 根据日期构建文件路径并读取数据 */
-int read_data_by_date(const char *base_dir, const char *date_str, float *temp, float *humi, float *lx)
-{
-    char year_month[7]; //存储年月部分，如 "202507"
-    strncpy(year_month, date_str, 6);
-    year_month[6] = '\0'; //确保字符串以 null 结尾
-
-    char file_path[256];
-    snprintf(file_path, sizeof(file_path), "%s/%s/%s.txt", base_dir, year_month, date_str);
-
-    FILE *fp = fopen(file_path, "r");
-    if(!fp)
-    {
-        //只记录一次错误日志
-        static int error_logged = 0;
-        if (!error_logged)
-        {
-            loge("Failed to open data file: %s", file_path);
-            error_logged = 1;
-        }
-        return -1;
-    }
-
-    char line[256];
-    char last_line[256] = {0};
-
-    //读取最后一行
-    while(fgets(line, sizeof(line), fp))
-    {
-        if(strlen(line) > 1) //忽略空行
-        {  
-            strncpy(last_line, line, sizeof(last_line));
-        }
-    }
-    fclose(fp);
-
-    if(strlen(last_line) == 0)
-    {
-        loge("No valid data in file");
-        return -1;
-    }
-
-    //解析数据，跳过时间戳，提取数值部分
-    //格式示例：2025-07-06 23:23:23 25.12℃ 34.56%RH 789.01lx
-    if(sscanf(last_line, "%*s %*s %f%*[^0-9.] %f%*[^0-9.] %f", temp, humi, lx) != 3)
-    {
-        loge("Invalid data format in file: %s", last_line);
-        return -1;
-    }
-
-    return 0;
-}
-
-/* 读取摄像头状态 */
-int read_camera_state(const char *camera_state_file, int *camera_state)
-{
-    FILE *fp = fopen(CAMERA_STATE_FILE, "r");
-    if(!fp)
-    {
-        //只记录一次错误日志
-        static int error_logged = 0;
-        if(!error_logged)
-        {
-            loge("Failed to open camera state file: %s", CAMERA_STATE_FILE);
-            error_logged = 1;
-        }
-        return -1;
-    }
-
-    //读取摄像头状态
-    if(fscanf(fp, "%d", camera_state) != 1)
-    {
-        loge("Failed to read camera state from file");
-        fclose(fp);
-        return -1;
-    }
-
-    fclose(fp);
-    return 0;
-}
@@ -12,6 +12,10 @@
 #include "tm_data.h"
 #include "tm_api.h"
 #include "tm_user.h"
+#include "log.h"
+#include "err_def.h"
+#include "attendance_ledger.h"
+#include <time.h>
 
 /*****************************************************************************/
 /* Local Definitions ( Constant and Macro )                                  */
@@ -22,6 +26,7 @@
 /*****************************************************************************/
 /*************************** Property Func List ******************************/
 struct tm_prop_tbl_t tm_prop_list[] = {
+    TM_PROPERTY_RO(attendance),
     TM_PROPERTY_RO(humi),
     TM_PROPERTY_RO(lx),
     TM_PROPERTY_RW(pose_recog),
@@ -30,6 +35,16 @@ struct tm_prop_tbl_t tm_prop_list[] = {
 uint16_t tm_prop_list_size = ARRAY_SIZE(tm_prop_list);
 /****************************** Auto Generated *******************************/
 
+/* 属性合并上报的过滤规则：变化不超过死区的采样不上报，值不变时按刷新间隔重新上报 */
+struct tm_batch_prop_t tm_batch_list[] = {
+    {(const uint8_t *)"attendance", TM_BATCH_TYPE_INT32, 0, 0},
+    {(const uint8_t *)"humi", TM_BATCH_TYPE_FLOAT, 1.0, 60000},
+    {(const uint8_t *)"lx", TM_BATCH_TYPE_FLOAT, 5.0, 60000},
+    {(const uint8_t *)"pose_recog", TM_BATCH_TYPE_INT32, 0, 0},
+    {(const uint8_t *)"temp", TM_BATCH_TYPE_FLOAT, 0.2, 60000}
+};
+uint16_t tm_batch_list_size = ARRAY_SIZE(tm_batch_list);
+
 /***************************** Service Func List *******************************/
 struct tm_svc_tbl_t tm_svc_list[] = {0};
 uint16_t tm_svc_list_size = 0;
@@ -42,6 +57,7 @@ uint16_t tm_svc_list_size = 0;
 /*****************************************************************************/
 /* Local Variables                                                           */
 /*****************************************************************************/
+static struct msg_bus_t *g_bus = NULL;
 
 /*****************************************************************************/
 /* Global Variables                                                          */
@@ -50,7 +66,23 @@ uint16_t tm_svc_list_size = 0;
 /*****************************************************************************/
 /* Function Implementation                                                   */
 /*****************************************************************************/
+/* 属性上报完成回调，失败时记录属性名，下次采样会重新上报 */
+static void tm_user_post_done(int32_t post_id, int32_t result, void *reply_data, void *arg)
+{
+    if(ERR_OK != result)
+    {
+        loge("Post %s failed(id %d): %d", (const char *)arg, post_id, result);
+    }
+}
+
 /**************************** Property Func Read *****************************/
+int32_t tm_prop_attendance_rd_cb(void *data)
+{
+    int32_t val = tm_user_attendance_count();
+    tm_data_struct_set_int32(data, "attendance", val < 0 ? 0 : val);
+    return 0;
+}
+
 int32_t tm_prop_humi_rd_cb(void *data)
 {
     float32_t val = 0.0;
@@ -87,17 +119,10 @@ int32_t tm_prop_pose_recog_wr_cb(void *data)
     int32_t val = 0;
     tm_data_get_int32(data, &val);
 
-    //接收平台下发的摄像头状态并写入文件
-    FILE *fp = fopen(CAMERA_STATE_FILE, "w");
-    if(fp)
+    //接收平台下发的摄像头状态并转发给Qt程序
+    if(NULL == g_bus || msg_bus_publish_camera_state(g_bus, val) <= 0)
     {
-        fprintf(fp, "%d\n", val);
-        fclose(fp);
-        //logi("Updated camera state to %d", val);
-    }
-    else
-    {
-        loge("Failed to open camera state file for writing");
+        loge("Failed to forward camera state to message bus");
     }
 
     return 0;
@@ -106,6 +131,30 @@ int32_t tm_prop_pose_recog_wr_cb(void *data)
 /****************************** Auto Generated *******************************/
 
 /**************************** Property Func Notify ***************************/
+int32_t tm_prop_attendance_notify(void *data, int32_t val, uint64_t timestamp, uint32_t timeout_ms)
+{
+	void *resource = NULL;
+    int32_t ret = 0;
+
+    if(NULL == data)
+    {
+        resource = tm_data_create();
+    }
+    else
+    {
+        resource = data;
+    }
+
+    tm_data_set_int32(resource, "attendance", val, timestamp);
+
+    if(NULL == data)
+    {
+        ret = tm_post_property_async(resource, timeout_ms, tm_user_post_done, "attendance");
+    }
+
+    return ret;
+}
+
 int32_t tm_prop_humi_notify(void *data, float32_t val, uint64_t timestamp, uint32_t timeout_ms)
 {
 	void *resource = NULL;
@@ -124,7 +173,7 @@ int32_t tm_prop_humi_notify(void *data, float32_t val, uint64_t timestamp, uint3
 
     if(NULL == data)
     {
-        ret = tm_post_property(resource, timeout_ms);
+        ret = tm_post_property_async(resource, timeout_ms, tm_user_post_done, "humi");
     }
 
     return ret;
@@ -148,7 +197,7 @@ int32_t tm_prop_lx_notify(void *data, float32_t val, uint64_t timestamp, uint32_
 
     if(NULL == data)
     {
-        ret = tm_post_property(resource, timeout_ms);
+        ret = tm_post_property_async(resource, timeout_ms, tm_user_post_done, "lx");
     }
 
     return ret;
@@ -172,7 +221,7 @@ int32_t tm_prop_pose_recog_notify(void *data, int32_t val, uint64_t timestamp, u
 
     if(NULL == data)
     {
-        ret = tm_post_property(resource, timeout_ms);
+        ret = tm_post_property_async(resource, timeout_ms, tm_user_post_done, "pose_recog");
     }
 
     return ret;
@@ -196,7 +245,7 @@ int32_t tm_prop_temp_notify(void *data, float32_t val, uint64_t timestamp, uint3
 
     if(NULL == data)
     {
-        ret = tm_post_property(resource, timeout_ms);
+        ret = tm_post_property_async(resource, timeout_ms, tm_user_post_done, "temp");
     }
 
     return ret;
@@ -212,3 +261,23 @@ int32_t tm_prop_temp_notify(void *data, float32_t val, uint64_t timestamp, uint3
 /**************************** Service Func Invoke ****************************/
 
 /****************************** Auto Generated *******************************/
+
+void tm_user_bind_bus(struct msg_bus_t *bus)
+{
+    g_bus = bus;
+}
+
+int32_t tm_user_attendance_count(void)
+{
+    struct attendance_ledger_t ledger;
+    int count;
+
+    //每次重新打开，台账由旧版日志重新导入时文件会被替换
+    if(attendance_ledger_open(&ledger, ATTENDANCE_LEDGER_PATH) < 0)
+    {
+        return -1;
+    }
+    count = attendance_ledger_day_summary(&ledger, attendance_ledger_day_of(time(NULL)), NULL, 0);
+    attendance_ledger_close(&ledger);
+    return count;
+}
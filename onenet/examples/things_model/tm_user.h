@@ -14,6 +14,8 @@
 /*****************************************************************************/
 #include "data_types.h"
 #include "tm_api.h"
+#include "tm_batch.h"
+#include "msg_bus.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -23,7 +25,6 @@ extern "C"
 /*****************************************************************************/
 /* External Definition ( Constant and Macro )                                */
 /*****************************************************************************/
-#define CAMERA_STATE_FILE "/home/elf/sensor/data/camera_state.txt"  //摄像头状态文件路径
 
 /*****************************************************************************/
 /* External Structures, Enum and Typedefs                                    */
@@ -40,12 +41,17 @@ extern struct tm_prop_tbl_t tm_prop_list[];
 extern uint16_t tm_prop_list_size;
 /****************************** Auto Generated *******************************/
 
+/* 属性合并上报的过滤规则 */
+extern struct tm_batch_prop_t tm_batch_list[];
+extern uint16_t tm_batch_list_size;
+
 /**************************** Service Func List ******************************/
 extern struct tm_svc_tbl_t tm_svc_list[];
 extern uint16_t tm_svc_list_size;
 /****************************** Auto Generated *******************************/
 
 /**************************** Property Func Read ****************************/
+int32_t tm_prop_attendance_rd_cb(void *data);
 int32_t tm_prop_humi_rd_cb(void *data);
 int32_t tm_prop_lx_rd_cb(void *data);
 int32_t tm_prop_pose_recog_rd_cb(void *data);
@@ -63,6 +69,8 @@ int32_t tm_prop_pose_recog_wr_cb(void *data);
 /****************************** Auto Generated *******************************/
 
 /**************************** Property Func Notify ***************************/
+/* 不等待平台应答，返回值大于0为请求ID，结果由tm_step()处理应答时记录 */
+int32_t tm_prop_attendance_notify(void *data, int32_t val, uint64_t timestamp, uint32_t timeout_ms);
 int32_t tm_prop_humi_notify(void *data, float32_t val, uint64_t timestamp, uint32_t timeout_ms);
 int32_t tm_prop_lx_notify(void *data, float32_t val, uint64_t timestamp, uint32_t timeout_ms);
 int32_t tm_prop_pose_recog_notify(void *data, int32_t val, uint64_t timestamp, uint32_t timeout_ms);
@@ -74,6 +82,12 @@ int32_t tm_prop_temp_notify(void *data, float32_t val, uint64_t timestamp, uint3
 
 /****************************** Auto Generated *******************************/
 
+/* 绑定本地消息总线，平台下发的属性经总线转发给Qt程序 */
+void tm_user_bind_bus(struct msg_bus_t *bus);
+
+/* 今天的考勤人数，读取人脸识别模块的考勤台账，台账不存在时返回 -1 */
+int32_t tm_user_attendance_count(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -65,6 +65,19 @@ int32_t plat_tcp_send(handle_t handle, void *buf, uint32_t len, uint32_t timeout
  */
 int32_t plat_tcp_recv(handle_t handle, void *buf, uint32_t len, uint32_t timeout_ms);
 
+/**
+ * @brief receive the TCP data already available, waiting only while there is none
+ *
+ * @param handle TCP Connection operation handle
+ * @param buf Buffer address used to receive data
+ * @param len Size of the buffer, at most this much is received
+ * @param timeout_ms Longest wait for the first byte
+ * @retval -1 - Error or connection closed by peer
+ * @retval  0 - Timeout
+ * @retval Other - Length of data actually received successfully
+ */
+int32_t plat_tcp_recv_some(handle_t handle, void *buf, uint32_t len, uint32_t timeout_ms);
+
 /**
  * @brief Disconnect assigned TCP Connection
  *
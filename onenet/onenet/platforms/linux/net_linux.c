@@ -0,0 +1,196 @@
+/**
+ * Copyright (c), 2012~2024 iot.10086.cn All Rights Reserved
+ *
+ * @file net_linux.c
+ * @brief Shared epoll readiness of the linux TCP/UDP sockets
+ */
+
+/*****************************************************************************/
+/* Includes                                                                  */
+/*****************************************************************************/
+#include "net_linux.h"
+#include "plat_osl.h"
+#include "plat_time.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+/*****************************************************************************/
+/* Local Definitions ( Constant and Macro )                                  */
+/*****************************************************************************/
+/** Initial size of the descriptor table, doubled as needed */
+#define NET_WATCH_TBL_INIT 16
+
+/** Events taken from the kernel per epoll_wait */
+#define NET_WATCH_EVENTS 8
+
+/*****************************************************************************/
+/* Structures, Enum and Typedefs                                             */
+/*****************************************************************************/
+struct net_watch_t
+{
+    uint32_t ready; // Events reported since the socket last returned EAGAIN
+    uint8_t  used;
+};
+
+struct net_watch_obj_t
+{
+    int32_t             epfd;
+    struct net_watch_t* tbl; // Indexed by descriptor
+    uint32_t            tbl_size;
+    uint32_t            count;
+};
+
+/*****************************************************************************/
+/* Local Function Prototype                                                  */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Local Variables                                                           */
+/*****************************************************************************/
+static struct net_watch_obj_t g_net_watch = { -1, NULL, 0, 0 };
+
+/*****************************************************************************/
+/* Global Variables                                                          */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Function Implementation                                                   */
+/*****************************************************************************/
+static struct net_watch_t* watch_get(int32_t fd)
+{
+    if (0 > fd || g_net_watch.tbl_size <= (uint32_t)fd || 0 == g_net_watch.tbl[fd].used) {
+        return NULL;
+    }
+
+    return &g_net_watch.tbl[fd];
+}
+
+static int32_t watch_tbl_grow(int32_t fd)
+{
+    struct net_watch_t* tbl  = NULL;
+    uint32_t            size = g_net_watch.tbl_size ? g_net_watch.tbl_size : NET_WATCH_TBL_INIT;
+
+    while (size <= (uint32_t)fd) {
+        size *= 2;
+    }
+
+    if (NULL == (tbl = osl_calloc(size, sizeof(*tbl)))) {
+        return -1;
+    }
+
+    if (g_net_watch.tbl) {
+        osl_memcpy(tbl, g_net_watch.tbl, g_net_watch.tbl_size * sizeof(*tbl));
+        osl_free(g_net_watch.tbl);
+    }
+    g_net_watch.tbl      = tbl;
+    g_net_watch.tbl_size = size;
+
+    return 0;
+}
+
+int32_t net_watch_add(int32_t fd)
+{
+    struct epoll_event ev = { 0 };
+
+    if (0 > fd) {
+        return -1;
+    }
+
+    if (0 > g_net_watch.epfd && 0 > (g_net_watch.epfd = epoll_create1(EPOLL_CLOEXEC))) {
+        return -1;
+    }
+
+    if (g_net_watch.tbl_size <= (uint32_t)fd && 0 > watch_tbl_grow(fd)) {
+        return -1;
+    }
+
+    ev.events  = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.fd = fd;
+    if (0 > epoll_ctl(g_net_watch.epfd, EPOLL_CTL_ADD, fd, &ev)) {
+        return -1;
+    }
+
+    g_net_watch.tbl[fd].ready = 0;
+    g_net_watch.tbl[fd].used  = 1;
+    g_net_watch.count++;
+
+    return 0;
+}
+
+void net_watch_del(int32_t fd)
+{
+    struct net_watch_t* watch = watch_get(fd);
+
+    if (NULL == watch) {
+        return;
+    }
+
+    epoll_ctl(g_net_watch.epfd, EPOLL_CTL_DEL, fd, NULL);
+    watch->ready = 0;
+    watch->used  = 0;
+
+    if (0 == --g_net_watch.count) {
+        close(g_net_watch.epfd);
+        osl_free(g_net_watch.tbl);
+        g_net_watch.epfd     = -1;
+        g_net_watch.tbl      = NULL;
+        g_net_watch.tbl_size = 0;
+    }
+}
+
+void net_watch_clear(int32_t fd, uint32_t events)
+{
+    struct net_watch_t* watch = watch_get(fd);
+
+    if (watch) {
+        watch->ready &= ~events;
+    }
+}
+
+int32_t net_watch_wait(int32_t fd, uint32_t events, uint64_t deadline_ms)
+{
+    struct epoll_event  evs[NET_WATCH_EVENTS];
+    struct net_watch_t* watch = watch_get(fd);
+    uint64_t            now   = 0;
+    int32_t             wait  = 0;
+    int32_t             n     = 0;
+    int32_t             i     = 0;
+
+    if (NULL == watch) {
+        return -1;
+    }
+
+    events |= EPOLLERR | EPOLLHUP;
+    if (events & EPOLLIN) {
+        events |= EPOLLRDHUP;
+    }
+
+    while (0 == (watch->ready & events)) {
+        now  = time_count_ms();
+        wait = (deadline_ms <= now) ? 0 : (deadline_ms - now > INT_MAX) ? INT_MAX : (int32_t)(deadline_ms - now);
+
+        if (0 > (n = epoll_wait(g_net_watch.epfd, evs, NET_WATCH_EVENTS, wait))) {
+            if (EINTR == errno) {
+                continue;
+            }
+            return -1;
+        }
+
+        // Edges of the other sockets are kept, their next send/recv goes straight to the socket
+        for (i = 0; i < n; i++) {
+            struct net_watch_t* ready = watch_get(evs[i].data.fd);
+
+            if (ready) {
+                ready->ready |= evs[i].events;
+            }
+        }
+
+        if (0 == n && 0 == wait) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
@@ -0,0 +1,73 @@
+/**
+ * Copyright (c), 2012~2024 iot.10086.cn All Rights Reserved
+ *
+ * @file net_linux.h
+ * @brief Shared epoll readiness of the linux TCP/UDP sockets
+ */
+
+#ifndef __NET_LINUX_H__
+#define __NET_LINUX_H__
+
+/*****************************************************************************/
+/* Includes                                                                  */
+/*****************************************************************************/
+#include "data_types.h"
+
+#include <sys/epoll.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************/
+/* External Definition ( Constant and Macro )                                */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* External Structures, Enum and Typedefs                                    */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* External Variables and Functions                                          */
+/*****************************************************************************/
+/**
+ * @brief Add a non-blocking socket to the shared edge-triggered epoll set
+ *
+ * @param fd Socket descriptor
+ * @retval  0 - Succeed
+ * @retval -1 - Error
+ */
+int32_t net_watch_add(int32_t fd);
+
+/**
+ * @brief Remove a socket from the epoll set, call before closing it
+ *
+ * @param fd Socket descriptor
+ */
+void net_watch_del(int32_t fd);
+
+/**
+ * @brief Forget the readiness of a socket once it returned EAGAIN
+ *
+ * @param fd Socket descriptor
+ * @param events EPOLLIN or EPOLLOUT
+ */
+void net_watch_clear(int32_t fd, uint32_t events);
+
+/**
+ * @brief Wait until a socket is ready. Readiness of the other sockets seen meanwhile is kept for their next call
+ *
+ * @param fd Socket descriptor
+ * @param events EPOLLIN or EPOLLOUT, errors and hang-ups always count as ready
+ * @param deadline_ms Deadline in time_count_ms()
+ * @retval  1 - Ready
+ * @retval  0 - Timeout
+ * @retval -1 - Error
+ */
+int32_t net_watch_wait(int32_t fd, uint32_t events, uint64_t deadline_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -10,8 +10,10 @@
 /*****************************************************************************/
 #include "data_types.h"
 #include "err_def.h"
+#include "net_linux.h"
 #include "plat_tcp.h"
 #include "plat_osl.h"
+#include "plat_time.h"
 
 #include "log.h"
 
@@ -27,8 +29,6 @@
 #include <sys/socket.h>
 #include <unistd.h>
 
-#include <sys/time.h>
-
 /*****************************************************************************/
 /* Local Definitions ( Constant and Macro )                                  */
 /*****************************************************************************/
@@ -88,9 +88,16 @@ handle_t plat_tcp_connect(const uint8_t *host, uint16_t port, uint32_t timeout_m
             goto close_socket;
         }
     }
+
+    if(0 > net_watch_add(fd))
+    {
+        goto close_socket;
+    }
+
     if(check_connect(fd, timeout_ms))
         return fd;
 
+    net_watch_del(fd);
 close_socket:
     close(fd);
 exit:
@@ -99,106 +106,122 @@ exit:
 
 int32_t plat_tcp_send(handle_t handle, void *buf, uint32_t len, uint32_t timeout_ms)
 {
-    handle_t countdown_tmr = 0;
-    struct timeval tv;
-    fd_set fs;
+    uint64_t deadline_ms = time_count_ms() + timeout_ms;
     int sent_len = 0;
     int ret = 0;
-    uint32_t left_time = 0;
 
-    if((0 > handle) || (0 == (countdown_tmr = countdown_start(timeout_ms))))
+    if(0 > handle)
         return -1;
 
-    do
+    while(sent_len < len)
     {
-        left_time = countdown_left(countdown_tmr);
-        tv.tv_sec = left_time / 1000;
-        tv.tv_usec = (left_time % 1000) * 1000;
-
-        FD_ZERO(&fs);
-        FD_SET(handle, &fs);
-
-        ret = select(handle + 1, NULL, &fs, NULL, &tv);
+        ret = send(handle, buf + sent_len, len - sent_len, MSG_DONTWAIT);
         if(0 < ret)
         {
-            if(FD_ISSET(handle, &fs))
-            {
-                ret = send(handle, buf + sent_len, len - sent_len, MSG_DONTWAIT);
-                if(0 < ret)
-                {
-                    sent_len += ret;
-                }
-                else if(0 > ret)
-                {
-                    sent_len = ret;
-                    break;
-                }
-            }
+            sent_len += ret;
+            continue;
         }
-        else if(0 > ret)
+        else if((0 > ret) && (EINTR == errno))
         {
-            sent_len = ret;
-            break;
+            continue;
+        }
+        else if((0 > ret) && (EAGAIN != errno) && (EWOULDBLOCK != errno))
+        {
+            return -1;
         }
-    } while((sent_len < len) && (0 == countdown_is_expired(countdown_tmr)));
-    countdown_stop(countdown_tmr);
+
+        // Send buffer full, wait for the next writable edge
+        net_watch_clear(handle, EPOLLOUT);
+        if(0 >= (ret = net_watch_wait(handle, EPOLLOUT, deadline_ms)))
+        {
+            return (0 == ret) ? sent_len : -1;
+        }
+    }
 
     return sent_len;
 }
 
 int32_t plat_tcp_recv(handle_t handle, void *buf, uint32_t len, uint32_t timeout_ms)
 {
-    handle_t countdown_tmr = 0;
-    struct timeval tv;
-    fd_set fs;
+    uint64_t deadline_ms = time_count_ms() + timeout_ms;
     int recv_len = 0;
     int ret = 0;
-    uint32_t left_time = 0;
 
-    if((0 > handle) || (0 == (countdown_tmr = countdown_start(timeout_ms))))
+    if(0 > handle)
         return -1;
 
-    do
+    while(recv_len < len)
     {
-        left_time = countdown_left(countdown_tmr);
-        tv.tv_sec = left_time / 1000;
-        tv.tv_usec = (left_time % 1000) * 1000;
+        ret = recv(handle, buf + recv_len, len - recv_len, MSG_DONTWAIT);
+        if(0 < ret)
+        {
+            recv_len += ret;
+            continue;
+        }
+        else if(0 == ret)
+        {
+            // Closed by peer
+            return (0 < recv_len) ? recv_len : -1;
+        }
+        else if(EINTR == errno)
+        {
+            continue;
+        }
+        else if((EAGAIN != errno) && (EWOULDBLOCK != errno))
+        {
+            return -1;
+        }
+
+        net_watch_clear(handle, EPOLLIN);
+        if(0 >= (ret = net_watch_wait(handle, EPOLLIN, deadline_ms)))
+        {
+            return (0 == ret) ? recv_len : -1;
+        }
+    }
+
+    return recv_len;
+}
+
+int32_t plat_tcp_recv_some(handle_t handle, void *buf, uint32_t len, uint32_t timeout_ms)
+{
+    uint64_t deadline_ms = time_count_ms() + timeout_ms;
+    int ret = 0;
 
-        FD_ZERO(&fs);
-        FD_SET(handle, &fs);
+    if(0 > handle)
+        return -1;
 
-        ret = select(handle + 1, &fs, NULL, NULL, &tv);
+    // Read first, the socket is only waited on once it is drained
+    do
+    {
+        ret = recv(handle, buf, len, MSG_DONTWAIT);
         if(0 < ret)
         {
-            if(FD_ISSET(handle, &fs))
-            {
-                ret = recv(handle, buf + recv_len, len - recv_len, MSG_DONTWAIT);
-                if(0 < ret)
-                {
-                    recv_len += ret;
-                }
-                else if(0 > ret)
-                {
-                    recv_len = ret;
-                    break;
-                }
-            }
+            return ret;
+        }
+        else if(0 == ret)
+        {
+            return -1;
         }
-        else if(0 > ret)
+        else if(EINTR == errno)
         {
-            recv_len = ret;
-            break;
+            continue;
+        }
+        else if((EAGAIN != errno) && (EWOULDBLOCK != errno))
+        {
+            return -1;
         }
-    } while((recv_len < len) && (0 == countdown_is_expired(countdown_tmr)));
-    countdown_stop(countdown_tmr);
 
-    return recv_len;
+        net_watch_clear(handle, EPOLLIN);
+    } while(0 < (ret = net_watch_wait(handle, EPOLLIN, deadline_ms)));
+
+    return ret;
 }
 
 int32_t plat_tcp_disconnect(handle_t handle)
 {
     if(0 < handle)
     {
+        net_watch_del(handle);
         close(handle);
     }
 
@@ -207,26 +230,15 @@ int32_t plat_tcp_disconnect(handle_t handle)
 
 static boolean check_connect(int32_t fd, uint32_t timeout_ms)
 {
-    struct timeval tv;
-    fd_set         fs;
     socklen_t      len        = 0;
-    int32_t        ret        = 0;
     int32_t        sock_error = 0;
 
-    tv.tv_sec  = timeout_ms / 1000;
-    tv.tv_usec = (timeout_ms % 1000) * 1000;
-
-    FD_ZERO(&fs);
-    FD_SET(fd, &fs);
-    ret = select(fd + 1, NULL, &fs, NULL, &tv);
-    if (0 < ret) {
-        if (FD_ISSET(fd, &fs)) {
-            len = sizeof(sock_error);
-            if ((0 == getsockopt(fd, SOL_SOCKET, SO_ERROR, &sock_error, &len)) && (0 == sock_error)) {
-                return TRUE;
-            }
+    if (0 < net_watch_wait(fd, EPOLLOUT, time_count_ms() + timeout_ms)) {
+        len = sizeof(sock_error);
+        if ((0 == getsockopt(fd, SOL_SOCKET, SO_ERROR, &sock_error, &len)) && (0 == sock_error)) {
+            return TRUE;
         }
     }
 
     return FALSE;
-}
\ No newline at end of file
+}
@@ -161,6 +161,25 @@ int32_t mqtt_yield(void *client, uint32_t timeout_ms);
  */
 int32_t mqtt_publish(void *client, const uint8_t *topic, struct mqtt_message_t *message, uint32_t timeout_ms);
 
+/**
+ * @brief Reserve the send buffer for a QoS0 message，the payload is then encoded in place.
+ *
+ * @param client MQTT Client instance action handle
+ * @param topic Destination of push messages topic
+ * @param payload_size Room left for the payload
+ * @return uint8_t* Payload position in the send buffer，NULL if failed
+ */
+uint8_t *mqtt_publish_begin(void *client, const uint8_t *topic, uint32_t *payload_size);
+
+/**
+ * @brief Send the message reserved by mqtt_publish_begin，nothing else may use the client in between.
+ *
+ * @param client MQTT Client instance action handle
+ * @param payload_len Length of the payload encoded in place
+ * @return int32_t
+ */
+int32_t mqtt_publish_commit(void *client, uint32_t payload_len, uint32_t timeout_ms);
+
 int32_t mqtt_set_default_message_handler(void *client, mqtt_message_handler msg_handler, void *arg);
 
 /**
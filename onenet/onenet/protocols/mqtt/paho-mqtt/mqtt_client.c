@@ -22,6 +22,7 @@
 /* Local Definitions ( Constant and Macro )                                  */
 /*****************************************************************************/
 #define MAX_PACKET_ID 65535 /* according to the MQTT specification - do not change! */
+#define MAX_FIXED_HEADER 5  /* packet type byte plus at most 4 bytes of remaining length */
 
 /*****************************************************************************/
 /* Structures, Enum and Typedefs                                             */
@@ -32,6 +33,7 @@ typedef struct mqtt_client
     size_t         buf_size, readbuf_size;
     unsigned char *buf, *readbuf;
     unsigned int   keepAliveInterval;
+    int            pub_topic_len; /* topic reserved by mqtt_client_publish_begin, 0 - none */
     char           ping_outstanding;
     int            isconnected;
     int            cleansession;
@@ -77,12 +79,12 @@ static int getNextPacketId(mqtt_client* c)
     return c->next_packetid = (c->next_packetid == MAX_PACKET_ID) ? 1 : c->next_packetid + 1;
 }
 
-static int sendPacket(mqtt_client* c, int length, handle_t cd_handle)
+static int sendBuffer(mqtt_client* c, unsigned char* buf, int length, handle_t cd_handle)
 {
     int rc = FAILURE, sent = 0;
 
     do {
-        rc = c->ipstack->mqttwrite(c->ipstack->handle, &c->buf[sent], length, countdown_left(cd_handle));
+        rc = c->ipstack->mqttwrite(c->ipstack->handle, &buf[sent], length - sent, countdown_left(cd_handle));
 
         if (rc < 0)    // there was an error writing the data
         {
@@ -102,6 +104,11 @@ static int sendPacket(mqtt_client* c, int length, handle_t cd_handle)
     return rc;
 }
 
+static int sendPacket(mqtt_client* c, int length, handle_t cd_handle)
+{
+    return sendBuffer(c, c->buf, length, cd_handle);
+}
+
 void* mqtt_client_init(mqtt_network* network, unsigned char* sendbuf, size_t sendbuf_size, unsigned char* readbuf, size_t readbuf_size)
 {
     int          i;
@@ -144,66 +151,155 @@ void mqtt_client_deinit(void* client)
     }
 }
 
-static int decodePacket(mqtt_client* c, int* value, int timeout)
+static uint32_t rx_used(mqtt_network* n)
+{
+    return n->rx_tail - n->rx_head;
+}
+
+static unsigned char rx_peek(mqtt_network* n, uint32_t offset)
+{
+    return n->rx_ring[(n->rx_head + offset) & (MQTT_RX_RING_SIZE - 1)];
+}
+
+/* one read of whatever the transport has, up to the contiguous free space of the ring */
+static int rx_fill(mqtt_network* n, uint32_t timeout)
+{
+    uint32_t tail = 0;
+    uint32_t len  = 0;
+    int      rc   = 0;
+
+    if (0 == rx_used(n)) {
+        n->rx_head = n->rx_tail = 0;
+    }
+
+    tail = n->rx_tail & (MQTT_RX_RING_SIZE - 1);
+    len  = MQTT_RX_RING_SIZE - rx_used(n);
+
+    if (len > MQTT_RX_RING_SIZE - tail) {
+        len = MQTT_RX_RING_SIZE - tail;
+    }
+
+    if (0 < (rc = n->mqttread(n->handle, n->rx_ring + tail, len, timeout))) {
+        n->rx_tail += rc;
+    }
+
+    return rc;
+}
+
+static void rx_take(mqtt_network* n, unsigned char* buf, uint32_t len)
+{
+    uint32_t head  = n->rx_head & (MQTT_RX_RING_SIZE - 1);
+    uint32_t first = MQTT_RX_RING_SIZE - head;
+
+    if (first > len) {
+        first = len;
+    }
+
+    osl_memcpy(buf, n->rx_ring + head, first);
+    osl_memcpy(buf + first, n->rx_ring, len - first);
+    n->rx_head += len;
+}
+
+/* decode the fixed header in the ring without consuming it, returns its length, 0 - incomplete */
+static int rx_header(mqtt_network* n, int* value)
 {
     unsigned char i;
-    int           multiplier                       = 1;
-    int           len                              = 0;
+    int           multiplier                         = 1;
+    int           len                                = 1;
     const int     k_max_no_of_remaining_length_bytes = 4;
 
     *value = 0;
 
     do {
-        int rc = MQTTPACKET_READ_ERROR;
-
-        if (++len > k_max_no_of_remaining_length_bytes) {
-            rc = MQTTPACKET_READ_ERROR; /* bad data */
-            goto exit;
+        if (len > k_max_no_of_remaining_length_bytes) {
+            return MQTTPACKET_READ_ERROR; /* bad data */
         }
 
-        rc = c->ipstack->mqttread(c->ipstack->handle, &i, 1, timeout);
-
-        if (rc != 1) {
-            goto exit;
+        if (len >= rx_used(n)) {
+            return 0;
         }
 
+        i = rx_peek(n, len++);
         *value += (i & 127) * multiplier;
         multiplier *= 128;
     } while ((i & 128) != 0);
 
-exit:
     return len;
 }
 
-static int readPacket(mqtt_client* c, handle_t cd_handle)
+/* discard a packet larger than readbuf so the next one starts on a packet boundary, returns 0 - skipped */
+static int rx_skip(mqtt_client* c, int total, handle_t cd_handle)
 {
-    MQTTHeader header  = { 0 };
-    int        len     = 0;
-    int        rem_len = 0;
+    mqtt_network* n   = c->ipstack;
+    int           got = (rx_used(n) < (uint32_t)total) ? (int)rx_used(n) : total;
+    int           rc  = 0;
 
-    /* 1. read the header byte.  This has the packet type in it */
-    int rc = c->ipstack->mqttread(c->ipstack->handle, c->readbuf, 1, countdown_left(cd_handle));
+    n->rx_head += got;
 
-    if (rc != 1) {
-        goto exit;
+    while (got < total) {
+        int chunk = (total - got > (int)c->readbuf_size) ? (int)c->readbuf_size : total - got;
+
+        if (0 >= (rc = n->mqttread(n->handle, c->readbuf, chunk, countdown_left(cd_handle)))) {
+            return FAILURE; /* part of the packet is consumed, the stream can not be resumed */
+        }
+
+        got += rc;
     }
 
-    len = 1;
-    /* 2. read the remaining length.  This is variable in itself */
-    decodePacket(c, &rem_len, countdown_left(cd_handle));
-    len += MQTTPacket_encode(c->readbuf + 1, rem_len); /* put the original remaining length back into the buffer */
+    loge("drop packet of %d bytes, larger than the receive buffer", total);
+    return 0;
+}
+
+static int readPacket(mqtt_client* c, handle_t cd_handle)
+{
+    mqtt_network* n       = c->ipstack;
+    MQTTHeader    header  = { 0 };
+    int           len     = 0;
+    int           rem_len = 0;
+    int           rc      = 0;
+
+    /* 1. header byte and remaining length, parsed in the ring so a partial header stays buffered */
+    while (0 == (len = rx_header(n, &rem_len))) {
+        if (0 >= (rc = rx_fill(n, countdown_left(cd_handle)))) {
+            goto exit;
+        }
+    }
 
-    if (rem_len > (c->readbuf_size - len)) {
-        rc = BUFFER_OVERFLOW;
+    if (0 > len) {
+        rc = len;
         goto exit;
     }
 
-    /* 3. read the rest of the buffer using a callback to supply the rest of the data */
-    if (rem_len > 0 && (rc = c->ipstack->mqttread(c->ipstack->handle, c->readbuf + len, rem_len, countdown_left(cd_handle)) != rem_len)) {
-        rc = 0;
+    if (rem_len > (int)(c->readbuf_size - len)) {
+        rc = rx_skip(c, len + rem_len, cd_handle);
         goto exit;
     }
 
+    if (len + rem_len <= MQTT_RX_RING_SIZE) {
+        /* 2. wait for the whole packet before consuming it, back to back packets are already in the ring */
+        while (rx_used(n) < (uint32_t)(len + rem_len)) {
+            if (0 >= (rc = rx_fill(n, countdown_left(cd_handle)))) {
+                goto exit;
+            }
+        }
+
+        rx_take(n, c->readbuf, len + rem_len);
+    } else {
+        /* 3. larger than the ring: drain it and read the rest straight into the packet buffer */
+        int got = rx_used(n);
+
+        rx_take(n, c->readbuf, got);
+
+        while (got < len + rem_len) {
+            if (0 >= (rc = n->mqttread(n->handle, c->readbuf + got, len + rem_len - got, countdown_left(cd_handle)))) {
+                rc = FAILURE; /* part of the packet is consumed, the stream can not be resumed */
+                goto exit;
+            }
+
+            got += rc;
+        }
+    }
+
     header.byte = c->readbuf[0];
     rc          = header.bits.type;
 
@@ -775,6 +871,52 @@ exit:
     return rc;
 }
 
+unsigned char* mqtt_client_publish_begin(void* client, const char* topicName, uint32_t* payload_size)
+{
+    mqtt_client*   c   = (mqtt_client*)client;
+    int            len = strlen(topicName);
+    unsigned char* ptr = c->buf + MAX_FIXED_HEADER;
+
+    if (!c->isconnected || 0 == len || MAX_FIXED_HEADER + 2 + len >= c->buf_size) {
+        return NULL;
+    }
+
+    writeCString(&ptr, topicName);
+    c->pub_topic_len = len;
+    *payload_size    = c->buf_size - (ptr - c->buf);
+
+    return ptr;
+}
+
+int32_t mqtt_client_publish_commit(void* client, uint32_t payload_len, uint32_t timeout_ms)
+{
+    mqtt_client*   c          = (mqtt_client*)client;
+    int            rc         = FAILURE;
+    handle_t       pub_cd_hdl = 0;
+    MQTTHeader     header     = {0};
+    int            rem_len    = 2 + c->pub_topic_len + payload_len;
+    int            hdr_len    = MQTTPacket_len(rem_len) - rem_len;
+    unsigned char* ptr        = c->buf + MAX_FIXED_HEADER - hdr_len;
+
+    if (!c->isconnected || 0 == c->pub_topic_len || MAX_FIXED_HEADER + rem_len > c->buf_size) {
+        goto exit;
+    }
+
+    /* The header is right-aligned against the topic, so the packet starts up to 4 bytes into the buffer */
+    header.bits.type = PUBLISH;
+    ptr[0]           = header.byte;
+    MQTTPacket_encode(ptr + 1, rem_len);
+
+    pub_cd_hdl = countdown_start(timeout_ms);
+    rc         = sendBuffer(c, ptr, hdr_len + rem_len, pub_cd_hdl);
+    countdown_stop(pub_cd_hdl);
+
+exit:
+    c->pub_topic_len = 0;
+
+    return rc;
+}
+
 int32_t mqtt_client_disconnect(void* client, uint32_t timeout_ms)
 {
     mqtt_client* c             = (mqtt_client*)client;
@@ -839,7 +981,7 @@ void* mqtt_connect(const uint8_t* remote_addr, uint16_t remote_port, const uint8
     net_cb->disconnect = tls_disconnect;
 #else
     net_cb->handle     = plat_tcp_connect(remote_addr, remote_port, countdown_left(cd_hdl));
-    net_cb->mqttread   = plat_tcp_recv;
+    net_cb->mqttread   = plat_tcp_recv_some;
     net_cb->mqttwrite  = plat_tcp_send;
     net_cb->disconnect = plat_tcp_disconnect;
 #endif
@@ -939,6 +1081,42 @@ int32_t mqtt_publish(void* client, const uint8_t* topic, struct mqtt_message_t*
     return -1;
 }
 
+/**
+ * @brief Reserve the send buffer for a QoS0 message and return where its payload goes.
+ *
+ * The payload is encoded in place and sent by mqtt_publish_commit() without being copied.
+ * Nothing else may use the client in between.
+ *
+ * @param client MQTT Client instance action handle
+ * @param topic Destination of push messages topic
+ * @param payload_size Room left for the payload
+ * @return uint8_t* Payload position in the send buffer, NULL if not connected or the topic does not fit
+ */
+uint8_t* mqtt_publish_begin(void* client, const uint8_t* topic, uint32_t* payload_size)
+{
+    if (client) {
+        return mqtt_client_publish_begin(client, (const char*)topic, payload_size);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Send the message reserved by mqtt_publish_begin().
+ *
+ * @param client MQTT Client instance action handle
+ * @param payload_len Length of the payload encoded in place
+ * @return int32_t
+ */
+int32_t mqtt_publish_commit(void* client, uint32_t payload_len, uint32_t timeout_ms)
+{
+    if (client) {
+        return mqtt_client_publish_commit(client, payload_len, timeout_ms);
+    }
+
+    return -1;
+}
+
 int32_t mqtt_set_default_message_handler(void* client, mqtt_message_handler msg_handler, void* arg)
 {
     mqtt_client* c = (mqtt_client*)client;
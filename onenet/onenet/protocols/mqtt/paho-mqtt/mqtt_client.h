@@ -23,6 +23,15 @@ extern "C" {
 /*****************************************************************************/
 #define MAX_MESSAGE_HANDLERS 5
 
+/** Receive ring under the network callbacks, must be a power of 2 */
+#ifndef MQTT_RX_RING_SIZE
+#define MQTT_RX_RING_SIZE 1024
+#endif
+
+#if (MQTT_RX_RING_SIZE & (MQTT_RX_RING_SIZE - 1)) || (MQTT_RX_RING_SIZE < 8)
+#error "MQTT_RX_RING_SIZE must be a power of 2 and at least 8"
+#endif
+
 #define DefaultClient                                                                                                  \
     {                                                                                                                  \
         0, 0, 0, 0, NULL, NULL, 0, 0, 0                                                                                \
@@ -58,6 +67,7 @@ typedef struct mqtt_sub_ack_data
 typedef void (*message_handler)(void *, const uint8_t *, struct mqtt_message_t *);
 
 typedef int32_t (*net_write_callback)(handle_t, void *, uint32_t, uint32_t);
+/** Returns as soon as any data is available, up to len bytes. 0 - timeout；< 0 - error or closed by peer */
 typedef int32_t (*net_read_callback)(handle_t, void *, uint32_t, uint32_t);
 typedef int32_t (*net_disconnect_callback)(handle_t);
 
@@ -67,6 +77,8 @@ typedef struct mqtt_network
     net_read_callback       mqttread;
     net_write_callback      mqttwrite;
     net_disconnect_callback disconnect;
+    uint32_t                rx_head, rx_tail; /* free running, masked on access */
+    uint8_t                 rx_ring[MQTT_RX_RING_SIZE];
 } mqtt_network;
 
 /*****************************************************************************/
@@ -108,6 +120,21 @@ int32_t mqtt_client_connect(void *client, MQTTPacket_connectData *options, uint3
  */
 int32_t mqtt_client_publish(void *client, const char *topicName, struct mqtt_message_t *message, uint32_t timeout_ms);
 
+/** MQTT Publish in place - reserve the send buffer for a QoS0 publish with the given topic
+ *  @param client - the client object to use
+ *  @param topic - the topic to publish to
+ *  @param payload_size - room left for the payload
+ *  @return where the payload is to be encoded, NULL on failure
+ */
+unsigned char *mqtt_client_publish_begin(void *client, const char *topicName, uint32_t *payload_size);
+
+/** MQTT Publish in place - add the fixed header in front of the reserved topic and send the packet
+ *  @param client - the client object to use
+ *  @param payload_len - length of the payload encoded after the topic
+ *  @return success code
+ */
+int32_t mqtt_client_publish_commit(void *client, uint32_t payload_len, uint32_t timeout_ms);
+
 /** MQTT SetMessageHandler - set or remove a per topic message handler
  *  @param client - the client object to use
  *  @param topic_filter - the topic filter set the message handler for
@@ -65,7 +65,7 @@ static int wolfssl_recv(WOLFSSL *ssl, char *buf, int sz, void *ctx) {
   struct tls_t *net = (struct tls_t *)ctx;
   int32_t ret = 0;
 
-  if (0 == (ret = plat_tcp_recv(net->handle, buf, sz, net->recv_timeout))) {
+  if (0 == (ret = plat_tcp_recv_some(net->handle, buf, sz, net->recv_timeout))) {
     return -2; // WOLFSSL_CBIO_ERR_WANT_READ
   }
 
@@ -18,6 +18,7 @@
 #include "tm_onejson.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #if defined(SDK_USE_MQTTS)
@@ -84,26 +85,37 @@
 #define TM_TOPIC_PACK_DATA_POST_REPLY "/pack/post/reply"
 #define TM_TOPIC_HISTORY_DATA_POST_REPLY "/history/post/reply"
 #endif
+/** Requests are encoded behind their topic, which is assembled on the stack */
+#ifndef TM_TOPIC_LEN_MAX
+#define TM_TOPIC_LEN_MAX 128
+#endif
+
 /*****************************************************************************/
 /* Structures, Enum and Typedefs                                             */
 /*****************************************************************************/
-#define REPLY_STATUS_NONE 0
-#define REPLY_STATUS_WAIT 1
-#define REPLY_STATUS_RECEIVED 2
-struct tm_reply_info_t {
-  uint8_t reply_id[16];
-  int32_t reply_code;
+/**
+ * One outstanding request, matched to its reply by post ID. Async requests
+ * release the slot when their callback runs; synchronous ones (cb == NULL)
+ * keep it until the waiter has collected the result.
+ */
+struct tm_pending_t {
+  int32_t post_id; /** 0 - free slot */
+  uint64_t deadline_ms; /** No timer handle, so tracking a request allocates nothing */
+  tm_request_cb cb;
+  void *cb_arg;
   void *reply_data;
-  uint8_t resp_flag;
-  uint16_t reply_status;
-  uint8_t reply_as_raw;
+  int32_t result;
+  uint8_t as_raw;
+  uint8_t done;
 };
 
 struct tm_obj_t {
   struct tm_downlink_tbl_t downlink_tbl;
   uint8_t *topic_prefix;
   int32_t post_id;
-  struct tm_reply_info_t reply_info;
+  struct tm_pending_t pending[TM_INFLIGHT_MAX];
+  uint32_t inflight;
+  uint32_t window;
 #ifdef CONFIG_TM_GATEWAY 
   tm_subdev_cb subdev_callback;
 #endif
@@ -125,154 +137,384 @@ struct tm_obj_t g_tm_obj;
 /*****************************************************************************/
 /* Function Implementation                                                   */
 /*****************************************************************************/
-static uint8_t *construct_topic(const uint8_t *prefix, const uint8_t *suffix) {
-  logd("construct_topic prefix %s, suffix %s\n", prefix, suffix);
-  uint32_t topic_len = osl_strlen(prefix) + osl_strlen(suffix) + 1;
-  uint8_t *topic_buf = osl_malloc(topic_len);
+static int32_t get_post_id(void) {
+  if (0x7FFFFFFF == ++(g_tm_obj.post_id)) {
+    g_tm_obj.post_id = 1;
+  }
+
+  return g_tm_obj.post_id;
+}
 
-  if (topic_buf) {
-    osl_memset(topic_buf, 0, topic_len);
-    osl_strcat(topic_buf, prefix);
-    osl_strcat(topic_buf, suffix);
+static void tm_reply_data_free(void *reply_data, uint8_t as_raw) {
+  if (NULL == reply_data) {
+    return;
+  }
+  if (as_raw) {
+    osl_free(reply_data);
+  } else {
+    tm_data_delete(reply_data);
   }
+}
+
+static uint32_t deadline_left(uint64_t deadline_ms) {
+  uint64_t now = time_count_ms();
 
-  return topic_buf;
+  return (deadline_ms > now) ? (uint32_t)(deadline_ms - now) : 0;
 }
 
-static int32_t get_post_id(void) {
-  if (0x7FFFFFFF == ++(g_tm_obj.post_id)) {
-    g_tm_obj.post_id = 1;
+static struct tm_pending_t *pending_find(int32_t post_id) {
+  uint32_t i = 0;
+
+  for (i = 0; i < TM_INFLIGHT_MAX; i++) {
+    if (post_id == g_tm_obj.pending[i].post_id) {
+      return &g_tm_obj.pending[i];
+    }
   }
 
-  return g_tm_obj.post_id;
+  return NULL;
 }
 
-int32_t tm_send_response(const uint8_t *name, uint8_t *msg_id, int32_t msg_code,
-                         uint8_t as_raw, void *resp_data,
-                         uint32_t resp_data_len, uint32_t timeout_ms) {
-#if defined(SDK_USE_MQTTS) || defined(SDK_USE_NBIOT)
-  uint8_t *topic = NULL;
-#endif
+static void pending_release(struct tm_pending_t *pending) {
+  osl_memset(pending, 0, sizeof(struct tm_pending_t));
+  g_tm_obj.inflight--;
+}
+
+/**
+ * The slot is freed before the callback runs, so the callback may post the
+ * next request. Reply data is released by the SDK after the callback returns.
+ */
+static void pending_complete(struct tm_pending_t *pending, int32_t result,
+                             void *reply_data) {
+  tm_request_cb cb = pending->cb;
+  void *cb_arg = pending->cb_arg;
+  int32_t post_id = pending->post_id;
+  uint8_t as_raw = pending->as_raw;
+
+  if (NULL == cb) {
+    /** The waiter reads the reply after its message's arena is reset */
+    pending->result = result;
+    pending->reply_data =
+        as_raw ? reply_data : tm_onejson_data_persist(reply_data);
+    pending->done = 1;
+    return;
+  }
+
+  pending_release(pending);
+  cb(post_id, result, reply_data, cb_arg);
+  tm_reply_data_free(reply_data, as_raw);
+}
+
+static void pending_expire(void) {
+  uint32_t i = 0;
+
+  for (i = 0; i < TM_INFLIGHT_MAX; i++) {
+    struct tm_pending_t *pending = &g_tm_obj.pending[i];
+
+    if (0 != pending->post_id && 0 == pending->done &&
+        time_count_ms() >= pending->deadline_ms) {
+      loge("request %d timeout", pending->post_id);
+      pending_complete(pending, ERR_TIMEOUT, NULL);
+    }
+  }
+}
+
+static void pending_cancel_all(int32_t result) {
+  uint32_t i = 0;
+
+  for (i = 0; i < TM_INFLIGHT_MAX; i++) {
+    if (0 != g_tm_obj.pending[i].post_id && 0 == g_tm_obj.pending[i].done) {
+      pending_complete(&g_tm_obj.pending[i], result, NULL);
+    }
+  }
+}
+
+/**
+ * What goes into an outgoing message: a request carries params from write_cb
+ * or data, a reply (msg_id set) carries data.
+ */
+struct tm_message_t {
+  int32_t post_id;
+  const uint8_t *msg_id;
+  int32_t msg_code;
+  void *data;
+  uint8_t as_raw;
+  tm_params_write_cb write_cb;
+  void *write_arg;
+};
+
+static int32_t message_encode(uint8_t *buf, uint32_t size,
+                              const struct tm_message_t *msg) {
+  struct tm_onejson_writer_t writer;
+
+  tm_onejson_writer_init(&writer, buf, size);
+  if (msg->msg_id) {
+    tm_onejson_write_reply_begin(&writer, msg->msg_id, msg->msg_code);
+    if (msg->data) {
+      tm_onejson_write_key(&writer, (const int8_t *)"data");
+      tm_onejson_write_data(&writer, msg->data, msg->as_raw);
+    }
+    return tm_onejson_write_reply_end(&writer);
+  }
+
+  tm_onejson_write_request_begin(&writer, msg->post_id);
+  if (msg->write_cb) {
+    tm_onejson_write_key(&writer, (const int8_t *)"params");
+    tm_onejson_write_object_begin(&writer);
+    msg->write_cb(&writer, msg->write_arg);
+    tm_onejson_write_object_end(&writer);
+  } else if (msg->data) {
+    tm_onejson_write_key(&writer, (const int8_t *)"params");
+    tm_onejson_write_data(&writer, msg->data, msg->as_raw);
+  }
+
+  return tm_onejson_write_request_end(&writer);
+}
+
+/**
+ * Encode the message behind its topic in the MQTT send buffer and publish it
+ * from there, so sending costs no payload buffer and no second copy.
+ */
+static int32_t message_send(const uint8_t *name, const struct tm_message_t *msg,
+                            uint32_t timeout_ms) {
+  uint8_t topic[TM_TOPIC_LEN_MAX] = {0};
   uint8_t *payload = NULL;
-  uint32_t payload_len = 0;
+  uint32_t payload_size = 0;
+  int32_t payload_len = 0;
+  int32_t ret = ERR_OK;
+
+  if (TM_TOPIC_LEN_MAX <= osl_strlen(g_tm_obj.topic_prefix) + osl_strlen(name)) {
+    loge("topic longer than TM_TOPIC_LEN_MAX(%d)", TM_TOPIC_LEN_MAX);
+    return ERR_OVERFLOW;
+  }
+  osl_strcat(topic, g_tm_obj.topic_prefix);
+  osl_strcat(topic, name);
 
-  if (NULL == (payload = osl_malloc(SDK_PAYLOAD_LEN))) {
+#if defined(SDK_USE_MQTTS)
+  if (NULL == (payload = tm_mqtt_packet_begin(topic, &payload_size))) {
+    return ERR_NETWORK;
+  }
+#else
+  payload_size = SDK_PAYLOAD_LEN;
+  if (NULL == (payload = osl_malloc(payload_size))) {
     return ERR_IO;
   }
+#endif
 
-  osl_memset(payload, 0, SDK_PAYLOAD_LEN);
-  payload_len =
-      tm_onejson_pack_reply(payload, msg_id, msg_code, resp_data, as_raw);
+  payload_len = message_encode(payload, payload_size, msg);
+  if (0 > payload_len) {
+    loge("%s does not fit in %d bytes", name, payload_size);
+    ret = ERR_OVERFLOW;
+  }
 #if defined(SDK_USE_MQTTS)
-  topic = construct_topic(g_tm_obj.topic_prefix, name);
-  tm_mqtt_send_packet(topic, payload, payload_len, timeout_ms);
-  osl_free(topic);
-#elif defined(SDK_USE_COAP)
-  tm_coap_send_packet(NULL, payload, payload_len, timeout_ms);
+  else {
+    ret = tm_mqtt_packet_commit(payload_len, timeout_ms);
+  }
+#else
+  else {
+#if defined(SDK_USE_COAP)
+    ret = tm_coap_send_packet(msg->msg_id ? NULL : topic, payload, payload_len,
+                              timeout_ms);
 #elif defined(SDK_USE_NBIOT)
-  topic = construct_topic(g_tm_obj.topic_prefix, name);
-  tm_lwm2m_send_packet(topic, payload, payload_len, timeout_ms);
-  osl_free(topic);
+    ret = tm_lwm2m_send_packet(topic, payload, payload_len, timeout_ms);
 #endif
-
+  }
   osl_free(payload);
+#endif
 
-  return ERR_OK;
+  return ret;
 }
 
-#if defined(SDK_USE_MQTTS)
-static int32_t wait_post_reply(int32_t post_id, handle_t cd_hdl) {
-  uint8_t temp_id[16] = {0};
-  int32_t ret = ERR_TIMEOUT;
+int32_t tm_send_response(const uint8_t *name, uint8_t *msg_id, int32_t msg_code,
+                         uint8_t as_raw, void *resp_data,
+                         uint32_t resp_data_len, uint32_t timeout_ms) {
+  struct tm_message_t msg = {0};
 
-  osl_sprintf(temp_id, (const uint8_t *)"%d", post_id);
+  msg.msg_id = msg_id;
+  msg.msg_code = msg_code;
+  msg.data = resp_data;
+  msg.as_raw = as_raw;
+  message_send(name, &msg, timeout_ms);
 
-  do {
-    ret = tm_mqtt_step(countdown_left(cd_hdl));
+  if (NULL != resp_data && 0 == as_raw) {
+    tm_data_delete(resp_data);
+  }
 
-    if (0 > ret) {
-      loge("wait reply error");
+  return ERR_OK;
+}
+
+/**
+ * Publish a request and register it in the in-flight table. When the window
+ * is full, the network is driven until a slot frees up or the request's own
+ * deadline passes. Params come from write_cb when set, otherwise from data;
+ * non-raw data is consumed whether or not the send succeeds.
+ */
+static struct tm_pending_t *tm_request_submit(const uint8_t *name,
+                                              uint8_t as_raw, void *data,
+                                              tm_params_write_cb write_cb,
+                                              void *write_arg,
+                                              uint32_t timeout_ms,
+                                              tm_request_cb cb, void *cb_arg,
+                                              int32_t *err) {
+  struct tm_pending_t *pending = NULL;
+  struct tm_message_t msg = {0};
+  uint64_t deadline_ms = time_count_ms() + timeout_ms;
+  int32_t ret = ERR_OK;
+
+  while (g_tm_obj.inflight >= g_tm_obj.window) {
+    pending_expire();
+    if (g_tm_obj.inflight < g_tm_obj.window) {
       break;
-    } else {
-      if (REPLY_STATUS_RECEIVED == g_tm_obj.reply_info.reply_status) {
-        if (0 == osl_strcmp(temp_id, g_tm_obj.reply_info.reply_id)) {
-          g_tm_obj.reply_info.reply_status = REPLY_STATUS_NONE;
-          ret = ERR_OK;
-          break;
-        } else {
-          g_tm_obj.reply_info.reply_status = REPLY_STATUS_WAIT;
-        }
-      }
     }
-  } while (0 == countdown_is_expired(cd_hdl));
+    if (time_count_ms() >= deadline_ms) {
+      ret = ERR_RESOURCE_BUSY;
+      goto exit;
+    }
+#if defined(SDK_USE_MQTTS)
+    if (0 > tm_mqtt_step(deadline_left(deadline_ms))) {
+      ret = ERR_NETWORK;
+      goto exit;
+    }
+#endif
+  }
 
-  return ret;
+  if (NULL == (pending = pending_find(0))) {
+    ret = ERR_RESOURCE_BUSY;
+    goto exit;
+  }
+
+  pending->post_id = get_post_id();
+  msg.post_id = pending->post_id;
+  msg.data = data;
+  msg.as_raw = as_raw;
+  msg.write_cb = write_cb;
+  msg.write_arg = write_arg;
+  ret = message_send(name, &msg, deadline_left(deadline_ms));
+  if (ERR_OK != ret) {
+    pending->post_id = 0;
+    goto exit;
+  }
+  if (NULL != data && 0 == as_raw) {
+    tm_data_delete(data);
+  }
+
+  pending->deadline_ms = deadline_ms;
+  pending->cb = cb;
+  pending->cb_arg = cb_arg;
+  pending->as_raw = as_raw;
+  g_tm_obj.inflight++;
+  *err = ERR_OK;
+  return pending;
+
+exit:
+  if (NULL != data && 0 == as_raw) {
+    tm_data_delete(data);
+  }
+  *err = ret;
+  return NULL;
 }
+
+int32_t tm_send_request_async(const uint8_t *name, uint8_t as_raw, void *data,
+                              uint32_t data_len, uint32_t timeout_ms,
+                              tm_request_cb cb, void *cb_arg) {
+  struct tm_pending_t *pending = NULL;
+  int32_t post_id = 0;
+  int32_t ret = ERR_OK;
+
+  if (NULL == cb) {
+    if (NULL != data && 0 == as_raw) {
+      tm_data_delete(data);
+    }
+    return ERR_INVALID_PARAM;
+  }
+
+  pending = tm_request_submit(name, as_raw, data, NULL, NULL, timeout_ms, cb,
+                              cb_arg, &ret);
+  if (NULL == pending) {
+    return ret;
+  }
+  post_id = pending->post_id;
+#if !defined(SDK_USE_MQTTS)
+  /** CoAP and LwM2M replies do not come back through the table */
+  pending_complete(pending, ERR_OK, NULL);
 #endif
 
+  return post_id;
+}
+
 int32_t tm_send_request(const uint8_t *name, uint8_t as_raw, void *data,
                         uint32_t data_len, void **reply_data,
                         uint32_t *reply_data_len, uint32_t timeout_ms) {
-  uint8_t *topic = NULL;
-  uint8_t *payload = NULL;
-  uint32_t payload_len = 0;
-  int32_t post_id = get_post_id();
-  handle_t cd_hdl = 0;
+  struct tm_pending_t *pending = NULL;
   int32_t ret = ERR_OTHERS;
 
-  cd_hdl = countdown_start(timeout_ms);
-
-  if (NULL == (payload = osl_malloc(SDK_PAYLOAD_LEN))) {
-    return ERR_IO;
+  pending = tm_request_submit(name, as_raw, data, NULL, NULL, timeout_ms, NULL,
+                              NULL, &ret);
+  if (NULL == pending) {
+    return ret;
   }
 
-  osl_memset(payload, 0, SDK_PAYLOAD_LEN);
-  payload_len = tm_onejson_pack_request(payload, post_id, data, as_raw);
-  g_tm_obj.reply_info.reply_as_raw = as_raw;
-
-  topic = construct_topic(g_tm_obj.topic_prefix, name);
 #if defined(SDK_USE_MQTTS)
-  ret =
-      tm_mqtt_send_packet(topic, payload, payload_len, countdown_left(cd_hdl));
-  if (ERR_OK == ret) {
-    g_tm_obj.reply_info.reply_status = REPLY_STATUS_WAIT;
-    if (0 == wait_post_reply(post_id, cd_hdl)) {
-      // logd("reply err code: %d", g_tm_obj.reply_info.reply_code);
-      if (200 == g_tm_obj.reply_info.reply_code) {
-        logd("post data ok");
-        if (NULL != reply_data) {
-          *reply_data = g_tm_obj.reply_info.reply_data;
-        }
-        ret = ERR_OK;
-      } else {
-        ret = ERR_OTHERS;
-      }
-      g_tm_obj.reply_info.reply_data = NULL;
+  /** Async requests keep completing while this one is waited for */
+  while (0 == pending->done) {
+    pending_expire();
+    if (pending->done) {
+      break;
+    }
+    if (0 > tm_mqtt_step(deadline_left(pending->deadline_ms))) {
+      loge("wait reply error");
+      pending_complete(pending, ERR_NETWORK, NULL);
     }
-    g_tm_obj.reply_info.reply_code = 0;
-    g_tm_obj.reply_info.reply_as_raw = 0;
   }
 
-#elif defined(SDK_USE_COAP)
-  ret =
-      tm_coap_send_packet(topic, payload, payload_len, countdown_left(cd_hdl));
+  ret = pending->result;
   if (ERR_OK == ret) {
-    logd("tm_send_request ok.");
-  } else {
-    logd("tm_send_request failed.");
+    logd("post data ok");
   }
-#elif defined(SDK_USE_NBIOT)
-  ret =
-      tm_lwm2m_send_packet(topic, payload, payload_len, countdown_left(cd_hdl));
-  if (ERR_OK == ret) {
-    logd("tm_send_request ok.");
+  if (ERR_OK == ret && NULL != reply_data) {
+    *reply_data = pending->reply_data;
   } else {
-    logd("tm_send_request failed.");
+    tm_reply_data_free(pending->reply_data, pending->as_raw);
   }
+#else
+  logd("tm_send_request ok.");
+  ret = ERR_OK;
 #endif
+  pending_release(pending);
 
-  osl_free(topic);
-  osl_free(payload);
+  return ret;
+}
+
+int32_t tm_set_request_window(uint32_t window) {
+  if (0 == window || TM_INFLIGHT_MAX < window) {
+    return ERR_INVALID_PARAM;
+  }
+  g_tm_obj.window = window;
+
+  return ERR_OK;
+}
+
+uint32_t tm_requests_in_flight(void) { return g_tm_obj.inflight; }
+
+int32_t tm_wait_requests(uint32_t timeout_ms) {
+  handle_t cd_hdl = countdown_start(timeout_ms);
+  int32_t ret = ERR_OK;
+
+  while (0 < g_tm_obj.inflight) {
+    pending_expire();
+    if (0 == g_tm_obj.inflight) {
+      break;
+    }
+    if (countdown_is_expired(cd_hdl)) {
+      ret = ERR_TIMEOUT;
+      break;
+    }
+#if defined(SDK_USE_MQTTS)
+    if (0 > tm_mqtt_step(countdown_left(cd_hdl))) {
+      ret = ERR_NETWORK;
+      break;
+    }
+#endif
+  }
   countdown_stop(cd_hdl);
 
   return ret;
@@ -313,15 +555,8 @@ static void tm_prop_set(uint8_t *payload, uint32_t payload_len) {
 
 static void tm_prop_get(uint8_t *payload, uint32_t payload_len) {
   void *props_data = NULL;
-  uint8_t *reply_payload = NULL;
   uint8_t id[16] = {0};
 
-  if (NULL == (reply_payload = osl_malloc(SDK_PAYLOAD_LEN))) {
-    loge("prop set error, malloc failed.");
-    return;
-  }
-  osl_memset(reply_payload, 0, SDK_PAYLOAD_LEN);
-
   props_data = tm_onejson_parse_request(payload, payload_len, id, 0);
 
   if (NULL != props_data) {
@@ -346,17 +581,36 @@ static void tm_prop_get(uint8_t *payload, uint32_t payload_len) {
 
     tm_data_delete(props_data);
   }
-
-  osl_free(reply_payload);
 }
 
 static void tm_post_reply(uint8_t *payload, uint32_t payload_len) {
-  if (REPLY_STATUS_WAIT == g_tm_obj.reply_info.reply_status) {
-    g_tm_obj.reply_info.reply_data = tm_onejson_parse_reply(
-        payload, payload_len, g_tm_obj.reply_info.reply_id,
-        &g_tm_obj.reply_info.reply_code, g_tm_obj.reply_info.reply_as_raw);
-    g_tm_obj.reply_info.reply_status = REPLY_STATUS_RECEIVED;
+  struct tm_pending_t *pending = NULL;
+  uint8_t reply_id[16] = {0};
+  int32_t reply_code = 0;
+  int32_t post_id = 0;
+  void *reply_data = NULL;
+
+  if (0 == g_tm_obj.inflight) {
+    return;
+  }
+
+  reply_data =
+      tm_onejson_parse_reply(payload, payload_len, reply_id, &reply_code, 0);
+  post_id = atoi((const char *)reply_id);
+  pending = (0 < post_id) ? pending_find(post_id) : NULL;
+
+  if (NULL == pending || pending->done) {
+    /** Late reply of an expired request */
+    logd("drop reply %s", reply_id);
+    tm_reply_data_free(reply_data, 0);
+    return;
   }
+
+  if (pending->as_raw) {
+    reply_data = tm_onejson_data_to_raw(reply_data);
+  }
+  pending_complete(pending, (200 == reply_code) ? ERR_OK : ERR_OTHERS,
+                   reply_data);
 }
 
 #if 0
@@ -417,8 +671,8 @@ static int32_t check_action_by_topic(const uint8_t *action,
   return osl_strncmp(action, topic, osl_strlen(topic));
 }
 
-static int32_t tm_data_parse(const uint8_t *res_name, uint8_t *payload,
-                             uint32_t payload_len) {
+static int32_t tm_data_dispatch(const uint8_t *res_name, uint8_t *payload,
+                                uint32_t payload_len) {
   const uint8_t *action = res_name + osl_strlen(g_tm_obj.topic_prefix);
 
   if (0 == check_action_by_topic(action, (const uint8_t *)TM_TOPIC_PROP_SET)) {
@@ -479,8 +733,27 @@ static int32_t tm_data_parse(const uint8_t *res_name, uint8_t *payload,
   return 0;
 }
 
+/**
+ * Everything parsed from one downlink message is released in one go once the
+ * message has been handled, see tm_onejson_arena_begin().
+ */
+static int32_t tm_data_parse(const uint8_t *res_name, uint8_t *payload,
+                             uint32_t payload_len) {
+  int32_t ret = 0;
+
+  tm_onejson_arena_begin();
+  ret = tm_data_dispatch(res_name, payload, payload_len);
+  tm_onejson_arena_end();
+
+  return ret;
+}
+
 int32_t tm_init(struct tm_downlink_tbl_t *downlink_tbl) {
   osl_memset(&g_tm_obj, 0, sizeof(g_tm_obj));
+  if (ERR_OK != tm_onejson_arena_init(TM_ONEJSON_ARENA_SIZE)) {
+    return ERR_ALLOC;
+  }
+  g_tm_obj.window = TM_REQUEST_WINDOW;
   g_tm_obj.downlink_tbl.prop_tbl = downlink_tbl->prop_tbl;
   g_tm_obj.downlink_tbl.prop_tbl_size = downlink_tbl->prop_tbl_size;
   g_tm_obj.downlink_tbl.svc_tbl = downlink_tbl->svc_tbl;
@@ -496,6 +769,7 @@ int32_t tm_init(struct tm_downlink_tbl_t *downlink_tbl) {
 }
 
 int32_t tm_deinit(void) {
+  tm_onejson_arena_deinit();
 #if defined(SDK_USE_MQTTS)
   return tm_mqtt_deinit();
 #elif defined(SDK_USE_COAP)
@@ -575,6 +849,7 @@ int32_t tm_login(const uint8_t *product_id, const uint8_t *dev_name,
 }
 
 int32_t tm_logout(uint32_t timeout_ms) {
+  pending_cancel_all(ERR_NETWORK);
 
   if (g_tm_obj.topic_prefix) {
     osl_free(g_tm_obj.topic_prefix);
@@ -606,6 +881,42 @@ int32_t tm_post_event(void *event_data, uint32_t timeout_ms) {
                          NULL, NULL, timeout_ms);
 }
 
+int32_t tm_post_property_async(void *prop_data, uint32_t timeout_ms,
+                               tm_request_cb cb, void *cb_arg) {
+  return tm_send_request_async((const uint8_t *)TM_TOPIC_PROP_POST, 0,
+                               prop_data, 0, timeout_ms, cb, cb_arg);
+}
+
+int32_t tm_post_event_async(void *event_data, uint32_t timeout_ms,
+                            tm_request_cb cb, void *cb_arg) {
+  return tm_send_request_async((const uint8_t *)TM_TOPIC_EVENT_POST, 0,
+                               event_data, 0, timeout_ms, cb, cb_arg);
+}
+
+int32_t tm_post_property_stream_async(tm_params_write_cb write_cb,
+                                      void *write_arg, uint32_t timeout_ms,
+                                      tm_request_cb cb, void *cb_arg) {
+  struct tm_pending_t *pending = NULL;
+  int32_t post_id = 0;
+  int32_t ret = ERR_OK;
+
+  if (NULL == write_cb || NULL == cb) {
+    return ERR_INVALID_PARAM;
+  }
+
+  pending = tm_request_submit((const uint8_t *)TM_TOPIC_PROP_POST, 0, NULL,
+                              write_cb, write_arg, timeout_ms, cb, cb_arg, &ret);
+  if (NULL == pending) {
+    return ret;
+  }
+  post_id = pending->post_id;
+#if !defined(SDK_USE_MQTTS)
+  pending_complete(pending, ERR_OK, NULL);
+#endif
+
+  return post_id;
+}
+
 int32_t tm_get_desired_props(uint32_t timeout_ms) {
   void *prop_list = tm_data_array_create(g_tm_obj.downlink_tbl.prop_tbl_size);
   uint32_t i = 0;
@@ -670,7 +981,10 @@ int32_t tm_post_history_data(void *history_data, uint32_t timeout_ms) {
 
 int32_t tm_step(uint32_t timeout_ms) {
 #if defined(SDK_USE_MQTTS)
-  return tm_mqtt_step(timeout_ms);
+  int32_t ret = tm_mqtt_step(timeout_ms);
+
+  pending_expire();
+  return ret;
 #elif defined(SDK_USE_COAP)
   return tm_coap_step(timeout_ms);
 #elif defined(SDK_USE_NBIOT)
@@ -21,6 +21,16 @@ extern "C"
 /*****************************************************************************/
 /* External Definition ( Constant and Macro )                                */
 /*****************************************************************************/
+/** Size of the in-flight request table */
+#ifndef TM_INFLIGHT_MAX
+#define TM_INFLIGHT_MAX 16
+#endif
+
+/** Default number of requests allowed on the wire at once, see tm_set_request_window() */
+#ifndef TM_REQUEST_WINDOW
+#define TM_REQUEST_WINDOW 8
+#endif
+
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof(x[0]))
 #endif
@@ -85,6 +95,22 @@ extern "C"
         uint16_t              prop_tbl_size;
         uint16_t              svc_tbl_size;
     };
+
+    /**
+     * @brief Completion of an asynchronous request, called from tm_step() or any other call that drives the network
+     *
+     * @param post_id ID returned by the async call
+     * @param result ERR_OK - platform replied 200；ERR_OTHERS - other reply code；ERR_TIMEOUT - deadline passed；ERR_NETWORK - logged out
+     * @param reply_data Reply data, released by the SDK after the callback returns
+     */
+    typedef void (*tm_request_cb)(int32_t post_id, int32_t result, void* reply_data, void* arg);
+
+    struct tm_onejson_writer_t;
+
+    /**
+     * @brief Writes the members of a request's params straight into the send buffer, see tm_onejson_write_*() in tm_onejson.h
+     */
+    typedef int32_t (*tm_params_write_cb)(struct tm_onejson_writer_t* writer, void* arg);
     /*****************************************************************************/
     /* External Variables and Functions                                          */
     /*****************************************************************************/
@@ -119,6 +145,39 @@ extern "C"
     int32_t tm_post_property(void* prop_data, uint32_t timeout_ms);
     int32_t tm_post_event(void* event_data, uint32_t timeout_ms);
     int32_t tm_get_desired_props(uint32_t timeout_ms);
+
+    /**
+     * @brief Post without waiting for the reply. Up to the request window of posts may be outstanding, a full window blocks
+     * until a reply arrives or timeout_ms passes
+     *
+     * @param timeout_ms Deadline of the request, the callback gets ERR_TIMEOUT after it
+     * @return Post ID (> 0) - Sent, cb will be called exactly once；< 0 - Failed, cb is not called
+     */
+    int32_t tm_post_property_async(void* prop_data, uint32_t timeout_ms, tm_request_cb cb, void* cb_arg);
+    int32_t tm_post_event_async(void* event_data, uint32_t timeout_ms, tm_request_cb cb, void* cb_arg);
+    /**
+     * @brief Post properties written by write_cb while the request is encoded, no property tree is built
+     *
+     * @return Post ID (> 0) - Sent, cb will be called exactly once；< 0 - Failed, cb is not called
+     */
+    int32_t tm_post_property_stream_async(tm_params_write_cb write_cb, void* write_arg, uint32_t timeout_ms, tm_request_cb cb, void* cb_arg);
+    int32_t tm_send_request_async(const uint8_t* name, uint8_t as_raw, void* data, uint32_t data_len, uint32_t timeout_ms, tm_request_cb cb,
+                                  void* cb_arg);
+
+    /**
+     * @brief Set the number of requests allowed on the wire at once
+     *
+     * @param window 1 ~ TM_INFLIGHT_MAX
+     */
+    int32_t  tm_set_request_window(uint32_t window);
+    uint32_t tm_requests_in_flight(void);
+
+    /**
+     * @brief Drive the network until all outstanding requests complete
+     *
+     * @return 0 - All completed；ERR_TIMEOUT - Some still outstanding
+     */
+    int32_t tm_wait_requests(uint32_t timeout_ms);
     int32_t tm_delete_desired_props(uint32_t timeout_ms);
 
     /**
@@ -0,0 +1,264 @@
+/**
+ * @file tm_batch.c
+ * @brief Property batcher: coalesces property updates into one property post per flush window
+ */
+
+/*****************************************************************************/
+/* Includes                                                                  */
+/*****************************************************************************/
+#include "tm_batch.h"
+#include "tm_api.h"
+#include "tm_onejson.h"
+
+#include "err_def.h"
+#include "log.h"
+#include "plat_osl.h"
+#include "plat_time.h"
+
+#include <stdint.h>
+
+/*****************************************************************************/
+/* Local Definitions ( Constant and Macro )                                  */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Structures, Enum and Typedefs                                             */
+/*****************************************************************************/
+struct tm_batch_slot_t
+{
+    const struct tm_batch_prop_t* prop;
+    float64_t                     pending;
+    uint64_t                      pending_ts;
+    float64_t                     posted;
+    uint64_t                      posted_ts;
+    uint64_t                      posted_at_ms;
+    uint32_t                      posted_seq; // Flush that sent the posted value
+    uint8_t                       has_pending;
+    uint8_t                       has_posted;
+};
+
+struct tm_batch_obj_t
+{
+    struct tm_batch_slot_t* slots;
+    uint16_t                count;
+    uint32_t                window_ms;
+    uint32_t                timeout_ms;
+    uint32_t                pending_mask;
+    uint32_t                post_seq;
+    uint64_t                window_start_ms;
+};
+
+/*****************************************************************************/
+/* Local Function Prototype                                                  */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Local Variables                                                           */
+/*****************************************************************************/
+static struct tm_batch_obj_t g_batch;
+
+/*****************************************************************************/
+/* Global Variables                                                          */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/* Function Implementation                                                   */
+/*****************************************************************************/
+static int32_t batch_find(const uint8_t* name)
+{
+    uint16_t i = 0;
+
+    for (i = 0; i < g_batch.count; i++) {
+        if (0 == osl_strcmp(name, g_batch.slots[i].prop->name)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void batch_queue(uint16_t index, float64_t val, uint64_t timestamp)
+{
+    struct tm_batch_slot_t* slot = &g_batch.slots[index];
+
+    if (0 == g_batch.pending_mask) {
+        g_batch.window_start_ms = time_count_ms();
+    }
+    slot->pending     = val;
+    slot->pending_ts  = timestamp;
+    slot->has_pending = 1;
+    g_batch.pending_mask |= (1u << index);
+}
+
+static void batch_unqueue(uint16_t index)
+{
+    g_batch.slots[index].has_pending = 0;
+    g_batch.pending_mask &= ~(1u << index);
+}
+
+static int32_t batch_set(const uint8_t* name, float64_t val, uint64_t timestamp)
+{
+    struct tm_batch_slot_t* slot  = NULL;
+    int32_t                 index = batch_find(name);
+    float64_t               diff  = 0;
+
+    if (0 > index) {
+        return ERR_INVALID_PARAM;
+    }
+    slot = &g_batch.slots[index];
+
+    if (slot->has_posted && 0 <= slot->prop->deadband) {
+        diff = (val > slot->posted) ? (val - slot->posted) : (slot->posted - val);
+        if (diff <= slot->prop->deadband &&
+            (0 == slot->prop->refresh_ms || time_count_ms() - slot->posted_at_ms < slot->prop->refresh_ms)) {
+            // Back within the deadband: an update queued earlier in this window is stale too
+            batch_unqueue(index);
+            return ERR_OK;
+        }
+    }
+
+    batch_queue(index, val, timestamp);
+
+    return ERR_OK;
+}
+
+/**
+ * A failed post puts its values back in the queue unless a newer update has
+ * replaced them, so a change-only property is not lost until its next change.
+ * Slots posted again by a later flush are left alone, whatever that post's outcome.
+ */
+static void batch_post_done(int32_t post_id, int32_t result, void* reply_data, void* arg)
+{
+    uint32_t seq = (uint32_t)(uintptr_t)arg;
+    uint16_t i   = 0;
+
+    if (ERR_OK == result || NULL == g_batch.slots) {
+        return;
+    }
+
+    loge("batch post %d failed: %d", post_id, result);
+    for (i = 0; i < g_batch.count; i++) {
+        struct tm_batch_slot_t* slot = &g_batch.slots[i];
+
+        if (slot->has_posted && seq == slot->posted_seq) {
+            slot->has_posted = 0;
+            if (0 == slot->has_pending) {
+                batch_queue(i, slot->posted, slot->posted_ts);
+            }
+        }
+    }
+}
+
+/**
+ * Encodes the flushed values straight into the request as it is sent.
+ */
+static int32_t batch_write(struct tm_onejson_writer_t* writer, void* arg)
+{
+    uint32_t mask = (uint32_t)(uintptr_t)arg;
+    uint16_t i    = 0;
+
+    for (i = 0; i < g_batch.count; i++) {
+        struct tm_batch_slot_t* slot = &g_batch.slots[i];
+
+        if (0 == (mask & (1u << i))) {
+            continue;
+        }
+        if (TM_BATCH_TYPE_INT32 == slot->prop->type) {
+            tm_onejson_write_int32(writer, (const int8_t*)slot->prop->name, (int32_t)slot->posted, slot->posted_ts);
+        } else {
+            tm_onejson_write_float32(writer, (const int8_t*)slot->prop->name, (float32_t)slot->posted, slot->posted_ts);
+        }
+    }
+
+    return ERR_OK;
+}
+
+int32_t tm_batch_init(const struct tm_batch_prop_t* props, uint16_t count, uint32_t window_ms, uint32_t timeout_ms)
+{
+    uint16_t i = 0;
+
+    if (NULL == props || 0 == count || TM_BATCH_PROP_MAX < count) {
+        return ERR_INVALID_PARAM;
+    }
+
+    tm_batch_deinit();
+    if (NULL == (g_batch.slots = osl_malloc(count * sizeof(struct tm_batch_slot_t)))) {
+        return ERR_ALLOC;
+    }
+    osl_memset(g_batch.slots, 0, count * sizeof(struct tm_batch_slot_t));
+
+    for (i = 0; i < count; i++) {
+        g_batch.slots[i].prop = &props[i];
+    }
+    g_batch.count      = count;
+    g_batch.window_ms  = window_ms;
+    g_batch.timeout_ms = timeout_ms;
+
+    return ERR_OK;
+}
+
+void tm_batch_deinit(void)
+{
+    if (g_batch.slots) {
+        osl_free(g_batch.slots);
+    }
+    osl_memset(&g_batch, 0, sizeof(g_batch));
+}
+
+int32_t tm_batch_set_int32(const uint8_t* name, int32_t val, uint64_t timestamp)
+{
+    return batch_set(name, val, timestamp);
+}
+
+int32_t tm_batch_set_float(const uint8_t* name, float32_t val, uint64_t timestamp)
+{
+    return batch_set(name, val, timestamp);
+}
+
+int32_t tm_batch_step(void)
+{
+    if (0 == g_batch.pending_mask || time_count_ms() - g_batch.window_start_ms < g_batch.window_ms) {
+        return ERR_OK;
+    }
+
+    return tm_batch_flush();
+}
+
+int32_t tm_batch_flush(void)
+{
+    uint32_t mask = g_batch.pending_mask;
+    uint64_t now  = time_count_ms();
+    uint16_t i    = 0;
+    int32_t  ret  = ERR_OK;
+
+    if (0 == mask) {
+        return ERR_OK;
+    }
+    g_batch.post_seq++;
+
+    for (i = 0; i < g_batch.count; i++) {
+        struct tm_batch_slot_t* slot = &g_batch.slots[i];
+
+        if (0 == slot->has_pending) {
+            continue;
+        }
+
+        // Filter against the posted value from now on, a failed post re-queues it
+        slot->posted       = slot->pending;
+        slot->posted_ts    = slot->pending_ts;
+        slot->posted_at_ms = now;
+        slot->posted_seq   = g_batch.post_seq;
+        slot->has_posted   = 1;
+        slot->has_pending  = 0;
+    }
+    g_batch.pending_mask = 0;
+
+    ret = tm_post_property_stream_async(batch_write, (void*)(uintptr_t)mask, g_batch.timeout_ms, batch_post_done,
+                                        (void*)(uintptr_t)g_batch.post_seq);
+    if (0 > ret) {
+        batch_post_done(0, ret, NULL, (void*)(uintptr_t)g_batch.post_seq);
+        return ret;
+    }
+
+    return ERR_OK;
+}
@@ -0,0 +1,76 @@
+/**
+ * @file tm_batch.h
+ * @brief Property batcher: coalesces property updates into one property post per flush window
+ */
+
+#ifndef __TM_BATCH_H__
+#define __TM_BATCH_H__
+
+/*****************************************************************************/
+/* Includes                                                                  */
+/*****************************************************************************/
+#include "data_types.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /*****************************************************************************/
+    /* External Definition ( Constant and Macro )                                */
+    /*****************************************************************************/
+    /** At most this many properties, one bit each in the completion mask */
+#define TM_BATCH_PROP_MAX 32
+
+#define TM_BATCH_TYPE_INT32 0
+#define TM_BATCH_TYPE_FLOAT 1
+
+    /*****************************************************************************/
+    /* External Structures, Enum and Typedefs                                    */
+    /*****************************************************************************/
+    struct tm_batch_prop_t
+    {
+        const uint8_t* name;
+        uint8_t        type;       // TM_BATCH_TYPE_*
+        float64_t      deadband;   // Updates within deadband of the last posted value are dropped，0 - change only，< 0 - post every update
+        uint32_t       refresh_ms; // Post an unchanged value again after this long，0 - never
+    };
+
+    /*****************************************************************************/
+    /* External Variables and Functions                                          */
+    /*****************************************************************************/
+    /**
+     * @brief Batcher Initialization
+     *
+     * @param props Property filter table，must stay valid until tm_batch_deinit
+     * @param count Number of properties，at most TM_BATCH_PROP_MAX
+     * @param window_ms Updates are collected this long after the first one before they are posted together
+     * @param timeout_ms Reply timeout of each post
+     * @return 0 - Succeed；< 0 - Failed
+     */
+    int32_t tm_batch_init(const struct tm_batch_prop_t* props, uint16_t count, uint32_t window_ms, uint32_t timeout_ms);
+    void    tm_batch_deinit(void);
+
+    /**
+     * @brief Queue a property update，a newer update of the same property within the window replaces the older one
+     *
+     * @return 0 - Queued or filtered；ERR_INVALID_PARAM - Property not in the table
+     */
+    int32_t tm_batch_set_int32(const uint8_t* name, int32_t val, uint64_t timestamp);
+    int32_t tm_batch_set_float(const uint8_t* name, float32_t val, uint64_t timestamp);
+
+    /**
+     * @brief Post the queued updates once the window has elapsed，call from the main loop
+     */
+    int32_t tm_batch_step(void);
+
+    /**
+     * @brief Post the queued updates now
+     */
+    int32_t tm_batch_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
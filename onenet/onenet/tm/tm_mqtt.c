@@ -241,6 +241,14 @@ int32_t tm_mqtt_send_packet(const uint8_t *topic, uint8_t *payload,
   return mqtt_publish(g_mqtt_obj->client, topic, &msg, timeout_ms);
 }
 
+uint8_t *tm_mqtt_packet_begin(const uint8_t *topic, uint32_t *payload_size) {
+  return mqtt_publish_begin(g_mqtt_obj->client, topic, payload_size);
+}
+
+int32_t tm_mqtt_packet_commit(uint32_t payload_len, uint32_t timeout_ms) {
+  return mqtt_publish_commit(g_mqtt_obj->client, payload_len, timeout_ms);
+}
+
 int32_t tm_mqtt_step(uint32_t timeout_ms) {
   return mqtt_yield(g_mqtt_obj->client, timeout_ms);
 }
@@ -35,6 +35,9 @@ int32_t tm_mqtt_login(const uint8_t *product_id, const uint8_t *dev_name, const
 int32_t tm_mqtt_logout(uint32_t timeout_ms);
 int32_t tm_mqtt_step(uint32_t timeout_ms);
 int32_t tm_mqtt_send_packet(const uint8_t *topic, uint8_t *payload, uint32_t payload_len, uint32_t timeout_ms);
+/** Encode the payload straight into the send buffer: begin returns where it goes，commit sends it */
+uint8_t *tm_mqtt_packet_begin(const uint8_t *topic, uint32_t *payload_size);
+int32_t  tm_mqtt_packet_commit(uint32_t payload_len, uint32_t timeout_ms);
 
 #ifdef __cplusplus
 }
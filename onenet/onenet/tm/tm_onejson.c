@@ -22,9 +22,24 @@
 /* Local Definitions ( Constant and Macro )                                  */
 /*****************************************************************************/
 
+#define ARENA_ALIGN(x) (((x) + 7) & ~7u)
+
 /*****************************************************************************/
 /* Structures, Enum and Typedefs                                             */
 /*****************************************************************************/
+/**
+ * Bump allocator for the trees parsed from downlink messages. It only serves
+ * cJSON while a payload is being parsed; every other allocation, and any parse
+ * that does not fit, goes to the heap. Frees are routed by address, so trees
+ * mixing both kinds of nodes are deleted as usual.
+ */
+struct tm_onejson_arena_t {
+  uint8_t *buf;
+  uint32_t size;
+  uint32_t used;
+  uint32_t depth; // Nested message scopes，reset when the outermost one ends
+  uint8_t parsing;
+};
 
 /*****************************************************************************/
 /* Local Function Prototype                                                  */
@@ -33,6 +48,7 @@
 /*****************************************************************************/
 /* Local Variables                                                           */
 /*****************************************************************************/
+static struct tm_onejson_arena_t g_arena;
 
 /*****************************************************************************/
 /* Global Variables                                                          */
@@ -41,6 +57,81 @@
 /*****************************************************************************/
 /* Function Implementation                                                   */
 /*****************************************************************************/
+static uint8_t in_arena(void *ptr) {
+  return (g_arena.buf && (uint8_t *)ptr >= g_arena.buf &&
+          (uint8_t *)ptr < g_arena.buf + g_arena.size);
+}
+
+static void *arena_malloc(size_t size) {
+  void *ptr = NULL;
+
+  if (g_arena.parsing && ARENA_ALIGN(size) <= g_arena.size - g_arena.used) {
+    ptr = g_arena.buf + g_arena.used;
+    g_arena.used += ARENA_ALIGN(size);
+    return ptr;
+  }
+
+  return osl_malloc(size);
+}
+
+static void arena_free(void *ptr) {
+  if (!in_arena(ptr)) {
+    osl_free(ptr);
+  }
+}
+
+static cJSON *parse_payload(uint8_t *payload, uint32_t payload_len) {
+  cJSON *root = NULL;
+
+  g_arena.parsing = (0 < g_arena.depth);
+  root = cJSON_ParseWithLength((const char *)payload, payload_len);
+  g_arena.parsing = 0;
+
+  return root;
+}
+
+int32_t tm_onejson_arena_init(uint32_t size) {
+  cJSON_Hooks hooks = {arena_malloc, arena_free};
+
+  tm_onejson_arena_deinit();
+  if (NULL == (g_arena.buf = osl_malloc(size))) {
+    return ERR_ALLOC;
+  }
+  g_arena.size = size;
+  cJSON_InitHooks(&hooks);
+
+  return ERR_OK;
+}
+
+void tm_onejson_arena_deinit(void) {
+  if (g_arena.buf) {
+    cJSON_InitHooks(NULL);
+    osl_free(g_arena.buf);
+  }
+  osl_memset(&g_arena, 0, sizeof(g_arena));
+}
+
+void tm_onejson_arena_begin(void) { g_arena.depth++; }
+
+void tm_onejson_arena_end(void) {
+  if (0 < g_arena.depth && 0 == --g_arena.depth) {
+    g_arena.used = 0;
+  }
+}
+
+void *tm_onejson_data_persist(void *data) {
+  cJSON *copy = NULL;
+
+  if (NULL == data || !in_arena(data)) {
+    return data;
+  }
+  // Not parsing, so the copy comes from the heap
+  copy = cJSON_Duplicate((cJSON *)data, 1);
+  cJSON_Delete((cJSON *)data);
+
+  return copy;
+}
+
 void *tm_onejson_create_data(void) { return (void *)cJSON_CreateObject(); }
 
 void *tm_onejson_create_array(uint32_t size) {
@@ -278,30 +369,24 @@ void *tm_onejson_pack_props_and_events(void *data, const uint8_t *product_id,
 
 uint32_t tm_onejson_pack_request(uint8_t *payload, int32_t msg_id, void *params,
                                  uint8_t as_raw) {
-  cJSON *request = cJSON_CreateObject();
-  uint8_t *str = NULL;
-  uint8_t temp_id[16] = {0};
-
-  osl_sprintf(temp_id, (const uint8_t *)"%d", msg_id);
-
-  cJSON_AddStringToObject(request, "id", (const char *const)temp_id);
-
-  cJSON_AddStringToObject(request, "version", SDK_TM_VERSION);
+  struct tm_onejson_writer_t writer;
+  int32_t len = 0;
 
+  tm_onejson_writer_init(&writer, payload, SDK_PAYLOAD_LEN);
+  tm_onejson_write_request_begin(&writer, msg_id);
   if (params) {
-    if (as_raw)
-      cJSON_AddRawToObject(request, "params", params);
-    else
-      cJSON_AddItemToObject(request, "params", (cJSON *)params);
+    tm_onejson_write_key(&writer, (const int8_t *)"params");
+    tm_onejson_write_data(&writer, params, as_raw);
+    if (!as_raw) {
+      cJSON_Delete((cJSON *)params);
+    }
   }
 
-  // Add msg To OneJSON
-  if (NULL != (str = (uint8_t *)cJSON_PrintUnformatted(request))) {
-    ADD_MSG2PAYLOAD(payload, str);
-    SAFE_FREE(str);
+  if (0 > (len = tm_onejson_write_request_end(&writer))) {
+    loge("payload length more than the SDK_PAYLOAD_LEN(%d)", SDK_PAYLOAD_LEN);
+    return 0;
   }
-  cJSON_Delete(request);
-  return osl_strlen(payload);
+  return len;
 }
 
 void *tm_onejson_parse_request(uint8_t *payload, uint32_t payload_len,
@@ -310,7 +395,7 @@ void *tm_onejson_parse_request(uint8_t *payload, uint32_t payload_len,
   cJSON *item = NULL;
   void *params = NULL;
 
-  root = cJSON_ParseWithLength((const char *)payload, payload_len);
+  root = parse_payload(payload, payload_len);
   item = cJSON_GetObjectItem(root, "id");
 
   if (root != NULL && item != NULL) {
@@ -332,30 +417,24 @@ void *tm_onejson_parse_request(uint8_t *payload, uint32_t payload_len,
 
 uint32_t tm_onejson_pack_reply(uint8_t *payload, uint8_t *msg_id,
                                int32_t msg_code, void *data, uint8_t as_raw) {
-  cJSON *reply = cJSON_CreateObject();
-  uint8_t *temp_str = NULL;
-
-  cJSON_AddStringToObject(reply, "id", (const char *const)msg_id);
-  cJSON_AddNumberToObject(reply, "code", msg_code);
-  // TODO: Add msg Fields and test
-  // cJSON_AddStringToObject(reply, "msg", "succ");
+  struct tm_onejson_writer_t writer;
+  int32_t len = 0;
 
+  tm_onejson_writer_init(&writer, payload, SDK_PAYLOAD_LEN);
+  tm_onejson_write_reply_begin(&writer, msg_id, msg_code);
   if (data) {
-    if (as_raw) {
-      cJSON_AddRawToObject(reply, "data", data);
-    } else {
-      cJSON_AddItemToObject(reply, "data", (cJSON *)data);
+    tm_onejson_write_key(&writer, (const int8_t *)"data");
+    tm_onejson_write_data(&writer, data, as_raw);
+    if (!as_raw) {
+      cJSON_Delete((cJSON *)data);
     }
   }
 
-  if (NULL != (temp_str = (uint8_t *)cJSON_PrintUnformatted(reply))) {
-    osl_strcpy(payload, temp_str);
-    osl_free(temp_str);
+  if (0 > (len = tm_onejson_write_reply_end(&writer))) {
+    loge("payload length more than the SDK_PAYLOAD_LEN(%d)", SDK_PAYLOAD_LEN);
+    return 0;
   }
-
-  cJSON_Delete(reply);
-
-  return osl_strlen(payload);
+  return len;
 }
 
 void *tm_onejson_parse_reply(uint8_t *payload, uint32_t payload_len,
@@ -365,9 +444,10 @@ void *tm_onejson_parse_reply(uint8_t *payload, uint32_t payload_len,
   cJSON *item = NULL;
   void *data = NULL;
 
-  root = cJSON_ParseWithLength((const char *)payload, payload_len);
+  root = parse_payload(payload, payload_len);
+  item = cJSON_GetObjectItem(root, "code");
+  *msg_code = (NULL != item) ? item->valueint : 0;
   item = cJSON_GetObjectItem(root, "id");
-  *msg_code = cJSON_GetObjectItem(root, "code")->valueint;
 
   if (root != NULL && item != NULL) {
     osl_strcpy(msg_id, (const uint8_t *)item->valuestring);
@@ -388,13 +468,24 @@ void *tm_onejson_parse_reply(uint8_t *payload, uint32_t payload_len,
   return data;
 }
 
+void *tm_onejson_data_to_raw(void *data) {
+  uint8_t *raw = NULL;
+
+  if (NULL != data) {
+    raw = (uint8_t *)cJSON_PrintUnformatted((cJSON *)data);
+    cJSON_Delete((cJSON *)data);
+  }
+
+  return raw;
+}
+
 int tm_onejson_parse_method(uint8_t *payload, uint32_t payload_len,
                             uint8_t *method) {
   cJSON *root = NULL;
   cJSON *item = NULL;
   int ret = ERR_INVALID_DATA;
 
-  root = cJSON_ParseWithLength((const char *)payload, payload_len);
+  root = parse_payload(payload, payload_len);
   CHECK_EXPR_GOTO(root == NULL, _END, "cJSON_ParseWithLength failed");
 
   item = cJSON_GetObjectItem(root, "method");
@@ -408,3 +499,245 @@ _END:
 
   return ret;
 }
+
+static int32_t writer_put(struct tm_onejson_writer_t *writer,
+                          const uint8_t *str, uint32_t len) {
+  // Keep one byte for the terminator so the buffer can be logged as a string
+  if (writer->overflow || writer->len + len >= writer->size) {
+    writer->overflow = 1;
+    return ERR_OVERFLOW;
+  }
+  osl_memcpy(writer->buf + writer->len, str, len);
+  writer->len += len;
+  writer->buf[writer->len] = '\0';
+
+  return ERR_OK;
+}
+
+static int32_t writer_put_str(struct tm_onejson_writer_t *writer,
+                              const char *str) {
+  return writer_put(writer, (const uint8_t *)str, osl_strlen((const uint8_t *)str));
+}
+
+static int32_t writer_put_quoted(struct tm_onejson_writer_t *writer,
+                                 const uint8_t *str) {
+  uint8_t esc[8] = {0};
+  const uint8_t *run = str;
+
+  writer_put_str(writer, "\"");
+  for (; *str; str++) {
+    if ('"' != *str && '\\' != *str && 0x20 <= *str) {
+      continue;
+    }
+    writer_put(writer, run, str - run);
+    run = str + 1;
+    switch (*str) {
+    case '"':
+      writer_put_str(writer, "\\\"");
+      break;
+    case '\\':
+      writer_put_str(writer, "\\\\");
+      break;
+    case '\b':
+      writer_put_str(writer, "\\b");
+      break;
+    case '\f':
+      writer_put_str(writer, "\\f");
+      break;
+    case '\n':
+      writer_put_str(writer, "\\n");
+      break;
+    case '\r':
+      writer_put_str(writer, "\\r");
+      break;
+    case '\t':
+      writer_put_str(writer, "\\t");
+      break;
+    default:
+      osl_sprintf(esc, (const uint8_t *)"\\u%04x", *str);
+      writer_put_str(writer, (const char *)esc);
+      break;
+    }
+  }
+  writer_put(writer, run, str - run);
+
+  return writer_put_str(writer, "\"");
+}
+
+/** Same text cJSON prints for a number, so both encoders produce identical payloads */
+static int32_t writer_put_number(struct tm_onejson_writer_t *writer,
+                                 float64_t val) {
+  uint8_t num[32] = {0};
+  float64_t check = 0;
+
+  if (val != val || 0 != val - val) {
+    return writer_put_str(writer, "null");
+  }
+  osl_sprintf(num, (const uint8_t *)"%1.15g", val);
+  if (1 != osl_sscanf(num, (const uint8_t *)"%lg", &check) || check != val) {
+    osl_sprintf(num, (const uint8_t *)"%1.17g", val);
+  }
+
+  return writer_put_str(writer, (const char *)num);
+}
+
+void tm_onejson_writer_init(struct tm_onejson_writer_t *writer, uint8_t *buf,
+                            uint32_t size) {
+  osl_memset(writer, 0, sizeof(struct tm_onejson_writer_t));
+  writer->buf = buf;
+  writer->size = size;
+  writer->first = 1;
+  if (0 < size) {
+    buf[0] = '\0';
+  }
+}
+
+int32_t tm_onejson_write_key(struct tm_onejson_writer_t *writer,
+                             const int8_t *name) {
+  if (!writer->first) {
+    writer_put_str(writer, ",");
+  }
+  writer->first = 0;
+  writer_put_quoted(writer, (const uint8_t *)name);
+
+  return writer_put_str(writer, ":");
+}
+
+int32_t tm_onejson_write_object_begin(struct tm_onejson_writer_t *writer) {
+  writer->first = 1;
+
+  return writer_put_str(writer, "{");
+}
+
+int32_t tm_onejson_write_object_end(struct tm_onejson_writer_t *writer) {
+  // The enclosing object now has this one as a member
+  writer->first = 0;
+
+  return writer_put_str(writer, "}");
+}
+
+int32_t tm_onejson_write_data(struct tm_onejson_writer_t *writer, void *data,
+                              uint8_t as_raw) {
+  int32_t room = writer->size - writer->len;
+
+  if (as_raw) {
+    return writer_put_str(writer, (const char *)data);
+  }
+  if (writer->overflow || 0 >= room ||
+      !cJSON_PrintPreallocated((cJSON *)data,
+                               (char *)(writer->buf + writer->len), room, 0)) {
+    writer->overflow = 1;
+    return ERR_OVERFLOW;
+  }
+  writer->len += osl_strlen(writer->buf + writer->len);
+  writer->first = 0;
+
+  return ERR_OK;
+}
+
+static int32_t write_member_end(struct tm_onejson_writer_t *writer,
+                                int64_t ts_in_ms) {
+  uint8_t num[24] = {0};
+
+  if (ts_in_ms) {
+    tm_onejson_write_key(writer, (const int8_t *)"time");
+    osl_sprintf(num, (const uint8_t *)"%lld", (long long)ts_in_ms);
+    writer_put_str(writer, (const char *)num);
+  }
+
+  return tm_onejson_write_object_end(writer);
+}
+
+static void write_member_begin(struct tm_onejson_writer_t *writer,
+                               const int8_t *name) {
+  tm_onejson_write_key(writer, name);
+  tm_onejson_write_object_begin(writer);
+  tm_onejson_write_key(writer, (const int8_t *)"value");
+}
+
+int32_t tm_onejson_write_bool(struct tm_onejson_writer_t *writer,
+                              const int8_t *name, boolean val,
+                              int64_t ts_in_ms) {
+  write_member_begin(writer, name);
+  writer_put_str(writer, val ? "true" : "false");
+
+  return write_member_end(writer, ts_in_ms);
+}
+
+int32_t tm_onejson_write_int32(struct tm_onejson_writer_t *writer,
+                               const int8_t *name, int32_t val,
+                               int64_t ts_in_ms) {
+  uint8_t num[16] = {0};
+
+  write_member_begin(writer, name);
+  osl_sprintf(num, (const uint8_t *)"%d", val);
+  writer_put_str(writer, (const char *)num);
+
+  return write_member_end(writer, ts_in_ms);
+}
+
+int32_t tm_onejson_write_number(struct tm_onejson_writer_t *writer,
+                                const int8_t *name, float64_t val,
+                                int64_t ts_in_ms) {
+  write_member_begin(writer, name);
+  writer_put_number(writer, val);
+
+  return write_member_end(writer, ts_in_ms);
+}
+
+int32_t tm_onejson_write_float32(struct tm_onejson_writer_t *writer,
+                                 const int8_t *name, float32_t val,
+                                 int64_t ts_in_ms) {
+  return tm_onejson_write_number(writer, name, float32_to_float64(val),
+                                 ts_in_ms);
+}
+
+int32_t tm_onejson_write_string(struct tm_onejson_writer_t *writer,
+                                const int8_t *name, const int8_t *val,
+                                int64_t ts_in_ms) {
+  write_member_begin(writer, name);
+  writer_put_quoted(writer, (const uint8_t *)val);
+
+  return write_member_end(writer, ts_in_ms);
+}
+
+int32_t tm_onejson_write_request_begin(struct tm_onejson_writer_t *writer,
+                                       int32_t msg_id) {
+  uint8_t temp_id[16] = {0};
+
+  osl_sprintf(temp_id, (const uint8_t *)"%d", msg_id);
+
+  tm_onejson_write_object_begin(writer);
+  tm_onejson_write_key(writer, (const int8_t *)"id");
+  writer_put_quoted(writer, temp_id);
+  tm_onejson_write_key(writer, (const int8_t *)"version");
+
+  return writer_put_quoted(writer, (const uint8_t *)SDK_TM_VERSION);
+}
+
+/**
+ * @return Payload length；ERR_OVERFLOW - The buffer was too small
+ */
+int32_t tm_onejson_write_request_end(struct tm_onejson_writer_t *writer) {
+  tm_onejson_write_object_end(writer);
+
+  return writer->overflow ? ERR_OVERFLOW : (int32_t)writer->len;
+}
+
+int32_t tm_onejson_write_reply_begin(struct tm_onejson_writer_t *writer,
+                                     const uint8_t *msg_id, int32_t msg_code) {
+  uint8_t code[16] = {0};
+
+  osl_sprintf(code, (const uint8_t *)"%d", msg_code);
+
+  tm_onejson_write_object_begin(writer);
+  tm_onejson_write_key(writer, (const int8_t *)"id");
+  writer_put_quoted(writer, msg_id);
+  tm_onejson_write_key(writer, (const int8_t *)"code");
+
+  return writer_put_str(writer, (const char *)code);
+}
+
+int32_t tm_onejson_write_reply_end(struct tm_onejson_writer_t *writer) {
+  return tm_onejson_write_request_end(writer);
+}
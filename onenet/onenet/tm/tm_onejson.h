@@ -24,13 +24,40 @@ extern "C" {
 #define TM_ONEJSON_PAYLOAD_TYPE_REQUEST 0
 #define TM_ONEJSON_PAYLOAD_TYPE_REPLY   1
 
+/** Arena for the trees parsed from one downlink message，a message that does not fit is parsed on the heap */
+#ifndef TM_ONEJSON_ARENA_SIZE
+#define TM_ONEJSON_ARENA_SIZE (16 * 1024)
+#endif
+
 /*****************************************************************************/
 /* External Structures, Enum and Typedefs                                    */
 /*****************************************************************************/
+/**
+ * Streaming writer, encodes OneJSON straight into a caller supplied buffer
+ * without building a cJSON tree or touching the heap.
+ */
+struct tm_onejson_writer_t {
+  uint8_t *buf;
+  uint32_t size;
+  uint32_t len;
+  uint8_t first;    // No member written yet in the current object
+  uint8_t overflow; // Buffer ran out, everything after is dropped
+};
 
 /*****************************************************************************/
 /* External Variables and Functions                                          */
 /*****************************************************************************/
+/**
+ * Downlink parsing: payloads parsed between begin and end come from the arena
+ * and are released at once by the outermost end. Strings read from them are
+ * only valid until then，tm_onejson_data_persist() copies a tree out.
+ */
+int32_t tm_onejson_arena_init(uint32_t size);
+void    tm_onejson_arena_deinit(void);
+void    tm_onejson_arena_begin(void);
+void    tm_onejson_arena_end(void);
+void   *tm_onejson_data_persist(void *data);
+
 void *tm_onejson_create_data(void);
 void *tm_onejson_create_array(uint32_t size);
 void *tm_onejson_create_struct(void);
@@ -65,8 +92,30 @@ void *   tm_onejson_parse_request(uint8_t *payload, uint32_t payload_len, uint8_
 uint32_t tm_onejson_pack_reply(uint8_t *payload, uint8_t *msg_id, int32_t msg_code, void *data, uint8_t as_raw);
 void *   tm_onejson_parse_reply(uint8_t *payload, uint32_t payload_len, uint8_t *msg_id, int32_t *msg_code,
                                 uint8_t as_raw);
+void *   tm_onejson_data_to_raw(void *data);
 int tm_onejson_parse_method(uint8_t *payload, uint32_t payload_len, uint8_t *method);
 
+void    tm_onejson_writer_init(struct tm_onejson_writer_t *writer, uint8_t *buf, uint32_t size);
+int32_t tm_onejson_write_key(struct tm_onejson_writer_t *writer, const int8_t *name);
+int32_t tm_onejson_write_object_begin(struct tm_onejson_writer_t *writer);
+int32_t tm_onejson_write_object_end(struct tm_onejson_writer_t *writer);
+int32_t tm_onejson_write_data(struct tm_onejson_writer_t *writer, void *data, uint8_t as_raw);
+
+/** Write a "name":{"value":val,"time":ts_in_ms} member，time is left out when ts_in_ms is 0 */
+int32_t tm_onejson_write_bool(struct tm_onejson_writer_t *writer, const int8_t *name, boolean val, int64_t ts_in_ms);
+int32_t tm_onejson_write_int32(struct tm_onejson_writer_t *writer, const int8_t *name, int32_t val, int64_t ts_in_ms);
+int32_t tm_onejson_write_number(struct tm_onejson_writer_t *writer, const int8_t *name, float64_t val, int64_t ts_in_ms);
+int32_t tm_onejson_write_float32(struct tm_onejson_writer_t *writer, const int8_t *name, float32_t val, int64_t ts_in_ms);
+int32_t tm_onejson_write_string(struct tm_onejson_writer_t *writer, const int8_t *name, const int8_t *val, int64_t ts_in_ms);
+
+/** {"id":"msg_id","version":"1.0" ... }，params go in between as tm_onejson_write_key("params") and a value */
+int32_t tm_onejson_write_request_begin(struct tm_onejson_writer_t *writer, int32_t msg_id);
+int32_t tm_onejson_write_request_end(struct tm_onejson_writer_t *writer);
+
+/** {"id":"msg_id","code":msg_code ... }，data goes in between as tm_onejson_write_key("data") and a value */
+int32_t tm_onejson_write_reply_begin(struct tm_onejson_writer_t *writer, const uint8_t *msg_id, int32_t msg_code);
+int32_t tm_onejson_write_reply_end(struct tm_onejson_writer_t *writer);
+
 #ifdef __cplusplus
 }
 #endif
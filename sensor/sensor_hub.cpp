@@ -0,0 +1,394 @@
+/**
+ * @file sensor_hub.cpp
+ * @brief 传感器汇集实现
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include "sensor_hub.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+//epoll 事件的 data.u32：低位为插件下标，高位区分设备 fd 与定时器
+#define SENSOR_TAG_TIMER    0x40000000u
+#define SENSOR_TAG_WAKE     0x80000000u
+#define SENSOR_TAG_RETRY    0x80000001u
+#define SENSOR_MAX_EVENTS   16
+
+/*****************************************************************************/
+/* 局部函数                                                                  */
+/*****************************************************************************/
+static void sensor_set_timer(int fd, int firstMs, int periodMs)
+{
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = firstMs / 1000;
+    spec.it_value.tv_nsec = (firstMs % 1000) * 1000000L;
+    if(firstMs == 0)
+    {
+        spec.it_value.tv_nsec = 1;     //全为0会停止定时器，立即触发一次
+    }
+    spec.it_interval.tv_sec = periodMs / 1000;
+    spec.it_interval.tv_nsec = (periodMs % 1000) * 1000000L;
+    timerfd_settime(fd, 0, &spec, NULL);
+}
+
+static void sensor_drain(int fd)
+{
+    uint64_t n;
+    while(::read(fd, &n, sizeof(n)) == static_cast<ssize_t>(sizeof(n)))
+    {
+    }
+}
+
+/*****************************************************************************/
+/* 函数定义                                                                  */
+/*****************************************************************************/
+int64_t sensorNowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+std::string sensorDeviceNode(const char *className)
+{
+    std::string classDir = std::string("/sys/class/") + className;
+    DIR *dir = opendir(classDir.c_str());
+    struct dirent *entry;
+    std::string node;
+
+    if(!dir)
+    {
+        return node;
+    }
+    while(node.empty() && (entry = readdir(dir)) != NULL)
+    {
+        char buf[512];
+        std::string path;
+        ssize_t n;
+        int fd;
+
+        if(entry->d_name[0] == '.')
+        {
+            continue;
+        }
+        path = classDir + "/" + entry->d_name + "/uevent";
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+        {
+            continue;
+        }
+        n = ::read(fd, buf, sizeof(buf) - 1);
+        ::close(fd);
+        if(n <= 0)
+        {
+            continue;
+        }
+        buf[n] = '\0';
+
+        const char *p = strstr(buf, "DEVNAME=");
+        if(p)
+        {
+            p += strlen("DEVNAME=");
+            node = std::string("/dev/") + std::string(p, strcspn(p, "\n"));
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+SensorHub::SensorHub()
+    : nextId(1), epollFd(-1), wakeFd(-1), retryFd(-1)
+{
+    memset(latestSample, 0, sizeof(latestSample));
+    memset(hasLatest, 0, sizeof(hasLatest));
+}
+
+SensorHub::~SensorHub()
+{
+    stop();
+}
+
+void SensorHub::addPlugin(std::unique_ptr<SensorPlugin> plugin)
+{
+    std::unique_ptr<Source> source(new Source);
+    source->plugin = std::move(plugin);
+    source->timerFd = -1;
+    source->opened = false;
+    sources.push_back(std::move(source));
+}
+
+int SensorHub::subscribe(Subscriber callback, unsigned typeMask)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    Subscription sub;
+    sub.id = nextId++;
+    sub.mask = typeMask;
+    sub.callback = callback;
+    subscriptions.push_back(sub);
+    return sub.id;
+}
+
+void SensorHub::unsubscribe(int id)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for(size_t i = 0; i < subscriptions.size(); i++)
+    {
+        if(subscriptions[i].id == id)
+        {
+            subscriptions.erase(subscriptions.begin() + i);
+            break;
+        }
+    }
+}
+
+bool SensorHub::start()
+{
+    struct epoll_event ev;
+    bool all = true;
+
+    if(thread.joinable())
+    {
+        return missing().empty();
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    retryFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if(epollFd < 0 || wakeFd < 0 || retryFd < 0)
+    {
+        perror("sensor hub");
+        stop();
+        return false;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = SENSOR_TAG_WAKE;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+    ev.data.u32 = SENSOR_TAG_RETRY;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, retryFd, &ev);
+    sensor_set_timer(retryFd, SENSOR_HUB_RETRY_MS, SENSOR_HUB_RETRY_MS);
+
+    //启动前打开设备，调用方可立即得到缺失的设备
+    for(size_t i = 0; i < sources.size(); i++)
+    {
+        all = attach(i) && all;
+    }
+
+    thread = std::thread(&SensorHub::run, this);
+    return all;
+}
+
+void SensorHub::stop()
+{
+    if(thread.joinable())
+    {
+        uint64_t one = 1;
+        if(::write(wakeFd, &one, sizeof(one)) < 0)
+        {
+            perror("sensor hub wake");
+        }
+        thread.join();
+    }
+    for(size_t i = 0; i < sources.size(); i++)
+    {
+        detach(i);
+    }
+    if(retryFd >= 0) ::close(retryFd);
+    if(wakeFd >= 0) ::close(wakeFd);
+    if(epollFd >= 0) ::close(epollFd);
+    retryFd = wakeFd = epollFd = -1;
+}
+
+std::vector<std::string> SensorHub::missing() const
+{
+    std::vector<std::string> names;
+    for(size_t i = 0; i < sources.size(); i++)
+    {
+        if(!sources[i]->opened)
+        {
+            names.push_back(sources[i]->plugin->name());
+        }
+    }
+    return names;
+}
+
+bool SensorHub::latest(int type, SensorSample *sample) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if(type < 0 || type >= SENSOR_TYPE_COUNT || !hasLatest[type])
+    {
+        return false;
+    }
+    *sample = latestSample[type];
+    return true;
+}
+
+/* 打开插件并加入 epoll；不支持 poll 的 fd（epoll_ctl 返回 EPERM）改用定时器。
+   可 poll 的设备打开后已有的采样即为可读，不需要额外的首次读取 */
+bool SensorHub::attach(size_t index)
+{
+    Source &src = *sources[index];
+    struct epoll_event ev;
+    int fd;
+
+    if(src.opened)
+    {
+        return true;
+    }
+    if(!src.plugin->open())
+    {
+        return false;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = static_cast<uint32_t>(index);
+    fd = src.plugin->fd();
+    if(fd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        src.timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        if(src.timerFd < 0)
+        {
+            src.plugin->close();
+            return false;
+        }
+        ev.data.u32 = SENSOR_TAG_TIMER | static_cast<uint32_t>(index);
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, src.timerFd, &ev);
+        sensor_set_timer(src.timerFd, 0, src.plugin->periodMs());
+    }
+    src.opened = true;
+    return true;
+}
+
+void SensorHub::detach(size_t index)
+{
+    Source &src = *sources[index];
+    if(!src.opened)
+    {
+        return;
+    }
+    if(src.timerFd >= 0)
+    {
+        ::close(src.timerFd);      //关闭后自动从 epoll 中移除
+        src.timerFd = -1;
+    }
+    if(epollFd >= 0 && src.plugin->fd() >= 0)
+    {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, src.plugin->fd(), NULL);
+    }
+    src.plugin->close();
+    src.opened = false;
+}
+
+void SensorHub::readSource(size_t index)
+{
+    Source &src = *sources[index];
+
+    scratch.clear();
+    if(src.plugin->read(scratch) < 0)
+    {
+        fprintf(stderr, "sensor hub: %s read failed, reopening later\n", src.plugin->name());
+        detach(index);
+        return;
+    }
+    for(size_t i = 0; i < scratch.size(); i++)
+    {
+        publish(scratch[i]);
+    }
+}
+
+/* 更新最近采样后通知订阅者，回调在锁外执行，回调中可以订阅或退订 */
+void SensorHub::publish(const SensorSample &sample)
+{
+    std::vector<Subscription> targets;
+
+    if(sample.type < 0 || sample.type >= SENSOR_TYPE_COUNT)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        latestSample[sample.type] = sample;
+        hasLatest[sample.type] = true;
+        for(size_t i = 0; i < subscriptions.size(); i++)
+        {
+            if(subscriptions[i].mask & SENSOR_MASK(sample.type))
+            {
+                targets.push_back(subscriptions[i]);
+            }
+        }
+    }
+    for(size_t i = 0; i < targets.size(); i++)
+    {
+        targets[i].callback(sample);
+    }
+}
+
+void SensorHub::run()
+{
+    struct epoll_event events[SENSOR_MAX_EVENTS];
+
+    for(;;)
+    {
+        int n = epoll_wait(epollFd, events, SENSOR_MAX_EVENTS, -1);
+        if(n < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            perror("sensor hub epoll_wait");
+            return;
+        }
+
+        for(int i = 0; i < n; i++)
+        {
+            uint32_t tag = events[i].data.u32;
+            if(tag == SENSOR_TAG_WAKE)
+            {
+                return;
+            }
+            if(tag == SENSOR_TAG_RETRY)
+            {
+                sensor_drain(retryFd);
+                for(size_t k = 0; k < sources.size(); k++)
+                {
+                    attach(k);
+                }
+                continue;
+            }
+
+            size_t index = tag & ~SENSOR_TAG_TIMER;
+            if(index >= sources.size() || !sources[index]->opened)
+            {
+                continue;   //同一批事件中已被关闭
+            }
+            if(tag & SENSOR_TAG_TIMER)
+            {
+                sensor_drain(sources[index]->timerFd);
+            }
+            else if(events[i].events & (EPOLLERR | EPOLLHUP))
+            {
+                detach(index);
+                continue;
+            }
+            readSource(index);
+        }
+    }
+}
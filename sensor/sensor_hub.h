@@ -0,0 +1,133 @@
+/**
+ * @file sensor_hub.h
+ * @brief 传感器汇集：所有传感器在一个 epoll 线程中读取，带时间戳的采样按类型分发给订阅者
+ *
+ * 每种传感器是一个插件（SensorPlugin）：可 poll 的设备 fd 直接加入 epoll，
+ * 不支持 poll 的设备由 timerfd 按插件给出的周期触发读取；打开失败的插件定期重试。
+ * 订阅回调在汇集线程中执行，界面程序需自行转到界面线程。
+ */
+
+#ifndef __SENSOR_HUB_H__
+#define __SENSOR_HUB_H__
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+#define SENSOR_HUB_RETRY_MS         5000    //未找到的设备重新打开的间隔
+#define SENSOR_HUB_DEFAULT_PERIOD   1000    //不支持 poll 的设备默认读取周期(ms)
+
+/*****************************************************************************/
+/* 类型定义                                                                  */
+/*****************************************************************************/
+enum SensorType
+{
+    SENSOR_LIGHT = 0,       //光照强度 lx
+    SENSOR_TEMPERATURE,     //温度 ℃
+    SENSOR_HUMIDITY,        //相对湿度 %RH
+    SENSOR_TYPE_COUNT
+};
+
+#define SENSOR_MASK(type)   (1u << (type))
+#define SENSOR_MASK_ALL     ((1u << SENSOR_TYPE_COUNT) - 1)
+
+struct SensorSample
+{
+    int type;               //SensorType
+    float value;
+    int64_t timestampNs;    //采样时刻（CLOCK_MONOTONIC）
+    const char *source;     //产生采样的插件名称
+};
+
+/* 传感器插件，新增传感器只需实现该接口并加入 SensorHub */
+class SensorPlugin
+{
+public:
+    virtual ~SensorPlugin() {}
+
+    virtual const char *name() const = 0;
+    virtual bool open() = 0;                //查找并打开设备，失败时稍后重试
+    virtual void close() = 0;
+    virtual int fd() const = 0;             //可加入 epoll 的 fd，返回 -1 或 poll 不被支持时按周期读取
+    virtual int periodMs() const { return SENSOR_HUB_DEFAULT_PERIOD; }
+
+    //读取采样追加到 out，暂无数据返回 0，设备出错返回 -1（关闭后重试）
+    virtual int read(std::vector<SensorSample> &out) = 0;
+};
+
+class SensorHub
+{
+public:
+    typedef std::function<void(const SensorSample &)> Subscriber;
+
+    SensorHub();
+    ~SensorHub();
+
+    void addPlugin(std::unique_ptr<SensorPlugin> plugin);  //须在 start() 之前调用
+
+    //订阅指定类型的采样，返回订阅编号；回调在汇集线程中执行，不应阻塞
+    int subscribe(Subscriber callback, unsigned typeMask = SENSOR_MASK_ALL);
+    void unsubscribe(int id);
+
+    //打开各插件并启动汇集线程，返回启动时全部插件是否都已打开
+    bool start();
+    void stop();
+
+    std::vector<std::string> missing() const;          //当前未打开的插件
+    bool latest(int type, SensorSample *sample) const; //每种类型最近一次采样
+
+private:
+    struct Source
+    {
+        std::unique_ptr<SensorPlugin> plugin;
+        int timerFd;
+        std::atomic<bool> opened;
+    };
+
+    struct Subscription
+    {
+        int id;
+        unsigned mask;
+        Subscriber callback;
+    };
+
+    bool attach(size_t index);
+    void detach(size_t index);
+    void readSource(size_t index);
+    void publish(const SensorSample &sample);
+    void run();
+
+    std::vector<std::unique_ptr<Source> > sources;
+    std::vector<SensorSample> scratch;     //汇集线程的读取缓冲
+
+    mutable std::mutex lock;                //保护订阅列表和最近采样
+    std::vector<Subscription> subscriptions;
+    SensorSample latestSample[SENSOR_TYPE_COUNT];
+    bool hasLatest[SENSOR_TYPE_COUNT];
+    int nextId;
+
+    int epollFd;
+    int wakeFd;
+    int retryFd;
+    std::thread thread;
+};
+
+/* 由 /sys/class/<className> 下设备的 uevent 得到设备节点路径，未找到返回空字符串 */
+std::string sensorDeviceNode(const char *className);
+
+/* 取 CLOCK_MONOTONIC 时间，与驱动采样时间戳同一时钟 */
+int64_t sensorNowNs();
+
+#endif
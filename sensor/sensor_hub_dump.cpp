@@ -0,0 +1,88 @@
+/**
+ * @file sensor_hub_dump.cpp
+ * @brief 打印传感器汇集收到的全部采样，用于在开发板上检查驱动和插件
+ *
+ * 用法: sensor_hub_dump [-n 采样数]
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include "sensor_hub.h"
+#include "sensor_plugins.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*****************************************************************************/
+/* 局部变量                                                                  */
+/*****************************************************************************/
+static volatile sig_atomic_t dump_stop;
+static std::atomic<long> dump_count;
+
+static const char *const dump_type_names[SENSOR_TYPE_COUNT] = {
+    "light", "temperature", "humidity"
+};
+
+/*****************************************************************************/
+/* 局部函数                                                                  */
+/*****************************************************************************/
+static void dump_on_signal(int sig)
+{
+    (void)sig;
+    dump_stop = 1;
+}
+
+/*****************************************************************************/
+/* 函数定义                                                                  */
+/*****************************************************************************/
+int main(int argc, char *argv[])
+{
+    long limit = 0;
+    int opt;
+
+    while((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'n': limit = strtol(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-n count]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    SensorHub hub;
+    sensorAddBoardPlugins(hub);
+    hub.subscribe([](const SensorSample &s)
+    {
+        //采样时间戳到收到的延迟，反映驱动缓存和汇集线程的时效
+        int64_t age = sensorNowNs() - s.timestampNs;
+        printf("%-8s %-12s %10.2f  t=%lld.%06lld  age=%.1fms\n", s.source, dump_type_names[s.type], s.value,
+               (long long)(s.timestampNs / 1000000000LL), (long long)(s.timestampNs % 1000000000LL / 1000),
+               age / 1e6);
+        fflush(stdout);
+        dump_count++;
+    });
+
+    signal(SIGINT, dump_on_signal);
+    signal(SIGTERM, dump_on_signal);
+
+    if(!hub.start())
+    {
+        std::vector<std::string> missing = hub.missing();
+        for(size_t i = 0; i < missing.size(); i++)
+        {
+            fprintf(stderr, "%s not found, retrying every %d ms\n", missing[i].c_str(), SENSOR_HUB_RETRY_MS);
+        }
+    }
+
+    while(!dump_stop && (limit <= 0 || dump_count < limit))
+    {
+        usleep(100000);
+    }
+    hub.stop();
+    return 0;
+}
@@ -0,0 +1,169 @@
+/**
+ * @file sensor_plugins.cpp
+ * @brief 开发板上的传感器插件实现
+ */
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include "sensor_plugins.h"
+#include "../driver/bh1750/bh1750.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+/*****************************************************************************/
+/* 宏定义                                                                  */
+/*****************************************************************************/
+//与 dht11 驱动一致
+#define DHT11_IOC_MAGIC     'k'
+#define DHT11_READ_DATA     _IOWR(DHT11_IOC_MAGIC, 1, unsigned char)
+
+/*****************************************************************************/
+/* 局部函数                                                                  */
+/*****************************************************************************/
+/* 优先按 sysfs 中的设备类查找节点，udev 规则改名后仍能找到 */
+static int sensor_open_node(const char *className, const char *fallback, int flags)
+{
+    std::string node = sensorDeviceNode(className);
+    int fd = -1;
+
+    if(!node.empty())
+    {
+        fd = ::open(node.c_str(), flags | O_CLOEXEC);
+    }
+    if(fd < 0)
+    {
+        fd = ::open(fallback, flags | O_CLOEXEC);
+    }
+    return fd;
+}
+
+static SensorSample sensor_sample(int type, float value, int64_t timestampNs, const char *source)
+{
+    SensorSample s;
+    s.type = type;
+    s.value = value;
+    s.timestampNs = timestampNs;
+    s.source = source;
+    return s;
+}
+
+/*****************************************************************************/
+/* BH1750                                                                  */
+/*****************************************************************************/
+Bh1750Plugin::Bh1750Plugin()
+    : devFd(-1)
+{
+}
+
+Bh1750Plugin::~Bh1750Plugin()
+{
+    close();
+}
+
+bool Bh1750Plugin::open()
+{
+    devFd = sensor_open_node("bh1750", "/dev/bh1750", O_RDONLY | O_NONBLOCK);
+    return devFd >= 0;
+}
+
+void Bh1750Plugin::close()
+{
+    if(devFd >= 0)
+    {
+        ::close(devFd);
+        devFd = -1;
+    }
+}
+
+int Bh1750Plugin::read(std::vector<SensorSample> &out)
+{
+    struct bh1750_sample sample;
+    ssize_t n;
+
+    memset(&sample, 0, sizeof(sample));
+    n = ::read(devFd, &sample, sizeof(sample));
+    if(n < 0)
+    {
+        return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+    }
+
+    if(n == static_cast<ssize_t>(sizeof(sample)))
+    {
+        out.push_back(sensor_sample(SENSOR_LIGHT, sample.lux_milli / 1000.0f,
+                                    static_cast<int64_t>(sample.timestamp_ns), name()));
+    }
+    else if(n == sizeof(unsigned short))
+    {
+        //旧版驱动只返回原始计数
+        unsigned short raw;
+        memcpy(&raw, &sample, sizeof(raw));
+        out.push_back(sensor_sample(SENSOR_LIGHT, raw / 1.2f, sensorNowNs(), name()));
+    }
+    else
+    {
+        return 0;
+    }
+    return 1;
+}
+
+/*****************************************************************************/
+/* DHT11                                                                   */
+/*****************************************************************************/
+Dht11Plugin::Dht11Plugin()
+    : devFd(-1)
+{
+}
+
+Dht11Plugin::~Dht11Plugin()
+{
+    close();
+}
+
+bool Dht11Plugin::open()
+{
+    devFd = sensor_open_node("DHT11", "/dev/dht11", O_RDWR);
+    return devFd >= 0;
+}
+
+void Dht11Plugin::close()
+{
+    if(devFd >= 0)
+    {
+        ::close(devFd);
+        devFd = -1;
+    }
+}
+
+int Dht11Plugin::read(std::vector<SensorSample> &out)
+{
+    unsigned char data[5];
+    int64_t now;
+
+    if(ioctl(devFd, DHT11_READ_DATA, data) < 0)
+    {
+        return errno == EINTR ? 0 : -1;
+    }
+    if(data[4] != 1)
+    {
+        return 0;   //驱动尚无有效结果
+    }
+
+    now = sensorNowNs();
+    out.push_back(sensor_sample(SENSOR_TEMPERATURE, data[2] + data[3] * 0.1f, now, name()));
+    out.push_back(sensor_sample(SENSOR_HUMIDITY, data[0] + data[1] * 0.1f, now, name()));
+    return 2;
+}
+
+/*****************************************************************************/
+/* 函数定义                                                                  */
+/*****************************************************************************/
+void sensorAddBoardPlugins(SensorHub &hub)
+{
+    hub.addPlugin(std::unique_ptr<SensorPlugin>(new Bh1750Plugin));
+    hub.addPlugin(std::unique_ptr<SensorPlugin>(new Dht11Plugin));
+}
@@ -0,0 +1,55 @@
+/**
+ * @file sensor_plugins.h
+ * @brief 开发板上的传感器插件：BH1750 光照、DHT11 温湿度
+ */
+
+#ifndef __SENSOR_PLUGINS_H__
+#define __SENSOR_PLUGINS_H__
+
+/*****************************************************************************/
+/* 头文件                                                                  */
+/*****************************************************************************/
+#include "sensor_hub.h"
+
+/*****************************************************************************/
+/* 类型定义                                                                  */
+/*****************************************************************************/
+/* BH1750：驱动支持 poll，每个新采样唤醒一次；旧版驱动不支持 poll 时按周期读取2字节原始值 */
+class Bh1750Plugin : public SensorPlugin
+{
+public:
+    Bh1750Plugin();
+    ~Bh1750Plugin();
+
+    const char *name() const { return "BH1750"; }
+    bool open();
+    void close();
+    int fd() const { return devFd; }
+    int read(std::vector<SensorSample> &out);
+
+private:
+    int devFd;
+};
+
+/* DHT11：驱动只提供 ioctl 读取缓存结果，按驱动的刷新周期读取 */
+class Dht11Plugin : public SensorPlugin
+{
+public:
+    Dht11Plugin();
+    ~Dht11Plugin();
+
+    const char *name() const { return "DHT11"; }
+    bool open();
+    void close();
+    int fd() const { return -1; }
+    int periodMs() const { return 2000; }
+    int read(std::vector<SensorSample> &out);
+
+private:
+    int devFd;
+};
+
+/* 加入开发板上的全部传感器 */
+void sensorAddBoardPlugins(SensorHub &hub);
+
+#endif